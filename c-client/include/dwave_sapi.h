@@ -827,6 +827,13 @@ typedef struct sapi_Solver sapi_Solver;
 */
 typedef struct sapi_SubmittedProblem sapi_SubmittedProblem;
 
+/**
+* \brief sapi completion queue struct.
+*
+* use sapi_freeCompletionQueue function to release sapi_CompletionQueue pointer.
+*/
+typedef struct sapi_CompletionQueue sapi_CompletionQueue;
+
 /**
 * \brief sapi quantum solver property's coupler struct.
 *
@@ -1292,6 +1299,58 @@ typedef struct sapi_VariablesRep
   size_t len;
 } sapi_VariablesRep;
 
+/**
+* \brief sapi global configuration struct, used by sapi_globalInitEx.
+*
+* http_threads number of threads running HTTP response callbacks
+* answer_threads number of threads delivering answers and problem notifications
+* problems_per_submission maximum number of problems sent in one submission request
+* ids_per_status_query maximum number of problem IDs sent in one status query
+* max_active_requests maximum number of concurrent HTTP requests per shared problem manager, i.e. for
+*   all remote connections with the same url, token and proxy_url (see sapi_remoteConnection)
+* answer_prefetches maximum number of answers downloaded ahead of time per shared problem manager: when
+*   problems complete, their answers are fetched into the answer cache before they are asked for.
+*   Zero (the default) turns prefetching off; only turn it on if the answers of most problems are used,
+*   since prefetches take request slots away from submissions and status queries.
+*
+* Zero selects the library default.  A nonzero problems_per_submission, ids_per_status_query or
+* max_active_requests is a fixed limit.  With the default, the limit starts at the value in the table
+* below and adapts up to 50, 500 and 16 respectively while the server keeps up.
+*
+* Each field can be overridden with an environment variable, which takes precedence over the value
+* passed to sapi_globalInitEx.  Environment values that are not positive integers are ignored.
+*
+*    +-------------------------+--------+---------------+-------------------------------------+
+*    |          Field          | Range  | Default value |        Environment variable         |
+*    +=========================+========+===============+=====================================+
+*    |      http_threads       |  >= 0  |       2       | DWAVE_SAPI_HTTP_THREADS             |
+*    +-------------------------+--------+---------------+-------------------------------------+
+*    |     answer_threads      |  >= 0  |       2       | DWAVE_SAPI_ANSWER_THREADS           |
+*    +-------------------------+--------+---------------+-------------------------------------+
+*    | problems_per_submission |  >= 0  |      20       | DWAVE_SAPI_PROBLEMS_PER_SUBMISSION  |
+*    +-------------------------+--------+---------------+-------------------------------------+
+*    |  ids_per_status_query   |  >= 0  |      100      | DWAVE_SAPI_IDS_PER_STATUS_QUERY     |
+*    +-------------------------+--------+---------------+-------------------------------------+
+*    |   max_active_requests   |  >= 0  |       6       | DWAVE_SAPI_MAX_ACTIVE_REQUESTS      |
+*    +-------------------------+--------+---------------+-------------------------------------+
+*    |    answer_prefetches    |  >= 0  |       0       | DWAVE_SAPI_ANSWER_PREFETCHES        |
+*    +-------------------------+--------+---------------+-------------------------------------+
+*/
+typedef struct sapi_GlobalConfig
+{
+  int http_threads;
+  int answer_threads;
+  int problems_per_submission;
+  int ids_per_status_query;
+  int max_active_requests;
+  int answer_prefetches;
+} sapi_GlobalConfig;
+
+/**
+* \brief sapi_GlobalConfig default value (all library defaults).
+*/
+DWAVE_SAPI extern const sapi_GlobalConfig SAPI_GLOBAL_DEFAULT_CONFIG;
+
 
 /* function */
 
@@ -1302,6 +1361,21 @@ typedef struct sapi_VariablesRep
 */
 DWAVE_SAPI sapi_Code sapi_globalInit();
 
+/**
+* \brief sapi global initialization function with resource limits.
+*
+* Same as sapi_globalInit but sizes the library's thread pools and request limits according to config
+* (see sapi_GlobalConfig).  config may be NULL, which is equivalent to SAPI_GLOBAL_DEFAULT_CONFIG.
+* Initialization is reference counted.  If the library is already initialized, the configuration in use
+* is kept: a NULL config is accepted, and a non-NULL config must match the configuration in use after
+* environment overrides.
+*
+* \param config global configuration.
+* \return sapi error code.  SAPI_ERR_INVALID_PARAMETER if any field of config is negative, or if the
+*         library is already initialized with a different configuration.
+*/
+DWAVE_SAPI sapi_Code sapi_globalInitEx(const sapi_GlobalConfig* config);
+
 /**
 * \brief sapi global cleanup function.
 *
@@ -1342,9 +1416,46 @@ DWAVE_SAPI sapi_Connection* sapi_localConnection();
 *
 * use sapi_freeConnection function to release the sapi_Connection pointer that
 * this function returns.
+*
+* Connections opened with the same url, token and proxy_url share their request queue,
+* status polling and request limits (see sapi_GlobalConfig), so opening many of them
+* doesn't multiply the load on the server.
 */
 DWAVE_SAPI sapi_Code sapi_remoteConnection(const char* url, const char* token, const char* proxy_url, sapi_Connection** remote_connection, char* err_msg);
 
+/**
+* \brief sapi remote connection with a problem journal.
+*
+* Same as sapi_remoteConnection, but the IDs of problems submitted through the connection are recorded
+* in the journal file at journal_path until their answers have been retrieved or the problems have been
+* freed.  If the process crashes, open a connection with the same journal again and pass the IDs from
+* sapi_journalProblemIds to sapi_addProblems to reattach to the problems that were still outstanding,
+* instead of submitting them again.
+*
+* Connections share a problem manager only if their journal_path is the same too.  A journal file
+* stays open until sapi_globalCleanup; it must only be used by one process at a time, and only for
+* connections with the same url, token and proxy_url.
+*
+* \param journal_path path of the journal file, created if it doesn't exist.  NULL or an empty
+*        string: no journal, as for sapi_remoteConnection.
+* \return sapi error code.  SAPI_ERR_INVALID_PARAMETER if the journal file can't be created, isn't a
+*         journal, or is already used by connections with a different url, token or proxy_url.
+*
+* See sapi_remoteConnection for the other parameters.
+*/
+DWAVE_SAPI sapi_Code sapi_remoteConnectionJournal(const char* url, const char* token, const char* proxy_url, const char* journal_path, sapi_Connection** remote_connection, char* err_msg);
+
+/**
+* \brief problems left outstanding in a connection's journal.
+*
+* \param connection returned by any of sapi_localConnection, sapi_remoteConnection or
+*        sapi_remoteConnectionJournal.
+* \return a string array of the problem IDs that the journal file listed as outstanding when it was
+*         opened, e.g. those left behind by a process that crashed.  The last element is NULL; the
+*         array is empty for connections without a journal.  It belongs to the connection.
+*/
+DWAVE_SAPI const char** sapi_journalProblemIds(const sapi_Connection* connection);
+
 /**
 * \brief list solvers available from a connection.
 *
@@ -1561,6 +1672,95 @@ DWAVE_SAPI sapi_Code sapi_asyncSolveQubo(const sapi_Solver* solver, const sapi_P
 */
 DWAVE_SAPI int sapi_awaitCompletion(const sapi_SubmittedProblem** submitted_problems, size_t num_submitted_problems, size_t min_done, double timeout);
 
+/**
+* \brief waits for problems to complete and reports which ones did
+*
+* Same as sapi_awaitCompletion but also writes the indices of the completed problems, so callers
+* don't need to call sapi_asyncDone on every problem after waking up.
+*
+* \param submitted_problems an array of submitted problems, each of the submitted problems
+*        returned by sapi_asyncSolve function
+* \param num_submitted_problems the length of the submitted_problems array
+* \param min_done minimum number of problems that must be completed before returning (without timeout)
+* \param timeout maximum time to wait (in seconds)
+* \param done_indices an array of at least num_submitted_problems elements.  Receives the indices (into
+*        submitted_problems) of the problems that were completed when the wait ended, in completion order.
+* \return the number of indices written to done_indices.  Fewer than min_done on timeout.
+*/
+DWAVE_SAPI size_t sapi_awaitAny(const sapi_SubmittedProblem** submitted_problems, size_t num_submitted_problems, size_t min_done, double timeout, size_t* done_indices);
+
+/**
+* \brief access existing problems on a remote SAPI server by problem ID
+*
+* Equivalent to looking up each problem separately but much faster for large numbers of problems,
+* e.g. when reattaching to problems submitted by an earlier process.
+*
+* \param connection returned by sapi_remoteConnection.
+* \param problem_ids an array of problem IDs (null terminated strings).
+* \param num_problem_ids the length of the problem_ids array.
+* \param submitted_problems an array of at least num_problem_ids sapi_SubmittedProblem pointers.
+*        On success, submitted_problems[i] is the problem with ID problem_ids[i].
+* \param err_msg error message.
+* \return sapi error code.  Local connections give SAPI_ERR_INVALID_PARAMETER.
+*
+* use sapi_freeSubmittedProblem function to release each of the sapi_SubmittedProblem pointers
+* that this function returns.
+*/
+DWAVE_SAPI sapi_Code sapi_addProblems(const sapi_Connection* connection, const char** problem_ids, size_t num_problem_ids, sapi_SubmittedProblem** submitted_problems, char* err_msg);
+
+/**
+* \brief create a completion queue
+*
+* A completion queue hands back submitted problems in the order they finish.  Problems are added once;
+* waiting on the queue costs nothing per outstanding problem, unlike sapi_awaitCompletion.
+*
+* \param completion_queue pointer of pointer to sapi_CompletionQueue struct.
+* \param err_msg error message.
+* \return sapi error code.
+*
+* use sapi_freeCompletionQueue function to release the sapi_CompletionQueue pointer.
+*/
+DWAVE_SAPI sapi_Code sapi_createCompletionQueue(sapi_CompletionQueue** completion_queue, char* err_msg);
+
+/**
+* \brief add a submitted problem to a completion queue
+*
+* The problem is popped from the queue once, when it first completes or fails.  Add it again after
+* sapi_asyncRetry to be notified of the retry finishing.  Adding a problem that is already in the queue
+* has no effect.  Don't free a problem while it is in the queue.
+*
+* \param completion_queue returned by sapi_createCompletionQueue.
+* \param submitted_problem returned by sapi_asyncSolve function or sapi_addProblems.
+* \param err_msg error message.
+* \return sapi error code.
+*/
+DWAVE_SAPI sapi_Code sapi_completionQueueAdd(sapi_CompletionQueue* completion_queue, sapi_SubmittedProblem* submitted_problem, char* err_msg);
+
+/**
+* \brief pop finished problems from a completion queue
+*
+* \param completion_queue returned by sapi_createCompletionQueue.
+* \param submitted_problems an array of at least max_problems sapi_SubmittedProblem pointers.  Receives
+*        the finished problems in completion order.  These are the pointers passed to
+*        sapi_completionQueueAdd; the queue doesn't own them.
+* \param max_problems the length of the submitted_problems array
+* \param timeout maximum time to wait for a problem to finish (in seconds; 0: don't wait)
+* \return number of problems popped (0 on timeout)
+*/
+DWAVE_SAPI size_t sapi_completionQueuePop(sapi_CompletionQueue* completion_queue, sapi_SubmittedProblem** submitted_problems, size_t max_problems, double timeout);
+
+/**
+* \brief file descriptor for event loops
+*
+* The descriptor polls readable while finished problems are waiting to be popped, so it can be added to
+* select, poll or epoll sets.  Only poll it; don't read from it or close it.  It is closed by
+* sapi_freeCompletionQueue.
+*
+* \param completion_queue returned by sapi_createCompletionQueue.
+* \return file descriptor, or -1 on Windows
+*/
+DWAVE_SAPI int sapi_completionQueueFd(const sapi_CompletionQueue* completion_queue);
+
 /**
 * \brief cancel a submitted problem
 * \param submitted_problem a sapi_SubmittedProblem pointer. Returned by the
@@ -1753,6 +1953,15 @@ DWAVE_SAPI void sapi_freeSolver(sapi_Solver* solver);
 */
 DWAVE_SAPI void sapi_freeSubmittedProblem(sapi_SubmittedProblem* submitted_problem);
 
+/**
+* \brief free sapi_CompletionQueue pointer.
+*
+* Problems still in the queue are not freed.
+*
+* \param completion_queue returned by sapi_createCompletionQueue.
+*/
+DWAVE_SAPI void sapi_freeCompletionQueue(sapi_CompletionQueue* completion_queue);
+
 /**
 * \brief free sapi_SparseMatrix pointer.
 *
@@ -63,7 +63,10 @@ struct IsingResultDeleter {
 
 typedef std::unique_ptr<sapi_IsingResult, IsingResultDeleter> IsingResultPtr;
 
-sapiremote::ProblemManagerPtr makeProblemManager(const char* url, const char* token, const char* proxy);
+// journalPath may be null or empty (no journal).  journalProblems receives the problems the journal
+// file listed as outstanding when it was opened.
+sapiremote::ProblemManagerPtr makeProblemManager(const char* url, const char* token, const char* proxy,
+    const char* journalPath, std::vector<std::string>& journalProblems);
 
 } // namespace sapi
 
@@ -177,9 +177,15 @@ public:
 class RemoteConnection : public sapi_Connection {
 private:
   sapiremote::ProblemManagerPtr problemManager_;
+  const std::vector<std::string> journalProblems_;
+  std::vector<const char*> journalProblemIds_; // null-terminated, points into journalProblems_
+
+  virtual std::vector<SubmittedProblemPtr> addProblemsImpl(const std::vector<std::string>& ids) const;
+  virtual const char* const* journalProblemIdsImpl() const { return journalProblemIds_.data(); }
 
 public:
-  RemoteConnection(const sapiremote::ProblemManagerPtr& problemManager);
+  RemoteConnection(const sapiremote::ProblemManagerPtr& problemManager,
+      std::vector<std::string> journalProblems = std::vector<std::string>());
 };
 
 
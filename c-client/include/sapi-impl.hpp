@@ -4,13 +4,17 @@
 #ifndef SAPI_IMPL_HPP_INCLUDED
 #define SAPI_IMPL_HPP_INCLUDED
 
+#include <cstddef>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include <boost/noncopyable.hpp>
 
 #include <problem.hpp>
+#include <completion-queue.hpp>
 
 #include "dwave_sapi.h"
 #include "internal.hpp"
@@ -69,12 +73,41 @@ private:
   const sapi::SolverMap solvers_;
   const std::vector<const char*> solverNames_;
 
+  // throws sapi::InvalidParameterException unless overridden
+  virtual std::vector<sapi::SubmittedProblemPtr> addProblemsImpl(const std::vector<std::string>& ids) const;
+  // null-terminated; empty unless overridden
+  virtual const char* const* journalProblemIdsImpl() const;
+
 public:
   sapi_Connection(sapi::SolverMap solvers);
   virtual ~sapi_Connection() {}
 
   sapi_Solver* getSolver(const std::string& solverName) const;
   const char* const* solverNames() const { return solverNames_.data(); }
+
+  std::vector<sapi::SubmittedProblemPtr> addProblems(const std::vector<std::string>& ids) const {
+    return addProblemsImpl(ids);
+  }
+
+  const char* const* journalProblemIds() const { return journalProblemIdsImpl(); }
+};
+
+
+// sapiremote::CompletionQueue that hands back the sapi_SubmittedProblem pointers it was given.  Local
+// problems are always done, so they are queued right away.
+struct sapi_CompletionQueue : boost::noncopyable {
+private:
+  sapiremote::CompletionQueuePtr queue_;
+  std::mutex mutex_;
+  std::unordered_map<const sapiremote::SubmittedProblem*, sapi_SubmittedProblem*> problems_;
+  std::unordered_map<sapi_SubmittedProblem*, sapiremote::SubmittedProblemPtr> localProblems_; // stand-ins
+
+public:
+  sapi_CompletionQueue() : queue_(sapiremote::makeCompletionQueue()) {}
+
+  void add(sapi_SubmittedProblem* problem);
+  std::size_t pop(sapi_SubmittedProblem** problems, std::size_t maxProblems, double timeoutS);
+  int notificationFd() const { return queue_->notificationFd(); }
 };
 
 #endif
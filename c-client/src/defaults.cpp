@@ -67,3 +67,12 @@ DWAVE_SAPI const sapi_SwHeuristicSolverParameters SAPI_SW_HEURISTIC_SOLVER_DEFAU
     0, // random_seed
     5.0 // time_limit_seconds
 };
+
+DWAVE_SAPI const sapi_GlobalConfig SAPI_GLOBAL_DEFAULT_CONFIG = {
+    0, // http_threads
+    0, // answer_threads
+    0, // problems_per_submission
+    0, // ids_per_status_query
+    0, // max_active_requests
+    0 // answer_prefetches
+};
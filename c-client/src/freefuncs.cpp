@@ -16,6 +16,10 @@ DWAVE_SAPI void sapi_freeSubmittedProblem(sapi_SubmittedProblem* submitted_probl
   delete submitted_problem;
 }
 
+DWAVE_SAPI void sapi_freeCompletionQueue(sapi_CompletionQueue* completion_queue) {
+  delete completion_queue;
+}
+
 
 DWAVE_SAPI void sapi_freeProblem(sapi_Problem* problem) {
   if (problem) {
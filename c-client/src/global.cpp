@@ -1,12 +1,20 @@
 //Copyright © 2019 D-Wave Systems Inc.
 //The software is licensed to authorized users only under the applicable license agreement.  See License.txt.
 
+#include <map>
 #include <memory>
 #include <mutex>
 #include <stdexcept>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
 
 #include <boost/noncopyable.hpp>
 
+#include <environment.hpp>
+#include <exceptions.hpp>
+#include <problem-journal.hpp>
 #include <retry-service.hpp>
 
 #include "dwave_sapi.h"
@@ -14,18 +22,100 @@
 #include <local.hpp>
 
 using std::lock_guard;
+using std::make_pair;
 using std::make_shared;
+using std::map;
 using std::mutex;
+using std::string;
+using std::tuple;
+using std::vector;
 using std::unique_ptr;
+using std::weak_ptr;
 
+using sapiremote::readEnvironment;
+
+using sapi::InvalidParameterException;
 using sapi::NotInitializedException;
 
 namespace {
 
-const sapiremote::ProblemManagerLimits limits = {
+const int defaultHttpThreads = 2;
+const int defaultAnswerThreads = 2;
+
+const sapiremote::ProblemManagerLimits defaultLimits = {
   20,  // maxProblemsPerSubmission
   100, // maxIdsPerStatusQuery
-  6    // maxActiveProblemSubmissions
+  6,   // maxActiveProblemSubmissions
+  64 << 20, // answerCacheBytes
+  0,   // maxAnswerPrefetches
+  100, // minPollIntervalMs
+  5000, // maxPollIntervalMs
+  20,  // longPollWaitS
+  {{0, 0, 0, 0}, {0, 0, 0, 1}}, // schedule: equal weights, one request slot kept for answer downloads
+  {16, 50, 500} // adaptive ceilings: active requests, problems per submission, IDs per status query
+};
+
+namespace envvars {
+const char* httpThreads = "DWAVE_SAPI_HTTP_THREADS";
+const char* answerThreads = "DWAVE_SAPI_ANSWER_THREADS";
+const char* problemsPerSubmission = "DWAVE_SAPI_PROBLEMS_PER_SUBMISSION";
+const char* idsPerStatusQuery = "DWAVE_SAPI_IDS_PER_STATUS_QUERY";
+const char* maxActiveRequests = "DWAVE_SAPI_MAX_ACTIVE_REQUESTS";
+} // namespace {anonymous}::envvars
+
+sapi_GlobalConfig effectiveConfig(const sapi_GlobalConfig* config) {
+  auto c = config ? *config : SAPI_GLOBAL_DEFAULT_CONFIG;
+  if (c.http_threads < 0 || c.answer_threads < 0 || c.problems_per_submission < 0
+      || c.ids_per_status_query < 0 || c.max_active_requests < 0 || c.answer_prefetches < 0) {
+    throw InvalidParameterException("negative sapi_GlobalConfig value");
+  }
+  readEnvironment(envvars::httpThreads, c.http_threads);
+  readEnvironment(envvars::answerThreads, c.answer_threads);
+  readEnvironment(envvars::problemsPerSubmission, c.problems_per_submission);
+  readEnvironment(envvars::idsPerStatusQuery, c.ids_per_status_query);
+  readEnvironment(envvars::maxActiveRequests, c.max_active_requests);
+  auto prefetches = sapiremote::environmentAnswerPrefetches();
+  if (prefetches > 0) c.answer_prefetches = prefetches;
+  return c;
+}
+
+bool operator==(const sapi_GlobalConfig& a, const sapi_GlobalConfig& b) {
+  return a.http_threads == b.http_threads && a.answer_threads == b.answer_threads
+      && a.problems_per_submission == b.problems_per_submission
+      && a.ids_per_status_query == b.ids_per_status_query && a.max_active_requests == b.max_active_requests
+      && a.answer_prefetches == b.answer_prefetches;
+}
+
+// A configured limit is fixed: the problem manager neither exceeds it nor adapts below it.  0: keep the
+// default starting value and ceiling.
+void applyLimit(int limit, int& value, int& ceiling) {
+  if (limit > 0) {
+    value = limit;
+    ceiling = limit;
+  }
+}
+
+sapiremote::ProblemManagerLimits problemManagerLimits(const sapi_GlobalConfig& config) {
+  auto limits = defaultLimits;
+  applyLimit(config.problems_per_submission, limits.maxProblemsPerSubmission,
+      limits.adaptive.maxProblemsPerSubmission);
+  applyLimit(config.ids_per_status_query, limits.maxIdsPerStatusQuery, limits.adaptive.maxIdsPerStatusQuery);
+  applyLimit(config.max_active_requests, limits.maxActiveRequests, limits.adaptive.maxActiveRequests);
+  limits.maxAnswerPrefetches = config.answer_prefetches;
+  // a single request slot can't be kept for answer downloads
+  if (limits.maxActiveRequests < 2) {
+    for (auto i = 0; i < sapiremote::requestclasses::count; ++i) limits.schedule.reserved[i] = 0;
+  }
+  return limits;
+}
+
+// url, token, proxy enabled, proxy url, journal path
+typedef tuple<string, string, bool, string, string> ProblemManagerKey;
+
+struct OpenJournal {
+  ProblemManagerKey key; // the connections using it
+  sapiremote::ProblemJournalPtr journal;
+  vector<string> leftoverProblems; // outstanding when the file was opened
 };
 
 class GlobalState : boost::noncopyable {
@@ -33,13 +123,24 @@ private:
   sapiremote::http::HttpServicePtr httpService_;
   sapiremote::ThreadPoolPtr answerThreadPool_;
   sapiremote::RetryTimerServicePtr retryService_;
+  sapiremote::ProblemManagerLimits limits_;
   sapi::LocalConnection localConnection_;
+  // Connections to the same server with the same credentials share a problem manager, so status polling
+  // is batched across all of them and they stay within one set of request limits.  Weak: the manager goes
+  // away with the last connection using it.
+  map<ProblemManagerKey, weak_ptr<sapiremote::ProblemManager>> problemManagers_;
+  // Journals stay open until cleanup, so a file is never opened twice, even if an old problem manager
+  // using it is still around.  Keyed by path.
+  map<string, OpenJournal> journals_;
 
 public:
-  GlobalState() :
-      httpService_(sapiremote::http::makeHttpService(2)),
-      answerThreadPool_(sapiremote::makeThreadPool(2)),
-      retryService_(sapiremote::makeRetryTimerService()) {}
+  GlobalState(const sapi_GlobalConfig& config) :
+      httpService_(sapiremote::http::makeHttpService(
+          config.http_threads > 0 ? config.http_threads : defaultHttpThreads)),
+      answerThreadPool_(sapiremote::makeThreadPool(
+          config.answer_threads > 0 ? config.answer_threads : defaultAnswerThreads)),
+      retryService_(sapiremote::makeRetryTimerService()),
+      limits_(problemManagerLimits(config)) {}
 
   ~GlobalState() {
     httpService_->shutdown();
@@ -50,21 +151,65 @@ public:
   const sapiremote::http::HttpServicePtr& httpService() const { return httpService_; }
   const sapiremote::ThreadPoolPtr& answerThreadPool() const { return answerThreadPool_; }
   const sapiremote::RetryTimerServicePtr& retryService() const { return retryService_; }
+  const sapiremote::ProblemManagerLimits& limits() const { return limits_; }
   sapi_Connection* localConnection() { return &localConnection_; }
+
+  sapiremote::ProblemManagerPtr sharedProblemManager(const ProblemManagerKey& key) {
+    auto iter = problemManagers_.find(key);
+    return iter != problemManagers_.end() ? iter->second.lock() : sapiremote::ProblemManagerPtr();
+  }
+
+  sapiremote::ProblemJournalPtr openJournal(const ProblemManagerKey& key, vector<string>& leftoverProblems) {
+    const auto& path = std::get<4>(key);
+    auto iter = journals_.find(path);
+    if (iter == journals_.end()) {
+      OpenJournal oj;
+      oj.key = key;
+      try {
+        oj.journal = sapiremote::makeProblemJournal(path);
+      } catch (sapiremote::JournalException& e) {
+        throw InvalidParameterException(e.what());
+      }
+      oj.leftoverProblems = oj.journal->outstandingProblems();
+      iter = journals_.insert(make_pair(path, std::move(oj))).first;
+    } else if (iter->second.key != key) {
+      throw InvalidParameterException("journal is already used for a different url, token or proxy: " + path);
+    }
+    leftoverProblems = iter->second.leftoverProblems;
+    return iter->second.journal;
+  }
+
+  void addProblemManager(const ProblemManagerKey& key, const sapiremote::ProblemManagerPtr& pm) {
+    for (auto iter = problemManagers_.begin(); iter != problemManagers_.end(); ) {
+      if (iter->second.expired()) {
+        iter = problemManagers_.erase(iter);
+      } else {
+        ++iter;
+      }
+    }
+    problemManagers_[key] = pm;
+  }
 };
 
 class GlobalStateMangager : boost::noncopyable {
 private:
   unique_ptr<GlobalState> gs_;
+  sapi_GlobalConfig config_;
   int count_;
   mutex mutex_;
 
 public:
-  GlobalStateMangager() : gs_(), count_(0) {}
+  GlobalStateMangager() : gs_(), config_(SAPI_GLOBAL_DEFAULT_CONFIG), count_(0) {}
 
-  void init() {
+  void init(const sapi_GlobalConfig* config) {
     lock_guard<mutex> l(mutex_);
-    if (count_ == 0) gs_.reset(new GlobalState);
+    if (count_ == 0) {
+      config_ = effectiveConfig(config);
+      gs_.reset(new GlobalState(config_));
+    } else if (config && !(effectiveConfig(config) == config_)) {
+      // the thread pools and limits in use can't be changed
+      throw InvalidParameterException("library already initialized with a different sapi_GlobalConfig");
+    }
     ++count_;
   }
 
@@ -80,15 +225,25 @@ public:
     return gs_->localConnection();
   }
 
-  sapiremote::ProblemManagerPtr makeProblemManager(const char* url, const char* token, const char* proxy) {
+  sapiremote::ProblemManagerPtr makeProblemManager(const char* url, const char* token, const char* proxy,
+      const char* journalPath, vector<string>& journalProblems) {
     lock_guard<mutex> l(mutex_);
     if (!gs_) throw NotInitializedException();
 
     auto srp = proxy ? sapiremote::http::Proxy(proxy) : sapiremote::http::Proxy();
-    auto sapiService = sapiremote::makeSapiService(gs_->httpService(), url, token, srp);
+    auto key = ProblemManagerKey(url, token, srp.enabled(), srp.url(), journalPath ? journalPath : "");
+    auto journal = std::get<4>(key).empty() ? sapiremote::ProblemJournalPtr()
+        : gs_->openJournal(key, journalProblems);
+    auto pm = gs_->sharedProblemManager(key);
+    if (pm) return pm;
+
+    auto sapiService = sapiremote::makeSapiService(gs_->httpService(), url, token, srp,
+      sapiremote::environmentSapiServiceOptions());
     auto answerService = sapiremote::makeAnswerService(gs_->answerThreadPool());
-    return sapiremote::makeProblemManager(sapiService, answerService, gs_->retryService(),
-      sapiremote::defaultRetryTiming(), limits);
+    pm = sapiremote::makeProblemManager(sapiService, answerService, gs_->retryService(),
+      sapiremote::defaultRetryTiming(), gs_->limits(), journal);
+    gs_->addProblemManager(key, pm);
+    return pm;
   }
 };
 
@@ -102,16 +257,23 @@ GlobalStateMangager& gsm() {
 
 namespace sapi {
 
-sapiremote::ProblemManagerPtr makeProblemManager(const char* url, const char* token, const char* proxy) {
-  return gsm().makeProblemManager(url, token, proxy);
+sapiremote::ProblemManagerPtr makeProblemManager(const char* url, const char* token, const char* proxy,
+    const char* journalPath, vector<string>& journalProblems) {
+  return gsm().makeProblemManager(url, token, proxy, journalPath, journalProblems);
 }
 
 } // namespace sapi
 
 DWAVE_SAPI sapi_Code sapi_globalInit() {
+  return sapi_globalInitEx(0);
+}
+
+DWAVE_SAPI sapi_Code sapi_globalInitEx(const sapi_GlobalConfig* config) {
   try {
-    gsm().init();
+    gsm().init(config);
     return SAPI_OK;
+  } catch (InvalidParameterException&) {
+    return SAPI_ERR_INVALID_PARAMETER;
   } catch (...) {
     return SAPI_ERR_OUT_OF_MEMORY;
   }
@@ -534,9 +534,27 @@ SubmittedProblemPtr RemoteSolver::submitImpl(
 }
 
 
-RemoteConnection::RemoteConnection(const sapiremote::ProblemManagerPtr& problemManager) :
+RemoteConnection::RemoteConnection(const sapiremote::ProblemManagerPtr& problemManager,
+    vector<string> journalProblems) :
     sapi_Connection(remoteSolverMap(problemManager)),
-    problemManager_(problemManager) {}
+    problemManager_(problemManager),
+    journalProblems_(std::move(journalProblems)) {
+
+  journalProblemIds_.reserve(journalProblems_.size() + 1);
+  BOOST_FOREACH( const auto& id, journalProblems_ ) journalProblemIds_.push_back(id.c_str());
+  journalProblemIds_.push_back(0);
+}
+
+
+vector<SubmittedProblemPtr> RemoteConnection::addProblemsImpl(const vector<string>& ids) const {
+  auto rsps = problemManager_->addProblems(ids);
+  vector<SubmittedProblemPtr> problems;
+  problems.reserve(rsps.size());
+  BOOST_FOREACH( const auto& rsp, rsps ) {
+    problems.push_back(SubmittedProblemPtr(new RemoteSubmittedProblem(rsp)));
+  }
+  return problems;
+}
 
 } // namespace sapi
 
@@ -547,9 +565,21 @@ DWAVE_SAPI sapi_Code sapi_remoteConnection(
     sapi_Connection** connOut,
     char* err_msg) {
 
+  return sapi_remoteConnectionJournal(url, token, proxy_url, 0, connOut, err_msg);
+}
+
+DWAVE_SAPI sapi_Code sapi_remoteConnectionJournal(
+    const char* url,
+    const char* token,
+    const char* proxy_url,
+    const char* journal_path,
+    sapi_Connection** connOut,
+    char* err_msg) {
+
   try {
-    auto pm = makeProblemManager(url, token, proxy_url);
-    auto conn = ConnectionPtr(new RemoteConnection(pm));
+    auto journalProblems = vector<string>();
+    auto pm = makeProblemManager(url, token, proxy_url, journal_path, journalProblems);
+    auto conn = ConnectionPtr(new RemoteConnection(pm, std::move(journalProblems)));
     *connOut = conn.release();
     return SAPI_OK;
   } catch (...) {
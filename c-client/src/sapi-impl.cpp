@@ -1,10 +1,14 @@
 //Copyright © 2019 D-Wave Systems Inc.
 //The software is licensed to authorized users only under the applicable license agreement.  See License.txt.
 
+#include <cstddef>
 #include <cstring>
 #include <exception>
 #include <limits>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <tuple>
 #include <utility>
 #include <vector>
 
@@ -16,11 +20,16 @@
 #include <sapi-impl.hpp>
 
 using std::current_exception;
+using std::lock_guard;
+using std::make_shared;
+using std::mutex;
 using std::numeric_limits;
 using std::string;
+using std::tuple;
 using std::vector;
 
 using sapi::handleException;
+using sapi::InvalidParameterException;
 using sapi::SolverMap;
 
 namespace remotestatuses = sapiremote::remotestatuses;
@@ -38,11 +47,72 @@ vector<const char*> extractSolverNames(const SolverMap& solvers) {
   return names;
 }
 
+// stands in for local problems in completion queues
+class LocalDoneProblem : public sapiremote::SubmittedProblem {
+private:
+  virtual string problemIdImpl() const { return string(); }
+  virtual bool doneImpl() const { return true; }
+  virtual sapiremote::SubmittedProblemInfo statusImpl() const { return sapiremote::SubmittedProblemInfo(); }
+  virtual tuple<string, json::Value> answerImpl() const { return tuple<string, json::Value>(); }
+  virtual void answerImpl(sapiremote::AnswerCallbackPtr) const {}
+  virtual void cancelImpl() {}
+  virtual void retryImpl() {}
+  virtual void addSubmittedProblemObserverImpl(const sapiremote::SubmittedProblemObserverPtr& observer) {
+    observer->notifyDone();
+  }
+};
+
 } // namespace {anonymous}
 
+void sapi_CompletionQueue::add(sapi_SubmittedProblem* problem) {
+  auto rp = problem->remoteSubmittedProblem();
+  {
+    lock_guard<mutex> lock(mutex_);
+    if (!rp) {
+      // one stand-in per attached problem, so adding it again has no effect, as for remote problems
+      auto& standIn = localProblems_[problem];
+      if (standIn) return;
+      standIn = make_shared<LocalDoneProblem>();
+      rp = standIn;
+    }
+    problems_[rp.get()] = problem;
+  }
+  queue_->add(rp);
+}
+
+std::size_t sapi_CompletionQueue::pop(
+    sapi_SubmittedProblem** problems,
+    std::size_t maxProblems,
+    double timeoutS) {
+
+  auto popped = vector<sapiremote::SubmittedProblemPtr>();
+  queue_->pop(popped, maxProblems, timeoutS);
+
+  std::size_t n = 0;
+  lock_guard<mutex> lock(mutex_);
+  BOOST_FOREACH( const auto& rp, popped ) {
+    auto iter = problems_.find(rp.get());
+    if (iter != problems_.end()) {
+      problems[n++] = iter->second;
+      localProblems_.erase(iter->second);
+      problems_.erase(iter);
+    }
+  }
+  return n;
+}
+
 sapi_Connection::sapi_Connection(SolverMap solvers) :
     solvers_(std::move(solvers)), solverNames_(extractSolverNames(solvers_)) {}
 
+vector<sapi::SubmittedProblemPtr> sapi_Connection::addProblemsImpl(const vector<string>&) const {
+  throw InvalidParameterException("connection does not support adding problems by ID");
+}
+
+const char* const* sapi_Connection::journalProblemIdsImpl() const {
+  static const char* const none[] = {0};
+  return none;
+}
+
 sapi_Solver* sapi_Connection::getSolver(const string& solverName) const {
   auto iter = solvers_.find(solverName);
   if (iter == solvers_.end()) {
@@ -58,6 +128,11 @@ DWAVE_SAPI const char** sapi_listSolvers(const sapi_Connection* connection) {
 }
 
 
+DWAVE_SAPI const char** sapi_journalProblemIds(const sapi_Connection* connection) {
+  return const_cast<const char**>(connection->journalProblemIds());
+}
+
+
 DWAVE_SAPI sapi_Solver* sapi_getSolver(const sapi_Connection* connection, const char* solverName) {
   return connection->getSolver(solverName);
 }
@@ -167,6 +242,111 @@ DWAVE_SAPI int sapi_awaitCompletion(
 }
 
 
+DWAVE_SAPI size_t sapi_awaitAny(
+    const sapi_SubmittedProblem** submittedProblems,
+    size_t numSubmittedProblems,
+    size_t minDone0,
+    double timeout,
+    size_t* doneIndices) {
+
+  try {
+    if (minDone0 > numSubmittedProblems) minDone0 = numSubmittedProblems;
+    if (minDone0 > numeric_limits<int>::max()) minDone0 = numeric_limits<int>::max();
+    auto minDone = static_cast<int>(minDone0);
+
+    // local problems are already done
+    size_t numDone = 0;
+    auto remoteProblems = vector<sapiremote::SubmittedProblemPtr>();
+    auto remoteIndices = vector<size_t>();
+    for (size_t i = 0; i < numSubmittedProblems; ++i) {
+      auto rp = submittedProblems[i]->remoteSubmittedProblem();
+      if (rp) {
+        remoteProblems.push_back(rp);
+        remoteIndices.push_back(i);
+      } else {
+        doneIndices[numDone++] = i;
+        --minDone;
+      }
+    }
+
+    if (remoteProblems.empty()) return numDone;
+    auto remoteDone = vector<size_t>();
+    sapiremote::awaitCompletion(remoteProblems, minDone > 0 ? minDone : 0, timeout, remoteDone);
+    BOOST_FOREACH( auto i, remoteDone ) {
+      doneIndices[numDone++] = remoteIndices[i];
+    }
+    return numDone;
+
+  } catch (...) {
+    return 0;
+  }
+}
+
+
+DWAVE_SAPI sapi_Code sapi_addProblems(
+    const sapi_Connection* connection,
+    const char** problemIds,
+    size_t numProblemIds,
+    sapi_SubmittedProblem** submittedProblems,
+    char* err_msg) {
+
+  try {
+    auto ids = vector<string>(problemIds, problemIds + numProblemIds);
+    auto problems = connection->addProblems(ids);
+    for (size_t i = 0; i < numProblemIds; ++i) submittedProblems[i] = problems[i].release();
+    return SAPI_OK;
+
+  } catch (...) {
+    return handleException(current_exception(), err_msg);
+  }
+}
+
+
+DWAVE_SAPI sapi_Code sapi_createCompletionQueue(sapi_CompletionQueue** completionQueue, char* err_msg) {
+  try {
+    *completionQueue = new sapi_CompletionQueue();
+    return SAPI_OK;
+
+  } catch (...) {
+    return handleException(current_exception(), err_msg);
+  }
+}
+
+
+DWAVE_SAPI sapi_Code sapi_completionQueueAdd(
+    sapi_CompletionQueue* completionQueue,
+    sapi_SubmittedProblem* submittedProblem,
+    char* err_msg) {
+
+  try {
+    completionQueue->add(submittedProblem);
+    return SAPI_OK;
+
+  } catch (...) {
+    return handleException(current_exception(), err_msg);
+  }
+}
+
+
+DWAVE_SAPI size_t sapi_completionQueuePop(
+    sapi_CompletionQueue* completionQueue,
+    sapi_SubmittedProblem** submittedProblems,
+    size_t maxProblems,
+    double timeout) {
+
+  try {
+    return completionQueue->pop(submittedProblems, maxProblems, timeout);
+  } catch (...) {
+    return 0;
+  }
+}
+
+
+DWAVE_SAPI int sapi_completionQueueFd(const sapi_CompletionQueue* completionQueue) {
+  return completionQueue->notificationFd();
+}
+
+
 DWAVE_SAPI void sapi_cancelSubmittedProblem(sapi_SubmittedProblem* submittedProblem) {
   submittedProblem->cancel();
 }
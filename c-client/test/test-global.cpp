@@ -1,6 +1,7 @@
 //Copyright © 2019 D-Wave Systems Inc.
 //The software is licensed to authorized users only under the applicable license agreement.  See License.txt.
 
+#include <cstdlib>
 #include <memory>
 #include <string>
 #include <vector>
@@ -14,6 +15,7 @@
 #include <retry-service.hpp>
 #include <problem-manager.hpp>
 #include <coding.hpp>
+#include <exceptions.hpp>
 
 #include <dwave_sapi.h>
 
@@ -24,6 +26,7 @@ using std::vector;
 
 using sapiremote::http::HttpService;
 using sapiremote::http::HttpHeaders;
+using sapiremote::http::HttpServiceStats;
 using sapiremote::http::Proxy;
 using sapiremote::http::HttpCallbackPtr;
 using sapiremote::ThreadPool;
@@ -31,7 +34,18 @@ using sapiremote::RetryTimerService;
 using sapiremote::RetryTimerPtr;
 using sapiremote::RetryNotifiableWeakPtr;
 using sapiremote::RetryTiming;
+using sapiremote::ProblemManagerLimits;
+using sapiremote::ProblemJournal;
+using sapiremote::ProblemJournalPtr;
 
+namespace {
+int lastHttpThreads = -1;
+int lastPoolThreads = -1;
+int problemManagersMade = 0;
+ProblemManagerLimits lastLimits;
+int journalsOpened = 0;
+ProblemJournalPtr lastJournal;
+} // namespace {anonymous}
 
 namespace sapiremote {
 extern char const * const userAgent = "sapi-remote/test";
@@ -44,12 +58,14 @@ private:
   virtual void asyncPostImpl(const std::string&, const HttpHeaders&, std::string&, const Proxy&, HttpCallbackPtr) {}
   virtual void asyncDeleteImpl(const std::string&, const HttpHeaders&, std::string&, const Proxy&, HttpCallbackPtr) {}
   virtual void shutdownImpl() {}
+  virtual HttpServiceStats statsImpl() const { return HttpServiceStats(); }
 };
 
 class DummyThreadPool : public ThreadPool {
 private:
   virtual void shutdownImpl() {}
-  virtual void postImpl(std::function<void()>) {}
+  virtual void postImpl(Task&) {}
+  virtual ThreadPoolStats statsImpl() const { return ThreadPoolStats(); }
 };
 
 class DummyRetryTimerService : public RetryTimerService {
@@ -58,35 +74,69 @@ private:
   virtual RetryTimerPtr createRetryTimerImpl(const RetryNotifiableWeakPtr&, const RetryTiming&) {
     return RetryTimerPtr();
   }
+  virtual PollTimerPtr createPollTimerImpl(const RetryNotifiableWeakPtr&) { return PollTimerPtr(); }
 };
 
 class DummyProblemManager : public ProblemManager {
 private:
-  virtual SubmittedProblemPtr submitProblemImpl(string&, string&, json::Value&, json::Object&) {
+  virtual SubmittedProblemPtr submitProblemImpl(string&, string&, json::Value&, json::Object&, int) {
     return SubmittedProblemPtr();
   }
   virtual SubmittedProblemPtr addProblemImpl(const string&) { return SubmittedProblemPtr(); }
+  virtual vector<SubmittedProblemPtr> addProblemsImpl(const vector<string>&) {
+    return vector<SubmittedProblemPtr>();
+  }
   virtual SolverMap fetchSolversImpl() { return SolverMap(); }
+  virtual ProblemManagerStats statsImpl() const { return ProblemManagerStats(); }
+};
+
+class DummyProblemJournal : public ProblemJournal {
+private:
+  virtual void problemSubmittedImpl(const string&) {}
+  virtual void problemDoneImpl(const string&) {}
+  virtual vector<string> outstandingProblemsImpl() const { return vector<string>{"left-1", "left-2"}; }
+  virtual bool syncImpl() { return true; }
 };
 
 } // namespace {anonymous}
 
 namespace http {
-HttpServicePtr makeHttpService(int) { return make_shared<DummyHttpService>(); }
+HttpServicePtr makeHttpService(int threads) {
+  lastHttpThreads = threads;
+  return make_shared<DummyHttpService>();
+}
 } // namespace sapiremote::http
 
 const RetryTiming& defaultRetryTiming() {
-  static const auto t = RetryTiming{-1, -1, -1.0f};
+  static const auto t = RetryTiming{-1, -1, -1.0f, -1.0f};
   return t;
 }
 
-ThreadPoolPtr makeThreadPool(int) { return make_shared<DummyThreadPool>(); }
+ThreadPoolPtr makeThreadPool(int threads) {
+  lastPoolThreads = threads;
+  return make_shared<DummyThreadPool>();
+}
 RetryTimerServicePtr makeRetryTimerService() { return make_shared<DummyRetryTimerService>(); }
 SapiServicePtr makeSapiService(http::HttpServicePtr, string, string, http::Proxy) { return SapiServicePtr(); }
+SapiServicePtr makeSapiService(http::HttpServicePtr, string, string, http::Proxy, const SapiServiceOptions&) {
+  return SapiServicePtr();
+}
+SapiServiceOptions environmentSapiServiceOptions() { return SapiServiceOptions(); }
 AnswerServicePtr makeAnswerService(ThreadPoolPtr) { return AnswerServicePtr(); }
 
 ProblemManagerPtr makeProblemManager(SapiServicePtr, AnswerServicePtr, RetryTimerServicePtr,
-    const RetryTiming&, const ProblemManagerLimits&) { return make_shared<DummyProblemManager>(); }
+    const RetryTiming&, const ProblemManagerLimits& limits, ProblemJournalPtr journal) {
+  lastLimits = limits;
+  lastJournal = journal;
+  ++problemManagersMade;
+  return make_shared<DummyProblemManager>();
+}
+
+ProblemJournalPtr makeProblemJournal(const string& path, int) {
+  if (path == "not-a-journal") throw JournalException("not a journal", path);
+  ++journalsOpened;
+  return make_shared<DummyProblemJournal>();
+}
 
 } // namespace sapiremote
 
@@ -121,3 +171,149 @@ TEST(GlobalTest, RemoteNoInit) {
   sapi_Connection* conn;
   EXPECT_EQ(SAPI_ERR_NO_INIT, sapi_remoteConnection("", "", 0, &conn, 0));
 }
+
+TEST(GlobalTest, SharedProblemManager) {
+  ASSERT_EQ(SAPI_OK, sapi_globalInit());
+  auto made = problemManagersMade;
+  sapi_Connection* conns[5];
+  ASSERT_EQ(SAPI_OK, sapi_remoteConnection("url", "token", 0, &conns[0], 0));
+  ASSERT_EQ(SAPI_OK, sapi_remoteConnection("url", "token", 0, &conns[1], 0));
+  EXPECT_EQ(made + 1, problemManagersMade);
+
+  ASSERT_EQ(SAPI_OK, sapi_remoteConnection("url", "other token", 0, &conns[2], 0));
+  ASSERT_EQ(SAPI_OK, sapi_remoteConnection("url", "token", "", &conns[3], 0));
+  ASSERT_EQ(SAPI_OK, sapi_remoteConnection("other url", "token", 0, &conns[4], 0));
+  EXPECT_EQ(made + 4, problemManagersMade);
+
+  // shared until the last connection using it is freed
+  sapi_freeConnection(conns[0]);
+  ASSERT_EQ(SAPI_OK, sapi_remoteConnection("url", "token", 0, &conns[0], 0));
+  EXPECT_EQ(made + 4, problemManagersMade);
+  sapi_freeConnection(conns[0]);
+  sapi_freeConnection(conns[1]);
+  ASSERT_EQ(SAPI_OK, sapi_remoteConnection("url", "token", 0, &conns[0], 0));
+  EXPECT_EQ(made + 5, problemManagersMade);
+
+  for (auto i = 0; i < 5; ++i) {
+    if (i != 1) sapi_freeConnection(conns[i]);
+  }
+  sapi_globalCleanup();
+}
+
+TEST(GlobalTest, JournalConnection) {
+  ASSERT_EQ(SAPI_OK, sapi_globalInit());
+  auto made = problemManagersMade;
+  auto opened = journalsOpened;
+  sapi_Connection* conns[3];
+  ASSERT_EQ(SAPI_OK, sapi_remoteConnectionJournal("url", "token", 0, "journal", &conns[0], 0));
+  EXPECT_EQ(made + 1, problemManagersMade);
+  EXPECT_EQ(opened + 1, journalsOpened);
+  EXPECT_TRUE(!!lastJournal);
+  auto ids = sapi_journalProblemIds(conns[0]);
+  ASSERT_TRUE(ids[0] && ids[1]);
+  EXPECT_EQ(string("left-1"), ids[0]);
+  EXPECT_EQ(string("left-2"), ids[1]);
+  EXPECT_EQ(nullptr, ids[2]);
+
+  // same journal: shared problem manager; no journal: a problem manager of its own
+  ASSERT_EQ(SAPI_OK, sapi_remoteConnectionJournal("url", "token", 0, "journal", &conns[1], 0));
+  EXPECT_EQ(made + 1, problemManagersMade);
+  EXPECT_EQ(string("left-1"), sapi_journalProblemIds(conns[1])[0]);
+  ASSERT_EQ(SAPI_OK, sapi_remoteConnection("url", "token", 0, &conns[2], 0));
+  EXPECT_EQ(made + 2, problemManagersMade);
+  EXPECT_FALSE(lastJournal);
+  EXPECT_EQ(nullptr, sapi_journalProblemIds(conns[2])[0]);
+  EXPECT_EQ(nullptr, sapi_journalProblemIds(sapi_localConnection())[0]);
+
+  // opened once; not for other servers or credentials
+  sapi_Connection* conn;
+  EXPECT_EQ(SAPI_ERR_INVALID_PARAMETER, sapi_remoteConnectionJournal("url", "other", 0, "journal", &conn, 0));
+  EXPECT_EQ(SAPI_ERR_INVALID_PARAMETER,
+      sapi_remoteConnectionJournal("url", "token", 0, "not-a-journal", &conn, 0));
+  EXPECT_EQ(opened + 1, journalsOpened);
+
+  for (auto i = 0; i < 3; ++i) sapi_freeConnection(conns[i]);
+  sapi_globalCleanup();
+}
+
+TEST(GlobalTest, InitExDefaults) {
+  ASSERT_EQ(SAPI_OK, sapi_globalInitEx(&SAPI_GLOBAL_DEFAULT_CONFIG));
+  EXPECT_EQ(2, lastHttpThreads);
+  EXPECT_EQ(2, lastPoolThreads);
+  sapi_Connection* conn;
+  ASSERT_EQ(SAPI_OK, sapi_remoteConnection("", "", 0, &conn, 0));
+  sapi_freeConnection(conn);
+  EXPECT_EQ(20, lastLimits.maxProblemsPerSubmission);
+  EXPECT_EQ(50, lastLimits.adaptive.maxProblemsPerSubmission);
+  EXPECT_EQ(6, lastLimits.maxActiveRequests);
+  EXPECT_EQ(1, lastLimits.schedule.reserved[sapiremote::requestclasses::ANSWER]);
+  EXPECT_EQ(0, lastLimits.maxAnswerPrefetches);
+  sapi_globalCleanup();
+}
+
+TEST(GlobalTest, InitExConfig) {
+  sapi_GlobalConfig config = SAPI_GLOBAL_DEFAULT_CONFIG;
+  config.http_threads = 8;
+  config.answer_threads = 1;
+  config.problems_per_submission = 200;
+  config.ids_per_status_query = 10;
+  config.max_active_requests = 1;
+  config.answer_prefetches = 4;
+  ASSERT_EQ(SAPI_OK, sapi_globalInitEx(&config));
+  EXPECT_EQ(8, lastHttpThreads);
+  EXPECT_EQ(1, lastPoolThreads);
+
+  sapi_Connection* conn;
+  ASSERT_EQ(SAPI_OK, sapi_remoteConnection("", "", 0, &conn, 0));
+  sapi_freeConnection(conn);
+  // configured limits are fixed
+  EXPECT_EQ(200, lastLimits.maxProblemsPerSubmission);
+  EXPECT_EQ(200, lastLimits.adaptive.maxProblemsPerSubmission);
+  EXPECT_EQ(10, lastLimits.maxIdsPerStatusQuery);
+  EXPECT_EQ(10, lastLimits.adaptive.maxIdsPerStatusQuery);
+  EXPECT_EQ(1, lastLimits.maxActiveRequests);
+  EXPECT_EQ(1, lastLimits.adaptive.maxActiveRequests);
+  EXPECT_EQ(0, lastLimits.schedule.reserved[sapiremote::requestclasses::ANSWER]);
+  EXPECT_EQ(4, lastLimits.maxAnswerPrefetches);
+
+  // already initialized: the same or no config is fine, a different one isn't
+  EXPECT_EQ(SAPI_OK, sapi_globalInitEx(&config));
+  EXPECT_EQ(SAPI_OK, sapi_globalInit());
+  config.http_threads = 4;
+  EXPECT_EQ(SAPI_ERR_INVALID_PARAMETER, sapi_globalInitEx(&config));
+  sapi_globalCleanup();
+  sapi_globalCleanup();
+  ASSERT_EQ(SAPI_OK, sapi_remoteConnection("", "", 0, &conn, 0));
+  sapi_freeConnection(conn);
+  sapi_globalCleanup();
+
+  config.answer_threads = -1;
+  EXPECT_EQ(SAPI_ERR_INVALID_PARAMETER, sapi_globalInitEx(&config));
+  EXPECT_EQ(SAPI_ERR_NO_INIT, sapi_remoteConnection("", "", 0, &conn, 0));
+}
+
+#ifndef _WIN32
+TEST(GlobalTest, InitExEnvironment) {
+  setenv("DWAVE_SAPI_ANSWER_THREADS", "12", 1);
+  setenv("DWAVE_SAPI_HTTP_THREADS", "lots", 1);
+  setenv("DWAVE_SAPI_MAX_ACTIVE_REQUESTS", "0", 1);
+  setenv("DWAVE_SAPI_ANSWER_PREFETCHES", "2", 1);
+  sapi_GlobalConfig config = SAPI_GLOBAL_DEFAULT_CONFIG;
+  config.answer_threads = 3;
+  config.http_threads = 3;
+  ASSERT_EQ(SAPI_OK, sapi_globalInitEx(&config));
+  unsetenv("DWAVE_SAPI_ANSWER_THREADS");
+  unsetenv("DWAVE_SAPI_HTTP_THREADS");
+  unsetenv("DWAVE_SAPI_MAX_ACTIVE_REQUESTS");
+  unsetenv("DWAVE_SAPI_ANSWER_PREFETCHES");
+
+  EXPECT_EQ(12, lastPoolThreads);
+  EXPECT_EQ(3, lastHttpThreads);
+  sapi_Connection* conn;
+  ASSERT_EQ(SAPI_OK, sapi_remoteConnection("", "", 0, &conn, 0));
+  sapi_freeConnection(conn);
+  EXPECT_EQ(6, lastLimits.maxActiveRequests);
+  EXPECT_EQ(2, lastLimits.maxAnswerPrefetches);
+  sapi_globalCleanup();
+}
+#endif
@@ -27,6 +27,7 @@ using std::tuple;
 using std::unique_ptr;
 using std::vector;
 
+using testing::ElementsAre;
 using testing::StrictMock;
 using testing::Return;
 using testing::_;
@@ -49,9 +50,11 @@ namespace {
 
 class MockProblemManager : public sapiremote::ProblemManager {
 public:
-  MOCK_METHOD4(submitProblemImpl, SubmittedProblemPtr(string&, string&, json::Value&, json::Object&));
+  MOCK_METHOD5(submitProblemImpl, SubmittedProblemPtr(string&, string&, json::Value&, json::Object&, int));
   MOCK_METHOD1(addProblemImpl, SubmittedProblemPtr(const string&));
+  MOCK_METHOD1(addProblemsImpl, vector<SubmittedProblemPtr>(const vector<string>&));
   MOCK_METHOD0(fetchSolversImpl, sapiremote::SolverMap());
+  MOCK_CONST_METHOD0(statsImpl, sapiremote::ProblemManagerStats());
 };
 
 class MockRemoteSolver : public sapiremote::Solver {
@@ -205,6 +208,26 @@ TEST(RemoteConnectionTest, Api) {
 
 
 
+TEST(RemoteConnectionTest, AddProblems) {
+  auto rsp1 = make_shared<StrictMock<MockRemoteSubmittedProblem>>();
+  auto rsp2 = make_shared<StrictMock<MockRemoteSubmittedProblem>>();
+  auto mockProblemManager = make_shared<StrictMock<MockProblemManager>>();
+  EXPECT_CALL(*mockProblemManager, fetchSolversImpl()).WillOnce(Return(sapiremote::SolverMap()));
+  EXPECT_CALL(*mockProblemManager, addProblemsImpl(ElementsAre("p1", "p2")))
+    .WillOnce(Return(vector<SubmittedProblemPtr>{rsp1, rsp2}));
+  RemoteConnection conn(mockProblemManager);
+
+  const char* ids[] = {"p1", "p2"};
+  sapi_SubmittedProblem* sps[2] = {};
+  ASSERT_EQ(SAPI_OK, sapi_addProblems(&conn, ids, 2, sps, 0));
+  EXPECT_EQ(rsp1, sps[0]->remoteSubmittedProblem());
+  EXPECT_EQ(rsp2, sps[1]->remoteSubmittedProblem());
+  sapi_freeSubmittedProblem(sps[0]);
+  sapi_freeSubmittedProblem(sps[1]);
+}
+
+
+
 
 TEST(RemoteParameterTest, Default) {
   EXPECT_EQ(json::Object(), quantumParametersToJson(SAPI_QUANTUM_SOLVER_DEFAULT_PARAMETERS));
@@ -96,6 +96,16 @@ bool awaitCompletion(const vector<SubmittedProblemPtr>& problems, int minDone, d
   return awaitCompletionResult;
 }
 
+// reports the problems whose doneImpl returns true (in index order), after recording the arguments
+bool awaitCompletion(const vector<SubmittedProblemPtr>& problems, int minDone, double timeout,
+    vector<size_t>& doneIndices) {
+  awaitCompletion(problems, minDone, timeout);
+  for (size_t i = 0; i < problems.size(); ++i) {
+    if (problems[i]->done()) doneIndices.push_back(i);
+  }
+  return awaitCompletionResult;
+}
+
 } // namespace sapiremote
 
 
@@ -383,6 +393,83 @@ TEST(SolversApiTest, AwaitCompletionMixedNotDone) {
 }
 
 
+TEST(SolversApiTest, AwaitAnyNoRemote) {
+  auto sp1 = unique_ptr<MockSubmittedProblem>(new StrictMock<MockSubmittedProblem>);
+  auto sp2 = unique_ptr<MockSubmittedProblem>(new StrictMock<MockSubmittedProblem>);
+  auto problems = vector<const sapi_SubmittedProblem*>{sp1.get(), sp2.get()};
+
+  EXPECT_CALL(*sp1, remoteSubmittedProblemImpl()).WillOnce(Return(sapiremote::SubmittedProblemPtr()));
+  EXPECT_CALL(*sp2, remoteSubmittedProblemImpl()).WillOnce(Return(sapiremote::SubmittedProblemPtr()));
+
+  lastAwaitCompletionProblems.clear();
+  auto doneIndices = vector<size_t>(problems.size());
+  ASSERT_EQ(2u, sapi_awaitAny(problems.data(), problems.size(), 1, 1234.5, doneIndices.data()));
+  EXPECT_EQ((vector<size_t>{0, 1}), doneIndices);
+  EXPECT_TRUE(lastAwaitCompletionProblems.empty());
+}
+
+
+TEST(SolversApiTest, AwaitAnyMixed) {
+  auto sp1 = unique_ptr<MockSubmittedProblem>(new StrictMock<MockSubmittedProblem>);
+  auto sp2 = unique_ptr<MockSubmittedProblem>(new StrictMock<MockSubmittedProblem>);
+  auto sp3 = unique_ptr<MockSubmittedProblem>(new StrictMock<MockSubmittedProblem>);
+  auto sp4 = unique_ptr<MockSubmittedProblem>(new StrictMock<MockSubmittedProblem>);
+  auto problems = vector<const sapi_SubmittedProblem*>{sp1.get(), sp2.get(), sp3.get(), sp4.get()};
+
+  auto rsp1 = make_shared<MockRemoteSubmittedProblem>();
+  auto rsp2 = make_shared<MockRemoteSubmittedProblem>();
+  auto rsp4 = make_shared<MockRemoteSubmittedProblem>();
+
+  EXPECT_CALL(*sp1, remoteSubmittedProblemImpl()).WillOnce(Return(rsp1));
+  EXPECT_CALL(*sp2, remoteSubmittedProblemImpl()).WillOnce(Return(rsp2));
+  EXPECT_CALL(*sp3, remoteSubmittedProblemImpl()).WillOnce(Return(sapiremote::SubmittedProblemPtr()));
+  EXPECT_CALL(*sp4, remoteSubmittedProblemImpl()).WillOnce(Return(rsp4));
+  EXPECT_CALL(*rsp1, doneImpl()).WillOnce(Return(false));
+  EXPECT_CALL(*rsp2, doneImpl()).WillOnce(Return(true));
+  EXPECT_CALL(*rsp4, doneImpl()).WillOnce(Return(true));
+
+  lastAwaitCompletionMinDone = -1;
+  lastAwaitCompletionTimeout = -1.0;
+  auto doneIndices = vector<size_t>(problems.size());
+  ASSERT_EQ(3u, sapi_awaitAny(problems.data(), problems.size(), 3, 1234.5, doneIndices.data()));
+  doneIndices.resize(3);
+  EXPECT_EQ((vector<size_t>{2, 1, 3}), doneIndices);
+  auto expectedProblems = vector<sapiremote::SubmittedProblem*>{rsp1.get(), rsp2.get(), rsp4.get()};
+  EXPECT_EQ(expectedProblems, lastAwaitCompletionProblems);
+  EXPECT_EQ(2, lastAwaitCompletionMinDone);
+  EXPECT_EQ(1234.5, lastAwaitCompletionTimeout);
+}
+
+
+TEST(SolversApiTest, CompletionQueueLocal) {
+  auto sp1 = unique_ptr<MockSubmittedProblem>(new StrictMock<MockSubmittedProblem>);
+  auto sp2 = unique_ptr<MockSubmittedProblem>(new StrictMock<MockSubmittedProblem>);
+  EXPECT_CALL(*sp1, remoteSubmittedProblemImpl()).Times(3)
+      .WillRepeatedly(Return(sapiremote::SubmittedProblemPtr()));
+  EXPECT_CALL(*sp2, remoteSubmittedProblemImpl()).WillOnce(Return(sapiremote::SubmittedProblemPtr()));
+
+  sapi_CompletionQueue* cqp;
+  ASSERT_EQ(SAPI_OK, sapi_createCompletionQueue(&cqp, 0));
+  auto cq = unique_ptr<sapi_CompletionQueue, decltype(&sapi_freeCompletionQueue)>(
+      cqp, sapi_freeCompletionQueue);
+  ASSERT_EQ(SAPI_OK, sapi_completionQueueAdd(cq.get(), sp1.get(), 0));
+  ASSERT_EQ(SAPI_OK, sapi_completionQueueAdd(cq.get(), sp2.get(), 0));
+  ASSERT_EQ(SAPI_OK, sapi_completionQueueAdd(cq.get(), sp1.get(), 0));
+
+  // local problems are done right away; adding one twice has no effect
+  sapi_SubmittedProblem* popped[3] = {0, 0, 0};
+  ASSERT_EQ(2u, sapi_completionQueuePop(cq.get(), popped, 3, 0.0));
+  EXPECT_EQ(sp1.get(), popped[0]);
+  EXPECT_EQ(sp2.get(), popped[1]);
+  EXPECT_EQ(0u, sapi_completionQueuePop(cq.get(), popped, 3, 0.0));
+
+  // popped problems can be added again
+  ASSERT_EQ(SAPI_OK, sapi_completionQueueAdd(cq.get(), sp1.get(), 0));
+  ASSERT_EQ(1u, sapi_completionQueuePop(cq.get(), popped, 3, 0.0));
+  EXPECT_EQ(sp1.get(), popped[0]);
+}
+
+
 TEST(SolversApiTest, RetryRemote) {
   auto problem = unique_ptr<MockSubmittedProblem>(new StrictMock<MockSubmittedProblem>);
   auto rsp = make_shared<MockRemoteSubmittedProblem>();
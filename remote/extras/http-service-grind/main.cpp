@@ -1,13 +1,17 @@
 //Copyright © 2019 D-Wave Systems Inc.
 //The software is licensed to authorized users only under the applicable license agreement.  See License.txt.
 
+#include <algorithm>
+#include <chrono>
 #include <cstdlib>
 #include <condition_variable>
 #include <iostream>
 #include <exception>
+#include <functional>
 #include <memory>
 #include <mutex>
 #include <string>
+#include <vector>
 
 #include <http-service.hpp>
 
@@ -23,6 +27,9 @@ using std::rethrow_exception;
 using std::string;
 using std::to_string;
 using std::unique_lock;
+using std::vector;
+using std::chrono::steady_clock;
+using std::chrono::duration;
 
 using namespace sapiremote;
 using namespace sapiremote::http;
@@ -63,9 +70,114 @@ public:
   }
 };
 
+//=========================================================================================================
+//
+// Transport benchmark: keeps a fixed number of GET requests in flight through a single HttpService and
+// records per-request latency.  Point it at a loopback server that speaks HTTP/2 over TLS (e.g.
+// nghttpd) to compare the HTTP/1.1 and HTTP/2 multiplexed transports.
+//
+
+class BenchState {
+private:
+  mutable mutex mutex_;
+  mutable condition_variable cv_;
+  int inFlight_;
+  int errors_;
+  vector<double> latenciesMs_;
+
+public:
+  BenchState() : inFlight_(0), errors_(0) {}
+
+  void start(int maxInFlight) {
+    unique_lock<mutex> lock(mutex_);
+    while (inFlight_ >= maxInFlight) cv_.wait(lock);
+    ++inFlight_;
+  }
+
+  void finish(double latencyMs, bool ok) {
+    lock_guard<mutex> lock(mutex_);
+    --inFlight_;
+    latenciesMs_.push_back(latencyMs);
+    if (!ok) ++errors_;
+    cv_.notify_all();
+  }
+
+  void waitAll() const {
+    unique_lock<mutex> lock(mutex_);
+    while (inFlight_ > 0) cv_.wait(lock);
+  }
+
+  int errors() const { return errors_; }
+  vector<double> latenciesMs() const { return latenciesMs_; }
+};
+
+class BenchCallback : public HttpCallback {
+  BenchState& state_;
+  steady_clock::time_point start_;
+
+  void finish(bool ok) {
+    state_.finish(duration<double, std::milli>(steady_clock::now() - start_).count(), ok);
+  }
+
+  virtual void completeImpl(int statusCode, std::shared_ptr<std::string>) { finish(statusCode == statusCodes::OK); }
+  virtual void errorImpl(std::exception_ptr) { finish(false); }
+
+public:
+  BenchCallback(BenchState& state) : state_(state), start_(steady_clock::now()) {}
+};
+
+double percentile(const vector<double>& sorted, double p) {
+  if (sorted.empty()) return 0.0;
+  auto i = static_cast<size_t>(p * (sorted.size() - 1) + 0.5);
+  return sorted[i];
+}
+
+void runBenchmark(
+    const char* name, transports::Type transport, const string& url, int requests, int concurrency, int ioThreads) {
+  HttpServiceOptions options = HttpServiceOptions();
+  options.numCallbackThreads = 2;
+  options.numIoThreads = ioThreads;
+  options.transport = transport;
+  auto httpService = makeHttpService(options);
+
+  // warm up: connection setup and TLS handshake aren't part of the measurement
+  auto warmup = make_shared<Callback>();
+  httpService->asyncGet(url, HttpHeaders(), Proxy(), warmup);
+  warmup->result();
+
+  BenchState state;
+  auto t0 = steady_clock::now();
+  for (auto i = 0; i < requests; ++i) {
+    state.start(concurrency);
+    try {
+      httpService->asyncGet(url, HttpHeaders(), Proxy(), make_shared<BenchCallback>(std::ref(state)));
+    } catch (...) {
+      state.finish(0.0, false);
+    }
+  }
+  state.waitAll();
+  auto elapsedS = duration<double>(steady_clock::now() - t0).count();
+
+  auto latencies = state.latenciesMs();
+  std::sort(latencies.begin(), latencies.end());
+  auto total = 0.0;
+  for (auto iter = latencies.begin(), end = latencies.end(); iter != end; ++iter) total += *iter;
+
+  auto stats = httpService->stats();
+  cout << name << ": " << requests << " requests, " << state.errors() << " errors, "
+      << (requests / elapsedS) << " req/s\n"
+      << "  latency ms: mean " << (latencies.empty() ? 0.0 : total / latencies.size())
+      << " p50 " << percentile(latencies, 0.5)
+      << " p90 " << percentile(latencies, 0.9)
+      << " p99 " << percentile(latencies, 0.99)
+      << " max " << (latencies.empty() ? 0.0 : latencies.back()) << "\n"
+      << "  easy handles created: " << stats.handlePoolMisses << "\n";
+}
+
 int main(int argc, char* argv[]) {
-  if (argc != 3) {
-    cerr << "Usage: " << argv[0] << " <url> [requests=1]\n";
+  if (argc < 3 || argc > 5) {
+    cerr << "Usage: " << argv[0] << " <url> [requests=1]\n"
+        << "       " << argv[0] << " <url> <requests> <concurrency> [io-threads=1]  (HTTP/1.1 vs HTTP/2 benchmark)\n";
     return 1;
   }
 
@@ -76,6 +188,22 @@ int main(int argc, char* argv[]) {
     return 1;
   }
 
+  if (argc >= 4) {
+    auto concurrency = atoi(argv[3]);
+    if (concurrency < 1) {
+      cerr << "concurrency must be a positive integer\n";
+      return 1;
+    }
+    auto ioThreads = argc == 5 ? atoi(argv[4]) : 1;
+    if (ioThreads < 1) {
+      cerr << "number of I/O threads must be a positive integer\n";
+      return 1;
+    }
+    runBenchmark("HTTP/1.1", transports::HTTP_1_1, url, requests, concurrency, ioThreads);
+    runBenchmark("HTTP/2", transports::HTTP_2_MULTIPLEX, url, requests, concurrency, ioThreads);
+    return 0;
+  }
+
   for (auto i = 0; i < requests; ++i) {
     auto httpService = makeHttpService(2);
     auto callback = make_shared<Callback>();
@@ -47,10 +47,17 @@ using sapiremote::makeRetryTimerService;
 const ProblemManagerLimits limits = {
     20,  // maxProblemsPerSubmission
     100, // maxIdsPerStatusQuery
-    6    // maxActiveRequests
+    6,   // maxActiveRequests
+    0,   // answerCacheBytes
+    0,   // maxAnswerPrefetches
+    0,   // minPollIntervalMs
+    0,   // maxPollIntervalMs
+    0,   // longPollWaitS
+    {},  // schedule
+    {16, 50, 500} // adaptive ceilings: active requests, problems per submission, IDs per status query
 };
 
-const RetryTiming retryTiming = { 1, 16, 2.0f };
+const RetryTiming retryTiming = { 1, 16, 2.0f, 0.5f };
 
 ProblemManagerPtr createProblemManager(string url, string token) {
   auto sapiService = makeSapiService(makeHttpService(2), std::move(url), std::move(token), Proxy{});
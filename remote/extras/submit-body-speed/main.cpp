@@ -0,0 +1,124 @@
+//Copyright © 2019 D-Wave Systems Inc.
+//The software is licensed to authorized users only under the applicable license agreement.  See License.txt.
+
+// Submission body serialization speed: json::Array tree + jsonToString (the old submit path) versus the
+// SAPI service's streaming writer.
+//
+// usage: submit-body-speed [problems-per-batch [qubits [iterations]]]
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include <chrono>
+
+#include <boost/foreach.hpp>
+
+#include <base64.hpp>
+#include <http-service.hpp>
+#include <sapi-service.hpp>
+#include <json.hpp>
+
+using std::atoi;
+using std::cout;
+using std::make_shared;
+using std::string;
+using std::vector;
+using std::chrono::steady_clock;
+using std::chrono::duration_cast;
+using std::chrono::microseconds;
+
+using sapiremote::Problem;
+using sapiremote::http::HttpService;
+using sapiremote::http::HttpHeaders;
+using sapiremote::http::HttpServiceStats;
+using sapiremote::http::HttpCallbackPtr;
+using sapiremote::http::Proxy;
+
+namespace {
+
+// Keeps the size of the last POST body; never sends anything
+class NullHttpService : public HttpService {
+private:
+  virtual void asyncGetImpl(const string&, const HttpHeaders&, const Proxy&, HttpCallbackPtr) {}
+  virtual void asyncPostImpl(const string&, const HttpHeaders&, string& data, const Proxy&, HttpCallbackPtr) {
+    bodySize = data.size();
+  }
+  virtual void asyncDeleteImpl(const string&, const HttpHeaders&, string&, const Proxy&, HttpCallbackPtr) {}
+  virtual void shutdownImpl() {}
+  virtual HttpServiceStats statsImpl() const { return HttpServiceStats(); }
+public:
+  NullHttpService() : bodySize(0) {}
+  std::size_t bodySize;
+};
+
+class NullStatusCallback : public sapiremote::StatusSapiCallback {
+  virtual void completeImpl(vector<sapiremote::RemoteProblemInfo>&) {}
+  virtual void errorImpl(std::exception_ptr) {}
+};
+
+// qp format problem with roughly Chimera-like coupler density
+Problem makeProblem(int numQubits) {
+  vector<double> lin(numQubits);
+  vector<double> quad(numQubits * 3);
+  for (auto i = 0u; i < lin.size(); ++i) lin[i] = (i % 7) * 0.25 - 0.75;
+  for (auto i = 0u; i < quad.size(); ++i) quad[i] = (i % 5) * 0.5 - 1.0;
+
+  json::Object data;
+  data["format"] = "qp";
+  data["lin"] = sapiremote::encodeBase64(lin);
+  data["quad"] = sapiremote::encodeBase64(quad);
+
+  json::Object params;
+  params["num_reads"] = 1000;
+  params["annealing_time"] = 20;
+  params["auto_scale"] = true;
+  params["label"] = "submit-body-speed";
+
+  return Problem("solver", "ising", std::move(data), std::move(params));
+}
+
+string treeBody(const vector<Problem>& problems) {
+  json::Array body;
+  BOOST_FOREACH( const auto& p, problems ) {
+    json::Object o;
+    o["solver"] = p.solver();
+    o["type"] = p.type();
+    o["data"] = p.data();
+    o["params"] = p.params();
+    body.push_back(std::move(o));
+  }
+  return json::jsonToString(body);
+}
+
+} // namespace {anonymous}
+
+int main(int argc, char* argv[]) {
+  auto batchSize = argc > 1 ? atoi(argv[1]) : 20;
+  auto numQubits = argc > 2 ? atoi(argv[2]) : 2048;
+  auto iterations = argc > 3 ? atoi(argv[3]) : 100;
+
+  vector<Problem> problems(batchSize, makeProblem(numQubits));
+
+  std::size_t treeSize = 0;
+  auto t0 = steady_clock::now();
+  for (auto i = 0; i < iterations; ++i) treeSize = treeBody(problems).size();
+  auto t1 = steady_clock::now();
+
+  auto httpService = make_shared<NullHttpService>();
+  auto sapiService = sapiremote::makeSapiService(httpService, "https://localhost/sapi/", "token", Proxy());
+  auto callback = make_shared<NullStatusCallback>();
+  auto t2 = steady_clock::now();
+  for (auto i = 0; i < iterations; ++i) sapiService->submitProblems(problems, callback);
+  auto t3 = steady_clock::now();
+
+  auto treeUs = duration_cast<microseconds>(t1 - t0).count() / iterations;
+  auto streamUs = duration_cast<microseconds>(t3 - t2).count() / iterations;
+  cout << batchSize << " problems x " << numQubits << " qubits, body " << treeSize << " / "
+      << httpService->bodySize << " bytes\n";
+  cout << "tree + jsonToString: " << treeUs << " us/batch\n";
+  cout << "streaming writer:    " << streamUs << " us/batch\n";
+  return 0;
+}
@@ -0,0 +1,163 @@
+//Copyright © 2019 D-Wave Systems Inc.
+//The software is licensed to authorized users only under the applicable license agreement.  See License.txt.
+
+// Problem submission throughput with many producer threads calling submitProblem at once, against a
+// stub SapiService that completes every submission right away (from a small thread pool, like HTTP
+// responses).  Measures ProblemManager overhead and lock contention only; nothing goes over the network.
+//
+// usage: submit-contention [threads [problems-per-thread [problems-per-submission]]]
+
+#include <chrono>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/foreach.hpp>
+
+#include <sapi-service.hpp>
+#include <retry-service.hpp>
+#include <answer-service.hpp>
+#include <problem-manager.hpp>
+#include <threadpool.hpp>
+#include <json.hpp>
+
+namespace sapiremote {
+
+extern char const * const userAgent = "sapi-remote/submit-contention";
+
+} // namespace sapiremote
+
+using std::atoi;
+using std::cerr;
+using std::cout;
+using std::make_shared;
+using std::string;
+using std::thread;
+using std::vector;
+using std::chrono::steady_clock;
+using std::chrono::duration;
+using std::chrono::milliseconds;
+
+using sapiremote::AdaptiveLimits;
+using sapiremote::CancelSapiCallbackPtr;
+using sapiremote::FetchAnswerSapiCallbackPtr;
+using sapiremote::Problem;
+using sapiremote::ProblemManagerLimits;
+using sapiremote::RemoteProblemInfo;
+using sapiremote::RequestSchedule;
+using sapiremote::SapiService;
+using sapiremote::SapiServiceStats;
+using sapiremote::SolversSapiCallbackPtr;
+using sapiremote::StatusSapiCallbackPtr;
+using sapiremote::SubmittedProblemPtr;
+using sapiremote::ThreadPoolPtr;
+using sapiremote::makeAnswerService;
+using sapiremote::makeProblemManager;
+using sapiremote::makeRetryTimerService;
+using sapiremote::makeThreadPool;
+using sapiremote::defaultRetryTiming;
+
+namespace remotestatuses = sapiremote::remotestatuses;
+
+namespace {
+
+class StubSapiService : public SapiService {
+private:
+  ThreadPoolPtr responders_;
+
+  virtual void fetchSolversImpl(SolversSapiCallbackPtr) {}
+
+  virtual void submitProblemsImpl(vector<Problem>& problems, StatusSapiCallbackPtr callback) {
+    auto info = make_shared<vector<RemoteProblemInfo>>(problems.size());
+    BOOST_FOREACH( auto& rpi, *info ) {
+      rpi.id = "id";
+      rpi.type = "ising";
+      rpi.status = remotestatuses::COMPLETED;
+    }
+    responders_->post([callback, info] { callback->complete(*info); });
+  }
+
+  virtual void multiProblemStatusImpl(const vector<string>&, StatusSapiCallbackPtr) {}
+  virtual void longPollStatusImpl(const vector<string>&, int, StatusSapiCallbackPtr) {}
+  virtual void fetchAnswerImpl(const string&, FetchAnswerSapiCallbackPtr) {}
+  virtual void cancelProblemsImpl(const vector<string>&, CancelSapiCallbackPtr) {}
+  virtual SapiServiceStats statsImpl() const { return SapiServiceStats(); }
+
+public:
+  StubSapiService() : responders_(makeThreadPool(2)) {}
+  ~StubSapiService() { responders_->shutdown(); }
+};
+
+// Fixed limits, so the numbers don't depend on adaptation.  Only the submission batch size varies; nothing
+// is polled or fetched.
+ProblemManagerLimits contentionLimits(int perSubmission) {
+  ProblemManagerLimits limits;
+  limits.maxProblemsPerSubmission = perSubmission;
+  limits.maxIdsPerStatusQuery = 100;
+  limits.maxActiveRequests = 6;
+  limits.answerCacheBytes = 0;
+  limits.maxAnswerPrefetches = 0;
+  limits.minPollIntervalMs = 0;
+  limits.maxPollIntervalMs = 0;
+  limits.longPollWaitS = 0;
+  limits.schedule = RequestSchedule();
+  limits.adaptive = AdaptiveLimits();
+  return limits;
+}
+
+} // namespace {anonymous}
+
+int main(int argc, char* argv[]) {
+  auto numThreads = argc > 1 ? atoi(argv[1]) : 32;
+  auto perThread = argc > 2 ? atoi(argv[2]) : 10000;
+  auto perSubmission = argc > 3 ? atoi(argv[3]) : 20;
+  if (numThreads < 1 || perThread < 1 || perSubmission < 1) {
+    cerr << "usage: submit-contention [threads [problems-per-thread [problems-per-submission]]]\n";
+    return 1;
+  }
+
+  auto limits = contentionLimits(perSubmission);
+  auto sapiService = make_shared<StubSapiService>();
+  auto retryService = makeRetryTimerService();
+  auto problemManager = makeProblemManager(sapiService, makeAnswerService(makeThreadPool(1)), retryService,
+      defaultRetryTiming(), limits);
+
+  auto data = json::Value(json::Array{1, 2, 3});
+  auto params = json::Object();
+  vector<vector<SubmittedProblemPtr>> submitted(numThreads);
+  vector<thread> producers;
+
+  auto t0 = steady_clock::now();
+  for (auto i = 0; i < numThreads; ++i) {
+    auto& mine = submitted[i];
+    producers.push_back(thread([&, perThread] {
+      mine.reserve(perThread);
+      for (auto j = 0; j < perThread; ++j) {
+        mine.push_back(problemManager->submitProblem("solver", "ising", data, params));
+      }
+    }));
+  }
+  BOOST_FOREACH( auto& t, producers ) t.join();
+  auto t1 = steady_clock::now();
+
+  BOOST_FOREACH( const auto& problems, submitted ) {
+    BOOST_FOREACH( const auto& sp, problems ) {
+      while (!sp->done()) std::this_thread::sleep_for(milliseconds(1));
+    }
+  }
+  auto t2 = steady_clock::now();
+
+  auto total = static_cast<double>(numThreads) * perThread;
+  auto intakeS = duration<double>(t1 - t0).count();
+  auto allS = duration<double>(t2 - t0).count();
+  cout << numThreads << " threads x " << perThread << " problems, " << perSubmission << " per submission\n";
+  cout << "submitProblem calls: " << static_cast<long long>(total / intakeS) << " problems/s\n";
+  cout << "until all submitted: " << static_cast<long long>(total / allS) << " problems/s\n";
+
+  retryService->shutdown();
+  return 0;
+}
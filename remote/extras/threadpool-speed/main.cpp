@@ -0,0 +1,159 @@
+//Copyright © 2019 D-Wave Systems Inc.
+//The software is licensed to authorized users only under the applicable license agreement.  See License.txt.
+
+// ThreadPool throughput with 1-32 producer threads posting small tasks at once, compared with the
+// previous single-queue pool (one std::queue of std::function behind one mutex, reproduced below).  Each
+// task captures a shared_ptr, like the HTTP and answer callbacks do.
+//
+// usage: threadpool-speed [pool-threads [posts-per-producer]]
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+#include <boost/foreach.hpp>
+#include <boost/noncopyable.hpp>
+
+#include <threadpool.hpp>
+
+namespace sapiremote {
+
+extern char const * const userAgent = "sapi-remote/threadpool-speed";
+
+} // namespace sapiremote
+
+using std::atoi;
+using std::atomic;
+using std::bind;
+using std::cerr;
+using std::condition_variable;
+using std::cout;
+using std::function;
+using std::make_shared;
+using std::mutex;
+using std::queue;
+using std::thread;
+using std::unique_lock;
+using std::vector;
+using std::chrono::duration;
+using std::chrono::steady_clock;
+
+using sapiremote::makeThreadPool;
+
+namespace {
+
+// the previous ThreadPoolImpl, minus exception handling
+class SingleQueueThreadPool : boost::noncopyable {
+private:
+  queue<function<void()>> workQueue_;
+  vector<thread> threads_;
+  mutex mutex_;
+  condition_variable cv_;
+  bool running_;
+
+  void threadFn() {
+    for (;;) {
+      unique_lock<mutex> lock(mutex_);
+      while (running_  && workQueue_.empty()) cv_.wait(lock);
+      if (!running_) break;
+
+      auto work = workQueue_.front();
+      workQueue_.pop();
+      lock.unlock();
+      work();
+    }
+  }
+
+public:
+  SingleQueueThreadPool(int threads) : running_(true) {
+    for (auto i = 0; i < threads; ++i) {
+      threads_.push_back(thread(bind(&SingleQueueThreadPool::threadFn, this)));
+    }
+  }
+  ~SingleQueueThreadPool() { shutdown(); }
+
+  void shutdown() {
+    unique_lock<mutex> lock(mutex_);
+    running_ = false;
+    cv_.notify_all();
+    lock.unlock();
+    BOOST_FOREACH( auto& t, threads_ ) if (t.joinable()) t.join();
+  }
+
+  void post(function<void()> f) {
+    unique_lock<mutex> lock(mutex_);
+    workQueue_.push(std::move(f));
+    cv_.notify_one();
+  }
+};
+
+struct Target : boost::noncopyable {
+  atomic<long long> count;
+  Target() : count(0) {}
+  void hit() { ++count; }
+};
+
+struct Result {
+  double postsPerS;
+  double tasksPerS;
+};
+
+template<typename Pool>
+Result run(Pool& pool, int producers, int perProducer) {
+  auto target = make_shared<Target>();
+  auto total = static_cast<long long>(producers) * perProducer;
+  vector<thread> threads;
+
+  auto t0 = steady_clock::now();
+  for (auto i = 0; i < producers; ++i) {
+    threads.push_back(thread([&pool, target, perProducer] {
+      for (auto j = 0; j < perProducer; ++j) pool.post(bind(&Target::hit, target));
+    }));
+  }
+  BOOST_FOREACH( auto& t, threads ) t.join();
+  auto t1 = steady_clock::now();
+  while (target->count < total) std::this_thread::yield();
+  auto t2 = steady_clock::now();
+
+  Result r = {total / duration<double>(t1 - t0).count(), total / duration<double>(t2 - t0).count()};
+  return r;
+}
+
+} // namespace {anonymous}
+
+int main(int argc, char* argv[]) {
+  auto poolThreads = argc > 1 ? atoi(argv[1]) : 4;
+  auto perProducer = argc > 2 ? atoi(argv[2]) : 100000;
+  if (poolThreads < 1 || perProducer < 1) {
+    cerr << "usage: threadpool-speed [pool-threads [posts-per-producer]]\n";
+    return 1;
+  }
+
+  cout << poolThreads << " pool threads, " << perProducer << " posts per producer\n";
+  cout << "producers  single-queue posts/s  tasks/s  work-stealing posts/s  tasks/s  steals\n";
+  for (auto producers = 1; producers <= 32; producers *= 2) {
+    Result rs;
+    {
+      SingleQueueThreadPool single(poolThreads);
+      rs = run(single, producers, perProducer);
+    }
+
+    auto stealing = makeThreadPool(poolThreads);
+    auto rw = run(*stealing, producers, perProducer);
+    auto stats = stealing->stats();
+    stealing->shutdown();
+
+    cout << producers << "  " << static_cast<long long>(rs.postsPerS) << "  "
+        << static_cast<long long>(rs.tasksPerS) << "  " << static_cast<long long>(rw.postsPerS) << "  "
+        << static_cast<long long>(rw.tasksPerS) << "  " << stats.steals << "\n";
+  }
+  return 0;
+}
@@ -0,0 +1,71 @@
+//Copyright © 2019 D-Wave Systems Inc.
+//The software is licensed to authorized users only under the applicable license agreement.  See License.txt.
+
+#ifndef ANSWER_CACHE_HPP_INCLUDED
+#define ANSWER_CACHE_HPP_INCLUDED
+
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include <boost/noncopyable.hpp>
+
+#include "json.hpp"
+
+namespace sapiremote {
+
+struct CachedAnswer {
+  std::string type;
+  json::Value answer;
+};
+typedef std::shared_ptr<const CachedAnswer> CachedAnswerPtr;
+
+struct AnswerCacheStats {
+  unsigned long long hits;
+  unsigned long long misses;
+  unsigned long long evictions;
+  std::size_t entries;
+  std::size_t bytes;        // approximate memory used by cached answers
+};
+
+// Answers of completed problems never change, so they can be kept and handed out again instead of being
+// downloaded for every request.  Least recently used answers are evicted once the approximate memory
+// used exceeds maxBytes.  Thread safe.
+class AnswerCache : boost::noncopyable {
+private:
+  struct Entry {
+    std::string id;
+    CachedAnswerPtr answer;
+    std::size_t bytes;
+  };
+  typedef std::list<Entry> EntryList;
+
+  const std::size_t maxBytes_;
+  mutable std::mutex mutex_;
+  EntryList entries_; // most recently used first
+  std::unordered_map<std::string, EntryList::iterator> index_;
+  AnswerCacheStats stats_;
+
+public:
+  AnswerCache(std::size_t maxBytes);
+
+  bool enabled() const { return maxBytes_ > 0; }
+
+  // returns null if id isn't cached
+  CachedAnswerPtr find(const std::string& id);
+
+  // answers larger than the whole budget aren't cached
+  void insert(const std::string& id, CachedAnswerPtr answer);
+
+  AnswerCacheStats stats() const;
+};
+
+// Rough number of bytes of memory used by a decoded JSON value
+std::size_t approximateSize(const json::Value& value);
+
+} // namespace sapiremote
+
+#endif
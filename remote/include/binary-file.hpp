@@ -0,0 +1,38 @@
+//Copyright © 2019 D-Wave Systems Inc.
+//The software is licensed to authorized users only under the applicable license agreement.  See License.txt.
+
+#ifndef BINARY_FILE_HPP_INCLUDED
+#define BINARY_FILE_HPP_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+namespace sapiremote {
+
+// FNV-1a; unlike std::hash, stable between builds
+std::uint32_t fnv1a32(const char* data, std::size_t n);
+std::uint64_t fnv1a64(const char* data, std::size_t n);
+
+// magic followed by a byte order mark: files are written in native byte order and aren't portable between
+// architectures
+std::string binaryFileHeader(const char* magic);
+
+// appends the whole file to contents; false if it can't be opened or read
+bool readFile(const std::string& path, std::string& contents);
+
+bool writeAll(std::FILE* f, const std::string& data);
+
+// flushes f and waits until its contents are on disk
+bool syncFile(std::FILE* f);
+
+// Writes contents to tmpPath, then moves it over path in one step, so readers and crashes see either the old
+// file or the new one.  durable: also waits until the new file and the move are on disk.  Nothing is left
+// at tmpPath on failure.
+bool replaceFile(const std::string& path, const std::string& tmpPath, const std::string& contents,
+    bool durable);
+
+} // namespace sapiremote
+
+#endif
@@ -0,0 +1,54 @@
+//Copyright © 2019 D-Wave Systems Inc.
+//The software is licensed to authorized users only under the applicable license agreement.  See License.txt.
+
+#ifndef COMPLETION_QUEUE_HPP_INCLUDED
+#define COMPLETION_QUEUE_HPP_INCLUDED
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "problem.hpp"
+
+namespace sapiremote {
+
+// Collects problems as they finish, in completion order.  Problems are attached once and each is handed
+// back once, when it first completes or fails; problems retried after failing must be attached again.
+// Unlike awaitCompletion, waiting doesn't cost anything per attached problem, so it suits callers that
+// keep many problems outstanding and check on them often.  The queue keeps attached problems alive until
+// they are popped.  Thread safe.
+class CompletionQueue {
+private:
+  virtual void addImpl(const SubmittedProblemPtr& problem) = 0;
+  virtual std::size_t popImpl(std::vector<SubmittedProblemPtr>& problems, std::size_t maxProblems,
+      double timeoutS) = 0;
+  virtual std::size_t sizeImpl() const = 0;
+  virtual int notificationFdImpl() const = 0;
+
+public:
+  virtual ~CompletionQueue() {}
+
+  // no effect if the problem is already attached and not yet popped
+  void add(const SubmittedProblemPtr& problem) { addImpl(problem); }
+
+  // Waits up to timeoutS seconds for a finished problem, then appends up to maxProblems finished problems
+  // to problems.  Returns the number appended (0 if none finished in time or maxProblems is 0).
+  std::size_t pop(std::vector<SubmittedProblemPtr>& problems, std::size_t maxProblems, double timeoutS) {
+    return popImpl(problems, maxProblems, timeoutS);
+  }
+
+  // problems attached and not yet popped, finished or not
+  std::size_t size() const { return sizeImpl(); }
+
+  // File descriptor that polls readable while finished problems are waiting to be popped, for use with
+  // select, poll, epoll and the like (an eventfd on Linux, a pipe on other POSIX systems).  Don't read
+  // from it or close it.  -1 on Windows.
+  int notificationFd() const { return notificationFdImpl(); }
+};
+typedef std::shared_ptr<CompletionQueue> CompletionQueuePtr;
+
+CompletionQueuePtr makeCompletionQueue();
+
+} // namespace sapiremote
+
+#endif
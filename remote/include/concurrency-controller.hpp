@@ -0,0 +1,104 @@
+//Copyright © 2019 D-Wave Systems Inc.
+//The software is licensed to authorized users only under the applicable license agreement.  See License.txt.
+
+#ifndef CONCURRENCY_CONTROLLER_HPP_INCLUDED
+#define CONCURRENCY_CONTROLLER_HPP_INCLUDED
+
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+#include "request-scheduler.hpp"
+
+namespace sapiremote {
+
+namespace concurrencyknobs {
+enum Type { ACTIVE_REQUESTS, PROBLEMS_PER_SUBMISSION, IDS_PER_STATUS_QUERY };
+const int count = IDS_PER_STATUS_QUERY + 1;
+} // namespace sapiremote::concurrencyknobs
+
+namespace concurrencyreasons {
+enum Type {
+  HEALTHY,      // a window of responses came back without errors or latency spikes
+  LATENCY,      // response time jumped well above the lowest seen recently
+  FAILURE,      // network error or bad response (e.g. HTTP 5xx)
+  TOO_MANY_IDS  // the server rejected a status query for having too many problem IDs
+};
+} // namespace sapiremote::concurrencyreasons
+
+struct ConcurrencyDecision {
+  double timeS; // since the controller was created
+  concurrencyknobs::Type knob;
+  concurrencyreasons::Type reason;
+  int value;    // new limit
+};
+
+struct ConcurrencyControllerStats {
+  int limits[concurrencyknobs::count]; // current values, indexed by concurrencyknobs::Type
+  unsigned long long increases;
+  unsigned long long decreases;
+  std::vector<ConcurrencyDecision> recentDecisions; // oldest first
+};
+
+// Additive-increase/multiplicative-decrease control of request concurrency and batch sizes.  Every response
+// counts towards the request-slot knob and, for submissions and status queries, the matching batch-size
+// knob.  A knob grows by its step after a window of healthy responses as long as its current value, and is
+// cut to 70% on an error or a latency spike, then left alone for a window so that responses to requests
+// sent before the cut don't cut it again.  A latency spike is a response slower than three times the
+// lowest recent latency of its request class (plus some slack for jitter).  Knobs whose ceiling is no
+// higher than their initial value stay fixed, except that TOO_MANY_IDS always shrinks the status query
+// size, and caps it from then on.  Thread safe.
+class ConcurrencyController {
+private:
+  struct Knob {
+    int value;
+    int floor;
+    int ceiling;
+    int step;
+    int healthy;  // healthy responses since the last change
+    int holdOff;  // responses to ignore before cutting again
+  };
+
+  struct Baseline {
+    double latencyS; // lowest recent latency (< 0: none yet)
+    int samples;
+  };
+
+  mutable std::mutex mutex_;
+  std::chrono::steady_clock::time_point start_;
+  Knob knobs_[concurrencyknobs::count];
+  Baseline baselines_[requestclasses::count];
+  unsigned long long increases_;
+  unsigned long long decreases_;
+  std::deque<ConcurrencyDecision> decisions_;
+
+  bool spike(requestclasses::Type c, double latencyS);
+  void healthy(concurrencyknobs::Type knob);
+  void cut(concurrencyknobs::Type knob, concurrencyreasons::Type reason);
+  void record(concurrencyknobs::Type knob, concurrencyreasons::Type reason);
+
+public:
+  static const int maxRecentDecisions = 32;
+
+  // values, floors and ceilings are indexed by concurrencyknobs::Type; values must lie between the floors
+  // and ceilings (a ceiling below its value fixes the knob)
+  ConcurrencyController(const int values[], const int floors[], const int ceilings[]);
+
+  int limit(concurrencyknobs::Type knob) const;
+
+  // latencyS < 0: no latency sample (e.g. long polls, which the server holds open on purpose)
+  void responseOk(requestclasses::Type c, double latencyS);
+
+  // the request failed in a way that suggests overload
+  void responseFailed(requestclasses::Type c);
+
+  // cuts the status query size regardless of hold-off; returns false if it is already 1
+  bool tooManyIds();
+
+  ConcurrencyControllerStats stats() const;
+};
+
+} // namespace sapiremote
+
+#endif
@@ -0,0 +1,73 @@
+//Copyright © 2019 D-Wave Systems Inc.
+//The software is licensed to authorized users only under the applicable license agreement.  See License.txt.
+
+#ifndef EASY_HANDLE_POOL_HPP_INCLUDED
+#define EASY_HANDLE_POOL_HPP_INCLUDED
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+
+#include <curl/curl.h>
+
+#include "http-service.hpp"
+
+namespace sapiremote {
+namespace http {
+
+class EasyHandlePool;
+typedef std::shared_ptr<EasyHandlePool> EasyHandlePoolPtr;
+
+struct ReleaseEasyHandle {
+  EasyHandlePoolPtr pool;
+  void operator()(CURL* h);
+};
+typedef std::unique_ptr<CURL, ReleaseEasyHandle> EasyHandlePtr;
+
+// Easy handles are reset and recycled instead of being destroyed after every request.  All handles
+// share DNS and SSL session caches through a single share handle.  Connections are cached by the multi
+// handle that runs the transfers, so handles used with the same multi handle share them without help.
+class EasyHandlePool : public std::enable_shared_from_this<EasyHandlePool>, boost::noncopyable {
+private:
+  struct CleanupShareHandle { void operator()(CURLSH* h) { curl_share_cleanup(h); } };
+
+  std::mutex shareMutexes_[CURL_LOCK_DATA_LAST];
+  std::unique_ptr<CURLSH, CleanupShareHandle> shareHandle_;
+  std::mutex mutex_;
+  std::vector<CURL*> idleHandles_;
+  std::size_t size_;
+  unsigned long long hits_;
+  unsigned long long misses_;
+  bool open_;
+
+  static void lockShare(CURL*, curl_lock_data data, curl_lock_access, void* userp);
+  static void unlockShare(CURL*, curl_lock_data data, void* userp);
+
+  template<typename T>
+  void setopt(CURLSHoption option, T value);
+
+  void cleanupHandle(CURL* h);
+
+public:
+  static const std::size_t maxIdleHandles = 32;
+
+  EasyHandlePool();
+  ~EasyHandlePool();
+
+  EasyHandlePtr acquire();
+  void release(CURL* h);
+
+  // destroy idle handles and the share handle; handles still in use are destroyed when released
+  void close();
+
+  // sets the handle pool fields only
+  void stats(HttpServiceStats& s);
+};
+
+} // namespace sapiremote::http
+} // namespace sapiremote
+
+#endif
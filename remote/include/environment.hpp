@@ -0,0 +1,18 @@
+//Copyright © 2019 D-Wave Systems Inc.
+//The software is licensed to authorized users only under the applicable license agreement.  See License.txt.
+
+#ifndef ENVIRONMENT_HPP_INCLUDED
+#define ENVIRONMENT_HPP_INCLUDED
+
+namespace sapiremote {
+
+// Sets value from the environment variable if it holds a positive integer; leaves it alone otherwise.
+void readEnvironment(const char* name, int& value);
+
+// maxAnswerPrefetches value from DWAVE_SAPI_ANSWER_PREFETCHES; 0 (no prefetching) unless the variable holds a
+// positive integer
+int environmentAnswerPrefetches();
+
+} // namespace sapiremote
+
+#endif
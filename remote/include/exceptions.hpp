@@ -55,6 +55,16 @@ public:
     Exception("Bad server response from <" + url + ">: " + msg) {}
 };
 
+class HttpStatusException : public CommunicationException {
+private:
+  int statusCode_;
+public:
+  HttpStatusException(int statusCode, const std::string& url) :
+    CommunicationException("HTTP status code " + std::to_string(static_cast<long long>(statusCode)), url),
+    statusCode_(statusCode) {}
+  int statusCode() const { return statusCode_; }
+};
+
 class TooManyProblemIdsException : public CommunicationException {
 public:
   TooManyProblemIdsException(const std::string& url) :
@@ -89,6 +99,14 @@ public:
 
 
 
+class JournalException : public Exception {
+public:
+  JournalException(const std::string& msg, const std::string& path) :
+    Exception("Problem journal error: " + msg + " (" + path + ")") {}
+};
+
+
+
 class InternalException : public Exception {
 public:
   InternalException(const std::string& msg) : Exception("Internal error: " + msg) {}
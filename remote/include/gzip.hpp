@@ -0,0 +1,16 @@
+//Copyright © 2019 D-Wave Systems Inc.
+//The software is licensed to authorized users only under the applicable license agreement.  See License.txt.
+
+#ifndef GZIP_HPP_INCLUDED
+#define GZIP_HPP_INCLUDED
+
+#include <string>
+
+namespace sapiremote {
+
+std::string gzipCompress(const std::string& data);
+std::string gzipDecompress(const std::string& gzData);
+
+} // namespace sapiremote
+
+#endif
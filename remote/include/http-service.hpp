@@ -4,6 +4,7 @@
 #ifndef HTTP_SERVICE_HPP_INCLUDED
 #define HTTP_SERVICE_HPP_INCLUDED
 
+#include <cstddef>
 #include <exception>
 #include <map>
 #include <memory>
@@ -16,11 +17,23 @@ namespace http {
 namespace statusCodes {
 enum Type {
   OK = 200,
+  NOT_MODIFIED = 304,
+  BAD_REQUEST = 400,
   UNAUTHORIZED = 401,
+  NOT_FOUND = 404,
+  METHOD_NOT_ALLOWED = 405,
   REQUEST_URI_TOO_LONG = 414,
+  NOT_IMPLEMENTED = 501,
 };
 } // namespace sapiremote::http::statusCodes
 
+namespace transports {
+enum Type {
+  HTTP_1_1,        // one request at a time per connection
+  HTTP_2_MULTIPLEX // HTTP/2 over TLS (HTTP/1.1 fallback), concurrent requests share connections
+};
+} // namespace sapiremote::http::transports
+
 class Proxy {
 private:
   std::string url_;
@@ -36,20 +49,59 @@ public:
   bool enabled() const { return enabled_; }
 };
 
+// Timing and size details of a completed request.  Times are in seconds from the start of the request
+// (i.e. cumulative, as reported by libcurl) and are zero when not applicable, e.g. appConnectS for plain
+// HTTP or when an existing connection was reused.
+struct TransferInfo {
+  double nameLookupS;     // name resolution done
+  double connectS;        // TCP connection established
+  double appConnectS;     // TLS handshake done
+  double startTransferS;  // first response byte received
+  double totalS;          // request complete
+  long long bytesSent;    // request body bytes uploaded
+  long long bytesReceived; // response body bytes downloaded
+};
+
+struct HttpResult {
+  int statusCode;
+  std::shared_ptr<std::string> data;
+  TransferInfo transfer;
+  std::string etag; // ETag response header (quotes included); empty if absent
+};
+
 class HttpCallback {
 private:
   virtual void completeImpl(int statusCode, std::shared_ptr<std::string> data) = 0;
   virtual void errorImpl(std::exception_ptr e) = 0;
+
+  // Extended completion.  Override to see transfer details; the default just calls completeImpl.
+  virtual void resultImpl(HttpResult& result) { completeImpl(result.statusCode, result.data); }
+
+  // Optional incremental sink.  If streamingImpl returns true, the HTTP service may pass response body
+  // bytes to receiveImpl in order as they arrive (from an I/O thread, so keep it cheap) and then call
+  // complete with an empty data buffer.  Services that don't stream deliver the whole body to complete
+  // as usual, so callbacks must handle both cases.  Exceptions thrown by receiveImpl abort the request.
+  virtual bool streamingImpl() const { return false; }
+  virtual void receiveImpl(const char*, std::size_t) {}
+
 public:
   virtual ~HttpCallback() {}
-  void complete(int statusCode, std::shared_ptr<std::string> data) {
+
+  bool streaming() const { return streamingImpl(); }
+  void receive(const char* data, std::size_t size) { receiveImpl(data, size); }
+  void complete(HttpResult result) {
     try {
-      completeImpl(statusCode, data);
+      resultImpl(result);
     } catch (...) {
       error(std::current_exception());
     }
   }
 
+  void complete(int statusCode, std::shared_ptr<std::string> data) {
+    HttpResult result = { statusCode, data, TransferInfo(), std::string() };
+    complete(result);
+  }
+
   void error(std::exception_ptr e) {
     try {
       errorImpl(e);
@@ -62,6 +114,13 @@ typedef std::shared_ptr<HttpCallback> HttpCallbackPtr;
 
 typedef std::map<std::string, std::string> HttpHeaders;
 
+struct HttpServiceStats {
+  std::size_t handlePoolSize;             // easy handles currently allocated (in use + idle)
+  std::size_t idleHandles;                // easy handles waiting in the pool
+  unsigned long long handlePoolHits;      // requests that reused a pooled handle
+  unsigned long long handlePoolMisses;    // requests that needed a new handle
+};
+
 class HttpService {
   virtual void asyncGetImpl(
       const std::string& url,
@@ -81,6 +140,7 @@ class HttpService {
       const Proxy& proxy,
       HttpCallbackPtr callback) = 0;
   virtual void shutdownImpl() = 0;
+  virtual HttpServiceStats statsImpl() const = 0;
 public:
   virtual ~HttpService() {}
 
@@ -102,10 +162,29 @@ public:
       const Proxy& proxy,
       HttpCallbackPtr callback) { asyncDeleteImpl(url, headers, data, proxy, callback); }
   void shutdown() { shutdownImpl(); }
+  HttpServiceStats stats() const { return statsImpl(); }
 };
 typedef std::shared_ptr<HttpService> HttpServicePtr;
 
+// Zero-valued fields select the defaults.
+struct HttpServiceOptions {
+  int numCallbackThreads;         // callback thread pool size (default 1)
+  int numIoThreads;               // socket I/O threads (default 1).  Each runs its own libcurl multi handle
+                                  // and connection cache; requests are spread across them round-robin.
+  transports::Type transport;     // default HTTP_1_1
+  long maxHostConnections;        // connections per host and I/O thread (default: unlimited).  Excess
+                                  // requests wait for a free connection.
+  long maxTotalConnections;       // connections per I/O thread (default: unlimited)
+  long connectTimeoutS;           // default 30
+  long lowSpeedTimeoutS;          // fail requests that receive nothing for this long (default 30)
+  bool tcpKeepAlive;              // send TCP keep-alive probes on idle connections (default off)
+  long keepAliveIdleS;            // idle time before the first probe (default 60)
+  long keepAliveIntervalS;        // time between probes (default 60)
+};
+
 HttpServicePtr makeHttpService(int numCallbackThreads);
+HttpServicePtr makeHttpService(int numCallbackThreads, transports::Type transport);
+HttpServicePtr makeHttpService(const HttpServiceOptions& options);
 
 } // namespace sapiremote::http
 } // namespace sapiremote
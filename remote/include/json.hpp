@@ -5,6 +5,7 @@
 #define JSON_HPP_INCLUDED
 
 #include <cmath>
+#include <cstddef>
 #include <exception>
 #include <limits>
 #include <map>
@@ -141,8 +142,32 @@ std::string jsonToString(const Value& jsonValue);
 std::string jsonToString(const Array& jsonArray);
 std::string jsonToString(const Object& jsonObject);
 
+// Serialize onto the end of an existing buffer, without temporary strings.  Reserve space in out first
+// when writing large values.
+void appendJson(std::string& out, const Value& jsonValue);
+void appendJson(std::string& out, const Array& jsonArray);
+void appendJson(std::string& out, const Object& jsonObject);
+void appendJsonString(std::string& out, const std::string& s); // as a quoted, escaped JSON string
+
 Value stringToJson(const std::string& s);
 
+// Incremental parser: accepts input in arbitrary chunks and parses as much as it can as data arrives.
+// finish() returns the same value that stringToJson would for the concatenated input.
+class StreamParser {
+private:
+  class Impl;
+  std::unique_ptr<Impl> impl_;
+
+  StreamParser(const StreamParser&);
+  StreamParser& operator=(const StreamParser&);
+
+public:
+  StreamParser();
+  ~StreamParser();
+  void feed(const char* data, std::size_t size);
+  Value finish();
+};
+
 
 } // namespace json
 
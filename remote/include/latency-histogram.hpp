@@ -0,0 +1,23 @@
+//Copyright © 2019 D-Wave Systems Inc.
+//The software is licensed to authorized users only under the applicable license agreement.  See License.txt.
+
+#ifndef LATENCY_HISTOGRAM_HPP_INCLUDED
+#define LATENCY_HISTOGRAM_HPP_INCLUDED
+
+namespace sapiremote {
+
+// Exponential latency histogram: bucket i counts samples below 2^i ms (bucket 0: below 1 ms); the last
+// bucket counts everything else.
+struct LatencyHistogram {
+  static const int numBuckets = 16;
+  unsigned long long buckets[numBuckets];
+  unsigned long long samples;
+  double totalS;
+  double maxS;
+
+  void add(double seconds);
+};
+
+} // namespace sapiremote
+
+#endif
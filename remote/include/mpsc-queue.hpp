@@ -0,0 +1,92 @@
+//Copyright © 2019 D-Wave Systems Inc.
+//The software is licensed to authorized users only under the applicable license agreement.  See License.txt.
+
+#ifndef MPSC_QUEUE_HPP_INCLUDED
+#define MPSC_QUEUE_HPP_INCLUDED
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+#include <boost/noncopyable.hpp>
+
+namespace sapiremote {
+
+// Bounded lock-free queue for any number of producers and one consumer at a time (callers serialize
+// consumers themselves, e.g. by popping only while holding some mutex).  Each cell carries a sequence
+// number telling producers and the consumer whose turn it is, so neither side ever blocks the other.
+// An element becomes visible to the consumer once tryPush returns; elements pushed by one thread come out
+// in the order they went in.
+template<typename T>
+class BoundedMpscQueue : boost::noncopyable {
+private:
+  struct Cell {
+    std::atomic<std::size_t> sequence;
+    T value;
+  };
+
+  const std::size_t mask_;
+  std::unique_ptr<Cell[]> cells_;
+  std::atomic<std::size_t> tail_; // next position to push
+  std::atomic<std::size_t> head_; // next position to pop; written by the consumer only
+
+  static std::size_t roundUp(std::size_t capacity) {
+    std::size_t size = 2;
+    while (size < capacity) size *= 2;
+    return size;
+  }
+
+public:
+  // capacity is rounded up to a power of two
+  explicit BoundedMpscQueue(std::size_t capacity) :
+      mask_(roundUp(capacity) - 1), cells_(new Cell[mask_ + 1]), tail_(0), head_(0) {
+    for (std::size_t i = 0; i <= mask_; ++i) cells_[i].sequence.store(i, std::memory_order_relaxed);
+  }
+
+  std::size_t capacity() const { return mask_ + 1; }
+
+  // returns false (and leaves value alone) if the queue is full
+  bool tryPush(T& value) {
+    auto pos = tail_.load(std::memory_order_relaxed);
+    for (;;) {
+      auto& cell = cells_[pos & mask_];
+      auto seq = cell.sequence.load(std::memory_order_acquire);
+      auto diff = static_cast<std::ptrdiff_t>(seq - pos);
+      if (diff == 0) {
+        if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          cell.value = std::move(value);
+          cell.sequence.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = tail_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // returns false if the queue is empty, or the oldest element is still being pushed
+  bool tryPop(T& value) {
+    auto pos = head_.load(std::memory_order_relaxed);
+    auto& cell = cells_[pos & mask_];
+    if (cell.sequence.load(std::memory_order_acquire) != pos + 1) return false;
+    value = std::move(cell.value);
+    cell.value = T();
+    cell.sequence.store(pos + mask_ + 1, std::memory_order_release);
+    head_.store(pos + 1, std::memory_order_relaxed);
+    return true;
+  }
+
+  // may be stale by the time it returns
+  std::size_t approximateSize() const {
+    auto head = head_.load(std::memory_order_relaxed);
+    auto tail = tail_.load(std::memory_order_relaxed);
+    return tail > head ? tail - head : 0;
+  }
+};
+
+} // namespace sapiremote
+
+#endif
@@ -0,0 +1,51 @@
+//Copyright © 2019 D-Wave Systems Inc.
+//The software is licensed to authorized users only under the applicable license agreement.  See License.txt.
+
+#ifndef PROBLEM_JOURNAL_HPP_INCLUDED
+#define PROBLEM_JOURNAL_HPP_INCLUDED
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace sapiremote {
+
+// Append-only on-disk record of which problems are still outstanding on the server, so that a process
+// restarted after a crash can reattach to them instead of submitting them again.  Records are buffered and
+// written by a background thread that syncs to disk at most once per sync interval, so recording is cheap
+// and a crash loses at most the last interval's worth.  Outstanding problems are kept in memory too, and
+// the file is rewritten with only those problems when it is opened and whenever it has grown mostly stale.
+// One journal file per process; it isn't safe to share between processes.
+class ProblemJournal {
+private:
+  virtual void problemSubmittedImpl(const std::string& id) = 0;
+  virtual void problemDoneImpl(const std::string& id) = 0;
+  virtual std::vector<std::string> outstandingProblemsImpl() const = 0;
+  virtual bool syncImpl() = 0;
+
+public:
+  virtual ~ProblemJournal() {}
+
+  // the server has the problem (no effect if it's already outstanding)
+  void problemSubmitted(const std::string& id) { problemSubmittedImpl(id); }
+
+  // the caller has the problem's answer or has released the problem (no effect if it isn't outstanding)
+  void problemDone(const std::string& id) { problemDoneImpl(id); }
+
+  // in the order they were first recorded, including those found in the file when it was opened
+  std::vector<std::string> outstandingProblems() const { return outstandingProblemsImpl(); }
+
+  // Waits until everything recorded so far is on disk.  Returns false if the journal file can't be
+  // written; recording carries on in memory, and the file is retried at the next interval.
+  bool sync() { return syncImpl(); }
+};
+typedef std::shared_ptr<ProblemJournal> ProblemJournalPtr;
+
+// Opens or creates the journal at path.  A partly written record at the end of the file (from a crash
+// mid-write) is dropped.  Throws sapiremote::JournalException if the file can't be created or isn't a
+// journal.
+ProblemJournalPtr makeProblemJournal(const std::string& path, int syncIntervalMs = 50);
+
+} // namespace sapiremote
+
+#endif
@@ -4,59 +4,115 @@
 #ifndef PROBLEM_MANAGER_HPP_INCLUDED
 #define PROBLEM_MANAGER_HPP_INCLUDED
 
+#include <cstddef>
 #include <memory>
 #include <string>
 #include <stdexcept>
+#include <vector>
 
+#include "answer-cache.hpp"
 #include "answer-service.hpp"
+#include "concurrency-controller.hpp"
 #include "sapi-service.hpp"
 #include "retry-service.hpp"
+#include "problem-journal.hpp"
+#include "request-scheduler.hpp"
 #include "problem.hpp"
 #include "solver.hpp"
 
 namespace sapiremote {
 
+struct ProblemManagerStats {
+  AnswerCacheStats answerCache;
+  RequestClassStats requests[requestclasses::count]; // indexed by requestclasses::Type
+  ConcurrencyControllerStats concurrency;
+};
+
 class ProblemManager {
 private:
   virtual SubmittedProblemPtr submitProblemImpl(
       std::string& solver,
       std::string& problemType,
       json::Value& problemData,
-      json::Object& problemParams) = 0;
+      json::Object& problemParams,
+      int priority) = 0;
   virtual SubmittedProblemPtr addProblemImpl(const std::string& id) = 0;
+  virtual std::vector<SubmittedProblemPtr> addProblemsImpl(const std::vector<std::string>& ids) = 0;
   virtual SolverMap fetchSolversImpl() = 0;
+  virtual ProblemManagerStats statsImpl() const = 0;
 
 public:
   virtual ~ProblemManager() {}
 
+  // problems with higher priority are submitted first
   SubmittedProblemPtr submitProblem(
       std::string solver,
       std::string problemType,
       json::Value problemData,
-      json::Object problemParams) {
-    return submitProblemImpl(solver, problemType, problemData, problemParams);
+      json::Object problemParams,
+      int priority = 0) {
+    return submitProblemImpl(solver, problemType, problemData, problemParams, priority);
   }
 
   SubmittedProblemPtr addProblem(const std::string& id) {
     return addProblemImpl(id);
   }
 
+  // same as calling addProblem for each id but registers them all at once; returned problems are in ids order
+  std::vector<SubmittedProblemPtr> addProblems(const std::vector<std::string>& ids) {
+    return addProblemsImpl(ids);
+  }
+
   SolverMap fetchSolvers() { return fetchSolversImpl(); }
+
+  ProblemManagerStats stats() const { return statsImpl(); }
 };
 typedef std::shared_ptr<ProblemManager> ProblemManagerPtr;
 
+// Ceilings up to which the corresponding ProblemManagerLimits grow while the server keeps up.  They start
+// from the ProblemManagerLimits values and shrink again on errors and latency spikes.  A ceiling of zero
+// (or no higher than the starting value) keeps that limit fixed.
+struct AdaptiveLimits {
+  int maxActiveRequests;
+  int maxProblemsPerSubmission;
+  int maxIdsPerStatusQuery;
+};
+
 struct ProblemManagerLimits {
   int maxProblemsPerSubmission;
   int maxIdsPerStatusQuery;
   int maxActiveRequests;
+  std::size_t answerCacheBytes; // memory budget for answers of completed problems (0: no caching)
+  int maxAnswerPrefetches;      // download answers into the cache as soon as problems complete, at most this
+                                // many at a time (0: only on request; requires answerCacheBytes > 0).
+                                // Prefetches take request slots, so only turn this on if callers fetch
+                                // the answers of most problems.
+  int minPollIntervalMs;        // status polling interval bounds.  Intervals grow with problem age and follow
+  int maxPollIntervalMs;        // the server's completion estimate, if any (0: poll again immediately)
+  int longPollWaitS;            // ask the server to hold status queries open until a problem changes state,
+                                // at most this long (0: don't).  Keep it below the HTTP low-speed timeout.
+                                // Falls back to polling while the server ignores or rejects the
+                                // request, and tries long polls again after a growing number of polls.
+  RequestSchedule schedule;     // how the maxActiveRequests slots are shared between request classes
+                                // (all zero: equal weights, nothing reserved)
+  AdaptiveLimits adaptive;      // all zero: fixed limits
 };
 
+// journal (optional) records the problem IDs the server has accepted until the caller has each answer or
+// releases the problem
 ProblemManagerPtr makeProblemManager(
     SapiServicePtr sapiService,
     AnswerServicePtr answerService,
     RetryTimerServicePtr retryService,
     const RetryTiming& retryTiming,
-    const ProblemManagerLimits& limits);
+    const ProblemManagerLimits& limits,
+    ProblemJournalPtr journal = ProblemJournalPtr());
+
+// Reattaches to every problem the journal lists as outstanding, e.g. those left behind by a process that
+// crashed, through ProblemManager::addProblems.  Use the journal the problem manager was made with.
+std::vector<SubmittedProblemPtr> resumeProblems(
+    ProblemManager& problemManager,
+    const ProblemJournal& journal);
 
 } // namespace sapiremote
 
@@ -4,6 +4,7 @@
 #ifndef PROBLEM_HPP_INCLUDED
 #define PROBLEM_HPP_INCLUDED
 
+#include <cstddef>
 #include <exception>
 #include <memory>
 #include <string>
@@ -19,9 +20,14 @@ private:
   virtual void notifySubmittedImpl() = 0;
   virtual void notifyDoneImpl() = 0;
   virtual void notifyErrorImpl() = 0;
+  virtual bool directImpl() const { return false; }
 public:
   virtual ~SubmittedProblemObserver() {}
 
+  // Direct observers are notified from the thread that changed the problem's state rather than through
+  // the answer service's thread pool.  Their notifications must be quick and must never block.
+  bool direct() const { return directImpl(); }
+
   void notifySubmitted() {
     try {
       notifySubmittedImpl();
@@ -99,6 +105,11 @@ typedef std::shared_ptr<SubmittedProblem> SubmittedProblemPtr;
 bool awaitSubmission(const std::vector<SubmittedProblemPtr>& problems, double timeoutS);
 bool awaitCompletion(const std::vector<SubmittedProblemPtr>& problems, int mindone, double timeoutS);
 
+// Like awaitCompletion but also reports which problems finished: appends to doneIndices the indices (into
+// problems) of the problems that were done when the wait ended, in completion order.
+bool awaitCompletion(const std::vector<SubmittedProblemPtr>& problems, int mindone, double timeoutS,
+    std::vector<std::size_t>& doneIndices);
+
 } // namespace sapiremote
 
 #endif
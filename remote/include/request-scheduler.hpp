@@ -0,0 +1,81 @@
+//Copyright © 2019 D-Wave Systems Inc.
+//The software is licensed to authorized users only under the applicable license agreement.  See License.txt.
+
+#ifndef REQUEST_SCHEDULER_HPP_INCLUDED
+#define REQUEST_SCHEDULER_HPP_INCLUDED
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+
+#include "latency-histogram.hpp"
+
+namespace sapiremote {
+
+namespace requestclasses {
+enum Type { SUBMIT, STATUS, CANCEL, ANSWER };
+const int count = ANSWER + 1;
+} // namespace sapiremote::requestclasses
+
+struct RequestSchedule {
+  int weights[requestclasses::count];  // share of request slots while several classes have work waiting
+                                       // (0: 1)
+  int reserved[requestclasses::count]; // slots kept free for the class even while it's idle (0: none)
+};
+
+struct RequestClassStats {
+  std::size_t queueDepth; // work items waiting for a request: problems, ids or answer fetches
+  int activeRequests;
+  LatencyHistogram wait;  // time from the class having work until it got a request slot
+};
+
+// Hands out a limited number of request slots to the request classes that have work waiting.  Competing
+// classes get slots in proportion to their weights (stride scheduling; ties go to the class that has
+// waited longest), so e.g. a burst of submissions can't crowd out answer downloads.  A class that was idle
+// rejoins at the current virtual time rather than with credit saved up.  Reserved slots are only ever
+// used by their own class.  Not thread safe.
+class RequestScheduler {
+private:
+  typedef std::chrono::steady_clock::time_point TimePoint;
+
+  int slots_;
+  int freeSlots_;
+  unsigned long long pushes_;
+  unsigned long long virtualTime_;
+  unsigned long long strides_[requestclasses::count];
+  int reserved_[requestclasses::count];
+  unsigned long long passes_[requestclasses::count];
+  bool queued_[requestclasses::count];
+  unsigned long long queuedOrder_[requestclasses::count];
+  TimePoint queuedSince_[requestclasses::count];
+  RequestClassStats stats_[requestclasses::count];
+
+  bool slotAvailable(int c) const;
+
+public:
+  // throws std::invalid_argument if weights or reservations are negative or more slots are reserved than
+  // there are
+  RequestScheduler(int slots, const RequestSchedule& schedule);
+
+  // class c has work waiting; no effect if it's already queued
+  void push(requestclasses::Type c);
+
+  // Picks the next class to send a request for among queued classes for which skip returns false, and gives
+  // it a slot.  The class is no longer queued afterwards.  Returns -1 if there is nothing to send or no
+  // slot for it.
+  int next(const std::function<bool(requestclasses::Type)>& skip);
+
+  // returns a slot given out by next
+  void release(requestclasses::Type c);
+
+  // Changes the number of slots.  Shrinking takes effect as requests finish; slots already given out stay
+  // valid.  Throws std::invalid_argument if fewer slots than reserved are requested.
+  void setSlots(int slots);
+
+  // queueDepth is left zero
+  RequestClassStats stats(requestclasses::Type c) const { return stats_[c]; }
+};
+
+} // namespace sapiremote
+
+#endif
@@ -12,6 +12,7 @@ struct RetryTiming {
   int initDelayMs;
   int maxDelayMs;
   float delayScale;
+  float jitter; // each wait is shortened by a random fraction (up to this) of the delay; 0: no jitter
 };
 
 class RetryTimer {
@@ -36,16 +37,29 @@ public:
 };
 typedef std::weak_ptr<RetryNotifiable> RetryNotifiableWeakPtr;
 
+// One-shot wake-up timer.  schedule() asks for a notification after delayMs; if a notification is already
+// pending sooner, it is left alone, otherwise it is moved earlier.
+class PollTimer {
+private:
+  virtual void scheduleImpl(int delayMs) = 0;
+public:
+  virtual ~PollTimer() {}
+  void schedule(int delayMs) { scheduleImpl(delayMs); }
+};
+typedef std::shared_ptr<PollTimer> PollTimerPtr;
+
 class RetryTimerService {
 private:
   virtual void shutdownImpl() = 0;
   virtual RetryTimerPtr createRetryTimerImpl(const RetryNotifiableWeakPtr& rn, const RetryTiming& timing) = 0;
+  virtual PollTimerPtr createPollTimerImpl(const RetryNotifiableWeakPtr& rn) = 0;
 public:
   virtual ~RetryTimerService() {}
   void shutdown() { shutdownImpl(); }
   RetryTimerPtr createRetryTimer(const RetryNotifiableWeakPtr& rn, const RetryTiming& timing) {
     return createRetryTimerImpl(rn, timing);
   }
+  PollTimerPtr createPollTimer(const RetryNotifiableWeakPtr& rn) { return createPollTimerImpl(rn); }
 };
 typedef std::shared_ptr<RetryTimerService> RetryTimerServicePtr;
 
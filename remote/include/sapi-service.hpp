@@ -4,12 +4,14 @@
 #ifndef SAPI_SERVICE_HPP_INCLUDED
 #define SAPI_SERVICE_HPP_INCLUDED
 
+#include <cstddef>
 #include <exception>
 #include <memory>
 #include <string>
 #include <vector>
 
 #include "http-service.hpp"
+#include "latency-histogram.hpp"
 #include "types.hpp"
 #include "json.hpp"
 
@@ -83,58 +85,72 @@ public:
 };
 typedef std::shared_ptr<FetchAnswerSapiCallback> FetchAnswerSapiCallbackPtr;
 
+// Problem payloads can be large (base64-encoded data) and are handed around between queues, retries and
+// the SAPI service.  The payload is immutable and shared, so copying a Problem is cheap.
 class Problem {
 private:
-  std::string solver_;
-  std::string type_;
-  json::Value data_;
-  json::Object params_;
+  struct Payload {
+    std::string solver;
+    std::string type;
+    json::Value data;
+    json::Object params;
+  };
+  std::shared_ptr<const Payload> payload_;
+
+  const Payload& payload() const {
+    static const Payload empty = Payload();
+    return payload_ ? *payload_ : empty;
+  }
 
 public:
   Problem() {}
 
-  Problem(std::string solver, std::string type, json::Value data, json::Object params) :
-    solver_(std::move(solver)),
-    type_(std::move(type)),
-    data_(std::move(data)),
-    params_(std::move(params)) {}
-
-  Problem(const Problem& other) :
-    solver_(other.solver_),
-    type_(other.type_),
-    data_(other.data_),
-    params_(other.params_) {}
-
-  Problem(Problem&& other) :
-    solver_(std::move(other.solver_)),
-    type_(std::move(other.type_)),
-    data_(std::move(other.data_)),
-    params_(std::move(other.params_)) {}
-
-  Problem& operator=(const Problem& other) {
-    solver_ = other.solver_;
-    type_ = other.type_;
-    data_ = other.data_;
-    params_ = other.params_;
-    return *this;
+  Problem(std::string solver, std::string type, json::Value data, json::Object params) {
+    auto payload = std::make_shared<Payload>();
+    payload->solver = std::move(solver);
+    payload->type = std::move(type);
+    payload->data = std::move(data);
+    payload->params = std::move(params);
+    payload_ = std::move(payload);
   }
 
-  Problem& operator=(Problem&& other) {
-    solver_ = std::move(other.solver_);
-    type_ = std::move(other.type_);
-    data_ = std::move(other.data_);
-    params_ = std::move(other.params_);
-    return *this;
-  }
+  const std::string& solver() const { return payload().solver; }
+  const std::string& type() const { return payload().type; }
+  const json::Value& data() const { return payload().data; }
+  const json::Object& params() const { return payload().params; }
+};
+
+struct SapiServiceOptions {
+  std::size_t gzipMinBytes; // gzip-compress submission bodies at least this large (0: never compress)
+  std::string solverCacheDir; // keep the solver list on disk here and revalidate it with ETags (empty: don't)
+};
+
+namespace endpoints {
+enum Type { SOLVERS, SUBMIT, STATUS, ANSWER, CANCEL };
+const int count = CANCEL + 1;
+} // namespace sapiremote::endpoints
+
+struct EndpointStats {
+  unsigned long long responses;  // requests that received an HTTP response (of any status)
+  LatencyHistogram nameLookup;
+  LatencyHistogram connect;
+  LatencyHistogram appConnect;
+  LatencyHistogram startTransfer;
+  LatencyHistogram total;
+  unsigned long long bytesSent;
+  unsigned long long bytesReceived;
+
+  void add(const http::TransferInfo& transfer);
+};
 
-  const std::string& solver() const { return solver_; }
-  const std::string& type() const { return type_; }
-  const json::Value& data() const { return data_; }
-  const json::Object& params() const { return params_; }
-  std::string& solver() { return solver_; }
-  std::string& type() { return type_; }
-  json::Value& data() { return data_; }
-  json::Object& params() { return params_; }
+struct SapiServiceStats {
+  unsigned long long submissions;           // submission requests sent
+  unsigned long long gzipSubmissions;       // submission requests sent gzip-compressed
+  unsigned long long gzipBytesIn;           // total JSON size of compressed submissions
+  unsigned long long gzipBytesOut;          // total compressed size of compressed submissions
+  unsigned long long lastGzipBytesSaved;    // bytes saved by the most recent compressed submission
+  EndpointStats endpointStats[endpoints::count]; // indexed by endpoints::Type
+  unsigned long long coalescedAnswerFetches; // answer fetches that joined an identical request in flight
 };
 
 class SapiService {
@@ -142,8 +158,11 @@ private:
   virtual void fetchSolversImpl(SolversSapiCallbackPtr callback) = 0;
   virtual void submitProblemsImpl(std::vector<Problem>& problems, StatusSapiCallbackPtr callback) = 0;
   virtual void multiProblemStatusImpl(const std::vector<std::string>& ids, StatusSapiCallbackPtr callback) = 0;
+  virtual void longPollStatusImpl(
+      const std::vector<std::string>& ids, int waitS, StatusSapiCallbackPtr callback) = 0;
   virtual void fetchAnswerImpl(const std::string& id, FetchAnswerSapiCallbackPtr callback) = 0;
   virtual void cancelProblemsImpl(const std::vector<std::string>& ids, CancelSapiCallbackPtr callback) = 0;
+  virtual SapiServiceStats statsImpl() const = 0;
 
 public:
   virtual ~SapiService() {}
@@ -154,21 +173,37 @@ public:
   void multiProblemStatus(const std::vector<std::string>& ids, StatusSapiCallbackPtr callback) {
     multiProblemStatusImpl(ids, callback);
   }
+  // Like multiProblemStatus, but asks the server to hold the request open for up to waitS seconds until
+  // one of the problems changes state.  Servers without long-poll support answer immediately.
+  void longPollStatus(const std::vector<std::string>& ids, int waitS, StatusSapiCallbackPtr callback) {
+    longPollStatusImpl(ids, waitS, callback);
+  }
   void fetchAnswer(const std::string& id, FetchAnswerSapiCallbackPtr callback) {
     fetchAnswerImpl(id, callback);
   }
   void cancelProblems(const std::vector<std::string>& ids, CancelSapiCallbackPtr callback) {
     cancelProblemsImpl(ids, callback);
   }
+  SapiServiceStats stats() const { return statsImpl(); }
 };
 typedef std::shared_ptr<SapiService> SapiServicePtr;
 
+// Default options, except that DWAVE_SAPI_SOLVER_CACHE_DIR (if set) enables the solver list cache
+SapiServiceOptions environmentSapiServiceOptions();
+
 SapiServicePtr makeSapiService(
     http::HttpServicePtr httpService,
     std::string baseUrl,
     std::string token,
     http::Proxy proxy);
 
+SapiServicePtr makeSapiService(
+    http::HttpServicePtr httpService,
+    std::string baseUrl,
+    std::string token,
+    http::Proxy proxy,
+    const SapiServiceOptions& options);
+
 } // namespace sapiremote
 
 #endif
@@ -0,0 +1,48 @@
+//Copyright © 2019 D-Wave Systems Inc.
+//The software is licensed to authorized users only under the applicable license agreement.  See License.txt.
+
+#ifndef SOLVER_CACHE_HPP_INCLUDED
+#define SOLVER_CACHE_HPP_INCLUDED
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "types.hpp"
+
+namespace sapiremote {
+
+struct CachedSolverList {
+  std::string etag;
+  std::vector<SolverInfo> solvers;
+};
+
+// On-disk copy of the remote solver list, one file per solver list URL and API token (different tokens
+// may see different solvers; files hold a hash of the token, never the token itself).  Qubit and coupler
+// tables are stored in binary form, so loading a cached list skips both the JSON parse of the (large)
+// qubits and couplers properties and extractQpSolverInfo.  Files are replaced atomically, so several
+// processes may share a directory.  All failures are silent: a cache that can't be read or written is
+// just a miss.
+class SolverCache {
+private:
+  const std::string dir_;
+  const std::string tokenHash_;
+
+public:
+  // empty dir: caching disabled
+  SolverCache(std::string dir, const std::string& token);
+
+  bool enabled() const { return !dir_.empty(); }
+
+  // file holding the cached list for url
+  std::string path(const std::string& url) const;
+
+  // returns null if nothing (usable) is cached for url
+  std::unique_ptr<CachedSolverList> load(const std::string& url) const;
+
+  void store(const std::string& url, const CachedSolverList& list) const;
+};
+
+} // namespace sapiremote
+
+#endif
@@ -19,7 +19,7 @@ class Solver {
 private:
   const std::string id_;
   const json::Object properties_;
-  const std::unique_ptr<QpSolverInfo> qpInfo_;
+  const std::shared_ptr<QpSolverInfo> qpInfo_;
 
   virtual SubmittedProblemPtr submitProblemImpl(
       std::string& type,
@@ -30,10 +30,14 @@ public:
       id_(std::move(id)),
       properties_(std::move(properties)),
       qpInfo_(extractQpSolverInfo(properties_)) {}
+  Solver(std::string id, json::Object properties, std::shared_ptr<QpSolverInfo> qpInfo) :
+      id_(std::move(id)),
+      properties_(std::move(properties)),
+      qpInfo_(qpInfo ? std::move(qpInfo) : extractQpSolverInfo(properties_)) {}
   virtual ~Solver() {}
   const std::string& id() const { return id_; }
   const json::Object& properties() const { return properties_; }
-  const std::unique_ptr<QpSolverInfo>& qpInfo() const { return qpInfo_; }
+  const std::shared_ptr<QpSolverInfo>& qpInfo() const { return qpInfo_; }
   SubmittedProblemPtr submitProblem(
       std::string type,
       json::Value problem,
@@ -4,21 +4,140 @@
 #ifndef THREADPOOL_HPP_INCLUDED
 #define THREADPOOL_HPP_INCLUDED
 
-#include <functional>
+#include <cstddef>
 #include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "latency-histogram.hpp"
 
 namespace sapiremote {
 
+// Move-only type-erased void() callable.  Small callables (up to inlineSize bytes, e.g. a bind expression
+// holding a couple of shared_ptrs, or a std::function) are stored in place, larger ones on the heap.
+class Task {
+public:
+  static const std::size_t inlineSize = 64;
+
+private:
+  typedef std::aligned_storage<inlineSize>::type Storage;
+
+  struct Ops {
+    void (*call)(Storage&);
+    void (*move)(Storage& from, Storage& to); // leaves from destroyed
+    void (*destroy)(Storage&);
+  };
+
+  template<typename F>
+  struct InlineOps {
+    static F& get(Storage& s) { return *static_cast<F*>(static_cast<void*>(&s)); }
+    static void call(Storage& s) { get(s)(); }
+    static void move(Storage& from, Storage& to) {
+      new (&to) F(std::move(get(from)));
+      get(from).~F();
+    }
+    static void destroy(Storage& s) { get(s).~F(); }
+    static const Ops ops;
+  };
+
+  template<typename F>
+  struct HeapOps {
+    static F*& get(Storage& s) { return *static_cast<F**>(static_cast<void*>(&s)); }
+    static void call(Storage& s) { (*get(s))(); }
+    static void move(Storage& from, Storage& to) { new (&to) F*(get(from)); }
+    static void destroy(Storage& s) { delete get(s); }
+    static const Ops ops;
+  };
+
+  template<typename F>
+  struct FitsInline {
+    static const bool value = sizeof(F) <= inlineSize
+        && std::alignment_of<Storage>::value % std::alignment_of<F>::value == 0
+        && std::is_nothrow_move_constructible<F>::value;
+  };
+
+  Storage storage_;
+  const Ops* ops_;
+
+  template<typename F>
+  void construct(F&& f, std::true_type /*inline*/) {
+    typedef typename std::decay<F>::type Fn;
+    new (&storage_) Fn(std::forward<F>(f));
+    ops_ = &InlineOps<Fn>::ops;
+  }
+
+  template<typename F>
+  void construct(F&& f, std::false_type /*inline*/) {
+    typedef typename std::decay<F>::type Fn;
+    new (&storage_) Fn*(new Fn(std::forward<F>(f)));
+    ops_ = &HeapOps<Fn>::ops;
+  }
+
+  void reset() {
+    if (ops_) ops_->destroy(storage_);
+    ops_ = 0;
+  }
+
+  Task(const Task&);
+  Task& operator=(const Task&);
+
+public:
+  Task() : ops_(0) {}
+
+  template<typename F, typename = typename std::enable_if<
+      !std::is_same<typename std::decay<F>::type, Task>::value>::type>
+  Task(F&& f) : ops_(0) {
+    typedef typename std::decay<F>::type Fn;
+    construct(std::forward<F>(f), std::integral_constant<bool, FitsInline<Fn>::value>());
+  }
+
+  Task(Task&& other) : ops_(other.ops_) {
+    if (ops_) ops_->move(other.storage_, storage_);
+    other.ops_ = 0;
+  }
+
+  Task& operator=(Task&& other) {
+    if (this != &other) {
+      reset();
+      ops_ = other.ops_;
+      if (ops_) ops_->move(other.storage_, storage_);
+      other.ops_ = 0;
+    }
+    return *this;
+  }
+
+  ~Task() { reset(); }
+
+  bool empty() const { return !ops_; }
+  void operator()() { ops_->call(storage_); }
+};
+
+template<typename F>
+const Task::Ops Task::InlineOps<F>::ops = {&call, &move, &destroy};
+
+template<typename F>
+const Task::Ops Task::HeapOps<F>::ops = {&call, &move, &destroy};
+
+struct ThreadPoolStats {
+  std::size_t queueDepth;          // tasks posted and not yet started
+  unsigned long long tasksRun;
+  unsigned long long steals;       // tasks run by a worker other than the one they were queued for
+  LatencyHistogram taskLatency;    // time from post until the task started (a sample of the tasks)
+};
+
 class ThreadPool {
 private:
   virtual void shutdownImpl() = 0;
-  virtual void postImpl(std::function<void()> f) = 0;
+  virtual void postImpl(Task& task) = 0;
+  virtual ThreadPoolStats statsImpl() const = 0;
 
 public:
   virtual ~ThreadPool() {}
 
   void shutdown() { shutdownImpl(); }
-  void post(std::function<void()> f) { postImpl(f); }
+  void post(Task task) { postImpl(task); }
+  ThreadPoolStats stats() const { return statsImpl(); }
 };
 typedef std::shared_ptr<ThreadPool> ThreadPoolPtr;
 
@@ -35,11 +35,15 @@ struct RemoteProblemInfo {
   std::string solvedOn;
   std::string type;
   std::string errorMessage;
+  std::string earliestCompletion; // server's completion estimate (ISO 8601, UTC); empty if not provided
 };
 
+struct QpSolverInfo;
+
 struct SolverInfo {
   std::string id;
   json::Object properties;
+  std::shared_ptr<QpSolverInfo> qpInfo; // precomputed qubit/coupler tables; null: derive from properties
 };
 
 struct SubmittedProblemInfo {
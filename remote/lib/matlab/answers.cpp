@@ -301,7 +301,7 @@ void awaitSubmission(int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[])
 
 void awaitCompletion(int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[]) {
   if (nrhs != 3) mexErrMsgIdAndTxt(err_id::internal::numArgs, "Wrong number of arguments");
-  if (nlhs > 1) mexErrMsgIdAndTxt(err_id::internal::numOut, "Wrong number of outputs");
+  if (nlhs > 2) mexErrMsgIdAndTxt(err_id::internal::numOut, "Wrong number of outputs");
 
   if (!mxIsDouble(prhs[2]) || mxGetNumberOfElements(prhs[2]) != 1) {
     mexErrMsgIdAndTxt(err_id::argType, "Invalid timeout");
@@ -325,12 +325,22 @@ void awaitCompletion(int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[])
     problems.push_back(getSubmittedProblem(mxGetCell(prhs[0], i), false));
   }
 
-  sapiremote::awaitCompletion(problems, minDone, timeout);
+  vector<size_t> doneIndices;
+  sapiremote::awaitCompletion(problems, minDone, timeout, doneIndices);
 
   plhs[0] = mxCreateLogicalMatrix(1, n);
   auto data = mxGetLogicals(plhs[0]);
-  for (size_t i = 0; i < n; ++i) {
-    data[i] = static_cast<mxLogical>(problems[i]->done());
+  for (size_t i = 0; i < doneIndices.size(); ++i) {
+    data[doneIndices[i]] = true;
+  }
+
+  // second output: one-based indices in completion order
+  if (nlhs > 1) {
+    plhs[1] = mxCreateDoubleMatrix(1, doneIndices.size(), mxREAL);
+    auto idx = mxGetPr(plhs[1]);
+    for (size_t i = 0; i < doneIndices.size(); ++i) {
+      idx[i] = static_cast<double>(doneIndices[i] + 1);
+    }
   }
 }
 
@@ -447,6 +457,29 @@ void addProblem(int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[]) {
   plhs[0] = createSubmittedProblemArray(conn->problemManager()->addProblem(id.get()), prhs[0]);
 }
 
+void addProblems(int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[]) {
+  if (nrhs != 2) mexErrMsgIdAndTxt(err_id::internal::numArgs, "Wrong number of arguments");
+  if (nlhs > 1) mexErrMsgIdAndTxt(err_id::internal::numOut, "Wrong number of outputs");
+
+  auto conn = getConnection(prhs[0]);
+  if (!mxIsCell(prhs[1])) mexErrMsgIdAndTxt(err_id::argType, "Problem IDs must be a cell array of strings");
+  const auto n = mxGetNumberOfElements(prhs[1]);
+  vector<string> ids;
+  ids.reserve(n);
+  for (size_t i = 0; i < n; ++i) {
+    auto idArray = mxGetCell(prhs[1], i);
+    auto id = unique_ptr<char, MxFreeDeleter>(idArray ? mxArrayToString(idArray) : 0);
+    if (!id) mexErrMsgIdAndTxt(err_id::argType, "Problem IDs must be a cell array of strings");
+    ids.push_back(id.get());
+  }
+
+  auto problems = conn->problemManager()->addProblems(ids);
+  plhs[0] = mxCreateCellMatrix(1, n);
+  for (size_t i = 0; i < n; ++i) {
+    mxSetCell(plhs[0], i, createSubmittedProblemArray(problems[i], prhs[0]));
+  }
+}
+
 void decodeQp(int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[]) {
   if (nrhs != 2) mexErrMsgIdAndTxt(err_id::internal::numArgs, "Wrong number of arguments");
   if (nlhs > 1) mexErrMsgIdAndTxt(err_id::internal::numOut, "Wrong number of outputs");
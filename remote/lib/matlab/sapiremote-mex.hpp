@@ -48,6 +48,7 @@ void solvers(int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[]);
 void encodeQp(int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[]);
 void submitProblem(int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[]);
 void addProblem(int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[]);
+void addProblems(int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[]);
 void decodeQp(int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[]);
 } // namespace subfunctions
 
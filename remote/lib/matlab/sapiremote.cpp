@@ -57,6 +57,7 @@ const auto solvers = "solvers";
 const auto encodeQp = "encodeqp";
 const auto submitProblem = "submitproblem";
 const auto addProblem = "addproblem";
+const auto addProblems = "addproblems";
 const auto decodeQp = "decodeqp";
 } // namespace subcommands
 
@@ -79,6 +80,7 @@ DispatchMap initDispatchMap() {
   dm[subcommands::encodeQp] = subfunctions::encodeQp;
   dm[subcommands::submitProblem] = subfunctions::submitProblem;
   dm[subcommands::addProblem] = subfunctions::addProblem;
+  dm[subcommands::addProblems] = subfunctions::addProblems;
   dm[subcommands::decodeQp] = subfunctions::decodeQp;
   return dm;
 }
@@ -1,7 +1,7 @@
 % Copyright © 2019 D-Wave Systems Inc.
 % The software is licensed to authorized users only under the applicable license agreement.  See License.txt.
 
-function done = sapiremote_awaitcompletion(phs, mindone, timeout)
+function [done, idx] = sapiremote_awaitcompletion(phs, mindone, timeout)
 
 % Proprietary Information D-Wave Systems Inc.
 % Copyright (c) 2015 by D-Wave Systems Inc. All rights reserved.
@@ -9,14 +9,16 @@ function done = sapiremote_awaitcompletion(phs, mindone, timeout)
 % applicable license agreement see eula.txt
 % D-Wave Systems Inc., 3033 Beta Ave., Burnaby, BC, V5G 4M9, Canada.
 
+% idx: indices of the completed problems, in completion order
+
 if ~isnumeric(timeout)
   error('sapiremote:BadArgType', 'timeout must be a number')
 end
 mindone = min(mindone, numel(phs));
 t = tic;
-done = sapiremote_mex('awaitcompletion', phs, mindone, min(1, timeout));
+[done, idx] = sapiremote_mex('awaitcompletion', phs, mindone, min(1, timeout));
 while toc(t) < timeout && sum(done) < mindone
-  done = sapiremote_mex('awaitcompletion', ...
+  [done, idx] = sapiremote_mex('awaitcompletion', ...
     phs, mindone, min(1, timeout - toc(t)));
 end
 end
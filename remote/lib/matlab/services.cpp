@@ -12,6 +12,7 @@
 #include <sapi-service.hpp>
 #include <retry-service.hpp>
 #include <problem-manager.hpp>
+#include <environment.hpp>
 #include <answer-service.hpp>
 #include <solver.hpp>
 
@@ -34,14 +35,23 @@ using sapiremote::makeRetryTimerService;
 using sapiremote::ProblemManagerLimits;
 using sapiremote::ProblemManagerPtr;
 using sapiremote::makeSapiService;
+using sapiremote::environmentSapiServiceOptions;
 using sapiremote::makeProblemManager;
+using sapiremote::environmentAnswerPrefetches;
 
 namespace {
 
-const ProblemManagerLimits limits = {
+const ProblemManagerLimits defaultLimits = {
     20,  // maxProblemsPerSubmission
     100, // maxIdsPerStatusQuery
-    6    // maxActiveProblemSubmissions
+    6,   // maxActiveProblemSubmissions
+    64 << 20, // answerCacheBytes
+    0,   // maxAnswerPrefetches: DWAVE_SAPI_ANSWER_PREFETCHES turns prefetching on
+    100, // minPollIntervalMs
+    5000, // maxPollIntervalMs
+    20,  // longPollWaitS
+    {{0, 0, 0, 0}, {0, 0, 0, 1}}, // schedule: equal weights, one request slot kept for answer downloads
+    {16, 50, 500} // adaptive ceilings: active requests, problems per submission, IDs per status query
 };
 
 
@@ -73,7 +83,10 @@ RetryTimerServicePtr getRetryService() {
 
 ProblemManagerPtr makeProblemManager(ConnectionInfo conninfo) {
   auto sapiService = makeSapiService(getHttpService(),
-      std::move(conninfo.url), std::move(conninfo.token), std::move(conninfo.proxy));
+      std::move(conninfo.url), std::move(conninfo.token), std::move(conninfo.proxy),
+      environmentSapiServiceOptions());
+  auto limits = defaultLimits;
+  limits.maxAnswerPrefetches = environmentAnswerPrefetches();
   return makeProblemManager(sapiService, getAnswerService(), getRetryService(), defaultRetryTiming(), limits);
 }
 
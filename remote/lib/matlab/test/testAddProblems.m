@@ -0,0 +1,28 @@
+% Copyright © 2019 D-Wave Systems Inc.
+% The software is licensed to authorized users only under the applicable license agreement.  See License.txt.
+
+function test_suite = testAddProblems %#ok<STOUT,*DEFNU>
+initTestSuite
+end
+
+function testBadConnection
+conn = 'not a connection';
+assertExceptionThrown(@() sapiremote_addproblems(conn, {'x'}), ...
+  'sapiremote:InvalidHandle')
+end
+
+function testBadProblemIds
+conn = sapiremote_connection('', '');
+assertExceptionThrown(@() sapiremote_addproblems(conn, 'x'), ...
+  'sapiremote:BadArgType')
+assertExceptionThrown(@() sapiremote_addproblems(conn, {'x', 6}), ...
+  'sapiremote:BadArgType')
+end
+
+function testReturnType
+conn = sapiremote_connection('', '');
+phs = sapiremote_addproblems(conn, {'1', '2', '3'});
+assertEqual(size(phs), [1 3])
+assertTrue(all(cellfun(@isAnswerHandle, phs)))
+assertEqual(sapiremote_problemid(phs{2}), '2')
+end
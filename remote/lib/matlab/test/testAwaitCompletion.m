@@ -26,6 +26,18 @@ t = toc(t);
 assertTrue(t < 0.05)
 end
 
+function testIndices
+h = [ ...
+  arrayfun(@(n) {answerHandle('incomplete')}, 1:2) ...
+  {answerHandle('answer', '', '')} ...
+  {answerHandle('incomplete')} ...
+  {answerHandle('error', '')} ];
+
+[done, idx] = sapiremote_awaitcompletion(h, 2, 2);
+assertEqual(done, [false false true false true])
+assertEqual(sort(idx), [3 5])
+end
+
 function testBadHandle
 assertExceptionThrown(@() sapiremote_awaitcompletion({1, '4'}, 1, 1), ...
   'sapiremote:InvalidHandle')
@@ -5,6 +5,7 @@
 #include <utility>
 
 #include <problem-manager.hpp>
+#include <environment.hpp>
 #include <sapi-service.hpp>
 #include <answer-service.hpp>
 #include <http-service.hpp>
@@ -15,7 +16,9 @@ using std::string;
 using sapiremote::ProblemManagerLimits;
 using sapiremote::ProblemManagerPtr;
 using sapiremote::makeProblemManager;
+using sapiremote::environmentAnswerPrefetches;
 using sapiremote::makeSapiService;
+using sapiremote::environmentSapiServiceOptions;
 using sapiremote::AnswerServicePtr;
 using sapiremote::makeAnswerService;
 using sapiremote::makeThreadPool;
@@ -28,10 +31,17 @@ using sapiremote::http::Proxy;
 
 namespace {
 
-const ProblemManagerLimits limits = {
+const ProblemManagerLimits defaultLimits = {
     20,  // maxProblemsPerSubmission
     100, // maxIdsPerStatusQuery
-    6    // maxActiveRequests
+    6,   // maxActiveRequests
+    64 << 20, // answerCacheBytes
+    0,   // maxAnswerPrefetches: DWAVE_SAPI_ANSWER_PREFETCHES turns prefetching on
+    100, // minPollIntervalMs
+    5000, // maxPollIntervalMs
+    20,  // longPollWaitS
+    {{0, 0, 0, 0}, {0, 0, 0, 1}}, // schedule: equal weights, one request slot kept for answer downloads
+    {16, 50, 500} // adaptive ceilings: active requests, problems per submission, IDs per status query
 };
 
 HttpServicePtr getHttpService() {
@@ -52,6 +62,9 @@ RetryTimerServicePtr getRetryService() {
 } // namespace {anonymous}
 
 ProblemManagerPtr createProblemManager(string& url, string& token, Proxy& proxy) {
-  auto sapiService = makeSapiService(getHttpService(), std::move(url), std::move(token), std::move(proxy));
+  auto sapiService = makeSapiService(getHttpService(), std::move(url), std::move(token), std::move(proxy),
+      environmentSapiServiceOptions());
+  auto limits = defaultLimits;
+  limits.maxAnswerPrefetches = environmentAnswerPrefetches();
   return makeProblemManager(sapiService, getAnswerService(), getRetryService(), defaultRetryTiming(), limits);
 }
@@ -1,6 +1,7 @@
 //Copyright © 2019 D-Wave Systems Inc.
 //The software is licensed to authorized users only under the applicable license agreement.  See License.txt.
 
+#include <cstddef>
 #include <map>
 #include <string>
 #include <utility>
@@ -14,6 +15,7 @@
 #include "python-api.hpp"
 
 using std::map;
+using std::size_t;
 using std::string;
 using std::tuple;
 using std::vector;
@@ -39,6 +41,17 @@ bool await_completion(const vector<SubmittedProblem>& problems, int min_done, do
   return awaitCompletion(sps, min_done, timeout);
 }
 
+vector<size_t> await_any(const vector<SubmittedProblem>& problems, int min_done, double timeout) {
+  vector<sapiremote::SubmittedProblemPtr> sps;
+  sps.reserve(problems.size());
+  BOOST_FOREACH(const auto& p, problems) {
+    sps.push_back(p.sp());
+  }
+  vector<size_t> doneIndices;
+  awaitCompletion(sps, min_done, timeout, doneIndices);
+  return doneIndices;
+}
+
 json::Value encode_qp_problem(const Solver& solver, QpProblem& problem) {
   return encodeQpProblem(solver.solver(), std::move(problem));
 }
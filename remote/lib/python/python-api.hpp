@@ -4,6 +4,7 @@
 #ifndef PYTHON_API_HPP_INCLUDED
 #define PYTHON_API_HPP_INCLUDED
 
+#include <cstddef>
 #include <map>
 #include <string>
 #include <tuple>
@@ -59,9 +60,15 @@ public:
       solvers_(fetchSolvers(problemManager_)) {}
   const std::map<std::string, Solver>& solvers() const { return solvers_; }
   SubmittedProblem add_problem(std::string& id) { return problemManager_->addProblem(std::move(id)); }
+  std::vector<SubmittedProblem> add_problems(const std::vector<std::string>& ids) {
+    auto sps = problemManager_->addProblems(ids);
+    return std::vector<SubmittedProblem>(sps.begin(), sps.end());
+  }
 };
 
 bool await_completion(const std::vector<SubmittedProblem>& problems, int min_done, double timeout);
+std::vector<std::size_t> await_any(
+    const std::vector<SubmittedProblem>& problems, int min_done, double timeout);
 
 json::Value encode_qp_problem(const Solver& solver, sapiremote::QpProblem& problem);
 std::tuple<json::Object, sapiremote::QpAnswer> decode_qp_answer(
@@ -125,6 +125,8 @@
 
 %include std_vector.i
 %template() std::vector<bool>;
+%template() std::vector<std::size_t>;
+%template() std::vector<std::string>;
 %template() std::vector<SubmittedProblem>;
 
 %include std_map.i
@@ -200,6 +202,20 @@ to Solver object."
 %feature("docstring") Connection::add_problem "add_problem(self, id) -> SubmittedProblem
 
 Access an existing problem on a SAPI server by its problem ID."
+
+%feature("docstring") Connection::add_problems "add_problems(self, ids) -> tuple
+
+Access many existing problems on a SAPI server at once.  Equivalent
+to calling add_problem for each ID but much faster for large numbers
+of problems.  Returns a tuple of SubmittedProblem instances in the
+same order as ids."
+
+%feature("docstring") await_any "await_any(problems, min_done, timeout) -> tuple
+
+Wait up to timeout seconds for at least min_done of the given
+SubmittedProblem instances to complete.  Returns a tuple of the
+indices into problems of the problems that were complete when the
+wait ended, in completion order (fewer than min_done on timeout)."
 // ----------------------------------------------------------------------------------------------------
 
 %ignore Solver::Solver;
@@ -207,4 +223,5 @@ Access an existing problem on a SAPI server by its problem ID."
 %ignore SubmittedProblem::SubmittedProblem;
 %ignore SubmittedProblem::sp;
 %thread await_completion;
+%thread await_any;
 %include "python-api.hpp"
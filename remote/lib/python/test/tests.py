@@ -18,6 +18,13 @@ class ConnectionTest(unittest.TestCase):
         self.assertTrue(isinstance(p, sapiremote.SubmittedProblem))
         self.assertEqual(p.problem_id(), '123')
 
+    def test_add_problems(self):
+        conn = sapiremote.Connection('', '')
+        ps = conn.add_problems(['1', '2', '3'])
+        self.assertEqual([p.problem_id() for p in ps], ['1', '2', '3'])
+        self.assertTrue(all(isinstance(p, sapiremote.SubmittedProblem) for p in ps))
+        self.assertEqual(len(conn.add_problems([])), 0)
+
     def test_config_solver_with_proxy(self):
         url = 'http://example.com/sapi'
         token = 'secret'
@@ -421,3 +428,14 @@ class AwaitCompletionTest(unittest.TestCase):
         self.assertTrue(sapiremote.await_completion(sp, len(sp), 2))
         t2 = datetime.datetime.now()
         self.assertTrue(t2 - t1 < datetime.timedelta(milliseconds=200))
+
+    def test_await_any(self):
+        conn = sapiremote.Connection('', '')
+        solver = conn.solvers()['test']
+        sp = [conn.add_problem('0'),
+              solver.submit('', None, {'answer': True}),
+              conn.add_problem('2'),
+              solver.submit('', None, {'error': 'x'})]
+        done = sapiremote.await_any(sp, 2, 2)
+        self.assertEqual(sorted(done), [1, 3])
+        self.assertEqual(sapiremote.await_any(sp[:1], 1, 0.01), ())
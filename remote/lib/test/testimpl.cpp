@@ -8,6 +8,7 @@
 #include <string>
 #include <tuple>
 #include <utility>
+#include <vector>
 
 #include <boost/foreach.hpp>
 
@@ -24,6 +25,7 @@ using std::rethrow_exception;
 using std::make_shared;
 using std::string;
 using std::tuple;
+using std::vector;
 
 using sapiremote::SubmittedProblem;
 using sapiremote::SubmittedProblemPtr;
@@ -32,6 +34,7 @@ using sapiremote::AnswerCallbackPtr;
 using sapiremote::Solver;
 using sapiremote::ProblemManager;
 using sapiremote::ProblemManagerPtr;
+using sapiremote::ProblemManagerStats;
 using sapiremote::SolverMap;
 using sapiremote::SubmittedProblemInfo;
 using sapiremote::InternalException;
@@ -296,7 +299,7 @@ private:
   Proxy proxy_;
   SolverMap solvers_;
 
-  virtual SubmittedProblemPtr submitProblemImpl(string&, string&, json::Value&, json::Object&) {
+  virtual SubmittedProblemPtr submitProblemImpl(string&, string&, json::Value&, json::Object&, int) {
     throw InternalException("not implemented");
   }
 
@@ -304,8 +307,16 @@ private:
     return make_shared<TestSubmittedProblem>(id);
   }
 
+  virtual vector<SubmittedProblemPtr> addProblemsImpl(const vector<string>& ids) {
+    vector<SubmittedProblemPtr> problems;
+    BOOST_FOREACH( const auto& id, ids ) problems.push_back(make_shared<TestSubmittedProblem>(id));
+    return problems;
+  }
+
   virtual SolverMap fetchSolversImpl() { return solvers_; }
 
+  virtual ProblemManagerStats statsImpl() const { return ProblemManagerStats(); }
+
 public:
   TestProblemManager(string url, string token, Proxy proxy) :
       url_(url), token_(token), proxy_(proxy) {
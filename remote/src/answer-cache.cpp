@@ -0,0 +1,99 @@
+//Copyright © 2019 D-Wave Systems Inc.
+//The software is licensed to authorized users only under the applicable license agreement.  See License.txt.
+
+#include <cstddef>
+#include <mutex>
+#include <string>
+
+#include <answer-cache.hpp>
+#include <json.hpp>
+
+using std::size_t;
+using std::lock_guard;
+using std::mutex;
+using std::string;
+
+namespace {
+
+// per-node overhead of std::map and std::unordered_map (pointers, colour/hash, allocator rounding)
+const size_t mapNodeOverhead = 4 * sizeof(void*);
+
+size_t stringSize(const string& s) {
+  return s.capacity() + 1;
+}
+
+} // namespace {anonymous}
+
+namespace sapiremote {
+
+size_t approximateSize(const json::Value& value) {
+  auto bytes = sizeof(json::Value);
+  if (value.isString()) {
+    bytes += stringSize(value.getString());
+  } else if (value.isArray()) {
+    const auto& a = value.getArray();
+    bytes += (a.capacity() - a.size()) * sizeof(json::Value);
+    for (auto iter = a.begin(), end = a.end(); iter != end; ++iter) bytes += approximateSize(*iter);
+  } else if (value.isObject()) {
+    const auto& o = value.getObject();
+    for (auto iter = o.begin(), end = o.end(); iter != end; ++iter) {
+      bytes += mapNodeOverhead + sizeof(string) + stringSize(iter->first) + approximateSize(iter->second);
+    }
+  }
+  return bytes;
+}
+
+AnswerCache::AnswerCache(size_t maxBytes) : maxBytes_(maxBytes), stats_() {}
+
+CachedAnswerPtr AnswerCache::find(const string& id) {
+  lock_guard<mutex> lock(mutex_);
+  auto iter = index_.find(id);
+  if (iter == index_.end()) {
+    ++stats_.misses;
+    return CachedAnswerPtr();
+  }
+
+  ++stats_.hits;
+  entries_.splice(entries_.begin(), entries_, iter->second);
+  return iter->second->answer;
+}
+
+void AnswerCache::insert(const string& id, CachedAnswerPtr answer) {
+  auto bytes = sizeof(Entry) + mapNodeOverhead + 2 * stringSize(id) + stringSize(answer->type)
+      + approximateSize(answer->answer);
+  if (bytes > maxBytes_) return;
+
+  lock_guard<mutex> lock(mutex_);
+  auto iter = index_.find(id);
+  if (iter != index_.end()) {
+    // already cached (e.g. concurrent fetches); answers don't change so keep the old one
+    entries_.splice(entries_.begin(), entries_, iter->second);
+    return;
+  }
+
+  while (!entries_.empty() && stats_.bytes + bytes > maxBytes_) {
+    const auto& lru = entries_.back();
+    stats_.bytes -= lru.bytes;
+    --stats_.entries;
+    ++stats_.evictions;
+    index_.erase(lru.id);
+    entries_.pop_back();
+  }
+
+  entries_.push_front(Entry{id, answer, bytes});
+  try {
+    index_[id] = entries_.begin();
+  } catch (...) {
+    entries_.pop_front();
+    throw;
+  }
+  stats_.bytes += bytes;
+  ++stats_.entries;
+}
+
+AnswerCacheStats AnswerCache::stats() const {
+  lock_guard<mutex> lock(mutex_);
+  return stats_;
+}
+
+} // namespace sapiremote
@@ -3,14 +3,13 @@
 
 #include <chrono>
 #include <condition_variable>
+#include <cstddef>
 #include <limits>
 #include <mutex>
 #include <new>
 #include <stdexcept>
 #include <vector>
 
-#include <boost/foreach.hpp>
-
 #include <problem.hpp>
 
 using std::condition_variable;
@@ -65,16 +64,23 @@ private:
   condition_variable cv_;
   system_clock::time_point endTime_;
   int remaining_;
+  vector<std::size_t> indices_; // of notifying problems, in notification order
 
 public:
   EventCounter(int remaining, system_clock::time_point endTime) : remaining_(remaining), endTime_(endTime) {}
 
-  void notify() {
+  void notify(std::size_t index) {
     lock_guard<mutex> l(mutex_);
     --remaining_;
+    indices_.push_back(index);
     cv_.notify_all();
   }
 
+  void indices(vector<std::size_t>& out) {
+    lock_guard<mutex> l(mutex_);
+    out.insert(out.end(), indices_.begin(), indices_.end());
+  }
+
   bool wait() {
     unique_lock<mutex> lock(mutex_);
     while (remaining_ > 0) {
@@ -89,17 +95,19 @@ class EventNotifier {
 private:
   mutex mutex_;
   EventCounterPtr eventCounter_;
+  std::size_t index_;
   bool done_;
 
 public:
-  EventNotifier(EventCounterPtr eventCounter) : eventCounter_(eventCounter), done_(false) {}
+  EventNotifier(EventCounterPtr eventCounter, std::size_t index) :
+      eventCounter_(eventCounter), index_(index), done_(false) {}
 
   void notify() {
     unique_lock<mutex> l(mutex_);
     if (!done_) {
       done_ = true;
       l.unlock();
-      eventCounter_->notify();
+      eventCounter_->notify(index_);
     }
   }
 };
@@ -109,9 +117,10 @@ private:
   virtual void notifySubmittedImpl() { notify(); }
   virtual void notifyDoneImpl() {}
   virtual void notifyErrorImpl() { notify(); }
+  virtual bool directImpl() const { return true; }
 
 public:
-  SubmissionObserver(EventCounterPtr eventCounter) : EventNotifier(eventCounter) {}
+  SubmissionObserver(EventCounterPtr eventCounter, std::size_t index) : EventNotifier(eventCounter, index) {}
 };
 
 class CompletionObserver : public SubmittedProblemObserver, public EventNotifier {
@@ -119,23 +128,30 @@ private:
   virtual void notifySubmittedImpl() {}
   virtual void notifyDoneImpl() { notify(); }
   virtual void notifyErrorImpl() { notify(); }
+  virtual bool directImpl() const { return true; }
 
 public:
-  CompletionObserver(EventCounterPtr eventCounter) : EventNotifier(eventCounter) {}
+  CompletionObserver(EventCounterPtr eventCounter, std::size_t index) : EventNotifier(eventCounter, index) {}
 };
 
+// indices may be null
 template<typename T>
-bool awaitEvents(const vector<SubmittedProblemPtr>& problems, int minEvents, double timeoutS) {
+bool awaitEvents(const vector<SubmittedProblemPtr>& problems, int minEvents, double timeoutS,
+    vector<std::size_t>* indices) {
+
   if (minEvents > 0 && static_cast<unsigned int>(minEvents) > problems.size()) {
     minEvents = static_cast<int>(problems.size());
   }
   auto eventCounter = make_shared<EventCounter>(minEvents, computeEndTime(timeoutS));
   vector<shared_ptr<T>> observers;
-  BOOST_FOREACH( auto& p, problems ) {
-    observers.push_back(make_shared<T>(eventCounter));
-    p->addSubmittedProblemObserver(observers.back());
+  observers.reserve(problems.size());
+  for (std::size_t i = 0; i < problems.size(); ++i) {
+    observers.push_back(make_shared<T>(eventCounter, i));
+    problems[i]->addSubmittedProblemObserver(observers.back());
   }
-  return eventCounter->wait();
+  auto r = eventCounter->wait();
+  if (indices) eventCounter->indices(*indices);
+  return r;
 }
 
 } // namespace {anonymous}
@@ -144,11 +160,16 @@ namespace sapiremote {
 
 bool awaitSubmission(const vector<SubmittedProblemPtr>& problems, double timeoutS) {
   if (problems.size() > numeric_limits<int>::max()) throw std::invalid_argument("sapiremote::awaitSubmission");
-  return awaitEvents<SubmissionObserver>(problems, static_cast<int>(problems.size()), timeoutS);
+  return awaitEvents<SubmissionObserver>(problems, static_cast<int>(problems.size()), timeoutS, 0);
 }
 
 bool awaitCompletion(const vector<SubmittedProblemPtr>& problems, int mindone, double timeoutS) {
-  return awaitEvents<CompletionObserver>(problems, mindone, timeoutS);
+  return awaitEvents<CompletionObserver>(problems, mindone, timeoutS, 0);
+}
+
+bool awaitCompletion(const vector<SubmittedProblemPtr>& problems, int mindone, double timeoutS,
+    vector<std::size_t>& doneIndices) {
+  return awaitEvents<CompletionObserver>(problems, mindone, timeoutS, &doneIndices);
 }
 
 } // namespace sapiremote
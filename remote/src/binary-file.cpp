@@ -0,0 +1,119 @@
+//Copyright © 2019 D-Wave Systems Inc.
+//The software is licensed to authorized users only under the applicable license agreement.  See License.txt.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <binary-file.hpp>
+
+using std::size_t;
+using std::string;
+using std::uint32_t;
+using std::uint64_t;
+
+namespace {
+
+const uint32_t byteOrderMark = 0x01020304;
+
+#ifndef _WIN32
+// makes a rename into the directory durable
+void syncParentDir(const string& path) {
+  auto slash = path.find_last_of('/');
+  auto dir = slash == string::npos ? string(".") : slash == 0 ? string("/") : path.substr(0, slash);
+  auto fd = open(dir.c_str(), O_RDONLY);
+  if (fd >= 0) {
+    fsync(fd);
+    close(fd);
+  }
+}
+#endif
+
+bool moveOver(const string& from, const string& to, bool durable) {
+#ifdef _WIN32
+  // plain rename won't replace an existing file, and removing it first leaves a moment with no file at all
+  DWORD flags = MOVEFILE_REPLACE_EXISTING;
+  if (durable) flags |= MOVEFILE_WRITE_THROUGH;
+  return MoveFileExA(from.c_str(), to.c_str(), flags) != 0;
+#else
+  if (std::rename(from.c_str(), to.c_str()) != 0) return false;
+  if (durable) syncParentDir(to);
+  return true;
+#endif
+}
+
+} // namespace {anonymous}
+
+namespace sapiremote {
+
+uint32_t fnv1a32(const char* data, size_t n) {
+  uint32_t h = 2166136261u;
+  for (size_t i = 0; i < n; ++i) {
+    h ^= static_cast<unsigned char>(data[i]);
+    h *= 16777619u;
+  }
+  return h;
+}
+
+uint64_t fnv1a64(const char* data, size_t n) {
+  uint64_t h = 14695981039346656037ull;
+  for (size_t i = 0; i < n; ++i) {
+    h ^= static_cast<unsigned char>(data[i]);
+    h *= 1099511628211ull;
+  }
+  return h;
+}
+
+string binaryFileHeader(const char* magic) {
+  auto header = string(magic);
+  header.append(reinterpret_cast<const char*>(&byteOrderMark), sizeof(byteOrderMark));
+  return header;
+}
+
+bool readFile(const string& path, string& contents) {
+  auto f = std::fopen(path.c_str(), "rb");
+  if (!f) return false;
+  char buf[1 << 16];
+  size_t n;
+  while ((n = std::fread(buf, 1, sizeof(buf), f)) > 0) contents.append(buf, n);
+  auto ok = !std::ferror(f);
+  std::fclose(f);
+  return ok;
+}
+
+bool writeAll(std::FILE* f, const string& data) {
+  return std::fwrite(data.data(), 1, data.size(), f) == data.size();
+}
+
+bool syncFile(std::FILE* f) {
+  if (std::fflush(f) != 0) return false;
+#ifdef _WIN32
+  return _commit(_fileno(f)) == 0;
+#else
+  return fsync(fileno(f)) == 0;
+#endif
+}
+
+bool replaceFile(const string& path, const string& tmpPath, const string& contents, bool durable) {
+  auto out = std::fopen(tmpPath.c_str(), "wb");
+  if (!out) return false;
+  auto ok = writeAll(out, contents) && (!durable || syncFile(out));
+  ok = std::fclose(out) == 0 && ok;
+  if (!ok || !moveOver(tmpPath, path, durable)) {
+    std::remove(tmpPath.c_str());
+    return false;
+  }
+  return true;
+}
+
+} // namespace sapiremote
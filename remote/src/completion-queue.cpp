@@ -0,0 +1,224 @@
+//Copyright © 2019 D-Wave Systems Inc.
+//The software is licensed to authorized users only under the applicable license agreement.  See License.txt.
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+
+#if defined(__linux__)
+#include <stdint.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#elif !defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <completion-queue.hpp>
+#include <exceptions.hpp>
+#include <problem.hpp>
+
+using std::deque;
+using std::enable_shared_from_this;
+using std::lock_guard;
+using std::make_shared;
+using std::min;
+using std::mutex;
+using std::condition_variable;
+using std::shared_ptr;
+using std::unique_lock;
+using std::unordered_map;
+using std::vector;
+using std::weak_ptr;
+using std::chrono::duration;
+using std::chrono::duration_cast;
+using std::chrono::steady_clock;
+
+using sapiremote::CompletionQueue;
+using sapiremote::CompletionQueuePtr;
+using sapiremote::InternalException;
+using sapiremote::SubmittedProblem;
+using sapiremote::SubmittedProblemObserver;
+using sapiremote::SubmittedProblemObserverPtr;
+using sapiremote::SubmittedProblemPtr;
+
+namespace {
+
+// longer timeouts wait forever (steady_clock time points overflow after a few hundred years)
+const double maxTimeoutS = 1e8;
+
+// Descriptor that is readable while set.  Not thread safe.
+class NotificationFd : boost::noncopyable {
+private:
+#if defined(__linux__)
+  int fd_;
+
+public:
+  NotificationFd() : fd_(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) {
+    if (fd_ < 0) throw InternalException("can't create completion queue eventfd");
+  }
+  ~NotificationFd() { close(fd_); }
+
+  int fd() const { return fd_; }
+
+  void set() {
+    uint64_t one = 1;
+    if (write(fd_, &one, sizeof(one)) < 0) {} // can only fail if the counter is full, i.e. already set
+  }
+
+  void clear() {
+    uint64_t count;
+    if (read(fd_, &count, sizeof(count)) < 0) {} // fails if already clear
+  }
+
+#elif !defined(_WIN32)
+  int fds_[2];
+
+public:
+  NotificationFd() {
+    if (pipe(fds_) != 0) throw InternalException("can't create completion queue pipe");
+    for (auto i = 0; i < 2; ++i) {
+      fcntl(fds_[i], F_SETFL, fcntl(fds_[i], F_GETFL) | O_NONBLOCK);
+      fcntl(fds_[i], F_SETFD, FD_CLOEXEC);
+    }
+  }
+  ~NotificationFd() {
+    close(fds_[0]);
+    close(fds_[1]);
+  }
+
+  int fd() const { return fds_[0]; }
+
+  void set() {
+    char c = 0;
+    if (write(fds_[1], &c, 1) < 0) {} // pipe full: already readable
+  }
+
+  void clear() {
+    char buf[64];
+    while (read(fds_[0], buf, sizeof(buf)) > 0) {}
+  }
+
+#else
+public:
+  int fd() const { return -1; }
+  void set() {}
+  void clear() {}
+#endif
+};
+
+class CompletionQueueImpl : public CompletionQueue, public enable_shared_from_this<CompletionQueueImpl> {
+private:
+  // problems only hold weak pointers to their observers; null once the problem has finished
+  typedef unordered_map<const SubmittedProblem*, SubmittedProblemObserverPtr> AttachedMap;
+
+  mutable mutex mutex_;
+  condition_variable cv_;
+  AttachedMap attached_; // until popped
+  deque<SubmittedProblemPtr> finished_;
+  NotificationFd notificationFd_;
+
+  virtual void addImpl(const SubmittedProblemPtr& problem);
+  virtual std::size_t popImpl(vector<SubmittedProblemPtr>& problems, std::size_t maxProblems,
+      double timeoutS);
+  virtual std::size_t sizeImpl() const;
+  virtual int notificationFdImpl() const { return notificationFd_.fd(); }
+
+public:
+  void finished(const SubmittedProblemPtr& problem);
+};
+
+class QueueObserver : public SubmittedProblemObserver {
+private:
+  weak_ptr<CompletionQueueImpl> queue_;
+  SubmittedProblemPtr problem_; // not a cycle: problems only hold weak pointers to their observers
+
+  void finished() {
+    auto queue = queue_.lock();
+    if (queue) queue->finished(problem_);
+  }
+
+  virtual void notifySubmittedImpl() {}
+  virtual void notifyDoneImpl() { finished(); }
+  virtual void notifyErrorImpl() { finished(); }
+  virtual bool directImpl() const { return true; }
+
+public:
+  QueueObserver(const shared_ptr<CompletionQueueImpl>& queue, const SubmittedProblemPtr& problem) :
+      queue_(queue), problem_(problem) {}
+};
+
+void CompletionQueueImpl::addImpl(const SubmittedProblemPtr& problem) {
+  auto observer = make_shared<QueueObserver>(shared_from_this(), problem);
+  {
+    lock_guard<mutex> lock(mutex_);
+    if (!attached_.insert(AttachedMap::value_type(problem.get(), observer)).second) return;
+  }
+  // may call finished right away
+  problem->addSubmittedProblemObserver(observer);
+}
+
+std::size_t CompletionQueueImpl::popImpl(
+    vector<SubmittedProblemPtr>& problems,
+    std::size_t maxProblems,
+    double timeoutS) {
+
+  if (maxProblems == 0) return 0;
+
+  unique_lock<mutex> lock(mutex_);
+  if (finished_.empty() && timeoutS > 0.0) {
+    if (timeoutS < maxTimeoutS) {
+      auto timeout = duration_cast<steady_clock::duration>(duration<double>(timeoutS));
+      auto endTime = steady_clock::now() + timeout;
+      cv_.wait_until(lock, endTime, [this] { return !finished_.empty(); });
+    } else {
+      cv_.wait(lock, [this] { return !finished_.empty(); });
+    }
+  }
+
+  auto n = min(maxProblems, finished_.size());
+  for (std::size_t i = 0; i < n; ++i) {
+    attached_.erase(finished_.front().get());
+    problems.push_back(std::move(finished_.front()));
+    finished_.pop_front();
+  }
+  if (finished_.empty()) {
+    notificationFd_.clear();
+  } else {
+    cv_.notify_one(); // for other waiters
+  }
+  return n;
+}
+
+std::size_t CompletionQueueImpl::sizeImpl() const {
+  lock_guard<mutex> lock(mutex_);
+  return attached_.size();
+}
+
+void CompletionQueueImpl::finished(const SubmittedProblemPtr& problem) {
+  lock_guard<mutex> lock(mutex_);
+  auto iter = attached_.find(problem.get());
+  if (iter == attached_.end() || !iter->second) return;
+  iter->second.reset(); // whoever is notifying holds another reference
+  if (finished_.empty()) notificationFd_.set();
+  finished_.push_back(problem);
+  cv_.notify_one();
+}
+
+} // namespace {anonymous}
+
+namespace sapiremote {
+
+CompletionQueuePtr makeCompletionQueue() {
+  return make_shared<CompletionQueueImpl>();
+}
+
+} // namespace sapiremote
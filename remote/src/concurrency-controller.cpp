@@ -0,0 +1,164 @@
+//Copyright © 2019 D-Wave Systems Inc.
+//The software is licensed to authorized users only under the applicable license agreement.  See License.txt.
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+
+#include <concurrency-controller.hpp>
+
+using std::lock_guard;
+using std::max;
+using std::min;
+using std::mutex;
+using std::chrono::duration;
+using std::chrono::steady_clock;
+
+using sapiremote::ConcurrencyDecision;
+
+namespace concurrencyknobs = sapiremote::concurrencyknobs;
+namespace concurrencyreasons = sapiremote::concurrencyreasons;
+namespace requestclasses = sapiremote::requestclasses;
+
+namespace {
+
+const double cutFactor = 0.7;
+const double spikeFactor = 3.0;
+const double spikeSlackS = 0.05;
+const double baselineDrift = 0.01; // lets the baseline follow latency that has gone up for good
+const int minBaselineSamples = 5;
+
+// -1: none
+int batchKnob(requestclasses::Type c) {
+  switch (c) {
+    case requestclasses::SUBMIT: return concurrencyknobs::PROBLEMS_PER_SUBMISSION;
+    case requestclasses::STATUS: return concurrencyknobs::IDS_PER_STATUS_QUERY;
+    default: return -1;
+  }
+}
+
+} // namespace {anonymous}
+
+namespace sapiremote {
+
+ConcurrencyController::ConcurrencyController(const int values[], const int floors[], const int ceilings[]) :
+    start_(steady_clock::now()), increases_(0), decreases_(0) {
+  for (auto k = 0; k < concurrencyknobs::count; ++k) {
+    auto& knob = knobs_[k];
+    knob.value = values[k];
+    knob.floor = min(floors[k], values[k]);
+    knob.ceiling = max(ceilings[k], values[k]);
+    knob.step = k == concurrencyknobs::ACTIVE_REQUESTS ? 1 : max(1, values[k] / 10);
+    knob.healthy = 0;
+    knob.holdOff = 0;
+  }
+  for (auto c = 0; c < requestclasses::count; ++c) {
+    baselines_[c].latencyS = -1.0;
+    baselines_[c].samples = 0;
+  }
+}
+
+int ConcurrencyController::limit(concurrencyknobs::Type knob) const {
+  lock_guard<mutex> lock(mutex_);
+  return knobs_[knob].value;
+}
+
+void ConcurrencyController::responseOk(requestclasses::Type c, double latencyS) {
+  lock_guard<mutex> lock(mutex_);
+  auto batch = batchKnob(c);
+  if (latencyS >= 0.0 && spike(c, latencyS)) {
+    cut(concurrencyknobs::ACTIVE_REQUESTS, concurrencyreasons::LATENCY);
+    if (batch >= 0) cut(static_cast<concurrencyknobs::Type>(batch), concurrencyreasons::LATENCY);
+  } else {
+    healthy(concurrencyknobs::ACTIVE_REQUESTS);
+    if (batch >= 0) healthy(static_cast<concurrencyknobs::Type>(batch));
+  }
+}
+
+void ConcurrencyController::responseFailed(requestclasses::Type c) {
+  lock_guard<mutex> lock(mutex_);
+  auto batch = batchKnob(c);
+  cut(concurrencyknobs::ACTIVE_REQUESTS, concurrencyreasons::FAILURE);
+  if (batch >= 0) cut(static_cast<concurrencyknobs::Type>(batch), concurrencyreasons::FAILURE);
+}
+
+bool ConcurrencyController::tooManyIds() {
+  lock_guard<mutex> lock(mutex_);
+  auto& knob = knobs_[concurrencyknobs::IDS_PER_STATUS_QUERY];
+  if (knob.value < 2) return false;
+  knob.value = static_cast<int>(knob.value * cutFactor);
+  knob.ceiling = knob.value;
+  knob.floor = min(knob.floor, knob.value);
+  knob.healthy = 0;
+  ++decreases_;
+  record(concurrencyknobs::IDS_PER_STATUS_QUERY, concurrencyreasons::TOO_MANY_IDS);
+  return true;
+}
+
+ConcurrencyControllerStats ConcurrencyController::stats() const {
+  lock_guard<mutex> lock(mutex_);
+  ConcurrencyControllerStats s;
+  for (auto k = 0; k < concurrencyknobs::count; ++k) s.limits[k] = knobs_[k].value;
+  s.increases = increases_;
+  s.decreases = decreases_;
+  s.recentDecisions.assign(decisions_.begin(), decisions_.end());
+  return s;
+}
+
+// caller must hold mutex_
+bool ConcurrencyController::spike(requestclasses::Type c, double latencyS) {
+  auto& baseline = baselines_[c];
+  auto isSpike = baseline.samples >= minBaselineSamples
+      && latencyS > spikeFactor * baseline.latencyS + spikeSlackS;
+  if (baseline.latencyS < 0.0 || latencyS < baseline.latencyS) {
+    baseline.latencyS = latencyS;
+  } else {
+    baseline.latencyS += baselineDrift * (latencyS - baseline.latencyS);
+  }
+  ++baseline.samples;
+  return isSpike;
+}
+
+// Windows are as many responses as there are request slots, i.e. roughly one round trip's worth.
+// caller must hold mutex_
+void ConcurrencyController::healthy(concurrencyknobs::Type k) {
+  auto& knob = knobs_[k];
+  if (knob.holdOff > 0) {
+    --knob.holdOff;
+    return;
+  }
+  if (++knob.healthy < knobs_[concurrencyknobs::ACTIVE_REQUESTS].value) return;
+  knob.healthy = 0;
+  if (knob.value >= knob.ceiling) return;
+  knob.value = min(knob.ceiling, knob.value + knob.step);
+  ++increases_;
+  record(k, concurrencyreasons::HEALTHY);
+}
+
+// caller must hold mutex_
+void ConcurrencyController::cut(concurrencyknobs::Type k, concurrencyreasons::Type reason) {
+  auto& knob = knobs_[k];
+  if (knob.holdOff > 0) {
+    --knob.holdOff;
+    return;
+  }
+  knob.healthy = 0;
+  // responses to requests already in flight say nothing about the new limit
+  knob.holdOff = knobs_[concurrencyknobs::ACTIVE_REQUESTS].value;
+  auto value = max(knob.floor, static_cast<int>(knob.value * cutFactor));
+  if (value == knob.value) return;
+  knob.value = value;
+  ++decreases_;
+  record(k, reason);
+}
+
+// caller must hold mutex_
+void ConcurrencyController::record(concurrencyknobs::Type knob, concurrencyreasons::Type reason) {
+  auto timeS = duration<double>(steady_clock::now() - start_).count();
+  ConcurrencyDecision d = {timeS, knob, reason, knobs_[knob].value};
+  decisions_.push_back(d);
+  if (decisions_.size() > static_cast<std::size_t>(maxRecentDecisions)) decisions_.pop_front();
+}
+
+} // namespace sapiremote
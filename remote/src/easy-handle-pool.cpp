@@ -0,0 +1,128 @@
+//Copyright © 2019 D-Wave Systems Inc.
+//The software is licensed to authorized users only under the applicable license agreement.  See License.txt.
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+
+#include <curl/curl.h>
+
+#include <easy-handle-pool.hpp>
+#include <exceptions.hpp>
+#include <http-service.hpp>
+
+using std::bad_alloc;
+using std::lock_guard;
+using std::mutex;
+
+namespace sapiremote {
+namespace http {
+
+const std::size_t EasyHandlePool::maxIdleHandles;
+
+void ReleaseEasyHandle::operator()(CURL* h) {
+  pool->release(h);
+}
+
+EasyHandlePool::EasyHandlePool() :
+    shareHandle_(curl_share_init()),
+    size_(0),
+    hits_(0),
+    misses_(0),
+    open_(true) {
+
+  if (!shareHandle_) throw bad_alloc();
+  setopt(CURLSHOPT_LOCKFUNC, &EasyHandlePool::lockShare);
+  setopt(CURLSHOPT_UNLOCKFUNC, &EasyHandlePool::unlockShare);
+  setopt(CURLSHOPT_USERDATA, this);
+  setopt(CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+  setopt(CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+}
+
+EasyHandlePool::~EasyHandlePool() {
+  close();
+}
+
+template<typename T>
+void EasyHandlePool::setopt(CURLSHoption option, T value) {
+  CURLSHcode r = curl_share_setopt(shareHandle_.get(), option, value);
+  if (r == CURLSHE_NOMEM) throw bad_alloc();
+  if (r != CURLSHE_OK) throw NetworkException(curl_share_strerror(r));
+}
+
+void EasyHandlePool::lockShare(CURL*, curl_lock_data data, curl_lock_access, void* userp) {
+  static_cast<EasyHandlePool*>(userp)->shareMutexes_[data].lock();
+}
+
+void EasyHandlePool::unlockShare(CURL*, curl_lock_data data, void* userp) {
+  static_cast<EasyHandlePool*>(userp)->shareMutexes_[data].unlock();
+}
+
+void EasyHandlePool::cleanupHandle(CURL* h) {
+  curl_easy_cleanup(h);
+  --size_;
+  if (!open_ && size_ == 0) shareHandle_.reset();
+}
+
+EasyHandlePtr EasyHandlePool::acquire() {
+  {
+    lock_guard<mutex> lock(mutex_);
+    if (!open_) throw ServiceShutdownException();
+    if (!idleHandles_.empty()) {
+      CURL* h = idleHandles_.back();
+      idleHandles_.pop_back();
+      ++hits_;
+      return EasyHandlePtr(h, ReleaseEasyHandle{shared_from_this()});
+    }
+    ++misses_;
+    ++size_;
+  }
+
+  CURL* h = curl_easy_init();
+  if (!h) {
+    lock_guard<mutex> lock(mutex_);
+    --size_;
+    throw bad_alloc();
+  }
+  EasyHandlePtr handle(h, ReleaseEasyHandle{shared_from_this()});
+  auto r = curl_easy_setopt(h, CURLOPT_SHARE, shareHandle_.get());
+  if (r == CURLE_OUT_OF_MEMORY) throw bad_alloc();
+  if (r != CURLE_OK) throw NetworkException(curl_easy_strerror(r));
+  return handle;
+}
+
+void EasyHandlePool::release(CURL* h) {
+  curl_easy_reset(h); // keeps the share handle and live connections
+
+  lock_guard<mutex> lock(mutex_);
+  if (open_ && idleHandles_.size() < maxIdleHandles) {
+    try {
+      idleHandles_.push_back(h);
+      return;
+    } catch (...) {}
+  }
+  cleanupHandle(h);
+}
+
+void EasyHandlePool::close() {
+  lock_guard<mutex> lock(mutex_);
+  open_ = false;
+  for (auto iter = idleHandles_.begin(), end = idleHandles_.end(); iter != end; ++iter) {
+    curl_easy_cleanup(*iter);
+  }
+  size_ -= idleHandles_.size();
+  idleHandles_.clear();
+  if (size_ == 0) shareHandle_.reset();
+}
+
+void EasyHandlePool::stats(HttpServiceStats& s) {
+  lock_guard<mutex> lock(mutex_);
+  s.handlePoolSize = size_;
+  s.idleHandles = idleHandles_.size();
+  s.handlePoolHits = hits_;
+  s.handlePoolMisses = misses_;
+}
+
+} // namespace sapiremote::http
+} // namespace sapiremote
@@ -0,0 +1,31 @@
+//Copyright © 2019 D-Wave Systems Inc.
+//The software is licensed to authorized users only under the applicable license agreement.  See License.txt.
+
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+
+#include <environment.hpp>
+
+namespace {
+const char* answerPrefetchesVariable = "DWAVE_SAPI_ANSWER_PREFETCHES";
+} // namespace {anonymous}
+
+namespace sapiremote {
+
+void readEnvironment(const char* name, int& value) {
+  auto s = std::getenv(name);
+  if (!s || !*s) return;
+  char* end;
+  errno = 0;
+  auto v = std::strtol(s, &end, 10);
+  if (*end == 0 && errno == 0 && v > 0 && v <= INT_MAX) value = static_cast<int>(v);
+}
+
+int environmentAnswerPrefetches() {
+  auto prefetches = 0;
+  readEnvironment(answerPrefetchesVariable, prefetches);
+  return prefetches;
+}
+
+} // namespace sapiremote
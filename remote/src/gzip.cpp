@@ -0,0 +1,136 @@
+//Copyright © 2019 D-Wave Systems Inc.
+//The software is licensed to authorized users only under the applicable license agreement.  See License.txt.
+
+#include <climits>
+#include <new>
+#include <string>
+
+#include <zlib.h>
+
+#include <exceptions.hpp>
+#include <gzip.hpp>
+
+using std::string;
+
+using sapiremote::EncodingException;
+using sapiremote::DecodingException;
+
+namespace {
+
+const int gzipWindowBits = 15 + 16; // 15: max window size, +16: gzip header/trailer instead of zlib
+const int memLevel = 8; // zlib default
+const size_t chunkSize = 16384;
+
+// zlib counts with uInt; feed it at most this much at a time
+const size_t maxAvail = UINT_MAX;
+
+class Deflater {
+private:
+  z_stream zs_;
+public:
+  Deflater() {
+    zs_.zalloc = Z_NULL;
+    zs_.zfree = Z_NULL;
+    zs_.opaque = Z_NULL;
+    auto r = deflateInit2(&zs_, Z_DEFAULT_COMPRESSION, Z_DEFLATED, gzipWindowBits, memLevel, Z_DEFAULT_STRATEGY);
+    if (r == Z_MEM_ERROR) throw std::bad_alloc();
+    if (r != Z_OK) throw EncodingException("gzip initialization failed");
+  }
+  ~Deflater() { deflateEnd(&zs_); }
+  z_stream& stream() { return zs_; }
+};
+
+class Inflater {
+private:
+  z_stream zs_;
+public:
+  Inflater() {
+    zs_.zalloc = Z_NULL;
+    zs_.zfree = Z_NULL;
+    zs_.opaque = Z_NULL;
+    zs_.next_in = Z_NULL;
+    zs_.avail_in = 0;
+    auto r = inflateInit2(&zs_, gzipWindowBits);
+    if (r == Z_MEM_ERROR) throw std::bad_alloc();
+    if (r != Z_OK) throw DecodingException("gzip initialization failed");
+  }
+  ~Inflater() { inflateEnd(&zs_); }
+  z_stream& stream() { return zs_; }
+};
+
+} // namespace {anonymous}
+
+namespace sapiremote {
+
+string gzipCompress(const string& data) {
+  Deflater deflater;
+  auto& zs = deflater.stream();
+
+  string out;
+  out.resize(deflateBound(&zs, static_cast<uLong>(data.size())));
+
+  zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+  auto inLeft = data.size();
+  size_t written = 0;
+  int r;
+  do {
+    auto inChunk = inLeft < maxAvail ? inLeft : maxAvail;
+    zs.avail_in = static_cast<uInt>(inChunk);
+    if (out.size() == written) out.resize(out.size() + chunkSize);
+    auto outChunk = out.size() - written < maxAvail ? out.size() - written : maxAvail;
+    zs.next_out = reinterpret_cast<Bytef*>(&out[written]);
+    zs.avail_out = static_cast<uInt>(outChunk);
+
+    r = deflate(&zs, inChunk == inLeft ? Z_FINISH : Z_NO_FLUSH);
+    if (r == Z_STREAM_ERROR) throw EncodingException("gzip compression failed");
+
+    inLeft -= inChunk - zs.avail_in;
+    written += outChunk - zs.avail_out;
+  } while (r != Z_STREAM_END);
+
+  out.resize(written);
+  return out;
+}
+
+string gzipDecompress(const string& gzData) {
+  Inflater inflater;
+  auto& zs = inflater.stream();
+
+  string out;
+  out.resize(gzData.size() * 4 + chunkSize);
+
+  zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(gzData.data()));
+  auto inLeft = gzData.size();
+  size_t written = 0;
+  int r;
+  do {
+    auto inChunk = inLeft < maxAvail ? inLeft : maxAvail;
+    zs.avail_in = static_cast<uInt>(inChunk);
+    if (out.size() == written) out.resize(out.size() * 2);
+    auto outChunk = out.size() - written < maxAvail ? out.size() - written : maxAvail;
+    zs.next_out = reinterpret_cast<Bytef*>(&out[written]);
+    zs.avail_out = static_cast<uInt>(outChunk);
+
+    r = inflate(&zs, Z_NO_FLUSH);
+    switch (r) {
+      case Z_OK:
+      case Z_STREAM_END:
+        break;
+      case Z_MEM_ERROR:
+        throw std::bad_alloc();
+      case Z_BUF_ERROR:
+        if (zs.avail_out != 0) throw DecodingException("truncated gzip data");
+        break;
+      default:
+        throw DecodingException("invalid gzip data");
+    }
+
+    inLeft -= inChunk - zs.avail_in;
+    written += outChunk - zs.avail_out;
+  } while (r != Z_STREAM_END);
+
+  out.resize(written);
+  return out;
+}
+
+} // namespace sapiremote
@@ -1,6 +1,8 @@
 //Copyright © 2019 D-Wave Systems Inc.
 //The software is licensed to authorized users only under the applicable license agreement.  See License.txt.
 
+#include <atomic>
+#include <cctype>
 #include <cstddef>
 #include <exception>
 #include <functional>
@@ -12,6 +14,7 @@
 #include <string>
 #include <sstream>
 #include <thread>
+#include <vector>
 
 #include <iostream>
 
@@ -23,11 +26,13 @@
 
 #include <curl/curl.h>
 
+#include <easy-handle-pool.hpp>
 #include <exceptions.hpp>
 #include <http-service.hpp>
 #include <threadpool.hpp>
 
 using std::size_t;
+using std::atomic;
 using std::bad_alloc;
 using std::bind;
 using std::map;
@@ -36,6 +41,7 @@ using std::string;
 using std::ostringstream;
 using std::shared_ptr;
 using std::unique_ptr;
+using std::vector;
 using std::weak_ptr;
 using std::make_shared;
 using std::ref;
@@ -53,11 +59,19 @@ using boost::asio::io_service;
 using boost::asio::deadline_timer;
 using boost::posix_time::milliseconds;
 
+using sapiremote::http::EasyHandlePool;
+using sapiremote::http::EasyHandlePoolPtr;
+using sapiremote::http::EasyHandlePtr;
 using sapiremote::http::HttpService;
 using sapiremote::http::HttpHeaders;
+using sapiremote::http::HttpServiceStats;
+using sapiremote::http::HttpServiceOptions;
+namespace transports = sapiremote::http::transports;
 using sapiremote::http::Proxy;
 using sapiremote::http::HttpCallback;
 using sapiremote::http::HttpCallbackPtr;
+using sapiremote::http::HttpResult;
+using sapiremote::http::TransferInfo;
 using sapiremote::ServiceShutdownException;
 using sapiremote::ThreadPoolPtr;
 using sapiremote::makeThreadPool;
@@ -168,9 +182,10 @@ private:
   ThreadPoolPtr threadpool_;
 public:
   HttpCallbackService(ThreadPoolPtr threadpool) : threadpool_(threadpool) {}
-  void postComplete(HttpCallbackPtr callback, int statusCode, shared_ptr<string> data) {
+  void postComplete(HttpCallbackPtr callback, const HttpResult& result) {
+    typedef void (HttpCallback::*CompleteFn)(HttpResult);
     try {
-      threadpool_->post(bind(&HttpCallback::complete, callback, statusCode, data));
+      threadpool_->post(bind(static_cast<CompleteFn>(&HttpCallback::complete), callback, result));
     } catch (...) {
       postError(callback, current_exception());
     }
@@ -195,21 +210,21 @@ public:
 
 class Connection : public enable_shared_from_this<Connection>, boost::noncopyable {
 private:
-  static const long connectTimeoutS = 30;
-  static const long lowSpeedTimeoutS = 30;
   static size_t writeFunction(char* ptr, size_t size, size_t nmemb, void* userdata);
-  static size_t headerFunction(void* ptr, size_t size, size_t nmemb, void* userdata);
+  static size_t headerFunction(char* ptr, size_t size, size_t nmemb, void* userdata);
+  static const size_t maxReserveBytes = 1 << 28; // don't trust Content-Length blindly
 
-  struct CleanupEasyHandle { void operator()(CURL* h) { curl_easy_cleanup(h); } };
   enum State { IN_PROGRESS, PENDING_COMPLETE, PENDING_FAIL, FINISHED };
 
   HttpCallbackService callbackService_;
-  unique_ptr<CURL, CleanupEasyHandle> easyHandle_;
+  EasyHandlePtr easyHandle_;
   CurlHeaders curlHeaders_;
   shared_ptr<string> writeBuffer_;
   string readBuffer_;
+  string etag_;
   char errorBuffer_[CURL_ERROR_SIZE];
   HttpCallbackPtr callback_;
+  bool streaming_;
   State complete_;
   CURLcode code_;
   exception_ptr exc_;
@@ -221,6 +236,8 @@ private:
 
   void complete(CURLcode c);
   void fail(exception_ptr e);
+  void header(const char* line, size_t size);
+  TransferInfo transferInfo();
 
 public:
   Connection(
@@ -324,11 +341,13 @@ private:
   deadline_timer timer_;
   SocketMap sockets_;
   unique_ptr<CURLM, CleanupMultiHandle> multiHandle_;
+  EasyHandlePoolPtr handlePool_;
   ConnectionSet activeConnections_;
   Mutex mutex_;
   ConnectionPtr doneHead_;
   unique_ptr<io_service::work> work_;
   bool running_;
+  const HttpServiceOptions options_;
 
   // libcurl callback implementations -- no locking
   void socketCallback(CURL* easyHandle, curl_socket_t s, int action);
@@ -373,14 +392,24 @@ public:
   static int curlCloseSocket(void* clientp, curl_socket_t item);
   // ------
 
-  CurlMultiService();
+  // options must already have defaults filled in
+  CurlMultiService(const HttpServiceOptions& options);
   ~CurlMultiService();
 
+  const HttpServiceOptions& options() const { return options_; }
+
+  // true if connections should request HTTP/2 and wait to share existing connections
+  bool multiplex() const { return options_.transport == transports::HTTP_2_MULTIPLEX; }
+
   void shutdown();
 
   // external entry point -- locks mutex_
   void addConnection(ConnectionPtr conn);
 
+  // thread safe (pool has its own mutex)
+  EasyHandlePtr acquireEasyHandle() { return handlePool_->acquire(); }
+  void stats(HttpServiceStats& s) const { handlePool_->stats(s); }
+
   // io_service callback function -- locks mutex_
   void socketAction(CURL* easyHandle, curl_socket_t s, int ev_bitmask, const boost::system::error_code& ec);
 };
@@ -394,15 +423,22 @@ public:
 class HttpServiceImpl : public HttpService, boost::noncopyable {
 private:
   HttpCallbackService callbackService_;
-  CurlMultiService curlMultiService_;
+  vector<unique_ptr<CurlMultiService>> curlMultiServices_;
+  atomic<size_t> nextCurlMultiService_;
+
+  // spread connections across I/O threads
+  CurlMultiService& curlMultiService() {
+    return *curlMultiServices_[nextCurlMultiService_++ % curlMultiServices_.size()];
+  }
 
   virtual void asyncGetImpl(
       const std::string& url,
       const HttpHeaders& headers,
       const Proxy& proxy,
       HttpCallbackPtr callback) {
-    ConnectionPtr conn = httpGetConnection(callbackService_, curlMultiService_, callback, url, headers, proxy);
-    curlMultiService_.addConnection(conn);
+    auto& curlMultiService = this->curlMultiService();
+    ConnectionPtr conn = httpGetConnection(callbackService_, curlMultiService, callback, url, headers, proxy);
+    curlMultiService.addConnection(conn);
   }
 
   virtual void asyncPostImpl(
@@ -411,8 +447,9 @@ private:
       std::string& data,
       const Proxy& proxy,
       HttpCallbackPtr callback) {
-    ConnectionPtr conn = httpPostConnection(callbackService_, curlMultiService_, callback, url, headers, data, proxy);
-    curlMultiService_.addConnection(conn);
+    auto& curlMultiService = this->curlMultiService();
+    ConnectionPtr conn = httpPostConnection(callbackService_, curlMultiService, callback, url, headers, data, proxy);
+    curlMultiService.addConnection(conn);
   }
 
   virtual void asyncDeleteImpl(
@@ -421,21 +458,41 @@ private:
       std::string& data,
       const Proxy& proxy,
       HttpCallbackPtr callback) {
+    auto& curlMultiService = this->curlMultiService();
     ConnectionPtr conn = httpDeleteConnection(
-        callbackService_, curlMultiService_, callback, url, headers, data, proxy);
-    curlMultiService_.addConnection(conn);
+        callbackService_, curlMultiService, callback, url, headers, data, proxy);
+    curlMultiService.addConnection(conn);
   }
 
   virtual void shutdownImpl() {
-    curlMultiService_.shutdown();
+    for (auto iter = curlMultiServices_.begin(), end = curlMultiServices_.end(); iter != end; ++iter) {
+      (*iter)->shutdown();
+    }
     callbackService_.shutdown();
   }
 
+  virtual HttpServiceStats statsImpl() const {
+    HttpServiceStats total = HttpServiceStats();
+    for (auto iter = curlMultiServices_.begin(), end = curlMultiServices_.end(); iter != end; ++iter) {
+      HttpServiceStats s = HttpServiceStats();
+      (*iter)->stats(s);
+      total.handlePoolSize += s.handlePoolSize;
+      total.idleHandles += s.idleHandles;
+      total.handlePoolHits += s.handlePoolHits;
+      total.handlePoolMisses += s.handlePoolMisses;
+    }
+    return total;
+  }
+
 public:
-  HttpServiceImpl(int numCallbackThreads) :
-      callbackService_(makeThreadPool(numCallbackThreads)),
-      curlMultiService_() {
+  HttpServiceImpl(const HttpServiceOptions& options) :
+      callbackService_(makeThreadPool(options.numCallbackThreads)),
+      nextCurlMultiService_(0) {
     curlGlobal.check();
+    curlMultiServices_.reserve(options.numIoThreads);
+    for (auto i = 0; i < options.numIoThreads; ++i) {
+      curlMultiServices_.push_back(unique_ptr<CurlMultiService>(new CurlMultiService(options)));
+    }
   }
 
   virtual ~HttpServiceImpl() { shutdown(); }
@@ -487,15 +544,20 @@ string curlmcodeMsg(CURLMcode c) {
 // CurlMultiService implementation
 //
 
-CurlMultiService::CurlMultiService() :
+CurlMultiService::CurlMultiService(const HttpServiceOptions& options) :
 ioService_(new io_service),
     work_(new io_service::work(*ioService_)),
     timer_(*ioService_),
     multiHandle_(curl_multi_init()),
+    handlePool_(make_shared<EasyHandlePool>()),
     mutex_(),
-    running_(true) {
+    running_(true),
+    options_(options) {
 
   if (!multiHandle_) throw bad_alloc();
+  setopt(CURLMOPT_PIPELINING, static_cast<long>(multiplex() ? CURLPIPE_MULTIPLEX : CURLPIPE_NOTHING));
+  setopt(CURLMOPT_MAX_HOST_CONNECTIONS, options_.maxHostConnections);
+  setopt(CURLMOPT_MAX_TOTAL_CONNECTIONS, options_.maxTotalConnections);
   setopt(CURLMOPT_SOCKETFUNCTION, &CurlMultiService::curlSocketCallback);
   setopt(CURLMOPT_SOCKETDATA, this);
   setopt(CURLMOPT_TIMERFUNCTION, &CurlMultiService::curlTimerCallback);
@@ -716,7 +778,10 @@ void CurlMultiService::shutdown() {
 
   // at this point, nothing is happening. Time to clean up curl multi handle and shutdown threads
   // locking is unnecessary since running_ is false.
+  // The handle pool must be closed before sockets_ is cleared: cached connections are closed through
+  // curlCloseSocket.
   multiHandle_.reset();
+  handlePool_->close();
   sockets_.clear();
   timer_.cancel();
   work_.reset();
@@ -758,14 +823,68 @@ size_t Connection::writeFunction(char* ptr, size_t size, size_t nmemb, void* use
   size_t bytes = size * nmemb;
   try {
     auto r = static_cast<Connection*>(userdata)->shared_from_this();
-    r->writeBuffer_->append(ptr, ptr + bytes);
+    if (r->streaming_) {
+      r->callback_->receive(ptr, bytes);
+    } else {
+      r->writeBuffer_->append(ptr, ptr + bytes);
+    }
     return bytes;
   } catch (...) {}
   return bytes - 1;
 }
 
-size_t Connection::headerFunction(void*, size_t size, size_t nmemb, void*) {
-  return size * nmemb;
+size_t Connection::headerFunction(char* ptr, size_t size, size_t nmemb, void* userdata) {
+  size_t bytes = size * nmemb;
+  try {
+    static_cast<Connection*>(userdata)->header(ptr, bytes);
+  } catch (...) {}
+  return bytes;
+}
+
+bool headerNameIs(const char* line, size_t size, const char* lowerName, size_t nameSize) {
+  if (size <= nameSize) return false;
+  for (size_t i = 0; i < nameSize; ++i) {
+    if (std::tolower(static_cast<unsigned char>(line[i])) != lowerName[i]) return false;
+  }
+  return true;
+}
+
+void Connection::header(const char* line, size_t size) {
+  static const char contentLength[] = "content-length:";
+  static const size_t contentLengthSize = sizeof(contentLength) - 1;
+  static const char etag[] = "etag:";
+  static const size_t etagSize = sizeof(etag) - 1;
+  static const char statusLine[] = "http/";
+  static const size_t statusLineSize = sizeof(statusLine) - 1;
+
+  // headers of every response in a redirect chain arrive here; only the last one counts
+  if (headerNameIs(line, size, statusLine, statusLineSize)) {
+    etag_.clear();
+    return;
+  }
+
+  if (headerNameIs(line, size, etag, etagSize)) {
+    auto begin = line + etagSize;
+    auto end = line + size;
+    while (begin != end && (*begin == ' ' || *begin == '\t')) ++begin;
+    while (end != begin && std::isspace(static_cast<unsigned char>(end[-1]))) --end;
+    etag_.assign(begin, end);
+    return;
+  }
+
+  if (streaming_ || !headerNameIs(line, size, contentLength, contentLengthSize)) return;
+
+  // Content-Length is the encoded size when the response is compressed, so this is only a lower bound
+  size_t length = 0;
+  for (size_t i = contentLengthSize; i < size && line[i] != '\r' && line[i] != '\n'; ++i) {
+    if (std::isdigit(static_cast<unsigned char>(line[i]))) {
+      length = length * 10 + static_cast<size_t>(line[i] - '0');
+      if (length > maxReserveBytes) return;
+    } else if (line[i] != ' ' && line[i] != '\t') {
+      return;
+    }
+  }
+  writeBuffer_->reserve(length);
 }
 
 Connection::Connection(
@@ -776,10 +895,11 @@ Connection::Connection(
     const HttpHeaders& headers,
     const Proxy& proxy) :
         callbackService_(callbackService),
-        easyHandle_(curl_easy_init()),
+        easyHandle_(curlMulti.acquireEasyHandle()),
         curlHeaders_(convertHeaders(headers)),
         writeBuffer_(make_shared<string>()),
         callback_(callback),
+        streaming_(callback->streaming()),
         complete_(IN_PROGRESS) {
 
   setOptions(url, proxy, &curlMulti);
@@ -795,11 +915,12 @@ Connection::Connection(
     std::string& data,
     const Proxy& proxy) :
         callbackService_(callbackService),
-        easyHandle_(curl_easy_init()),
+        easyHandle_(curlMulti.acquireEasyHandle()),
         curlHeaders_(convertHeaders(headers)),
         writeBuffer_(make_shared<string>()),
         readBuffer_(std::move(data)),
         callback_(callback),
+        streaming_(callback->streaming()),
         complete_(IN_PROGRESS) {
 
   setOptions(url, proxy, &curlMulti);
@@ -818,11 +939,12 @@ Connection::Connection(
     std::string& data,
     const Proxy& proxy) :
         callbackService_(callbackService),
-        easyHandle_(curl_easy_init()),
+        easyHandle_(curlMulti.acquireEasyHandle()),
         curlHeaders_(convertHeaders(headers)),
         writeBuffer_(make_shared<string>()),
         readBuffer_(std::move(data)),
         callback_(callback),
+        streaming_(callback->streaming()),
         complete_(IN_PROGRESS) {
 
   setOptions(url, proxy, &curlMulti);
@@ -852,6 +974,7 @@ void Connection::setOptions(const string& url, const Proxy& proxy, CurlMultiServ
   setopt(CURLOPT_OPENSOCKETFUNCTION, &CurlMultiService::curlOpenSocket);
   setopt(CURLOPT_OPENSOCKETDATA, curlMulti);
   setopt(CURLOPT_HEADERFUNCTION, &Connection::headerFunction);
+  setopt(CURLOPT_HEADERDATA, this);
   setopt(CURLOPT_CLOSESOCKETFUNCTION, &CurlMultiService::curlCloseSocket);
   setopt(CURLOPT_CLOSESOCKETDATA, curlMulti);
   setopt(CURLOPT_ERRORBUFFER, static_cast<char*>(errorBuffer_));
@@ -864,11 +987,23 @@ void Connection::setOptions(const string& url, const Proxy& proxy, CurlMultiServ
   setopt(CURLOPT_FOLLOWLOCATION, 1L);
   setopt(CURLOPT_MAXREDIRS, 128L); //
   setopt(CURLOPT_POSTREDIR, CURL_REDIR_POST_ALL);
-  setopt(CURLOPT_CONNECTTIMEOUT, connectTimeoutS);
-  setopt(CURLOPT_LOW_SPEED_LIMIT, 1); // time out connection if bytes stop arriving (usually triggered by firewalls)
-  setopt(CURLOPT_LOW_SPEED_TIME , lowSpeedTimeoutS);
+  const auto& options = curlMulti->options();
+  setopt(CURLOPT_CONNECTTIMEOUT, options.connectTimeoutS);
+  setopt(CURLOPT_LOW_SPEED_LIMIT, 1L); // time out connection if bytes stop arriving (usually triggered by firewalls)
+  setopt(CURLOPT_LOW_SPEED_TIME , options.lowSpeedTimeoutS);
+  if (options.tcpKeepAlive) {
+    setopt(CURLOPT_TCP_KEEPALIVE, 1L);
+    setopt(CURLOPT_TCP_KEEPIDLE, options.keepAliveIdleS);
+    setopt(CURLOPT_TCP_KEEPINTVL, options.keepAliveIntervalS);
+  }
   setopt(CURLOPT_SSL_VERIFYPEER, 0L); // less secure but app servers lack proper certificates
   setopt(CURLOPT_SSL_VERIFYHOST, 0L);
+  if (curlMulti->multiplex()) {
+    setopt(CURLOPT_HTTP_VERSION, static_cast<long>(CURL_HTTP_VERSION_2TLS));
+    setopt(CURLOPT_PIPEWAIT, 1L); // prefer waiting for a connection that can multiplex over opening a new one
+  } else {
+    setopt(CURLOPT_HTTP_VERSION, static_cast<long>(CURL_HTTP_VERSION_1_1));
+  }
   setopt(CURLOPT_PRIVATE, this);
 }
 
@@ -877,7 +1012,8 @@ void Connection::complete(CURLcode c) {
   long responseCode = 0;
   if (c == CURLE_OK) c = curl_easy_getinfo(easyHandle_.get(), CURLINFO_RESPONSE_CODE, &responseCode);
   if (c == CURLE_OK) {
-    callbackService_.postComplete(callback_, static_cast<int>(responseCode), writeBuffer_);
+    HttpResult result = { static_cast<int>(responseCode), writeBuffer_, transferInfo(), etag_ };
+    callbackService_.postComplete(callback_, result);
     callback_.reset();
   } else {
     try {
@@ -888,6 +1024,22 @@ void Connection::complete(CURLcode c) {
   }
 }
 
+TransferInfo Connection::transferInfo() {
+  // best effort: anything libcurl can't report stays zero
+  TransferInfo t = TransferInfo();
+  auto h = easyHandle_.get();
+  curl_easy_getinfo(h, CURLINFO_NAMELOOKUP_TIME, &t.nameLookupS);
+  curl_easy_getinfo(h, CURLINFO_CONNECT_TIME, &t.connectS);
+  curl_easy_getinfo(h, CURLINFO_APPCONNECT_TIME, &t.appConnectS);
+  curl_easy_getinfo(h, CURLINFO_STARTTRANSFER_TIME, &t.startTransferS);
+  curl_easy_getinfo(h, CURLINFO_TOTAL_TIME, &t.totalS);
+  curl_off_t bytes = 0;
+  if (curl_easy_getinfo(h, CURLINFO_SIZE_UPLOAD_T, &bytes) == CURLE_OK) t.bytesSent = bytes;
+  bytes = 0;
+  if (curl_easy_getinfo(h, CURLINFO_SIZE_DOWNLOAD_T, &bytes) == CURLE_OK) t.bytesReceived = bytes;
+  return t;
+}
+
 void Connection::fail(exception_ptr e) {
   complete_ = FINISHED;
   callbackService_.postError(callback_, e);
@@ -961,7 +1113,30 @@ ConnectionPtr httpDeleteConnection(
 namespace sapiremote {
 namespace http {
 HttpServicePtr makeHttpService(int numCallbackThreads) {
-  return make_shared<HttpServiceImpl>(numCallbackThreads);
+  return makeHttpService(numCallbackThreads, transports::HTTP_1_1);
+}
+
+HttpServicePtr makeHttpService(int numCallbackThreads, transports::Type transport) {
+  HttpServiceOptions options = HttpServiceOptions();
+  options.numCallbackThreads = numCallbackThreads;
+  options.transport = transport;
+  return makeHttpService(options);
+}
+
+HttpServicePtr makeHttpService(const HttpServiceOptions& options) {
+  static const long defaultTimeoutS = 30;
+  static const long defaultKeepAliveS = 60;
+
+  HttpServiceOptions o = options;
+  if (o.numCallbackThreads <= 0) o.numCallbackThreads = 1;
+  if (o.numIoThreads <= 0) o.numIoThreads = 1;
+  if (o.maxHostConnections < 0) o.maxHostConnections = 0;
+  if (o.maxTotalConnections < 0) o.maxTotalConnections = 0;
+  if (o.connectTimeoutS <= 0) o.connectTimeoutS = defaultTimeoutS;
+  if (o.lowSpeedTimeoutS <= 0) o.lowSpeedTimeoutS = defaultTimeoutS;
+  if (o.keepAliveIdleS <= 0) o.keepAliveIdleS = defaultKeepAliveS;
+  if (o.keepAliveIntervalS <= 0) o.keepAliveIntervalS = defaultKeepAliveS;
+  return make_shared<HttpServiceImpl>(o);
 }
 } // namespace sapi::http
 } // namespace sapi
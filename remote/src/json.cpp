@@ -10,6 +10,7 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cerrno>
+#include <cstring>
 #include <limits>
 #include <memory>
 #include <stack>
@@ -69,7 +70,7 @@ int snprintf(char* str, size_t size, const char* format, ...) {
 
 class ToStringVisitor : public boost::static_visitor<> {
 private:
-  string s_;
+  string& s_;
   vector<char> buf_;
 
   void appendDouble(double d) {
@@ -103,9 +104,22 @@ private:
     s_.append(buf_.data());
   }
 
+  static bool plain(char c) { return static_cast<unsigned char>(c) >= 0x20 && c != 0x22 && c != 0x5c; }
+
+public:
   void appendString(const string& s) {
     s_.append(1, '"');
-    BOOST_FOREACH( char c, s ) {
+    auto iter = s.data();
+    const auto end = iter + s.size();
+    while (iter != end) {
+      // copy runs of characters that don't need escaping in one go (e.g. base64 data)
+      auto runEnd = iter;
+      while (runEnd != end && plain(*runEnd)) ++runEnd;
+      s_.append(iter, runEnd - iter);
+      if (runEnd == end) break;
+      iter = runEnd;
+
+      auto c = *iter++;
       switch (c) {
         case 0x08: s_.append("\\b"); break; // backspace
         case 0x0c: s_.append("\\f"); break; // form feed
@@ -114,20 +128,13 @@ private:
         case 0x09: s_.append("\\t"); break; // tab
         case 0x22: s_.append("\\\""); break; // quotation mark
         case 0x5c: s_.append("\\\\"); break; // backslash
-        default:
-          if (static_cast<unsigned char>(c) >= 0x20) {
-            s_.append(1, c);
-          } else {
-            appendUEscape(static_cast<unsigned char>(c));
-          }
-          break;
+        default: appendUEscape(static_cast<unsigned char>(c)); break;
       }
     }
     s_.append(1, '"');
   }
 
-public:
-  ToStringVisitor() : buf_(20) {}
+  ToStringVisitor(string& s) : s_(s), buf_(20) {}
   void operator()(const json::Null&) { s_.append("null"); }
   void operator()(bool b) { s_.append(b ? "true" : "false"); }
   void operator()(double d) { appendDouble(d); }
@@ -155,8 +162,6 @@ public:
     }
     s_.append(1, '}');
   }
-
-  string str() { return s_; }
 };
 
 //=========================================================================================================
@@ -419,6 +424,67 @@ void badCharacter() {
   throw json::ParseException("invalid character");
 }
 
+// Parses the token at sp (leading whitespace already skipped) along with any following separator.
+// Returns false at end of input.
+bool parseToken(const char*& sp, JsonStack& jsonStack) {
+  switch (*sp) {
+    case '\0': return false;
+    case '[': ++sp; jsonStack.openArray(); break;
+    case '{': ++sp; jsonStack.openObject(); break;
+    case ']':
+      sp = eatSpace(sp + 1);
+      if (jsonStack.closeArray(*sp)) ++sp;
+      break;
+    case '}':
+      sp = eatSpace(sp + 1);
+      if (jsonStack.closeObject(*sp)) ++sp;
+      break;
+    case 'n':
+      if (*++sp != 'u' || *++sp != 'l' || *++sp != 'l') badCharacter();
+      sp = eatSpace(sp + 1);
+      if (jsonStack.addValue(json::Null(), *sp)) ++sp;
+      break;
+    case 'f':
+      if (*++sp != 'a' || *++sp != 'l' || *++sp != 's' || *++sp != 'e') badCharacter();
+      sp = eatSpace(sp + 1);
+      if (jsonStack.addValue(false, *sp)) ++sp;
+      break;
+    case 't':
+      if (*++sp != 'r' || *++sp != 'u' || *++sp != 'e') badCharacter();
+      sp = eatSpace(sp + 1);
+      if (jsonStack.addValue(true, *sp)) ++sp;
+      break;
+    case '0':
+    case '1':
+    case '2':
+    case '3':
+    case '4':
+    case '5':
+    case '6':
+    case '7':
+    case '8':
+    case '9':
+    case '-':
+    {
+      json::Value val = parseNumber(sp);
+      sp = eatSpace(sp);
+      if (jsonStack.addValue(std::move(val), *sp)) ++sp;
+      break;
+    }
+    case '"':
+    {
+      ++sp;
+      json::Value val = parseString(sp);
+      sp = eatSpace(sp);
+      if (jsonStack.addValue(std::move(val), *sp)) ++sp;
+      break;
+    }
+    default: badCharacter(); break;
+  }
+
+  return true;
+}
+
 } // namespace {anonymous}
 
 
@@ -430,30 +496,53 @@ void badCharacter() {
 namespace json {
 
 std::string jsonToString(const Value& v) {
+  string s;
+  appendJson(s, v);
+  return s;
+}
+
+std::string jsonToString(const Array& v) {
+  string s;
+  appendJson(s, v);
+  return s;
+}
+
+std::string jsonToString(const Object& v) {
+  string s;
+  appendJson(s, v);
+  return s;
+}
+
+void appendJson(std::string& out, const Value& v) {
 #ifdef ENABLE_DEBUG_NEW
   mem_debug::DeactivateThisThread mddtt;
 #endif
-  ToStringVisitor visitor;
+  ToStringVisitor visitor(out);
   boost::apply_visitor(visitor, v.variant());
-  return visitor.str();
 }
 
-std::string jsonToString(const Array& v) {
+void appendJson(std::string& out, const Array& v) {
 #ifdef ENABLE_DEBUG_NEW
   mem_debug::DeactivateThisThread mddtt;
 #endif
-  ToStringVisitor visitor;
+  ToStringVisitor visitor(out);
   visitor(v);
-  return visitor.str();
 }
 
-std::string jsonToString(const Object& v) {
+void appendJson(std::string& out, const Object& v) {
 #ifdef ENABLE_DEBUG_NEW
   mem_debug::DeactivateThisThread mddtt;
 #endif
-  ToStringVisitor visitor;
+  ToStringVisitor visitor(out);
   visitor(v);
-  return visitor.str();
+}
+
+void appendJsonString(std::string& out, const std::string& s) {
+#ifdef ENABLE_DEBUG_NEW
+  mem_debug::DeactivateThisThread mddtt;
+#endif
+  ToStringVisitor visitor(out);
+  visitor.appendString(s);
 }
 
 Value stringToJson(const std::string& s) {
@@ -465,61 +554,129 @@ Value stringToJson(const std::string& s) {
 
   for (;;) {
     sp = eatSpace(sp);
-    switch (*sp) {
-      case '\0': return jsonStack.result();
-      case '[': ++sp; jsonStack.openArray(); break;
-      case '{': ++sp; jsonStack.openObject(); break;
+    if (!parseToken(sp, jsonStack)) return jsonStack.result();
+  }
+}
+
+//=========================================================================================================
+//
+// StreamParser
+//
+// Input is buffered only until the token at its front is complete (including the next non-space character,
+// which the parser uses to decide how the value is added to its container) and then handed to parseToken.
+//
+
+class StreamParser::Impl {
+private:
+  static const size_t incomplete = string::npos;
+
+  JsonStack jsonStack_;
+  string buffer_;
+  size_t pos_;     // start of the first unparsed token
+  size_t scanPos_; // where to resume looking for the end of an incomplete string token (0: from the start)
+
+  size_t skipSpace(size_t i) const {
+    while (i < buffer_.size() && isspace(buffer_[i])) ++i;
+    return i;
+  }
+
+  // position of the first non-space character after the token starting at i, or incomplete
+  size_t tokenEnd(size_t i) {
+    switch (buffer_[i]) {
+      case '[':
+      case '{':
+        return i + 1;
+
       case ']':
-        sp = eatSpace(sp + 1);
-        if (jsonStack.closeArray(*sp)) ++sp;
-        break;
       case '}':
-        sp = eatSpace(sp + 1);
-        if (jsonStack.closeObject(*sp)) ++sp;
+        ++i;
         break;
+
       case 'n':
-        if (*++sp != 'u' || *++sp != 'l' || *++sp != 'l') badCharacter();
-        sp = eatSpace(sp + 1);
-        if (jsonStack.addValue(json::Null(), *sp)) ++sp;
-        break;
-      case 'f':
-        if (*++sp != 'a' || *++sp != 'l' || *++sp != 's' || *++sp != 'e') badCharacter();
-        sp = eatSpace(sp + 1);
-        if (jsonStack.addValue(false, *sp)) ++sp;
-        break;
       case 't':
-        if (*++sp != 'r' || *++sp != 'u' || *++sp != 'e') badCharacter();
-        sp = eatSpace(sp + 1);
-        if (jsonStack.addValue(true, *sp)) ++sp;
+        i += 4;
         break;
-      case '0':
-      case '1':
-      case '2':
-      case '3':
-      case '4':
-      case '5':
-      case '6':
-      case '7':
-      case '8':
-      case '9':
-      case '-':
-      {
-        json::Value val = parseNumber(sp);
-        sp = eatSpace(sp);
-        if (jsonStack.addValue(std::move(val), *sp)) ++sp;
+
+      case 'f':
+        i += 5;
         break;
-      }
+
       case '"':
-      {
-        ++sp;
-        json::Value val = parseString(sp);
-        sp = eatSpace(sp);
-        if (jsonStack.addValue(std::move(val), *sp)) ++sp;
+        for (i = scanPos_ > i ? scanPos_ : i + 1; i < buffer_.size(); ++i) {
+          if (buffer_[i] == '\\') {
+            if (i + 1 == buffer_.size()) break; // escape sequence split between chunks: resume at backslash
+            ++i;
+          } else if (buffer_[i] == '"') {
+            break;
+          }
+        }
+        if (i == buffer_.size() || buffer_[i] != '"') {
+          scanPos_ = i;
+          return incomplete;
+        }
+        ++i;
+        break;
+
+      default:
+        if (isdigit(buffer_[i]) || buffer_[i] == '-') {
+          while (i < buffer_.size() && buffer_[i] != '\0' && std::strchr("0123456789+-.eE", buffer_[i])) ++i;
+        } else {
+          return i + 1; // bad character; let parseToken complain
+        }
         break;
-      }
-      default: badCharacter(); break;
     }
+
+    if (i >= buffer_.size()) return incomplete;
+    i = skipSpace(i);
+    return i < buffer_.size() ? i : incomplete;
   }
+
+  void parse(bool final) {
+    for (;;) {
+      pos_ = skipSpace(pos_);
+      if (!final && (pos_ == buffer_.size() || tokenEnd(pos_) == incomplete)) break;
+
+      const char* sp = buffer_.c_str() + pos_;
+      if (!parseToken(sp, jsonStack_)) break;
+      pos_ = static_cast<size_t>(sp - buffer_.c_str());
+      scanPos_ = 0;
+    }
+
+    buffer_.erase(0, pos_);
+    scanPos_ = scanPos_ > pos_ ? scanPos_ - pos_ : 0;
+    pos_ = 0;
+  }
+
+public:
+  Impl() : pos_(0), scanPos_(0) {}
+
+  void feed(const char* data, size_t size) {
+    buffer_.append(data, size);
+    parse(false);
+  }
+
+  Value finish() {
+    parse(true);
+    return jsonStack_.result();
+  }
+};
+
+StreamParser::StreamParser() : impl_(new Impl) {}
+
+StreamParser::~StreamParser() {}
+
+void StreamParser::feed(const char* data, std::size_t size) {
+#ifdef ENABLE_DEBUG_NEW
+  mem_debug::DeactivateThisThread mddtt;
+#endif
+  impl_->feed(data, size);
+}
+
+Value StreamParser::finish() {
+#ifdef ENABLE_DEBUG_NEW
+  mem_debug::DeactivateThisThread mddtt;
+#endif
+  return impl_->finish();
 }
 
 } // namespace json
@@ -0,0 +1,18 @@
+//Copyright © 2019 D-Wave Systems Inc.
+//The software is licensed to authorized users only under the applicable license agreement.  See License.txt.
+
+#include <latency-histogram.hpp>
+
+namespace sapiremote {
+
+void LatencyHistogram::add(double seconds) {
+  auto ms = seconds * 1000.0;
+  auto i = 0;
+  for (auto limit = 1.0; i < numBuckets - 1 && ms >= limit; limit *= 2.0) ++i;
+  ++buckets[i];
+  ++samples;
+  totalS += seconds;
+  if (seconds > maxS) maxS = seconds;
+}
+
+} // namespace sapiremote
@@ -0,0 +1,309 @@
+//Copyright © 2019 D-Wave Systems Inc.
+//The software is licensed to authorized users only under the applicable license agreement.  See License.txt.
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <boost/foreach.hpp>
+
+#include <binary-file.hpp>
+#include <exceptions.hpp>
+#include <problem-journal.hpp>
+
+using std::condition_variable;
+using std::lock_guard;
+using std::make_pair;
+using std::make_shared;
+using std::max;
+using std::mutex;
+using std::pair;
+using std::size_t;
+using std::sort;
+using std::string;
+using std::thread;
+using std::uint16_t;
+using std::uint32_t;
+using std::unique_lock;
+using std::unordered_map;
+using std::vector;
+using std::chrono::milliseconds;
+
+using sapiremote::JournalException;
+using sapiremote::ProblemJournal;
+using sapiremote::ProblemJournalPtr;
+using sapiremote::binaryFileHeader;
+using sapiremote::fnv1a32;
+using sapiremote::readFile;
+using sapiremote::replaceFile;
+using sapiremote::syncFile;
+using sapiremote::writeAll;
+
+namespace {
+
+// bump the version whenever the layout changes
+const char magic[] = "SAPIPJN1";
+
+// Record layout: kind (1 byte), id size (uint16), id, FNV-1a checksum of the preceding bytes (uint32).  A
+// record that is cut short or fails its checksum ends the journal.
+namespace recordkinds {
+const unsigned char SUBMITTED = 1;
+const unsigned char DONE = 2;
+} // namespace {anonymous}::recordkinds
+const size_t maxIdSize = 0xffff;
+const size_t recordOverhead = 1 + sizeof(uint16_t) + sizeof(uint32_t);
+
+// wait at least this long before trying again after the file couldn't be written
+const milliseconds failureRetryInterval(1000);
+
+// rewrite the file once it holds at least this many records and no more than a quarter are outstanding
+const unsigned long long minCompactRecords = 4096;
+
+void appendRecord(string& buffer, unsigned char kind, const string& id) {
+  auto start = buffer.size();
+  auto size = static_cast<uint16_t>(id.size());
+  buffer.push_back(static_cast<char>(kind));
+  buffer.append(reinterpret_cast<const char*>(&size), sizeof(size));
+  buffer.append(id);
+  auto sum = fnv1a32(buffer.data() + start, buffer.size() - start);
+  buffer.append(reinterpret_cast<const char*>(&sum), sizeof(sum));
+}
+
+class ProblemJournalImpl : public ProblemJournal {
+private:
+  typedef unordered_map<string, unsigned long long> OutstandingMap; // id -> order first recorded
+
+  const string path_;
+  const milliseconds syncInterval_;
+
+  mutable mutex mutex_;
+  condition_variable writerCv_;
+  condition_variable syncedCv_;
+  OutstandingMap outstanding_;
+  unsigned long long nextOrder_;
+  string pending_;                    // records not yet handed to the writer thread
+  unsigned long long pendingRecords_;
+  unsigned long long recorded_;       // records ever added to pending_
+  unsigned long long synced_;         // value of recorded_ covered by the file on disk
+  unsigned long long writeAttempts_;
+  bool syncRequested_;
+  bool needRewrite_;                  // last write failed; the file may end in a partial batch
+  bool stop_;
+
+  // writer thread only (and the constructor, before it starts)
+  std::FILE* file_;
+  unsigned long long fileRecords_;
+
+  thread writer_;
+
+  void record(unsigned char kind, const string& id);
+  vector<string> outstandingInOrder() const;
+  bool rewrite(const vector<string>& ids);
+  void writerLoop();
+
+  virtual void problemSubmittedImpl(const string& id);
+  virtual void problemDoneImpl(const string& id);
+  virtual vector<string> outstandingProblemsImpl() const;
+  virtual bool syncImpl();
+
+public:
+  ProblemJournalImpl(string path, int syncIntervalMs);
+  ~ProblemJournalImpl();
+};
+
+ProblemJournalImpl::ProblemJournalImpl(string path, int syncIntervalMs) :
+    path_(std::move(path)),
+    syncInterval_(syncIntervalMs),
+    nextOrder_(0),
+    pendingRecords_(0),
+    recorded_(0),
+    synced_(0),
+    writeAttempts_(0),
+    syncRequested_(false),
+    needRewrite_(false),
+    stop_(false),
+    file_(0),
+    fileRecords_(0) {
+
+  string contents;
+  auto header = binaryFileHeader(magic);
+  if (readFile(path_, contents) && !contents.empty()) {
+    auto matches = contents.size() < header.size()
+        ? header.compare(0, contents.size(), contents) == 0
+        : contents.compare(0, header.size(), header) == 0;
+    if (!matches) throw JournalException("not a problem journal", path_);
+  }
+
+  if (contents.size() > header.size()) {
+    auto pos = header.size();
+    while (contents.size() - pos >= recordOverhead) {
+      auto data = contents.data() + pos;
+      uint16_t idSize;
+      std::memcpy(&idSize, data + 1, sizeof(idSize));
+      auto size = recordOverhead + idSize;
+      if (contents.size() - pos < size) break;
+      uint32_t sum;
+      std::memcpy(&sum, data + size - sizeof(sum), sizeof(sum));
+      if (sum != fnv1a32(data, size - sizeof(sum))) break;
+
+      auto kind = static_cast<unsigned char>(data[0]);
+      auto id = string(data + 1 + sizeof(idSize), idSize);
+      if (kind == recordkinds::SUBMITTED) {
+        if (outstanding_.insert(make_pair(std::move(id), nextOrder_)).second) ++nextOrder_;
+      } else if (kind == recordkinds::DONE) {
+        outstanding_.erase(id);
+      } else {
+        break;
+      }
+      pos += size;
+    }
+  }
+
+  // drops stale and partial records and leaves file_ open for appending
+  if (!rewrite(outstandingInOrder())) throw JournalException("unable to write file", path_);
+
+  writer_ = thread([this] { writerLoop(); });
+}
+
+ProblemJournalImpl::~ProblemJournalImpl() {
+  {
+    lock_guard<mutex> lock(mutex_);
+    stop_ = true;
+  }
+  writerCv_.notify_one();
+  writer_.join();
+  if (file_) std::fclose(file_);
+}
+
+void ProblemJournalImpl::record(unsigned char kind, const string& id) {
+  auto wasEmpty = pending_.empty();
+  appendRecord(pending_, kind, id);
+  ++pendingRecords_;
+  ++recorded_;
+  if (wasEmpty) writerCv_.notify_one();
+}
+
+vector<string> ProblemJournalImpl::outstandingInOrder() const {
+  vector<pair<unsigned long long, const string*>> ordered;
+  ordered.reserve(outstanding_.size());
+  BOOST_FOREACH( const auto& e, outstanding_ ) ordered.push_back(make_pair(e.second, &e.first));
+  sort(ordered.begin(), ordered.end());
+
+  vector<string> ids;
+  ids.reserve(ordered.size());
+  BOOST_FOREACH( const auto& e, ordered ) ids.push_back(*e.second);
+  return ids;
+}
+
+bool ProblemJournalImpl::rewrite(const vector<string>& ids) {
+  auto contents = binaryFileHeader(magic);
+  BOOST_FOREACH( const auto& id, ids ) appendRecord(contents, recordkinds::SUBMITTED, id);
+
+  // Windows can't replace a file that is open; a crash leaves either the old or the new journal
+  if (file_) {
+    std::fclose(file_);
+    file_ = 0;
+  }
+  if (!replaceFile(path_, path_ + ".tmp", contents, true)) return false;
+
+  file_ = std::fopen(path_.c_str(), "ab");
+  if (!file_) return false;
+  fileRecords_ = ids.size();
+  return true;
+}
+
+void ProblemJournalImpl::writerLoop() {
+  unique_lock<mutex> lock(mutex_);
+  for (;;) {
+    while (!stop_ && !syncRequested_ && !needRewrite_ && pending_.empty()) writerCv_.wait(lock);
+
+    // let records pile up for one interval, unless someone is waiting for them
+    auto interval = needRewrite_ ? max(syncInterval_, failureRetryInterval) : syncInterval_;
+    writerCv_.wait_for(lock, interval, [this] { return stop_ || syncRequested_; });
+    syncRequested_ = false;
+
+    auto fileRecords = fileRecords_ + pendingRecords_;
+    auto rewriteFile = needRewrite_
+        || (fileRecords >= minCompactRecords && fileRecords > 4 * outstanding_.size());
+    vector<string> ids;
+    string batch;
+    auto batchRecords = pendingRecords_;
+    if (rewriteFile) {
+      ids = outstandingInOrder(); // covers everything pending
+      pending_.clear();
+    } else {
+      batch.swap(pending_);
+    }
+    pendingRecords_ = 0;
+    auto target = recorded_;
+
+    lock.unlock();
+    bool ok;
+    if (rewriteFile) {
+      ok = rewrite(ids);
+    } else {
+      ok = file_ && writeAll(file_, batch) && syncFile(file_);
+      if (ok) fileRecords_ += batchRecords;
+    }
+    lock.lock();
+
+    ++writeAttempts_;
+    needRewrite_ = !ok;
+    if (ok) synced_ = target;
+    syncedCv_.notify_all();
+
+    if (stop_ && (!ok || pending_.empty())) break;
+  }
+}
+
+void ProblemJournalImpl::problemSubmittedImpl(const string& id) {
+  if (id.size() > maxIdSize) return;
+  lock_guard<mutex> lock(mutex_);
+  if (outstanding_.insert(make_pair(id, nextOrder_)).second) {
+    ++nextOrder_;
+    record(recordkinds::SUBMITTED, id);
+  }
+}
+
+void ProblemJournalImpl::problemDoneImpl(const string& id) {
+  lock_guard<mutex> lock(mutex_);
+  if (outstanding_.erase(id) > 0) record(recordkinds::DONE, id);
+}
+
+vector<string> ProblemJournalImpl::outstandingProblemsImpl() const {
+  lock_guard<mutex> lock(mutex_);
+  return outstandingInOrder();
+}
+
+bool ProblemJournalImpl::syncImpl() {
+  unique_lock<mutex> lock(mutex_);
+  auto target = recorded_;
+  auto attempts = writeAttempts_;
+  if (synced_ >= target && !needRewrite_) return true;
+
+  syncRequested_ = true;
+  writerCv_.notify_one();
+  syncedCv_.wait(lock, [&] { return synced_ >= target || (writeAttempts_ > attempts && needRewrite_); });
+  return synced_ >= target;
+}
+
+} // namespace {anonymous}
+
+namespace sapiremote {
+
+ProblemJournalPtr makeProblemJournal(const string& path, int syncIntervalMs) {
+  return make_shared<ProblemJournalImpl>(path, max(syncIntervalMs, 0));
+}
+
+} // namespace sapiremote
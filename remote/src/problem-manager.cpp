@@ -2,11 +2,14 @@
 //The software is licensed to authorized users only under the applicable license agreement.  See License.txt.
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <deque>
 #include <exception>
 #include <functional>
 #include <iterator>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <new>
@@ -18,11 +21,16 @@
 
 #include <boost/noncopyable.hpp>
 #include <boost/foreach.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
 
 #include <problem-manager.hpp>
+#include <answer-cache.hpp>
 #include <answer-service.hpp>
 #include <sapi-service.hpp>
 #include <retry-service.hpp>
+#include <request-scheduler.hpp>
+#include <concurrency-controller.hpp>
+#include <mpsc-queue.hpp>
 #include <solver.hpp>
 #include <json.hpp>
 #include <exceptions.hpp>
@@ -38,24 +46,41 @@ using std::make_shared;
 using std::enable_shared_from_this;
 using std::make_move_iterator;
 using std::deque;
+using std::multimap;
 using std::queue;
 using std::string;
 using std::vector;
 using std::tuple;
 using std::make_tuple;
-using std::find;
+using std::pair;
+using std::make_pair;
 using std::sort;
 using std::unique;
+using std::min;
+using std::atomic;
+using std::max;
+using std::partition_point;
 using std::mutex;
 using std::condition_variable;
 using std::unique_lock;
 using std::lock_guard;
+using std::chrono::steady_clock;
+using std::chrono::milliseconds;
+using std::chrono::seconds;
+using std::chrono::duration_cast;
+using std::chrono::duration;
 
 using sapiremote::AnswerCallback;
 using sapiremote::AnswerCallbackPtr;
 using sapiremote::ProblemManagerLimits;
+using sapiremote::ProblemManagerStats;
+using sapiremote::AnswerCache;
+using sapiremote::CachedAnswer;
+using sapiremote::CachedAnswerPtr;
 using sapiremote::ProblemManager;
 using sapiremote::ProblemManagerPtr;
+using sapiremote::ProblemJournal;
+using sapiremote::ProblemJournalPtr;
 using sapiremote::Problem;
 using sapiremote::SubmittedProblemPtr;
 using sapiremote::SubmittedProblem;
@@ -66,7 +91,11 @@ using sapiremote::RetryTiming;
 using sapiremote::RetryTimer;
 using sapiremote::RetryTimerPtr;
 using sapiremote::RetryNotifiable;
+using sapiremote::PollTimerPtr;
 using sapiremote::RetryTimerServicePtr;
+using sapiremote::RequestScheduler;
+using sapiremote::ConcurrencyController;
+using sapiremote::BoundedMpscQueue;
 using sapiremote::SolversSapiCallback;
 using sapiremote::StatusSapiCallback;
 using sapiremote::CancelSapiCallback;
@@ -76,11 +105,13 @@ using sapiremote::SapiServicePtr;
 using sapiremote::RemoteProblemInfo;
 using sapiremote::SubmittedProblemInfo;
 using sapiremote::SolverInfo;
+using sapiremote::QpSolverInfo;
 using sapiremote::Solver;
 using sapiremote::SolverPtr;
 using sapiremote::Error;
 using sapiremote::NetworkException;
 using sapiremote::CommunicationException;
+using sapiremote::HttpStatusException;
 using sapiremote::AuthenticationException;
 using sapiremote::ProblemCancelledException;
 using sapiremote::SolveException;
@@ -90,6 +121,7 @@ using sapiremote::TooManyProblemIdsException;
 namespace remotestatuses = sapiremote::remotestatuses;
 namespace submittedstates = sapiremote::submittedstates;
 namespace errortypes = sapiremote::errortypes;
+namespace httpstatus = sapiremote::http::statusCodes;
 
 namespace {
 
@@ -97,6 +129,7 @@ class ProblemManagerImpl;
 typedef shared_ptr<ProblemManagerImpl> ProblemManagerImplPtr;
 
 class RetryNotifiableImpl;
+class PollNotifiableImpl;
 
 
 
@@ -105,9 +138,45 @@ class RetryNotifiableImpl;
 // Request types
 //
 
-namespace request {
-enum Type { SUBMIT, STATUS, CANCEL, ANSWER };
-} // namespace {anonymous}::request
+namespace request = sapiremote::requestclasses;
+namespace concurrencyknobs = sapiremote::concurrencyknobs;
+
+// stop long polling after this many consecutive long polls came back in less than half the wait with no
+// status change
+const int maxIgnoredLongPolls = 3;
+
+// Once long polling has stopped, try it again after this many plain status queries.  The interval doubles
+// each time the server ignores or rejects the retry, up to the maximum, and resets once it honours one.
+const int firstLongPollProbe = 10;
+const int maxLongPollProbe = 1000;
+
+// Starts from the fixed limits.  Request slots never drop below what the request schedule reserves plus
+// one, so classes without reserved slots can always make progress.
+unique_ptr<ConcurrencyController> makeConcurrencyController(const ProblemManagerLimits& limits) {
+  auto totalReserved = 0;
+  for (auto i = 0; i < request::count; ++i) totalReserved += limits.schedule.reserved[i];
+
+  int values[concurrencyknobs::count];
+  int ceilings[concurrencyknobs::count];
+  int floors[concurrencyknobs::count];
+  values[concurrencyknobs::ACTIVE_REQUESTS] = limits.maxActiveRequests;
+  values[concurrencyknobs::PROBLEMS_PER_SUBMISSION] = limits.maxProblemsPerSubmission;
+  values[concurrencyknobs::IDS_PER_STATUS_QUERY] = limits.maxIdsPerStatusQuery;
+  ceilings[concurrencyknobs::ACTIVE_REQUESTS] = limits.adaptive.maxActiveRequests;
+  ceilings[concurrencyknobs::PROBLEMS_PER_SUBMISSION] = limits.adaptive.maxProblemsPerSubmission;
+  ceilings[concurrencyknobs::IDS_PER_STATUS_QUERY] = limits.adaptive.maxIdsPerStatusQuery;
+  floors[concurrencyknobs::ACTIVE_REQUESTS] = totalReserved + 1;
+  floors[concurrencyknobs::PROBLEMS_PER_SUBMISSION] = 1;
+  floors[concurrencyknobs::IDS_PER_STATUS_QUERY] = 1;
+  for (auto k = 0; k < concurrencyknobs::count; ++k) {
+    if (ceilings[k] <= values[k]) floors[k] = values[k]; // fixed
+  }
+  return unique_ptr<ConcurrencyController>(new ConcurrencyController(values, floors, ceilings));
+}
+
+// problems queued for submission or status queries without taking a lock; more than this many waiting
+// to be picked up overflow into the locked queues
+const std::size_t intakeCapacity = 1 << 10;
 
 
 
@@ -168,6 +237,8 @@ private:
 
   mutable mutex mutex_;
 
+  const steady_clock::time_point created_;
+  const int priority_;
   Problem problem_;
 
   string problemId_;
@@ -185,6 +256,12 @@ private:
 
   vector<SubmittedProblemObserverPtr> liveObservers();
 
+  // direct observers are notified right away, the others through answerService_
+  // must not be called while holding mutex_
+  void notifySubmitted(const SubmittedProblemObserverPtr& observer);
+  void notifyDone(const SubmittedProblemObserverPtr& observer);
+  void notifyError(const SubmittedProblemObserverPtr& observer);
+
   // SubmittedProblem implementation
   virtual string problemIdImpl() const;
   virtual bool doneImpl() const;
@@ -196,14 +273,18 @@ private:
   virtual void addSubmittedProblemObserverImpl(const SubmittedProblemObserverPtr& observer);
 
 public:
-  SubmittedProblemImpl(ProblemManagerImplPtr rpm, AnswerServicePtr answerService, Problem problem);
+  SubmittedProblemImpl(ProblemManagerImplPtr rpm, AnswerServicePtr answerService, Problem problem, int priority);
   SubmittedProblemImpl(ProblemManagerImplPtr rpm, AnswerServicePtr answerService, string problemId);
+  ~SubmittedProblemImpl();
 
   Problem problem() const;
+  int priority() const { return priority_; }
+  steady_clock::duration age() const { return steady_clock::now() - created_; }
   bool cancelled() const;
   void resetCancelled();
   void setProblemId(std::string id);
-  bool updateStatus(RemoteProblemInfo rpi);
+  // changed: the server reported a status other than the previous one (not counting the first report)
+  bool updateStatus(RemoteProblemInfo rpi, bool& changed);
   void setError(std::exception_ptr e, bool retry);
 };
 
@@ -228,6 +309,30 @@ void failSubmittedProblems(Iter begin, Iter end, exception_ptr e, bool retry) {
 
 
 
+//=========================================================================================================
+//
+// Milliseconds from now until a server timestamp (ISO 8601, UTC).  Negative if the timestamp is in the
+// past or can't be parsed.
+//
+
+long long msUntil(string timestamp) {
+  if (!timestamp.empty() && timestamp.back() == 'Z') {
+    timestamp.pop_back();
+  } else if (timestamp.size() > 6 && timestamp.compare(timestamp.size() - 6, 6, "+00:00") == 0) {
+    timestamp.resize(timestamp.size() - 6);
+  }
+
+  try {
+    auto t = boost::posix_time::from_iso_extended_string(timestamp);
+    if (t.is_special()) return -1;
+    return (t - boost::posix_time::microsec_clock::universal_time()).total_milliseconds();
+  } catch (...) {
+    return -1;
+  }
+}
+
+
+
 //=========================================================================================================
 //
 // Solver List
@@ -277,49 +382,106 @@ public:
 class ProblemManagerImpl : public ProblemManager, public enable_shared_from_this<ProblemManagerImpl> {
 private:
   friend class RetryNotifiableImpl;
+  friend class PollNotifiableImpl;
   typedef tuple<string, AnswerCallbackPtr> PendingAnswerFetch;
+  typedef multimap<steady_clock::time_point, SubmittedProblemImplWeakPtr> ScheduledPolls;
   enum RetryState { NO_RETRY, WAITING_TO_RETRY, RETRY_NOW };
 
+  struct UnsubmittedProblem {
+    int priority;
+    SubmittedProblemImplWeakPtr problem;
+  };
+
+  // Each request type backs off independently, so e.g. failing answer downloads don't hold up submissions
+  // and status polls.  Indexed by request::Type.
+  struct RetryChannel {
+    shared_ptr<RetryNotifiableImpl> notifiable;
+    RetryTimerPtr timer;
+    RetryState state;
+  };
+
   SapiServicePtr sapiService_;
   AnswerServicePtr answerService_;
 
   // request management
-  mutex requestMutex_;
-  deque<request::Type> requestQueue_;
-  int availableRequests_;
-  shared_ptr<RetryNotifiableImpl> retryNotifiable_;
-  RetryTimerPtr retryTimer_;
-  RetryState retryState_;
+  // Request types with work waiting and finished requests are recorded without locking and handed to the
+  // scheduler by processRequestQueue.  pendingRequests_ holds the order in which types were first flagged
+  // (0: not pending).  Only one thread at a time runs processRequestQueue; callers that find it busy leave
+  // their work to that thread.
+  mutable mutex requestMutex_;
+  RequestScheduler scheduler_;
+  unique_ptr<ConcurrencyController> concurrency_; // request slots and batch sizes; thread safe
+  RetryChannel retry_[request::count];
+  atomic<unsigned long long> requestOrder_;
+  atomic<unsigned long long> pendingRequests_[request::count];
+  atomic<int> finishedRequests_[request::count];
+  atomic<int> processCalls_;
 
   // problem submission
-  mutex unsubmittedProblemsMutex_;
-  deque<SubmittedProblemImplWeakPtr> unsubmittedProblems_;
-  int maxProblemsPerSubmission_;
+  // highest priority first; first come, first served within a priority
+  // new problems arrive through submitIntake_, which is only popped while holding unsubmittedProblemsMutex_
+  mutable mutex unsubmittedProblemsMutex_;
+  deque<UnsubmittedProblem> unsubmittedProblems_;
+  BoundedMpscQueue<UnsubmittedProblem> submitIntake_;
 
   // problem status querying
-  mutex activeProblemMutex_;
+  // statusIntake_ is only popped while holding activeProblemMutex_
+  mutable mutex activeProblemMutex_;
   deque<SubmittedProblemImplWeakPtr> activeProblems_;
-  int maxIdsPerStatusQuery_;
+  BoundedMpscQueue<SubmittedProblemImplWeakPtr> statusIntake_;
+  const int configuredLongPollWaitS_;
+  int longPollWaitS_; // 0 while the server is found not to support long polling
+  int ignoredLongPolls_;
+  int plainPollsUntilProbe_;
+  int longPollProbeInterval_;
 
   // problem cancellation
-  mutex cancelMutex_;
+  mutable mutex cancelMutex_;
   vector<string> cancelIds_;
 
   // answer fetching
-  mutex pendingFetchesMutex_;
+  mutable mutex pendingFetchesMutex_;
   queue<PendingAnswerFetch> pendingFetches_;
+  AnswerCache answerCache_;
+
+  // answer prefetching (guarded by pendingFetchesMutex_)
+  // prefetches are answer fetches with a null callback
+  int maxAnswerPrefetches_;
+  int activePrefetches_;
+  deque<string> prefetchIds_;
+
+  // status poll scheduling (scheduledPolls_ guarded by activeProblemMutex_)
+  // unfinished problems wait here until their next poll is due, then move to activeProblems_
+  // disabled (pollTimer_ null) if minPollIntervalMs is zero
+  int minPollIntervalMs_;
+  int maxPollIntervalMs_;
+  ScheduledPolls scheduledPolls_;
+  shared_ptr<PollNotifiableImpl> pollNotifiable_;
+  PollTimerPtr pollTimer_;
+
+  // problems the server has and that aren't done yet, for resuming after a crash (may be null)
+  ProblemJournalPtr journal_;
 
   // ProblemManager implementation
   virtual SubmittedProblemPtr submitProblemImpl(
       string& solver,
       string& problemType,
       json::Value& problemData,
-      json::Object& problemParams);
+      json::Object& problemParams,
+      int priority);
   virtual SubmittedProblemPtr addProblemImpl(const std::string& id);
+  virtual vector<SubmittedProblemPtr> addProblemsImpl(const vector<string>& ids);
   virtual SolverMap fetchSolversImpl();
+  virtual ProblemManagerStats statsImpl() const;
 
   //------
-  void retryNotification();
+  void retryNotification(request::Type requestType);
+  void pollNotification();
+  int pollDelayMs(steady_clock::duration age, remotestatuses::Type status, string estimate) const;
+  void schedulePolls(const vector<ScheduledPolls::value_type>& polls);
+  void queueUnsubmittedProblem(UnsubmittedProblem problem, bool retry);
+  void drainSubmitIntake();
+  void drainStatusIntake();
   void retrySubmit(const SubmittedProblemImplWeakVector& problems);
   void queueActiveProblems(const SubmittedProblemImplWeakVector& problems, bool atFront);
   void retryCancel(vector<string> ids);
@@ -327,6 +489,10 @@ private:
   void failUnsubmittedProblems(exception_ptr e);
   void failActiveProblems(exception_ptr e);
   void failPendingFetches(exception_ptr e);
+  void postAnswerError(AnswerCallbackPtr callback, exception_ptr e);
+
+  void prefetchAnswers(vector<string> ids);
+  void prefetchDone();
 
   bool checkCancelled(SubmittedProblemImplPtr problem);
 
@@ -336,11 +502,13 @@ private:
   void pushCancelRequest();
   void pushAnswerRequest();
   void processRequestQueue();
+  void dispatchRequests();
+  void collectRequests();
 
   // functions that actually make SAPI requests
   // these are called by processRequestQueue
   // they must not call processRequestQueue
-  // they can push into requestQueue_
+  // they can push requests
   // return true iff request sent
   bool sendSubmitRequest();
   bool sendStatusRequest();
@@ -348,16 +516,21 @@ private:
   bool sendAnswerRequest();
 
   bool reduceMaxIds();
-  void requestComplete();
-  bool retryFailedRequest();
-  void stopRetrying();
+  bool longPolling();
+  void disableLongPolling();
+  void disableLongPollingLocked();
+  int statusQueryWaitS();
+  void requestComplete(request::Type requestType);
+  bool retryFailedRequest(request::Type requestType);
+  void stopRetrying(request::Type requestType);
 
   ProblemManagerImpl(
       SapiServicePtr sapiService,
       AnswerServicePtr answerCallbackService,
       RetryTimerServicePtr retryService,
       const RetryTiming& retryTiming,
-      const ProblemManagerLimits& limits);
+      const ProblemManagerLimits& limits,
+      ProblemJournalPtr journal);
 
 public:
   static ProblemManagerImplPtr create(
@@ -365,14 +538,31 @@ public:
     AnswerServicePtr answerCallbackService,
     RetryTimerServicePtr retryService,
     const RetryTiming& retryTiming,
-    const ProblemManagerLimits& limits);
+    const ProblemManagerLimits& limits,
+    ProblemJournalPtr journal);
+
+  // no effect without a journal
+  void journalSubmitted(const string& id) { if (journal_) journal_->problemSubmitted(id); }
+  void journalDone(const string& id) { if (journal_) journal_->problemDone(id); }
+
+  // feed the concurrency controller; latencyS < 0: no latency sample
+  void responseOk(request::Type requestType, double latencyS) {
+    concurrency_->responseOk(requestType, latencyS);
+  }
+  void responseFailed(request::Type requestType, exception_ptr e);
 
+  // longPollWaitS > 0: the request was a long poll with this wait, sent at longPollSent
   void statusComplete(
       const SubmittedProblemImplWeakVector& problems,
       vector<RemoteProblemInfo> problemInfo,
-      bool submit);
+      bool submit,
+      int longPollWaitS = 0,
+      steady_clock::time_point longPollSent = steady_clock::time_point());
   void statusFailed(const SubmittedProblemImplWeakVector& problem, bool submit, exception_ptr e);
-  void fetchAnswerComplete(AnswerCallbackPtr callback, string type, json::Value answer);
+  void retryStatus(const SubmittedProblemImplWeakVector& problems, bool submit, exception_ptr e);
+  void longPollComplete(steady_clock::duration elapsed, int waitS, bool changed);
+  void longPollFailed(const SubmittedProblemImplWeakVector& problems, exception_ptr e);
+  void fetchAnswerComplete(const string& problemId, AnswerCallbackPtr callback, string type, json::Value answer);
   void fetchAnswerFailed(string problemId, AnswerCallbackPtr callback, exception_ptr e);
   void cancelComplete();
   void cancelFailed(exception_ptr e, vector<string> ids);
@@ -380,6 +570,9 @@ public:
   void addSubmittedProblem(const SubmittedProblemImplWeakPtr& sp, submittedstates::Type state);
 
   void fetchAnswer(string id, AnswerCallbackPtr callback);
+
+  // returns null if not cached
+  CachedAnswerPtr cachedAnswer(const string& id);
 };
 
 
@@ -401,8 +594,9 @@ private:
   }
 
 public:
-  SolverImpl(string id, json::Object properties, ProblemManagerPtr problemManager) :
-    Solver(std::move(id), std::move(properties)), problemManager_(problemManager) {}
+  SolverImpl(string id, json::Object properties, shared_ptr<QpSolverInfo> qpInfo,
+      ProblemManagerPtr problemManager) :
+    Solver(std::move(id), std::move(properties), std::move(qpInfo)), problemManager_(problemManager) {}
 };
 
 
@@ -415,9 +609,18 @@ public:
 class RetryNotifiableImpl : public RetryNotifiable {
 private:
   ProblemManagerImpl* pm_; // raw pointer since ProblemManagerImpl owns this
-  virtual void notifyImpl() { pm_->retryNotification(); }
+  const request::Type requestType_;
+  virtual void notifyImpl() { pm_->retryNotification(requestType_); }
 public:
-  RetryNotifiableImpl(ProblemManagerImpl* pm) : pm_(pm) {}
+  RetryNotifiableImpl(ProblemManagerImpl* pm, request::Type requestType) : pm_(pm), requestType_(requestType) {}
+};
+
+class PollNotifiableImpl : public RetryNotifiable {
+private:
+  ProblemManagerImpl* pm_; // raw pointer since ProblemManagerImpl owns this
+  virtual void notifyImpl() { pm_->pollNotification(); }
+public:
+  PollNotifiableImpl(ProblemManagerImpl* pm) : pm_(pm) {}
 };
 
 
@@ -432,16 +635,35 @@ private:
   ProblemManagerImplPtr rpm_;
   SubmittedProblemImplWeakVector problems_;
   bool submit_;
+  int longPollWaitS_;
+  steady_clock::time_point sent_;
 
   virtual void completeImpl(vector<RemoteProblemInfo>& problemInfo) {
-    rpm_->statusComplete(problems_, std::move(problemInfo), submit_);
+    auto elapsed = steady_clock::now() - sent_;
+    auto requestType = submit_ ? request::SUBMIT : request::STATUS;
+    if (longPollWaitS_ > 0) {
+      rpm_->responseOk(requestType, -1.0);
+      rpm_->statusComplete(problems_, std::move(problemInfo), submit_, longPollWaitS_, sent_);
+    } else {
+      rpm_->responseOk(requestType, duration<double>(elapsed).count());
+      rpm_->statusComplete(problems_, std::move(problemInfo), submit_);
+    }
   }
 
-  virtual void errorImpl(exception_ptr e) { rpm_->statusFailed(problems_, submit_, e); }
+  virtual void errorImpl(exception_ptr e) {
+    if (longPollWaitS_ > 0) {
+      // long polls are held open on purpose and rejected by servers that don't support them, so their
+      // failures say little about load
+      rpm_->longPollFailed(problems_, e);
+    } else {
+      rpm_->responseFailed(submit_ ? request::SUBMIT : request::STATUS, e);
+      rpm_->statusFailed(problems_, submit_, e);
+    }
+  }
 
 public:
   StatusCallback(ProblemManagerImplPtr rpm, request::Type mode) :
-      rpm_(rpm), submit_(mode == request::SUBMIT) {
+      rpm_(rpm), submit_(mode == request::SUBMIT), longPollWaitS_(0) {
     switch (mode) {
       case request::SUBMIT:
       case request::STATUS:
@@ -450,7 +672,12 @@ public:
         throw std::invalid_argument("invalid StatusCallback request type");
     }
   }
-  void setProblems(SubmittedProblemImplWeakVector problems) { problems_ = std::move(problems); }
+  // call just before sending the request
+  void setProblems(SubmittedProblemImplWeakVector problems) {
+    problems_ = std::move(problems);
+    sent_ = steady_clock::now();
+  }
+  void setLongPoll(int waitS) { longPollWaitS_ = waitS; }
 };
 typedef shared_ptr<StatusCallback> StatusCallbackPtr;
 
@@ -466,8 +693,15 @@ private:
   ProblemManagerImplPtr rpm_;
   vector<string> ids_;
 
-  virtual void completeImpl() { rpm_->cancelComplete(); }
-  virtual void errorImpl(exception_ptr e) { rpm_->cancelFailed(e, std::move(ids_)); }
+  virtual void completeImpl() {
+    rpm_->responseOk(request::CANCEL, -1.0);
+    rpm_->cancelComplete();
+  }
+
+  virtual void errorImpl(exception_ptr e) {
+    rpm_->responseFailed(request::CANCEL, e);
+    rpm_->cancelFailed(e, std::move(ids_));
+  }
 
 public:
   CancelCallback(ProblemManagerImplPtr rpm) : rpm_(rpm) {}
@@ -487,11 +721,16 @@ private:
   AnswerCallbackPtr callback_;
   string id_;
 
+  // no latency samples: download time depends mostly on answer size
   virtual void completeImpl(string& type, json::Value& answer) {
-    rpm_->fetchAnswerComplete(std::move(callback_), std::move(type), std::move(answer));
+    rpm_->responseOk(request::ANSWER, -1.0);
+    rpm_->fetchAnswerComplete(id_, std::move(callback_), std::move(type), std::move(answer));
   }
 
-  virtual void errorImpl(exception_ptr e) { rpm_->fetchAnswerFailed(std::move(id_), std::move(callback_), e); }
+  virtual void errorImpl(exception_ptr e) {
+    rpm_->responseFailed(request::ANSWER, e);
+    rpm_->fetchAnswerFailed(std::move(id_), std::move(callback_), e);
+  }
 
 public:
   FetchAnswerCallback(ProblemManagerImplPtr rpm, AnswerCallbackPtr callback, string id) :
@@ -526,6 +765,30 @@ vector<SubmittedProblemObserverPtr> SubmittedProblemImpl::liveObservers() {
   return obs;
 }
 
+void SubmittedProblemImpl::notifySubmitted(const SubmittedProblemObserverPtr& observer) {
+  if (observer->direct()) {
+    observer->notifySubmitted();
+  } else {
+    answerService_->postSubmitted(observer);
+  }
+}
+
+void SubmittedProblemImpl::notifyDone(const SubmittedProblemObserverPtr& observer) {
+  if (observer->direct()) {
+    observer->notifyDone();
+  } else {
+    answerService_->postDone(observer);
+  }
+}
+
+void SubmittedProblemImpl::notifyError(const SubmittedProblemObserverPtr& observer) {
+  if (observer->direct()) {
+    observer->notifyError();
+  } else {
+    answerService_->postError(observer);
+  }
+}
+
 string SubmittedProblemImpl::problemIdImpl() const {
   lock_guard<mutex> l(mutex_);
   return problemId_;
@@ -578,7 +841,13 @@ void SubmittedProblemImpl::answerImpl(AnswerCallbackPtr callback) const {
     return;
   }
 
-  rpm_->fetchAnswer(std::move(id), callback);
+  auto cached = rpm_->cachedAnswer(id);
+  if (cached) {
+    rpm_->journalDone(id);
+    answerService_->postAnswer(callback, cached->type, cached->answer);
+  } else {
+    rpm_->fetchAnswer(std::move(id), callback);
+  }
 }
 
 void SubmittedProblemImpl::cancelImpl() {
@@ -617,12 +886,12 @@ void SubmittedProblemImpl::addSubmittedProblemObserverImpl(const SubmittedProble
     success = done && remoteStatus_ == remotestatuses::COMPLETED;
   }
 
-  if (submitted) answerService_->postSubmitted(observer);
+  if (submitted) notifySubmitted(observer);
   if (done) {
     if (success) {
-      answerService_->postDone(observer);
+      notifyDone(observer);
     } else {
-      answerService_->postError(observer);
+      notifyError(observer);
     }
   }
 }
@@ -630,9 +899,12 @@ void SubmittedProblemImpl::addSubmittedProblemObserverImpl(const SubmittedProble
 SubmittedProblemImpl::SubmittedProblemImpl(
     ProblemManagerImplPtr rpm,
     AnswerServicePtr answerService,
-    Problem problem) :
+    Problem problem,
+    int priority) :
   rpm_(rpm),
   answerService_(answerService),
+  created_(steady_clock::now()),
+  priority_(priority),
   problem_(std::move(problem)),
   state_(submittedstates::SUBMITTING),
   lastGoodState_(submittedstates::SUBMITTING),
@@ -646,6 +918,8 @@ SubmittedProblemImpl::SubmittedProblemImpl(
     string problemId) :
   rpm_(rpm),
   answerService_(answerService),
+  created_(steady_clock::now()),
+  priority_(0),
   problemId_(problemId),
   state_(submittedstates::SUBMITTED),
   lastGoodState_(submittedstates::SUBMITTED),
@@ -653,6 +927,13 @@ SubmittedProblemImpl::SubmittedProblemImpl(
   error_(Error{errortypes::INTERNAL, string()}),
   cancelled_(false) {}
 
+SubmittedProblemImpl::~SubmittedProblemImpl() {
+  // the caller has given up on the problem, or has its answer already
+  try {
+    if (!problemId_.empty()) rpm_->journalDone(problemId_);
+  } catch (...) {}
+}
+
 Problem SubmittedProblemImpl::problem() const {
   lock_guard<mutex> l(mutex_);
   return problem_;
@@ -669,19 +950,23 @@ void SubmittedProblemImpl::resetCancelled() {
 }
 
 void SubmittedProblemImpl::setProblemId(std::string id) {
+  rpm_->journalSubmitted(id);
+
   vector<SubmittedProblemObserverPtr> obs;
   {
     lock_guard<mutex> l(mutex_);
     problemId_ = std::move(id);
+    problem_ = Problem(); // server has it now; never resubmitted
     obs = liveObservers();
   }
 
   BOOST_FOREACH( auto& o, obs ) {
-    answerService_->postSubmitted(o);
+    notifySubmitted(o);
   }
 }
 
-bool SubmittedProblemImpl::updateStatus(RemoteProblemInfo rpi) {
+bool SubmittedProblemImpl::updateStatus(RemoteProblemInfo rpi, bool& changed) {
+  changed = false;
   try {
     vector<SubmittedProblemObserverPtr> obs;
     bool done = true;
@@ -690,6 +975,7 @@ bool SubmittedProblemImpl::updateStatus(RemoteProblemInfo rpi) {
       if (!rpi.submittedOn.empty()) submittedOn_ = rpi.submittedOn;
       if (!rpi.solvedOn.empty()) solvedOn_ = rpi.solvedOn;
 
+      changed = remoteStatus_ != remotestatuses::UNKNOWN && remoteStatus_ != rpi.status;
       remoteStatus_ = rpi.status;
       switch (remoteStatus_) {
         case remotestatuses::PENDING:
@@ -718,10 +1004,9 @@ bool SubmittedProblemImpl::updateStatus(RemoteProblemInfo rpi) {
     }
 
     BOOST_FOREACH( auto& o, obs ) {
-      answerService_->postDone(o);
+      notifyDone(o);
     }
 
-    problem_ = Problem();
     return done;
 
   } catch (...) {
@@ -776,7 +1061,7 @@ void SubmittedProblemImpl::setError(std::exception_ptr e, bool retry) {
   }
 
   BOOST_FOREACH( auto& o, obs ) {
-    answerService_->postError(o);
+    notifyError(o);
   }
 }
 
@@ -792,19 +1077,116 @@ void SubmittedProblemImpl::setError(std::exception_ptr e, bool retry) {
 //@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@
 //@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@
 
-void ProblemManagerImpl::retryNotification() {
+void ProblemManagerImpl::retryNotification(request::Type requestType) {
   {
     lock_guard<mutex> l(requestMutex_);
-    retryState_ = RETRY_NOW;
+    retry_[requestType].state = RETRY_NOW;
   }
   processRequestQueue();
 }
 
+void ProblemManagerImpl::pollNotification() {
+  SubmittedProblemImplWeakVector due;
+  try {
+    lock_guard<mutex> lock(activeProblemMutex_);
+    // The timer only fires for the earliest scheduled poll, so that one is due even if the timer's clock
+    // ran slightly ahead of steady_clock.  Take polls due shortly after as well so that they share a
+    // status query.
+    auto dueTime = steady_clock::now();
+    if (!scheduledPolls_.empty()) dueTime = max(dueTime, scheduledPolls_.begin()->first);
+    auto dueEnd = scheduledPolls_.upper_bound(dueTime + milliseconds(minPollIntervalMs_ / 2));
+    for (auto iter = scheduledPolls_.begin(); iter != dueEnd; ++iter) due.push_back(iter->second);
+    scheduledPolls_.erase(scheduledPolls_.begin(), dueEnd);
+    if (!scheduledPolls_.empty()) {
+      auto nextMs = duration_cast<milliseconds>(scheduledPolls_.begin()->first - steady_clock::now()).count();
+      pollTimer_->schedule(static_cast<int>(nextMs));
+    }
+  } catch (...) {
+    auto e = current_exception();
+    ScheduledPolls spLocal;
+    {
+      lock_guard<mutex> lock(activeProblemMutex_);
+      spLocal.swap(scheduledPolls_);
+    }
+    BOOST_FOREACH( const auto& sp, spLocal ) {
+      auto lsp = sp.second.lock();
+      if (lsp) lsp->setError(e, false);
+    }
+    failSubmittedProblems(due.begin(), due.end(), e, false);
+    return;
+  }
+
+  if (!due.empty()) queueActiveProblems(due, false);
+  processRequestQueue();
+}
+
+int ProblemManagerImpl::pollDelayMs(
+    steady_clock::duration age,
+    remotestatuses::Type status,
+    string estimate) const {
+
+  // follow the server's estimate if it has one; otherwise back off with age, more slowly once the problem
+  // is running since it's likely close to done
+  auto delay = msUntil(std::move(estimate));
+  if (delay <= 0) {
+    auto ageMs = duration_cast<milliseconds>(age).count();
+    delay = status == remotestatuses::IN_PROGRESS ? ageMs / 4 : ageMs / 2;
+  }
+  return static_cast<int>(max<long long>(min<long long>(delay, maxPollIntervalMs_), minPollIntervalMs_));
+}
+
+void ProblemManagerImpl::schedulePolls(const vector<ScheduledPolls::value_type>& polls) {
+  bool anyCancelled = false;
+  BOOST_FOREACH( auto& p, polls ) {
+    auto lp = p.second.lock();
+    if (lp && checkCancelled(lp)) anyCancelled = true;
+  }
+  if (anyCancelled) pushCancelRequest();
+
+  try {
+    lock_guard<mutex> lock(activeProblemMutex_);
+    scheduledPolls_.insert(polls.begin(), polls.end());
+    auto nextMs = duration_cast<milliseconds>(scheduledPolls_.begin()->first - steady_clock::now()).count();
+    pollTimer_->schedule(static_cast<int>(nextMs));
+  } catch (...) {
+    auto e = current_exception();
+    BOOST_FOREACH( auto& p, polls ) {
+      auto lp = p.second.lock();
+      if (lp) lp->setError(e, false);
+    }
+  }
+}
+
+// caller must hold unsubmittedProblemsMutex_
+// retried problems go ahead of others with the same priority
+void ProblemManagerImpl::queueUnsubmittedProblem(UnsubmittedProblem problem, bool retry) {
+  auto priority = problem.priority;
+  auto pos = partition_point(unsubmittedProblems_.begin(), unsubmittedProblems_.end(),
+      [=](const UnsubmittedProblem& up) { return retry ? up.priority > priority : up.priority >= priority; });
+  unsubmittedProblems_.insert(pos, std::move(problem));
+}
+
+// caller must hold unsubmittedProblemsMutex_
+void ProblemManagerImpl::drainSubmitIntake() {
+  UnsubmittedProblem up;
+  while (submitIntake_.tryPop(up)) queueUnsubmittedProblem(std::move(up), false);
+}
+
+// caller must hold activeProblemMutex_
+void ProblemManagerImpl::drainStatusIntake() {
+  SubmittedProblemImplWeakPtr sp;
+  while (statusIntake_.tryPop(sp)) activeProblems_.push_back(std::move(sp));
+}
+
 void ProblemManagerImpl::retrySubmit(const SubmittedProblemImplWeakVector& problems) {
   bool anyActive = false;
   try {
     lock_guard<mutex> lock(unsubmittedProblemsMutex_);
-    unsubmittedProblems_.insert(unsubmittedProblems_.begin(), problems.begin(), problems.end());
+    // backwards, so the problems keep their order
+    for (auto iter = problems.rbegin(); iter != problems.rend(); ++iter) {
+      auto lp = iter->lock();
+      if (lp) queueUnsubmittedProblem(UnsubmittedProblem{lp->priority(), lp}, true);
+    }
     anyActive = !unsubmittedProblems_.empty();
   } catch (...) {
     failSubmittedProblems(problems.begin(), problems.end(), current_exception(), false);
@@ -829,18 +1211,23 @@ void ProblemManagerImpl::retryCancel(vector<string> ids) {
 }
 
 void ProblemManagerImpl::failUnsubmittedProblems(exception_ptr e) {
-  deque<SubmittedProblemImplWeakPtr> upLocal;
+  deque<UnsubmittedProblem> upLocal;
   {
     lock_guard<mutex> lock(unsubmittedProblemsMutex_);
+    drainSubmitIntake();
     upLocal = std::move(unsubmittedProblems_);
   }
-  failSubmittedProblems(upLocal.begin(), upLocal.end(), e, false);
+  BOOST_FOREACH( auto& up, upLocal ) {
+    auto lsp = up.problem.lock();
+    if (lsp) lsp->setError(e, false);
+  }
 }
 
 void ProblemManagerImpl::failActiveProblems(exception_ptr e) {
   deque<SubmittedProblemImplWeakPtr> apLocal;
   {
     lock_guard<mutex> lock(activeProblemMutex_);
+    drainStatusIntake();
     apLocal = std::move(activeProblems_);
   }
   failSubmittedProblems(apLocal.begin(), apLocal.end(), e, false);
@@ -853,11 +1240,57 @@ void ProblemManagerImpl::failPendingFetches(exception_ptr e) {
     pfLocal = std::move(pendingFetches_);
   }
   while (!pfLocal.empty()) {
-    answerService_->postAnswerError(std::get<1>(pfLocal.front()), e);
+    postAnswerError(std::get<1>(pfLocal.front()), e);
     pfLocal.pop();
   }
 }
 
+void ProblemManagerImpl::postAnswerError(AnswerCallbackPtr callback, exception_ptr e) {
+  if (callback) {
+    answerService_->postAnswerError(callback, e);
+  } else {
+    prefetchDone(); // not much else to do; answer will be fetched on request
+  }
+}
+
+void ProblemManagerImpl::prefetchAnswers(vector<string> ids) {
+  vector<string> startIds;
+  try {
+    lock_guard<mutex> lock(pendingFetchesMutex_);
+    prefetchIds_.insert(prefetchIds_.end(), make_move_iterator(ids.begin()), make_move_iterator(ids.end()));
+    while (activePrefetches_ < maxAnswerPrefetches_ && !prefetchIds_.empty()) {
+      startIds.push_back(std::move(prefetchIds_.front()));
+      prefetchIds_.pop_front();
+      ++activePrefetches_;
+    }
+  } catch (...) {
+    // prefetching is optional
+  }
+
+  BOOST_FOREACH( auto& id, startIds ) {
+    fetchAnswer(std::move(id), AnswerCallbackPtr());
+  }
+}
+
+void ProblemManagerImpl::prefetchDone() {
+  string nextId;
+  {
+    lock_guard<mutex> lock(pendingFetchesMutex_);
+    --activePrefetches_;
+    if (prefetchIds_.empty()) return;
+    nextId = std::move(prefetchIds_.front());
+    prefetchIds_.pop_front();
+    ++activePrefetches_;
+  }
+
+  try {
+    fetchAnswer(std::move(nextId), AnswerCallbackPtr());
+  } catch (...) {
+    lock_guard<mutex> lock(pendingFetchesMutex_);
+    --activePrefetches_;
+  }
+}
+
 bool ProblemManagerImpl::checkCancelled(SubmittedProblemImplPtr problem) {
   try {
     if (problem->cancelled()) {
@@ -873,9 +1306,9 @@ bool ProblemManagerImpl::checkCancelled(SubmittedProblemImplPtr problem) {
 }
 
 void ProblemManagerImpl::pushRequest(request::Type r) {
-  lock_guard<mutex> l(requestMutex_);
-  if (find(requestQueue_.begin(), requestQueue_.end(), r) == requestQueue_.end()) {
-    requestQueue_.push_back(r);
+  if (pendingRequests_[r].load() == 0) {
+    auto notPending = 0ull;
+    pendingRequests_[r].compare_exchange_strong(notPending, ++requestOrder_);
   }
 }
 
@@ -912,13 +1345,48 @@ void ProblemManagerImpl::pushAnswerRequest() {
 }
 
 void ProblemManagerImpl::processRequestQueue() {
+  if (processCalls_.fetch_add(1) > 0) return;
+
+  auto handled = 1;
+  try {
+    for (;;) {
+      dispatchRequests();
+      // go again if anyone else called in the meantime
+      auto calls = processCalls_.fetch_sub(handled) - handled;
+      if (calls == 0) break;
+      handled = calls;
+    }
+  } catch (...) {
+    processCalls_.store(0);
+    throw;
+  }
+}
+
+// caller must hold requestMutex_
+void ProblemManagerImpl::collectRequests() {
+  scheduler_.setSlots(concurrency_->limit(concurrencyknobs::ACTIVE_REQUESTS));
+  pair<unsigned long long, request::Type> pending[request::count];
+  auto numPending = 0;
+  for (auto i = 0; i < request::count; ++i) {
+    auto requestType = static_cast<request::Type>(i);
+    for (auto n = finishedRequests_[i].exchange(0); n > 0; --n) scheduler_.release(requestType);
+    auto order = pendingRequests_[i].exchange(0);
+    if (order != 0) pending[numPending++] = make_pair(order, requestType);
+  }
+  sort(pending, pending + numPending);
+  for (auto i = 0; i < numPending; ++i) scheduler_.push(pending[i].second);
+}
+
+void ProblemManagerImpl::dispatchRequests() {
   unique_lock<mutex> lock(requestMutex_);
-  if (retryState_ == WAITING_TO_RETRY) return;
+  // request types waiting to retry stay queued; the others go ahead
+  auto waitingToRetry = [this](request::Type t) { return retry_[t].state == WAITING_TO_RETRY; };
 
-  while (availableRequests_ > 0 && !requestQueue_.empty()) {
-    --availableRequests_;
-    auto requestType = requestQueue_.front();
-    requestQueue_.pop_front();
+  for (;;) {
+    collectRequests();
+    auto next = scheduler_.next(waitingToRetry);
+    if (next < 0) break;
+    auto requestType = static_cast<request::Type>(next);
 
     auto done = false;
     lock.unlock();
@@ -945,15 +1413,16 @@ void ProblemManagerImpl::processRequestQueue() {
     lock.lock();
     if (done) {
       // return to waiting state only if request actually sent
-      if (retryState_ == RETRY_NOW) retryState_ = WAITING_TO_RETRY;
+      auto& retryState = retry_[requestType].state;
+      if (retryState == RETRY_NOW) retryState = WAITING_TO_RETRY;
     } else {
-      ++availableRequests_;
+      scheduler_.release(requestType);
     }
   }
 }
 
 bool ProblemManagerImpl::sendSubmitRequest() {
-  auto quota = maxProblemsPerSubmission_;
+  auto quota = concurrency_->limit(concurrencyknobs::PROBLEMS_PER_SUBMISSION);
   StatusCallbackPtr callback;
   vector<Problem> problems;
   SubmittedProblemImplWeakVector submittedProblems;
@@ -971,11 +1440,12 @@ bool ProblemManagerImpl::sendSubmitRequest() {
   bool moreUnsubmitted;
   {
     lock_guard<mutex> l(unsubmittedProblemsMutex_);
+    drainSubmitIntake();
     auto subEnd = unsubmittedProblems_.begin();
     const auto upEnd = unsubmittedProblems_.end();
 
     while (quota > 0 && subEnd != upEnd) {
-      auto lsp = subEnd->lock();
+      auto lsp = subEnd->problem.lock();
       if (lsp) {
         problems.push_back(lsp->problem());
         submittedProblems.push_back(lsp);
@@ -999,7 +1469,7 @@ bool ProblemManagerImpl::sendSubmitRequest() {
 }
 
 bool ProblemManagerImpl::sendStatusRequest() {
-  auto quota = maxIdsPerStatusQuery_;
+  auto quota = concurrency_->limit(concurrencyknobs::IDS_PER_STATUS_QUERY);
   StatusCallbackPtr callback;
   vector<string> ids;
   SubmittedProblemImplWeakVector problems;
@@ -1015,8 +1485,10 @@ bool ProblemManagerImpl::sendStatusRequest() {
 
   // nothing throws from here on
   bool moreActive;
+  int longPollWaitS = 0;
   {
     lock_guard<mutex> l(activeProblemMutex_);
+    drainStatusIntake();
     auto apIter = activeProblems_.begin();
     const auto apEnd = activeProblems_.end();
 
@@ -1031,6 +1503,7 @@ bool ProblemManagerImpl::sendStatusRequest() {
     }
     activeProblems_.erase(activeProblems_.begin(), apIter);
     moreActive = !activeProblems_.empty();
+    if (!problems.empty()) longPollWaitS = statusQueryWaitS();
   }
 
   if (moreActive) pushStatusRequest();
@@ -1039,7 +1512,12 @@ bool ProblemManagerImpl::sendStatusRequest() {
     return false;
   } else {
     callback->setProblems(std::move(problems));
-    sapiService_->multiProblemStatus(std::move(ids), callback);
+    if (longPollWaitS > 0) {
+      callback->setLongPoll(longPollWaitS);
+      sapiService_->longPollStatus(std::move(ids), longPollWaitS, callback);
+    } else {
+      sapiService_->multiProblemStatus(std::move(ids), callback);
+    }
     return true;
   }
 }
@@ -1084,7 +1562,7 @@ bool ProblemManagerImpl::sendAnswerRequest() {
     sapiService_->fetchAnswer(id, callback);
     return true;
   } catch (...) {
-    answerService_->postAnswerError(answerCallback, current_exception());
+    postAnswerError(answerCallback, current_exception());
     return false;
   }
 }
@@ -1093,14 +1571,18 @@ SubmittedProblemPtr ProblemManagerImpl::submitProblemImpl(
     string& solver,
     string& type,
     json::Value& problemData,
-    json::Object& params) {
+    json::Object& params,
+    int priority) {
 
   auto problem = Problem(std::move(solver), std::move(type), std::move(problemData), std::move(params));
-  auto submittedProblem = make_shared<SubmittedProblemImpl>(shared_from_this(), answerService_, std::move(problem));
+  auto submittedProblem = make_shared<SubmittedProblemImpl>(
+      shared_from_this(), answerService_, std::move(problem), priority);
 
-  {
+  auto up = UnsubmittedProblem{priority, submittedProblem};
+  if (!submitIntake_.tryPush(up)) {
     lock_guard<mutex> lock(unsubmittedProblemsMutex_);
-    unsubmittedProblems_.push_back(submittedProblem);
+    drainSubmitIntake();
+    queueUnsubmittedProblem(std::move(up), false);
   }
 
   pushSubmitRequest();
@@ -1112,9 +1594,11 @@ SubmittedProblemPtr ProblemManagerImpl::addProblemImpl(const string& id) {
   auto submittedProblem = make_shared<SubmittedProblemImpl>(shared_from_this(), answerService_, id);
   submittedProblem->setProblemId(id);
 
-  {
+  SubmittedProblemImplWeakPtr sp = submittedProblem;
+  if (!statusIntake_.tryPush(sp)) {
     lock_guard<mutex> lock(activeProblemMutex_);
-    activeProblems_.push_back(submittedProblem);
+    drainStatusIntake();
+    activeProblems_.push_back(std::move(sp));
   }
 
   pushStatusRequest();
@@ -1122,27 +1606,79 @@ SubmittedProblemPtr ProblemManagerImpl::addProblemImpl(const string& id) {
   return submittedProblem;
 }
 
+vector<SubmittedProblemPtr> ProblemManagerImpl::addProblemsImpl(const vector<string>& ids) {
+  vector<SubmittedProblemPtr> submittedProblems;
+  submittedProblems.reserve(ids.size());
+  SubmittedProblemImplWeakVector weakProblems;
+  weakProblems.reserve(ids.size());
+  BOOST_FOREACH( const auto& id, ids ) {
+    auto submittedProblem = make_shared<SubmittedProblemImpl>(shared_from_this(), answerService_, id);
+    submittedProblem->setProblemId(id);
+    weakProblems.push_back(submittedProblem);
+    submittedProblems.push_back(std::move(submittedProblem));
+  }
+  if (ids.empty()) return submittedProblems;
+
+  // sendStatusRequest takes as many problems as a status query allows off activeProblems_ and queues
+  // another status request while any are left, so this turns into full-size queries sent as request slots
+  // allow
+  {
+    lock_guard<mutex> lock(activeProblemMutex_);
+    drainStatusIntake();
+    activeProblems_.insert(activeProblems_.end(), weakProblems.begin(), weakProblems.end());
+  }
+
+  pushStatusRequest();
+  processRequestQueue();
+  return submittedProblems;
+}
+
 ProblemManagerImpl::ProblemManagerImpl(
     SapiServicePtr sapiService,
     AnswerServicePtr answerService,
     RetryTimerServicePtr retryService,
     const RetryTiming& retryTiming,
-    const ProblemManagerLimits& limits) :
+    const ProblemManagerLimits& limits,
+    ProblemJournalPtr journal) :
       sapiService_(sapiService),
       answerService_(std::move(answerService)),
-      availableRequests_(limits.maxActiveRequests),
-      retryNotifiable_(make_shared<RetryNotifiableImpl>(this)),
-      retryTimer_(retryService->createRetryTimer(retryNotifiable_, retryTiming)),
-      retryState_(NO_RETRY),
-      maxProblemsPerSubmission_(limits.maxProblemsPerSubmission),
-      maxIdsPerStatusQuery_(limits.maxIdsPerStatusQuery) {}
+      scheduler_(limits.maxActiveRequests, limits.schedule),
+      concurrency_(makeConcurrencyController(limits)),
+      requestOrder_(0),
+      processCalls_(0),
+      submitIntake_(intakeCapacity),
+      statusIntake_(intakeCapacity),
+      configuredLongPollWaitS_(max(limits.longPollWaitS, 0)),
+      longPollWaitS_(configuredLongPollWaitS_),
+      ignoredLongPolls_(0),
+      plainPollsUntilProbe_(0),
+      longPollProbeInterval_(firstLongPollProbe),
+      answerCache_(limits.answerCacheBytes),
+      maxAnswerPrefetches_(answerCache_.enabled() ? limits.maxAnswerPrefetches : 0),
+      activePrefetches_(0),
+      minPollIntervalMs_(max(limits.minPollIntervalMs, 0)),
+      maxPollIntervalMs_(max(limits.maxPollIntervalMs, minPollIntervalMs_)),
+      pollNotifiable_(make_shared<PollNotifiableImpl>(this)),
+      pollTimer_(minPollIntervalMs_ > 0 ? retryService->createPollTimer(pollNotifiable_) : PollTimerPtr()),
+      journal_(std::move(journal)) {
+
+  for (auto i = 0; i < request::count; ++i) {
+    auto& retry = retry_[i];
+    retry.notifiable = make_shared<RetryNotifiableImpl>(this, static_cast<request::Type>(i));
+    retry.timer = retryService->createRetryTimer(retry.notifiable, retryTiming);
+    retry.state = NO_RETRY;
+    pendingRequests_[i].store(0);
+    finishedRequests_[i].store(0);
+  }
+}
 
 ProblemManagerImplPtr ProblemManagerImpl::create(
     SapiServicePtr sapiService,
     AnswerServicePtr answerService,
     RetryTimerServicePtr retryService,
     const RetryTiming& retryTiming,
-    const ProblemManagerLimits& limits) {
+    const ProblemManagerLimits& limits,
+    ProblemJournalPtr journal) {
 
 #define CHECK_LIMIT(l) do { if(l < 1) throw std::invalid_argument(#l); } while (false)
   CHECK_LIMIT(limits.maxProblemsPerSubmission);
@@ -1150,47 +1686,91 @@ ProblemManagerImplPtr ProblemManagerImpl::create(
   CHECK_LIMIT(limits.maxActiveRequests);
 #undef CHECK_LIMIT
   auto pmi = shared_ptr<ProblemManagerImpl>(
-    new ProblemManagerImpl(sapiService, answerService, retryService, retryTiming, limits));
+    new ProblemManagerImpl(sapiService, answerService, retryService, retryTiming, limits,
+      std::move(journal)));
   return pmi;
 }
 
 bool ProblemManagerImpl::reduceMaxIds() {
+  return concurrency_->tooManyIds();
+}
+
+bool ProblemManagerImpl::longPolling() {
   lock_guard<mutex> lock(activeProblemMutex_);
-  if (maxIdsPerStatusQuery_ < 2) return false;
-  maxIdsPerStatusQuery_ = static_cast<int>(maxIdsPerStatusQuery_ * 0.7);
-  return true;
+  return longPollWaitS_ > 0;
 }
 
-void ProblemManagerImpl::requestComplete() {
-  {
-    lock_guard<mutex> l(requestMutex_);
-    ++availableRequests_;
+void ProblemManagerImpl::disableLongPolling() {
+  lock_guard<mutex> lock(activeProblemMutex_);
+  disableLongPollingLocked();
+}
+
+// caller must hold activeProblemMutex_
+void ProblemManagerImpl::disableLongPollingLocked() {
+  if (longPollWaitS_ == 0) return;
+  longPollWaitS_ = 0;
+  ignoredLongPolls_ = 0;
+  plainPollsUntilProbe_ = longPollProbeInterval_;
+  longPollProbeInterval_ = min(2 * longPollProbeInterval_, maxLongPollProbe);
+}
+
+// Wait to ask for in the next status query (0: plain query).  Caller must hold activeProblemMutex_.
+int ProblemManagerImpl::statusQueryWaitS() {
+  if (longPollWaitS_ == 0 && configuredLongPollWaitS_ > 0) {
+    if (plainPollsUntilProbe_ > 0) {
+      --plainPollsUntilProbe_;
+    } else {
+      // probe: one ignored answer is enough to stop again
+      longPollWaitS_ = configuredLongPollWaitS_;
+      ignoredLongPolls_ = maxIgnoredLongPolls - 1;
+    }
   }
+  return longPollWaitS_;
+}
+
+void ProblemManagerImpl::responseFailed(request::Type requestType, exception_ptr e) {
+  try {
+    rethrow_exception(e);
+  } catch (TooManyProblemIdsException&) {
+    // not overload; reduceMaxIds handles it
+  } catch (NetworkException&) {
+    concurrency_->responseFailed(requestType);
+  } catch (CommunicationException&) {
+    concurrency_->responseFailed(requestType);
+  } catch (...) {
+    // problem errors, authentication failures, etc.
+  }
+}
+
+void ProblemManagerImpl::requestComplete(request::Type requestType) {
+  ++finishedRequests_[requestType];
   processRequestQueue();
 }
 
-bool ProblemManagerImpl::retryFailedRequest() {
+bool ProblemManagerImpl::retryFailedRequest(request::Type requestType) {
   lock_guard<mutex> l(requestMutex_);
-  switch (retryTimer_->retry()) {
+  auto& retry = retry_[requestType];
+  switch (retry.timer->retry()) {
     case RetryTimer::RETRY:
-      if (retryState_ != RETRY_NOW) retryState_ = WAITING_TO_RETRY;
+      if (retry.state != RETRY_NOW) retry.state = WAITING_TO_RETRY;
       return true;
 
     case RetryTimer::FAIL:
-      if (retryState_ != RETRY_NOW) retryState_ = WAITING_TO_RETRY;
+      if (retry.state != RETRY_NOW) retry.state = WAITING_TO_RETRY;
       return false;
 
     default:
-      retryState_ = NO_RETRY;
+      retry.state = NO_RETRY;
       return false;
   }
 }
 
-void ProblemManagerImpl::stopRetrying() {
+void ProblemManagerImpl::stopRetrying(request::Type requestType) {
   lock_guard<mutex> l(requestMutex_);
-  if (retryState_ != NO_RETRY) {
-    retryTimer_->success();
-    retryState_ = NO_RETRY;
+  auto& retry = retry_[requestType];
+  if (retry.state != NO_RETRY) {
+    retry.timer->success();
+    retry.state = NO_RETRY;
   }
 }
 
@@ -1203,10 +1783,19 @@ void ProblemManagerImpl::queueActiveProblems(const SubmittedProblemImplWeakVecto
   if (anyCancelled) pushCancelRequest();
 
   try {
-    lock_guard<mutex> lock(activeProblemMutex_);
-    activeProblems_.insert(atFront ? activeProblems_.begin() : activeProblems_.end(),
-        problems.begin(), problems.end());
-    if (!activeProblems_.empty()) pushStatusRequest();
+    auto iter = problems.begin();
+    if (!atFront) {
+      for (; iter != problems.end(); ++iter) {
+        auto sp = *iter;
+        if (!statusIntake_.tryPush(sp)) break;
+      }
+    }
+    if (iter != problems.end()) {
+      lock_guard<mutex> lock(activeProblemMutex_);
+      if (!atFront) drainStatusIntake();
+      activeProblems_.insert(atFront ? activeProblems_.begin() : activeProblems_.end(), iter, problems.end());
+    }
+    if (!problems.empty()) pushStatusRequest();
   } catch (...) {
     failSubmittedProblems(problems.begin(), problems.end(), current_exception(), false);
   }
@@ -1215,23 +1804,55 @@ void ProblemManagerImpl::queueActiveProblems(const SubmittedProblemImplWeakVecto
 void ProblemManagerImpl::statusComplete(
     const SubmittedProblemImplWeakVector& problems,
     vector<RemoteProblemInfo> problemInfo,
-    bool submit) {
+    bool submit,
+    int longPollWaitS,
+    steady_clock::time_point longPollSent) {
 
-  stopRetrying();
+  stopRetrying(submit ? request::SUBMIT : request::STATUS);
   SubmittedProblemImplWeakVector stillActive;
+  vector<ScheduledPolls::value_type> scheduled;
+  vector<string> completedIds;
   try {
     auto numProblems = problems.size();
     if (problemInfo.size() != numProblems) throw std::runtime_error("problem status size mismatch");
 
-    stillActive.reserve(numProblems);
-
+    // unfinished problems, with their next poll time in case polling is scheduled
+    auto now = steady_clock::now();
+    vector<pair<steady_clock::time_point, SubmittedProblemImplPtr>> unfinished;
+    unfinished.reserve(numProblems);
+    auto anyChanged = false;
     for (size_t i = 0; i < numProblems; ++i) {
       auto lp = problems[i].lock();
       if (lp) {
         if (submit) lp->setProblemId(std::move(problemInfo[i].id));
-        if (!lp->updateStatus(std::move(problemInfo[i]))) stillActive.push_back(lp);
+        auto status = problemInfo[i].status;
+        auto estimate = std::move(problemInfo[i].earliestCompletion);
+        bool changed;
+        if (!lp->updateStatus(std::move(problemInfo[i]), changed)) {
+          auto delay = pollTimer_ ? milliseconds(pollDelayMs(lp->age(), status, std::move(estimate)))
+              : milliseconds(0);
+          unfinished.push_back(make_pair(now + delay, lp));
+        } else if (status == remotestatuses::COMPLETED && maxAnswerPrefetches_ > 0) {
+          completedIds.push_back(lp->problemId());
+        }
+        anyChanged = anyChanged || changed;
       }
     }
+    if (longPollWaitS > 0) longPollComplete(now - longPollSent, longPollWaitS, anyChanged);
+
+    // When long polling, the server does the waiting.  Long polls still start no more often than the
+    // minimum poll interval, in case the server answers them right away.
+    auto longPoll = longPolling();
+    auto nextLongPoll = longPollSent + milliseconds(minPollIntervalMs_);
+    if (pollTimer_ && (!longPoll || nextLongPoll > now)) {
+      scheduled.reserve(unfinished.size());
+      BOOST_FOREACH( const auto& p, unfinished ) {
+        scheduled.push_back(ScheduledPolls::value_type(longPoll ? nextLongPoll : p.first, p.second));
+      }
+    } else {
+      stillActive.reserve(unfinished.size());
+      BOOST_FOREACH( auto& p, unfinished ) stillActive.push_back(p.second);
+    }
 
   } catch (...) {
     statusFailed(problems, submit, current_exception());
@@ -1240,26 +1861,21 @@ void ProblemManagerImpl::statusComplete(
   if (!stillActive.empty()) {
     queueActiveProblems(stillActive, false);
   }
-  requestComplete();
+  if (!scheduled.empty()) schedulePolls(scheduled);
+  if (!completedIds.empty()) prefetchAnswers(std::move(completedIds));
+  requestComplete(submit ? request::SUBMIT : request::STATUS);
 }
 
 void ProblemManagerImpl::statusFailed(const SubmittedProblemImplWeakVector& problems, bool submit, exception_ptr e) {
 
+  auto requestType = submit ? request::SUBMIT : request::STATUS;
   auto nonNetworkFailure = true;
   try {
     rethrow_exception(e);
 
   } catch (NetworkException&) {
     nonNetworkFailure = false;
-    auto retry = retryFailedRequest();
-    failSubmittedProblems(problems.begin(), problems.end(), e, retry);
-    if (retry) {
-      if (submit) {
-        retrySubmit(problems);
-      } else {
-        queueActiveProblems(problems, true);
-      }
-    }
+    retryStatus(problems, submit, e);
 
   } catch (TooManyProblemIdsException&) {
     if (reduceMaxIds()) {
@@ -1272,14 +1888,99 @@ void ProblemManagerImpl::statusFailed(const SubmittedProblemImplWeakVector& prob
     failSubmittedProblems(problems.begin(), problems.end(), e, false);
   }
 
-  if (nonNetworkFailure) stopRetrying();
-  requestComplete();
+  if (nonNetworkFailure) stopRetrying(requestType);
+  requestComplete(requestType);
+}
+
+void ProblemManagerImpl::retryStatus(
+    const SubmittedProblemImplWeakVector& problems,
+    bool submit,
+    exception_ptr e) {
+
+  auto retry = retryFailedRequest(submit ? request::SUBMIT : request::STATUS);
+  failSubmittedProblems(problems.begin(), problems.end(), e, retry);
+  if (retry) {
+    if (submit) {
+      retrySubmit(problems);
+    } else {
+      queueActiveProblems(problems, true);
+    }
+  }
+}
+
+void ProblemManagerImpl::longPollComplete(steady_clock::duration elapsed, int waitS, bool changed) {
+  // A server that ignores the wait parameter answers right away with nothing new.  One that honours it
+  // answers early only when a problem changed state, which in a large batch happens in most intervals.
+  auto ignored = !changed && elapsed < seconds(waitS) / 2;
+
+  lock_guard<mutex> lock(activeProblemMutex_);
+  if (!ignored) {
+    ignoredLongPolls_ = 0;
+    longPollProbeInterval_ = firstLongPollProbe;
+  } else if (++ignoredLongPolls_ >= maxIgnoredLongPolls) {
+    disableLongPollingLocked();
+  }
+}
+
+void ProblemManagerImpl::longPollFailed(const SubmittedProblemImplWeakVector& problems, exception_ptr e) {
+  try {
+    rethrow_exception(e);
+
+  } catch (HttpStatusException& hse) {
+    switch (hse.statusCode()) {
+      case httpstatus::BAD_REQUEST:
+      case httpstatus::NOT_FOUND:
+      case httpstatus::METHOD_NOT_ALLOWED:
+      case httpstatus::NOT_IMPLEMENTED:
+        // server doesn't support long polls; poll normally for a while
+        disableLongPolling();
+        queueActiveProblems(problems, true);
+        break;
+
+      default:
+        // throttling, server errors, or a proxy that gave up on the held request: try again later, still
+        // long polling
+        retryStatus(problems, false, e);
+        break;
+    }
+    requestComplete(request::STATUS);
+
+  } catch (...) {
+    // includes TooManyProblemIdsException (URL too long): statusFailed splits the ID list
+    statusFailed(problems, false, e);
+  }
 }
 
-void ProblemManagerImpl::fetchAnswerComplete(AnswerCallbackPtr callback, string type, json::Value answer) {
-  stopRetrying();
-  answerService_->postAnswer(callback, std::move(type), std::move(answer));
-  requestComplete();
+void ProblemManagerImpl::fetchAnswerComplete(
+    const string& problemId,
+    AnswerCallbackPtr callback,
+    string type,
+    json::Value answer) {
+
+  stopRetrying(request::ANSWER);
+  CachedAnswerPtr cached;
+  if (answerCache_.enabled()) {
+    try {
+      auto entry = make_shared<CachedAnswer>();
+      entry->type.swap(type);
+      entry->answer.swap(answer);
+      cached = entry;
+      answerCache_.insert(problemId, cached);
+    } catch (...) {
+      // not cached, still deliverable
+    }
+  }
+
+  if (!callback) {
+    prefetchDone();
+  } else if (cached) {
+    journalDone(problemId);
+    answerService_->postAnswer(callback, cached->type, cached->answer);
+  } else {
+    journalDone(problemId);
+    answerService_->postAnswer(callback, std::move(type), std::move(answer));
+  }
+  requestComplete(request::ANSWER);
 }
 
 void ProblemManagerImpl::fetchAnswerFailed(string problemId, AnswerCallbackPtr callback, exception_ptr e) {
@@ -1287,24 +1988,24 @@ void ProblemManagerImpl::fetchAnswerFailed(string problemId, AnswerCallbackPtr c
     rethrow_exception(e);
 
   } catch (NetworkException&) {
-    auto retry = retryFailedRequest();
+    auto retry = retryFailedRequest(request::ANSWER);
     if (retry) {
       fetchAnswer(std::move(problemId), callback);
     } else {
-      answerService_->postAnswerError(callback, e);
+      postAnswerError(callback, e);
     }
 
   } catch (...) {
-    stopRetrying();
-    answerService_->postAnswerError(callback, e);
+    stopRetrying(request::ANSWER);
+    postAnswerError(callback, e);
   }
 
-  requestComplete();
+  requestComplete(request::ANSWER);
 }
 
 void ProblemManagerImpl::cancelComplete() {
-  stopRetrying();
-  requestComplete();
+  stopRetrying(request::CANCEL);
+  requestComplete(request::CANCEL);
 }
 
 void ProblemManagerImpl::cancelFailed(exception_ptr e, vector<string> ids) {
@@ -1312,21 +2013,23 @@ void ProblemManagerImpl::cancelFailed(exception_ptr e, vector<string> ids) {
     rethrow_exception(e);
 
   } catch (NetworkException&) {
-    auto retry = retryFailedRequest();
+    auto retry = retryFailedRequest(request::CANCEL);
     if (retry) retryCancel(std::move(ids));
 
   } catch (...) {
-    stopRetrying();
+    stopRetrying(request::CANCEL);
   }
 
-  requestComplete();
+  requestComplete(request::CANCEL);
 }
 
 void ProblemManagerImpl::addSubmittedProblem(const SubmittedProblemImplWeakPtr& sp, submittedstates::Type state) {
   if (state == submittedstates::SUBMITTING) {
+    auto lsp = sp.lock();
+    if (!lsp) return;
     {
       lock_guard<mutex> l(unsubmittedProblemsMutex_);
-      unsubmittedProblems_.push_back(sp);
+      queueUnsubmittedProblem(UnsubmittedProblem{lsp->priority(), lsp}, false);
     }
     pushSubmitRequest();
   } else {
@@ -1350,6 +2053,37 @@ void ProblemManagerImpl::fetchAnswer(string id, AnswerCallbackPtr callback) {
   processRequestQueue();
 }
 
+CachedAnswerPtr ProblemManagerImpl::cachedAnswer(const string& id) {
+  return answerCache_.enabled() ? answerCache_.find(id) : CachedAnswerPtr();
+}
+
+ProblemManagerStats ProblemManagerImpl::statsImpl() const {
+  auto s = ProblemManagerStats();
+  s.answerCache = answerCache_.stats();
+  s.concurrency = concurrency_->stats();
+  {
+    lock_guard<mutex> lock(requestMutex_);
+    for (auto i = 0; i < request::count; ++i) s.requests[i] = scheduler_.stats(static_cast<request::Type>(i));
+  }
+  {
+    lock_guard<mutex> lock(unsubmittedProblemsMutex_);
+    s.requests[request::SUBMIT].queueDepth = unsubmittedProblems_.size() + submitIntake_.approximateSize();
+  }
+  {
+    lock_guard<mutex> lock(activeProblemMutex_);
+    s.requests[request::STATUS].queueDepth = activeProblems_.size() + statusIntake_.approximateSize();
+  }
+  {
+    lock_guard<mutex> lock(cancelMutex_);
+    s.requests[request::CANCEL].queueDepth = cancelIds_.size();
+  }
+  {
+    lock_guard<mutex> lock(pendingFetchesMutex_);
+    s.requests[request::ANSWER].queueDepth = pendingFetches_.size() + prefetchIds_.size();
+  }
+  return s;
+}
+
 SolverMap ProblemManagerImpl::fetchSolversImpl() {
   auto cb = make_shared<SolversCallback>();
   sapiService_->fetchSolvers(cb);
@@ -1358,7 +2092,7 @@ SolverMap ProblemManagerImpl::fetchSolversImpl() {
   SolverMap solvers;
   BOOST_FOREACH( const auto& solverInfo, solverInfos ) {
     solvers[solverInfo.id] = make_shared<SolverImpl>(
-        solverInfo.id, std::move(solverInfo.properties), shared_from_this());
+        solverInfo.id, std::move(solverInfo.properties), solverInfo.qpInfo, shared_from_this());
   }
 
   return solvers;
@@ -1384,9 +2118,15 @@ ProblemManagerPtr makeProblemManager(
     AnswerServicePtr answerService,
     RetryTimerServicePtr retryService,
     const RetryTiming& retryTiming,
-    const ProblemManagerLimits& limits) {
+    const ProblemManagerLimits& limits,
+    ProblemJournalPtr journal) {
+
+  return ProblemManagerImpl::create(sapiService, answerService, retryService, retryTiming, limits,
+    std::move(journal));
+}
 
-  return ProblemManagerImpl::create(sapiService, answerService, retryService, retryTiming, limits);
+vector<SubmittedProblemPtr> resumeProblems(ProblemManager& problemManager, const ProblemJournal& journal) {
+  return problemManager.addProblems(journal.outstandingProblems());
 }
 
 } // namespace sapiremote
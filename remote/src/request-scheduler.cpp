@@ -0,0 +1,91 @@
+//Copyright © 2019 D-Wave Systems Inc.
+//The software is licensed to authorized users only under the applicable license agreement.  See License.txt.
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <stdexcept>
+
+#include <request-scheduler.hpp>
+
+using std::max;
+using std::function;
+using std::chrono::duration;
+using std::chrono::steady_clock;
+
+namespace {
+
+const unsigned long long strideBase = 1 << 20;
+
+} // namespace {anonymous}
+
+namespace sapiremote {
+
+RequestScheduler::RequestScheduler(int slots, const RequestSchedule& schedule) :
+    slots_(slots), freeSlots_(slots), pushes_(0), virtualTime_(0) {
+  auto totalReserved = 0;
+  for (auto c = 0; c < requestclasses::count; ++c) {
+    if (schedule.weights[c] < 0) throw std::invalid_argument("negative request weight");
+    if (schedule.reserved[c] < 0) throw std::invalid_argument("negative reserved requests");
+    strides_[c] = strideBase / (schedule.weights[c] > 0 ? schedule.weights[c] : 1);
+    reserved_[c] = schedule.reserved[c];
+    totalReserved += reserved_[c];
+    passes_[c] = 0;
+    queued_[c] = false;
+    stats_[c] = RequestClassStats();
+  }
+  if (totalReserved > slots) throw std::invalid_argument("more requests reserved than allowed");
+}
+
+bool RequestScheduler::slotAvailable(int c) const {
+  auto held = 0;
+  for (auto d = 0; d < requestclasses::count; ++d) {
+    if (d != c) held += max(reserved_[d] - stats_[d].activeRequests, 0);
+  }
+  return freeSlots_ > held;
+}
+
+void RequestScheduler::push(requestclasses::Type c) {
+  if (!queued_[c]) {
+    queued_[c] = true;
+    queuedOrder_[c] = ++pushes_;
+    queuedSince_[c] = steady_clock::now();
+    passes_[c] = max(passes_[c], virtualTime_);
+  }
+}
+
+int RequestScheduler::next(const function<bool(requestclasses::Type)>& skip) {
+  auto best = -1;
+  for (auto c = 0; c < requestclasses::count; ++c) {
+    if (!queued_[c] || !slotAvailable(c) || skip(static_cast<requestclasses::Type>(c))) continue;
+    if (best < 0 || passes_[c] < passes_[best]
+        || (passes_[c] == passes_[best] && queuedOrder_[c] < queuedOrder_[best])) {
+      best = c;
+    }
+  }
+  if (best < 0) return -1;
+
+  virtualTime_ = passes_[best];
+  passes_[best] += strides_[best];
+  queued_[best] = false;
+  --freeSlots_;
+  auto& stats = stats_[best];
+  ++stats.activeRequests;
+  stats.wait.add(duration<double>(steady_clock::now() - queuedSince_[best]).count());
+  return best;
+}
+
+void RequestScheduler::release(requestclasses::Type c) {
+  ++freeSlots_;
+  --stats_[c].activeRequests;
+}
+
+void RequestScheduler::setSlots(int slots) {
+  auto totalReserved = 0;
+  for (auto c = 0; c < requestclasses::count; ++c) totalReserved += reserved_[c];
+  if (totalReserved > slots) throw std::invalid_argument("more requests reserved than allowed");
+  freeSlots_ += slots - slots_;
+  slots_ = slots;
+}
+
+} // namespace sapiremote
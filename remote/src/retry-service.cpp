@@ -4,6 +4,7 @@
 #include <functional>
 #include <memory>
 #include <mutex>
+#include <random>
 #include <stdexcept>
 #include <thread>
 #include <unordered_map>
@@ -42,6 +43,8 @@ using sapiremote::RetryTimer;
 using sapiremote::RetryTimerPtr;
 using sapiremote::RetryTimerService;
 using sapiremote::RetryTimerServicePtr;
+using sapiremote::PollTimer;
+using sapiremote::PollTimerPtr;
 using sapiremote::ServiceShutdownException;
 
 namespace {
@@ -49,13 +52,22 @@ namespace {
 class RetryTimerServiceImpl;
 typedef shared_ptr<RetryTimerServiceImpl> RetryTimerServiceImplPtr;
 
-class RetryTimerImpl : public RetryTimer {
+// Timers owned by RetryTimerServiceImpl; shut down with the service
+class ServiceTimer {
+public:
+  virtual ~ServiceTimer() {}
+  virtual void shutdown() = 0;
+};
+typedef weak_ptr<ServiceTimer> ServiceTimerWeakPtr;
+
+class RetryTimerImpl : public RetryTimer, public ServiceTimer {
 private:
   RetryTimerServiceImplPtr rts_;
   const RetryTiming timing_;
   const RetryNotifiableWeakPtr target_;
   unique_ptr<deadline_timer> timer_;
   mutex mutex_;
+  std::minstd_rand rng_;
   int nextDelayMs_;
   bool waiting_;
   bool fail_;
@@ -65,7 +77,9 @@ private:
     lock_guard<mutex> l(mutex_);
     if (!timer_) return RetryTimer::SHUTDOWN;
     if (!waiting_) {
-      timer_->expires_from_now(milliseconds(nextDelayMs_));
+      // jitter keeps clients that failed together from retrying together
+      auto jitter = timing_.jitter > 0.0f ? std::uniform_real_distribution<float>(0.0f, timing_.jitter)(rng_) : 0.0f;
+      timer_->expires_from_now(milliseconds(static_cast<long>(nextDelayMs_ * (1.0f - jitter))));
       timer_->async_wait(bind(&RetryTimerImpl::timerExpired, this, _1));
 
       waiting_ = true;
@@ -100,24 +114,69 @@ private:
 public:
   RetryTimerImpl(RetryTimerServiceImplPtr rts, unique_ptr<deadline_timer> timer, RetryNotifiableWeakPtr target,
       const RetryTiming& timing) : rts_(rts), timing_(timing), target_(target), timer_(std::move(timer)),
-          nextDelayMs_(timing.initDelayMs), waiting_(false), fail_(false), failOnExpiry_(false) {
+          rng_(std::random_device()()), nextDelayMs_(timing.initDelayMs), waiting_(false), fail_(false),
+          failOnExpiry_(false) {
 
     if (timing_.initDelayMs < 1) throw std::invalid_argument("initDelayMs must be positive");
     if (timing_.delayScale < 1.0f) throw std::invalid_argument("delayScale must be >=1.0f");
     if (timing_.maxDelayMs < timing_.initDelayMs) {
       throw std::invalid_argument("maxDelayMs must be at least initDelayMs");
     }
+    if (!(timing_.jitter >= 0.0f && timing_.jitter < 1.0f)) {
+      throw std::invalid_argument("jitter must be in [0, 1)");
+    }
   }
 
   ~RetryTimerImpl();
 
-  void shutdown() {
+  virtual void shutdown() {
+    lock_guard<mutex> l(mutex_);
+    timer_.reset();
+    rts_.reset();
+  }
+};
+
+class PollTimerImpl : public PollTimer, public ServiceTimer {
+private:
+  RetryTimerServiceImplPtr rts_;
+  const RetryNotifiableWeakPtr target_;
+  unique_ptr<deadline_timer> timer_;
+  mutex mutex_;
+  bool waiting_;
+
+  virtual void scheduleImpl(int delayMs) {
+    lock_guard<mutex> l(mutex_);
+    if (!timer_) return;
+    auto expiry = deadline_timer::traits_type::now() + milliseconds(delayMs > 0 ? delayMs : 0);
+    if (waiting_ && timer_->expires_at() <= expiry) return;
+    timer_->expires_at(expiry); // cancels pending wait, if any
+    timer_->async_wait(bind(&PollTimerImpl::timerExpired, this, _1));
+    waiting_ = true;
+  }
+
+  void timerExpired(const error_code& ec) {
+    if (!ec) {
+      {
+        lock_guard<mutex> l(mutex_);
+        waiting_ = false;
+      }
+      auto lt = target_.lock();
+      if (lt) lt->notify();
+    }
+  }
+
+public:
+  PollTimerImpl(RetryTimerServiceImplPtr rts, unique_ptr<deadline_timer> timer, RetryNotifiableWeakPtr target) :
+      rts_(rts), target_(target), timer_(std::move(timer)), waiting_(false) {}
+
+  ~PollTimerImpl();
+
+  virtual void shutdown() {
     lock_guard<mutex> l(mutex_);
     timer_.reset();
     rts_.reset();
   }
 };
-typedef weak_ptr<RetryTimerImpl> RetryTimerImplWeakPtr;
 
 class IoServiceThread : boost::noncopyable {
 private:
@@ -141,7 +200,7 @@ private:
   unique_ptr<io_service> ioService_;
   IoServiceThread thread_;
   unique_ptr<io_service::work> work_;
-  unordered_map<RetryTimerImpl*, RetryTimerImplWeakPtr> timers_;
+  unordered_map<ServiceTimer*, ServiceTimerWeakPtr> timers_;
   mutex mutex_;
   bool running_;
 
@@ -168,6 +227,15 @@ private:
     return timer;
   }
 
+  virtual PollTimerPtr createPollTimerImpl(const RetryNotifiableWeakPtr& rn) {
+    lock_guard<mutex> l(mutex_);
+    if (!running_) throw ServiceShutdownException();
+    auto dt = unique_ptr<deadline_timer>(new deadline_timer(*ioService_));
+    auto timer = make_shared<PollTimerImpl>(shared_from_this(), std::move(dt), rn);
+    timers_[timer.get()] = timer;
+    return timer;
+  }
+
 public:
   RetryTimerServiceImpl() : ioService_(new io_service), work_(new io_service::work(*ioService_)), running_(true) {
     thread_ = IoServiceThread(*ioService_);
@@ -175,7 +243,7 @@ public:
 
   ~RetryTimerServiceImpl() { shutdown(); }
 
-  void removeTimer(RetryTimerImpl* timer) {
+  void removeTimer(ServiceTimer* timer) {
     lock_guard<mutex> l(mutex_);
     if (running_) timers_.erase(timer);
   }
@@ -190,13 +258,17 @@ RetryTimerImpl::~RetryTimerImpl() {
   if (rts_) rts_->removeTimer(this);
 }
 
+PollTimerImpl::~PollTimerImpl() {
+  if (rts_) rts_->removeTimer(this);
+}
+
 } // namespace {anonymous}
 
 
 namespace sapiremote {
 
 const RetryTiming& defaultRetryTiming() {
-  static RetryTiming timing = { 10, 10000, 10.0f };
+  static RetryTiming timing = { 10, 10000, 10.0f, 0.5f };
   return timing;
 }
 
@@ -2,10 +2,14 @@
 //The software is licensed to authorized users only under the applicable license agreement.  See License.txt.
 
 #include <cctype>
+#include <cstddef>
 #include <cstdio>
+#include <cstdlib>
 #include <exception>
 #include <iterator>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <sstream>
 #include <utility>
@@ -14,35 +18,54 @@
 #include <boost/foreach.hpp>
 
 #include <exceptions.hpp>
+#include <gzip.hpp>
 #include <http-service.hpp>
 #include <sapi-service.hpp>
+#include <solver-cache.hpp>
+#include <coding.hpp>
 #include <json.hpp>
 
 #include "user-agent.hpp"
 
 using std::isalnum;
 using std::exception_ptr;
+using std::lock_guard;
+using std::map;
+using std::mutex;
 using std::ostringstream;
 using std::shared_ptr;
 using std::string;
 using std::make_shared;
 using std::make_pair;
 using std::next;
+using std::prev;
 using std::current_exception;
+using std::size_t;
+using std::unique_ptr;
 using std::vector;
 
 using sapiremote::http::HttpServicePtr;
 using sapiremote::http::HttpHeaders;
 using sapiremote::http::HttpCallback;
+using sapiremote::http::HttpResult;
+using sapiremote::http::TransferInfo;
 using sapiremote::http::Proxy;
 using sapiremote::SapiService;
+using sapiremote::SapiServiceOptions;
+using sapiremote::SapiServiceStats;
+using sapiremote::EndpointStats;
 using sapiremote::SolversSapiCallbackPtr;
 using sapiremote::StatusSapiCallbackPtr;
 using sapiremote::CancelSapiCallbackPtr;
+using sapiremote::FetchAnswerSapiCallback;
 using sapiremote::FetchAnswerSapiCallbackPtr;
 using sapiremote::RemoteProblemInfo;
 using sapiremote::SolverInfo;
+using sapiremote::SolverCache;
+using sapiremote::CachedSolverList;
 using sapiremote::CommunicationException;
+using sapiremote::HttpStatusException;
+using sapiremote::TooManyProblemIdsException;
 using sapiremote::AuthenticationException;
 using sapiremote::NoAnswerException;
 using sapiremote::SolveException;
@@ -50,22 +73,32 @@ using sapiremote::ProblemCancelledException;
 using sapiremote::Problem;
 
 namespace remotestatuses = sapiremote::remotestatuses;
+namespace endpoints = sapiremote::endpoints;
 
 namespace {
 
 namespace headers {
 const char* authToken = "X-Auth-Token";
 const char* contentType = "Content-Type";
+const char* contentEncoding = "Content-Encoding";
 const char* userAgent = "User-Agent";
+const char* ifNoneMatch = "If-None-Match";
 } // namespace {anonymous}::headers
 
 const char* applicationJson = "application/json";
+const char* solverCacheDirVariable = "DWAVE_SAPI_SOLVER_CACHE_DIR";
+const char* gzip = "gzip";
 
 namespace paths {
 const char* remoteSolvers = "solvers/remote/";
 const char* problems = "problems/";
 } // namespace {anonymous}::paths
 
+namespace queryparams {
+const char* ids = "?id=";
+const char* longPollTimeout = "&timeout=";
+} // namespace {anonymous}::queryparams
+
 namespace solverkeys {
 const char* solverId = "id";
 const char* properties = "properties";
@@ -84,6 +117,7 @@ const char* problemId = "id";
 const char* status = "status";
 const char* submittedOn = "submitted_on";
 const char* solvedOn = "solved_on";
+const char* earliestCompletion = "earliest_estimated_completion";
 const char* answer = "answer";
 const char* errorMessage = "error_message";
 }
@@ -102,12 +136,6 @@ struct KeyException {
   KeyException(string key0) : key(key0) {}
 };
 
-class HttpStatusException : public CommunicationException {
-public:
-  HttpStatusException(int status, const std::string& url) :
-    CommunicationException(string("HTTP status code " + std::to_string(static_cast<long long>(status))), url) {}
-};
-
 class MissingKeyException : public CommunicationException {
 public:
   MissingKeyException(const KeyException& ke, const string& url) :
@@ -189,8 +217,183 @@ string getErrorMessage(json::Object& obj) {
   }
 }
 
+class StatsRecorder {
+private:
+  mutable mutex mutex_;
+  SapiServiceStats stats_;
+
+public:
+  StatsRecorder() : stats_() {}
+
+  void addSubmission() {
+    lock_guard<mutex> lock(mutex_);
+    ++stats_.submissions;
+  }
+
+  void addGzipSubmission(size_t bytesIn, size_t bytesOut) {
+    lock_guard<mutex> lock(mutex_);
+    ++stats_.submissions;
+    ++stats_.gzipSubmissions;
+    stats_.gzipBytesIn += bytesIn;
+    stats_.gzipBytesOut += bytesOut;
+    stats_.lastGzipBytesSaved = bytesIn - bytesOut;
+  }
+
+  void addCoalescedAnswerFetch() {
+    lock_guard<mutex> lock(mutex_);
+    ++stats_.coalescedAnswerFetches;
+  }
+
+  void addTransfer(endpoints::Type endpoint, const TransferInfo& transfer) {
+    lock_guard<mutex> lock(mutex_);
+    stats_.endpointStats[endpoint].add(transfer);
+  }
+
+  SapiServiceStats stats() const {
+    lock_guard<mutex> lock(mutex_);
+    return stats_;
+  }
+};
+typedef shared_ptr<StatsRecorder> StatsRecorderPtr;
+
+// Records transfer details in the service statistics before handling the response
+class TimedHttpCallback : public HttpCallback {
+private:
+  StatsRecorderPtr statsRecorder_;
+  const endpoints::Type endpoint_;
+
+  virtual void completeImpl(int statusCode, shared_ptr<string> data) = 0;
+  virtual void resultImpl(HttpResult& result) {
+    statsRecorder_->addTransfer(endpoint_, result.transfer);
+    handleResult(result);
+  }
+
+  // Override to see response details other than the status code and body
+  virtual void handleResult(HttpResult& result) { completeImpl(result.statusCode, result.data); }
+
+public:
+  TimedHttpCallback(StatsRecorderPtr statsRecorder, endpoints::Type endpoint) :
+    statsRecorder_(statsRecorder), endpoint_(endpoint) {}
+};
+
+// Answer fetches currently in flight, keyed by URL.  Identical fetches share one HTTP request.
+class AnswerFlights {
+private:
+  typedef vector<FetchAnswerSapiCallbackPtr> Waiters;
+  mutex mutex_;
+  map<string, Waiters> flights_;
+
+public:
+  // Returns true if the caller must start the request (i.e. no identical request is in flight)
+  bool join(const string& url, FetchAnswerSapiCallbackPtr callback) {
+    lock_guard<mutex> lock(mutex_);
+    auto iter = flights_.find(url);
+    if (iter != flights_.end()) {
+      iter->second.push_back(callback);
+      return false;
+    }
+    flights_[url].push_back(callback);
+    return true;
+  }
+
+  Waiters land(const string& url) {
+    Waiters waiters;
+    lock_guard<mutex> lock(mutex_);
+    auto iter = flights_.find(url);
+    if (iter != flights_.end()) {
+      waiters.swap(iter->second);
+      flights_.erase(iter);
+    }
+    return waiters;
+  }
+};
+typedef shared_ptr<AnswerFlights> AnswerFlightsPtr;
+
+// Passes the result of a shared answer fetch to every waiting callback
+class FanOutFetchAnswerCallback : public FetchAnswerSapiCallback {
+private:
+  AnswerFlightsPtr flights_;
+  string url_;
+
+  virtual void completeImpl(string& type, json::Value& answer) {
+    auto waiters = flights_->land(url_);
+    if (waiters.empty()) return;
+    auto last = prev(waiters.end());
+    for (auto iter = waiters.begin(); iter != last; ++iter) (*iter)->complete(type, answer);
+    (*last)->complete(std::move(type), std::move(answer));
+  }
+
+  virtual void errorImpl(exception_ptr e) {
+    auto waiters = flights_->land(url_);
+    for (auto iter = waiters.begin(), end = waiters.end(); iter != end; ++iter) (*iter)->error(e);
+  }
+
+public:
+  FanOutFetchAnswerCallback(AnswerFlightsPtr flights, string url) : flights_(flights), url_(std::move(url)) {}
+};
+
+//=========================================================================================================
+//
+// Submission body writer
+//
+// Problems are serialized straight into one reserved buffer.  Problem data is mostly a few large base64
+// strings (qp format lin/quad) so the size estimate only has to be close for those.
+//
+
+size_t jsonSizeHint(const json::Value& v) {
+  if (v.isString()) return v.getString().size() + 2;
+  if (v.isArray()) {
+    size_t size = 2;
+    BOOST_FOREACH( const auto& item, v.getArray() ) size += jsonSizeHint(item) + 1;
+    return size;
+  }
+  if (v.isObject()) {
+    size_t size = 2;
+    BOOST_FOREACH( const auto& item, v.getObject() ) size += item.first.size() + 4 + jsonSizeHint(item.second);
+    return size;
+  }
+  return 24; // numbers, booleans, null
+}
+
+size_t submissionSizeHint(const Problem& p) {
+  size_t size = 64 + p.solver().size() + p.type().size() + jsonSizeHint(p.data()) + 2;
+  BOOST_FOREACH( const auto& item, p.params() ) size += item.first.size() + 4 + jsonSizeHint(item.second);
+  return size;
+}
+
+template<typename T>
+void appendMember(string& s, char separator, const char* key, const T& value) {
+  s.append(1, separator).append(1, '"').append(key).append("\":"); // keys are plain ASCII
+  json::appendJson(s, value);
+}
+
+void appendMember(string& s, char separator, const char* key, const string& value) {
+  s.append(1, separator).append(1, '"').append(key).append("\":");
+  json::appendJsonString(s, value);
+}
+
+string submissionBody(const vector<Problem>& problems) {
+  size_t size = 2;
+  BOOST_FOREACH( const auto& p, problems ) size += submissionSizeHint(p);
+
+  string body;
+  body.reserve(size);
+  body.append(1, '[');
+  BOOST_FOREACH( const auto& p, problems ) {
+    if (body.size() > 1) body.append(1, ',');
+    appendMember(body, '{', submitkeys::solver, p.solver());
+    appendMember(body, ',', submitkeys::type, p.type());
+    appendMember(body, ',', submitkeys::data, p.data());
+    appendMember(body, ',', submitkeys::params, p.params());
+    body.append(1, '}');
+  }
+  body.append(1, ']');
+  return body;
+}
+
 HttpHeaders makeGetHeaders(std::string token);
 HttpHeaders makePostHeaders(const HttpHeaders& getHeaders);
+HttpHeaders makeGzipPostHeaders(const HttpHeaders& postHeaders);
 
 string fixToken(string);
 string fixBaseUrl(string baseUrl);
@@ -205,31 +408,57 @@ private:
   const Proxy proxy_;
   HttpHeaders getHeaders_;
   HttpHeaders postHeaders_;
+  HttpHeaders gzipPostHeaders_;
+  const SapiServiceOptions options_;
+  const SolverCache solverCache_;
+  StatsRecorderPtr statsRecorder_;
+  AnswerFlightsPtr answerFlights_;
 
   virtual void fetchSolversImpl(SolversSapiCallbackPtr callback);
   virtual void submitProblemsImpl(vector<Problem>& problems, StatusSapiCallbackPtr callback);
   virtual void multiProblemStatusImpl(const vector<string>& ids, StatusSapiCallbackPtr callback);
+  virtual void longPollStatusImpl(const vector<string>& ids, int waitS, StatusSapiCallbackPtr callback);
   virtual void fetchAnswerImpl(const std::string& id, FetchAnswerSapiCallbackPtr callback);
   virtual void cancelProblemsImpl(const std::vector<std::string>& ids, CancelSapiCallbackPtr callback);
+  virtual SapiServiceStats statsImpl() const;
 
   template<typename T>
   std::string url(const T& path) { return baseUrl_ + path; }
 
+  // waitS <= 0: plain status query
+  void statusQuery(const vector<string>& ids, int waitS, StatusSapiCallbackPtr callback);
+
 public:
-  SapiServiceImpl(HttpServicePtr httpService, string baseUrl, string token, Proxy proxy);
+  SapiServiceImpl(
+      HttpServicePtr httpService,
+      string baseUrl,
+      string token,
+      Proxy proxy,
+      const SapiServiceOptions& options);
 };
 
-class SolversHttpCallback : public HttpCallback {
+class SolversHttpCallback : public TimedHttpCallback {
 private:
   string url_;
   SolversSapiCallbackPtr callback_;
+  const SolverCache solverCache_;
+  unique_ptr<CachedSolverList> cached_; // sent as If-None-Match; may be null
+  string etag_;
+
+  virtual void handleResult(HttpResult& result);
   virtual void completeImpl(int statusCode, shared_ptr<string> data);
   virtual void errorImpl(exception_ptr e) { callback_->error(e); }
 public:
-  SolversHttpCallback(string url, SolversSapiCallbackPtr callback) : url_(std::move(url)), callback_(callback) {}
+  SolversHttpCallback(string url, SolversSapiCallbackPtr callback, StatsRecorderPtr statsRecorder,
+      const SolverCache& solverCache, unique_ptr<CachedSolverList> cached) :
+    TimedHttpCallback(statsRecorder, endpoints::SOLVERS),
+    url_(std::move(url)),
+    callback_(callback),
+    solverCache_(solverCache),
+    cached_(std::move(cached)) {}
 };
 
-class StatusHttpCallback : public HttpCallback {
+class StatusHttpCallback : public TimedHttpCallback {
 private:
   string url_;
   StatusSapiCallbackPtr callback_;
@@ -240,71 +469,111 @@ private:
   virtual void errorImpl(exception_ptr e) { callback_->error(e); }
 
 public:
-  StatusHttpCallback(string url, StatusSapiCallbackPtr callback, size_t expectedNumProblems, int expectedHttpStatus) :
+  StatusHttpCallback(
+      string url,
+      StatusSapiCallbackPtr callback,
+      size_t expectedNumProblems,
+      int expectedHttpStatus,
+      StatsRecorderPtr statsRecorder,
+      endpoints::Type endpoint) :
+    TimedHttpCallback(statsRecorder, endpoint),
     url_(std::move(url)),
     callback_(callback),
     expectedNumProblems_(expectedNumProblems),
     expectedHttpStatus_(expectedHttpStatus) {}
 };
 
-class FetchAnswerHttpCallback : public HttpCallback {
+class FetchAnswerHttpCallback : public TimedHttpCallback {
 private:
   string url_;
   FetchAnswerSapiCallbackPtr callback_;
+
+  // Not streamed: answers can be large, and parsing them as they arrive would tie up the HTTP I/O thread.
+  // The body is collected into a buffer sized from Content-Length and parsed on a callback thread.
   virtual void completeImpl(int statusCode, shared_ptr<string> data);
   virtual void errorImpl(exception_ptr e) { callback_->error(e); }
+
 public:
-  FetchAnswerHttpCallback(string url, FetchAnswerSapiCallbackPtr callback) :
+  FetchAnswerHttpCallback(string url, FetchAnswerSapiCallbackPtr callback, StatsRecorderPtr statsRecorder) :
+    TimedHttpCallback(statsRecorder, endpoints::ANSWER),
     url_(std::move(url)),
     callback_(callback) {}
 };
 
-class CancelHttpCallback : public HttpCallback {
+class CancelHttpCallback : public TimedHttpCallback {
 private:
   CancelSapiCallbackPtr callback_;
   virtual void completeImpl(int, shared_ptr<string>) { callback_->complete(); }
   virtual void errorImpl(exception_ptr e) { callback_->error(e); }
 public:
-  CancelHttpCallback(CancelSapiCallbackPtr callback) : callback_(callback) {}
+  CancelHttpCallback(CancelSapiCallbackPtr callback, StatsRecorderPtr statsRecorder) :
+    TimedHttpCallback(statsRecorder, endpoints::CANCEL), callback_(callback) {}
 };
 
 SapiServiceImpl::SapiServiceImpl(
     HttpServicePtr httpService,
     string baseUrl,
     string token,
-    Proxy proxy) :
+    Proxy proxy,
+    const SapiServiceOptions& options) :
         httpService_(httpService),
         baseUrl_(fixBaseUrl(std::move(baseUrl))),
         problemsUrl_(baseUrl_ + paths::problems),
+        token_(fixToken(std::move(token))),
         proxy_(std::move(proxy)),
-        getHeaders_(makeGetHeaders(fixToken(std::move(token)))),
-        postHeaders_(makePostHeaders(getHeaders_)) {}
+        getHeaders_(makeGetHeaders(token_)),
+        postHeaders_(makePostHeaders(getHeaders_)),
+        gzipPostHeaders_(makeGzipPostHeaders(postHeaders_)),
+        options_(options),
+        solverCache_(options.solverCacheDir, token_),
+        statsRecorder_(make_shared<StatsRecorder>()),
+        answerFlights_(make_shared<AnswerFlights>()) {}
 
 void SapiServiceImpl::fetchSolversImpl(SolversSapiCallbackPtr callback) {
   auto u = url(paths::remoteSolvers);
-  auto httpCallback = make_shared<SolversHttpCallback>(u, callback);
-  httpService_->asyncGet(u, getHeaders_, proxy_, httpCallback);
+  auto cached = solverCache_.load(u);
+  if (cached && !cached->etag.empty()) {
+    auto headers = getHeaders_;
+    headers[headers::ifNoneMatch] = cached->etag;
+    auto httpCallback = make_shared<SolversHttpCallback>(u, callback, statsRecorder_, solverCache_, std::move(cached));
+    httpService_->asyncGet(u, headers, proxy_, httpCallback);
+  } else {
+    auto httpCallback = make_shared<SolversHttpCallback>(
+        u, callback, statsRecorder_, solverCache_, unique_ptr<CachedSolverList>());
+    httpService_->asyncGet(u, getHeaders_, proxy_, httpCallback);
+  }
 }
 
 void SapiServiceImpl::submitProblemsImpl(vector<Problem>& problems, StatusSapiCallbackPtr callback) {
-  json::Array request;
-  request.reserve(problems.size());
-
-  BOOST_FOREACH( auto& p, problems ) {
-    json::Object problemJson;
-    problemJson[submitkeys::solver] = std::move(p.solver());
-    problemJson[submitkeys::type] = std::move(p.type());
-    problemJson[submitkeys::data] = std::move(p.data());
-    problemJson[submitkeys::params] = std::move(p.params());
-    request.push_back(std::move(problemJson));
+  auto httpCallback = make_shared<StatusHttpCallback>(
+      problemsUrl_, callback, problems.size(), sapiremote::http::statusCodes::OK, statsRecorder_, endpoints::SUBMIT);
+
+  // Problem payloads are shared and immutable: serialize them in place rather than copying them into
+  // a json::Array first
+  auto body = submissionBody(problems);
+
+  if (options_.gzipMinBytes > 0 && body.size() >= options_.gzipMinBytes) {
+    auto compressed = sapiremote::gzipCompress(body);
+    if (compressed.size() < body.size()) {
+      statsRecorder_->addGzipSubmission(body.size(), compressed.size());
+      httpService_->asyncPost(problemsUrl_, gzipPostHeaders_, std::move(compressed), proxy_, httpCallback);
+      return;
+    }
   }
 
-  auto httpCallback = make_shared<StatusHttpCallback>(
-      problemsUrl_, callback, problems.size(), sapiremote::http::statusCodes::OK);
-  httpService_->asyncPost(problemsUrl_, postHeaders_, jsonToString(request), proxy_, httpCallback);
+  statsRecorder_->addSubmission();
+  httpService_->asyncPost(problemsUrl_, postHeaders_, std::move(body), proxy_, httpCallback);
 }
 
 void SapiServiceImpl::multiProblemStatusImpl(const vector<string>& ids, StatusSapiCallbackPtr callback) {
+  statusQuery(ids, 0, callback);
+}
+
+void SapiServiceImpl::longPollStatusImpl(const vector<string>& ids, int waitS, StatusSapiCallbackPtr callback) {
+  statusQuery(ids, waitS, callback);
+}
+
+void SapiServiceImpl::statusQuery(const vector<string>& ids, int waitS, StatusSapiCallbackPtr callback) {
 
   if (ids.empty()) {
     callback->complete(vector<RemoteProblemInfo>());
@@ -312,14 +581,16 @@ void SapiServiceImpl::multiProblemStatusImpl(const vector<string>& ids, StatusSa
   }
 
   try {
-    string query = "?id=";
+    string query = queryparams::ids;
     query.append(percentEscape(ids.front()));
     BOOST_FOREACH( const std::string& id, make_pair(next(ids.begin()), ids.end()) ) {
       query.append(1, ',').append(percentEscape(id));
     }
+    if (waitS > 0) query.append(queryparams::longPollTimeout).append(std::to_string(waitS));
 
     auto u = problemsUrl_ + query;
-    auto httpCallback = make_shared<StatusHttpCallback>(u, callback, ids.size(), sapiremote::http::statusCodes::OK);
+    auto httpCallback = make_shared<StatusHttpCallback>(
+        u, callback, ids.size(), sapiremote::http::statusCodes::OK, statsRecorder_, endpoints::STATUS);
     httpService_->asyncGet(u, getHeaders_, proxy_, httpCallback);
   } catch (...) {
     callback->error(current_exception());
@@ -327,12 +598,25 @@ void SapiServiceImpl::multiProblemStatusImpl(const vector<string>& ids, StatusSa
 }
 
 void SapiServiceImpl::fetchAnswerImpl(const string& id, FetchAnswerSapiCallbackPtr callback) {
+  string u;
   try {
-    auto u = problemsUrl_ + id + "/";
-    auto httpCallback = make_shared<FetchAnswerHttpCallback>(u, callback);
-    httpService_->asyncGet(u, getHeaders_, proxy_, httpCallback);
+    u = problemsUrl_ + id + "/";
+    if (!answerFlights_->join(u, callback)) {
+      statsRecorder_->addCoalescedAnswerFetch();
+      return;
+    }
   } catch (...) {
     callback->error(current_exception());
+    return;
+  }
+
+  // this call leads the flight: all errors from here on go to every waiter
+  try {
+    auto flightCallback = make_shared<FanOutFetchAnswerCallback>(answerFlights_, u);
+    auto httpCallback = make_shared<FetchAnswerHttpCallback>(u, flightCallback, statsRecorder_);
+    httpService_->asyncGet(u, getHeaders_, proxy_, httpCallback);
+  } catch (...) {
+    FanOutFetchAnswerCallback(answerFlights_, u).error(current_exception());
   }
 }
 
@@ -340,12 +624,25 @@ void SapiServiceImpl::cancelProblemsImpl(const std::vector<std::string>& ids, Ca
   try {
     auto idsJson = json::Array(ids.begin(), ids.end());
     httpService_->asyncDelete(problemsUrl_, getHeaders_, json::jsonToString(idsJson), proxy_,
-      make_shared<CancelHttpCallback>(callback));
+      make_shared<CancelHttpCallback>(callback, statsRecorder_));
   } catch (...) {
     callback->error(current_exception());
   }
 }
 
+SapiServiceStats SapiServiceImpl::statsImpl() const {
+  return statsRecorder_->stats();
+}
+
+
+void SolversHttpCallback::handleResult(HttpResult& result) {
+  if (cached_ && result.statusCode == sapiremote::http::statusCodes::NOT_MODIFIED) {
+    callback_->complete(std::move(cached_->solvers));
+  } else {
+    etag_ = std::move(result.etag);
+    completeImpl(result.statusCode, result.data);
+  }
+}
 
 void SolversHttpCallback::completeImpl(int statusCode, shared_ptr<string> data) {
   try {
@@ -364,6 +661,16 @@ void SolversHttpCallback::completeImpl(int statusCode, shared_ptr<string> data)
       solvers.push_back(std::move(si));
     }
 
+    if (solverCache_.enabled() && !etag_.empty()) {
+      // the cache keeps the qubit and coupler tables too, so build them now rather than in each Solver
+      CachedSolverList list;
+      list.etag = etag_;
+      list.solvers.swap(solvers);
+      BOOST_FOREACH( auto& si, list.solvers ) si.qpInfo = sapiremote::extractQpSolverInfo(si.properties);
+      solverCache_.store(url_, list);
+      solvers.swap(list.solvers);
+    }
+
     callback_->complete(std::move(solvers));
 
   } catch (json::Exception&) {
@@ -376,6 +683,10 @@ void SolversHttpCallback::completeImpl(int statusCode, shared_ptr<string> data)
 
 void StatusHttpCallback::completeImpl(int statusCode, shared_ptr<string> data) {
   try {
+    // status query URLs list the problem IDs
+    if (statusCode == sapiremote::http::statusCodes::REQUEST_URI_TOO_LONG) {
+      throw TooManyProblemIdsException(url_);
+    }
     checkHttpResponse(statusCode, expectedHttpStatus_, url_);
 
     auto dataJson = json::stringToJson(*data);
@@ -401,6 +712,8 @@ void StatusHttpCallback::completeImpl(int statusCode, shared_ptr<string> data) {
         if (iter != vObj.end() && iter->second.isString()) pi.submittedOn = iter->second.getString();
         iter = vObj.find(problemkeys::solvedOn);
         if (iter != vObj.end() && iter->second.isString()) pi.solvedOn = iter->second.getString();
+        iter = vObj.find(problemkeys::earliestCompletion);
+        if (iter != vObj.end() && iter->second.isString()) pi.earliestCompletion = iter->second.getString();
 
         if (pi.status == remotestatuses::FAILED) pi.errorMessage = getErrorMessage(vObj);
         if (pi.status == remotestatuses::UNKNOWN) throw UnknownStatusException(statusString, url_);
@@ -419,7 +732,6 @@ void StatusHttpCallback::completeImpl(int statusCode, shared_ptr<string> data) {
 void FetchAnswerHttpCallback::completeImpl(int statusCode, shared_ptr<string> data) {
   try {
     checkHttpResponse(statusCode, sapiremote::http::statusCodes::OK, url_);
-
     auto dataJson = json::stringToJson(*data);
     auto& dataObj = dataJson.getObject();
 
@@ -464,6 +776,12 @@ HttpHeaders makePostHeaders(const HttpHeaders& getHeaders) {
   return h;
 }
 
+HttpHeaders makeGzipPostHeaders(const HttpHeaders& postHeaders) {
+  HttpHeaders h = postHeaders;
+  h[headers::contentEncoding] = gzip;
+  return h;
+}
+
 
 string fixToken(string token) {
   // strip leading and trailing whitespace
@@ -531,13 +849,43 @@ string percentEscape(const string& s) {
 
 namespace sapiremote {
 
+void EndpointStats::add(const http::TransferInfo& transfer) {
+  ++responses;
+  nameLookup.add(transfer.nameLookupS);
+  connect.add(transfer.connectS);
+  appConnect.add(transfer.appConnectS);
+  startTransfer.add(transfer.startTransferS);
+  total.add(transfer.totalS);
+  bytesSent += static_cast<unsigned long long>(transfer.bytesSent);
+  bytesReceived += static_cast<unsigned long long>(transfer.bytesReceived);
+}
+
+SapiServiceOptions environmentSapiServiceOptions() {
+  auto options = SapiServiceOptions();
+  auto cacheDir = std::getenv(solverCacheDirVariable);
+  if (cacheDir) options.solverCacheDir = cacheDir;
+  return options;
+}
+
 SapiServicePtr makeSapiService(
     http::HttpServicePtr httpService,
     std::string baseUrl,
     std::string token,
     http::Proxy proxy) {
 
-  return make_shared<SapiServiceImpl>(httpService, std::move(baseUrl), std::move(token), std::move(proxy));
+  return make_shared<SapiServiceImpl>(
+      httpService, std::move(baseUrl), std::move(token), std::move(proxy), SapiServiceOptions());
+}
+
+SapiServicePtr makeSapiService(
+    http::HttpServicePtr httpService,
+    std::string baseUrl,
+    std::string token,
+    http::Proxy proxy,
+    const SapiServiceOptions& options) {
+
+  return make_shared<SapiServiceImpl>(
+      httpService, std::move(baseUrl), std::move(token), std::move(proxy), options);
 }
 
 } // namespace sapiremote
@@ -0,0 +1,278 @@
+//Copyright © 2019 D-Wave Systems Inc.
+//The software is licensed to authorized users only under the applicable license agreement.  See License.txt.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/foreach.hpp>
+
+#include <binary-file.hpp>
+#include <coding.hpp>
+#include <json.hpp>
+#include <solver-cache.hpp>
+
+using std::int32_t;
+using std::size_t;
+using std::uint32_t;
+using std::make_pair;
+using std::make_shared;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+using sapiremote::CachedSolverList;
+using sapiremote::QpSolverInfo;
+using sapiremote::SolverInfo;
+using sapiremote::binaryFileHeader;
+using sapiremote::fnv1a64;
+using sapiremote::readFile;
+using sapiremote::replaceFile;
+
+namespace {
+
+// bump the version whenever the layout changes; old files then just miss
+const char magic[] = "SAPISLC2";
+static_assert(sizeof(int) == sizeof(int32_t), "qubit tables are written as int32");
+
+namespace propkeys {
+const auto qubits = "qubits";
+const auto couplers = "couplers";
+} // namespace {anonymous}::propkeys
+
+struct BadCacheFile {};
+
+class Writer {
+private:
+  string& buffer_;
+
+public:
+  Writer(string& buffer) : buffer_(buffer) {}
+
+  template<typename T>
+  void raw(const T* data, size_t n) {
+    buffer_.append(reinterpret_cast<const char*>(data), n * sizeof(T));
+  }
+
+  void u32(uint32_t x) { raw(&x, 1); }
+
+  void str(const string& s) {
+    u32(static_cast<uint32_t>(s.size()));
+    buffer_.append(s);
+  }
+};
+
+class Reader {
+private:
+  const char* pos_;
+  const char* const end_;
+
+public:
+  Reader(const string& buffer) : pos_(buffer.data()), end_(buffer.data() + buffer.size()) {}
+
+  template<typename T>
+  void raw(T* data, size_t n) {
+    if (static_cast<size_t>(end_ - pos_) / sizeof(T) < n) throw BadCacheFile();
+    std::memcpy(data, pos_, n * sizeof(T));
+    pos_ += n * sizeof(T);
+  }
+
+  uint32_t u32() {
+    uint32_t x;
+    raw(&x, 1);
+    return x;
+  }
+
+  // element count, checked against the bytes left so corrupt files can't cause huge allocations
+  uint32_t count(size_t elementSize) {
+    auto n = u32();
+    if (static_cast<size_t>(end_ - pos_) / elementSize < n) throw BadCacheFile();
+    return n;
+  }
+
+  string str() {
+    auto size = u32();
+    if (static_cast<size_t>(end_ - pos_) < size) throw BadCacheFile();
+    string s(pos_, size);
+    pos_ += size;
+    return s;
+  }
+
+  void skip(size_t n) {
+    if (static_cast<size_t>(end_ - pos_) < n) throw BadCacheFile();
+    pos_ += n;
+  }
+
+  bool atEnd() const { return pos_ == end_; }
+};
+
+string hexHash(const string& s) {
+  char hex[17];
+  std::snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(fnv1a64(s.data(), s.size())));
+  return hex;
+}
+
+json::Array qubitsJson(const QpSolverInfo& qpi) {
+  return json::Array(qpi.qubits.begin(), qpi.qubits.end());
+}
+
+json::Array couplersJson(const QpSolverInfo& qpi) {
+  json::Array couplers;
+  couplers.reserve(qpi.couplers.size());
+  BOOST_FOREACH( const auto& c, qpi.couplers ) {
+    couplers.push_back(json::Array{c.first, c.second});
+  }
+  return couplers;
+}
+
+bool sameIntegers(const json::Array& a, const vector<int>& v) {
+  if (a.size() != v.size()) return false;
+  for (auto i = 0u; i < v.size(); ++i) {
+    if (!a[i].isInteger() || a[i].getInteger() != v[i]) return false;
+  }
+  return true;
+}
+
+// The tables can stand in for the qubits and couplers properties only if rebuilding those properties from
+// them gives back exactly what the server sent (extractQpSolverInfo orders coupler endpoints).
+bool tablesMatchProperties(const QpSolverInfo& qpi, const json::Object& props) {
+  auto qubitsIter = props.find(propkeys::qubits);
+  auto couplersIter = props.find(propkeys::couplers);
+  if (qubitsIter == props.end() || !qubitsIter->second.isArray()) return false;
+  if (couplersIter == props.end() || !couplersIter->second.isArray()) return false;
+
+  if (!sameIntegers(qubitsIter->second.getArray(), qpi.qubits)) return false;
+
+  const auto& couplers = couplersIter->second.getArray();
+  if (couplers.size() != qpi.couplers.size()) return false;
+  vector<int> pair(2);
+  for (auto i = 0u; i < couplers.size(); ++i) {
+    if (!couplers[i].isArray()) return false;
+    pair[0] = qpi.couplers[i].first;
+    pair[1] = qpi.couplers[i].second;
+    if (!sameIntegers(couplers[i].getArray(), pair)) return false;
+  }
+  return true;
+}
+
+void writeSolver(Writer& w, const SolverInfo& si) {
+  w.str(si.id);
+
+  if (si.qpInfo && tablesMatchProperties(*si.qpInfo, si.properties)) {
+    auto props = si.properties;
+    props.erase(propkeys::qubits);
+    props.erase(propkeys::couplers);
+    w.str(json::jsonToString(props));
+
+    const auto& qpi = *si.qpInfo;
+    w.u32(1);
+    w.u32(static_cast<uint32_t>(qpi.qubits.size()));
+    w.raw(qpi.qubits.data(), qpi.qubits.size());
+    w.u32(static_cast<uint32_t>(qpi.couplers.size()));
+    BOOST_FOREACH( const auto& c, qpi.couplers ) {
+      int32_t qs[2] = { c.first, c.second };
+      w.raw(qs, 2);
+    }
+
+  } else {
+    w.str(json::jsonToString(si.properties));
+    w.u32(0);
+  }
+}
+
+SolverInfo readSolver(Reader& r) {
+  SolverInfo si;
+  si.id = r.str();
+  auto props = json::stringToJson(r.str());
+  si.properties = std::move(props.getObject());
+
+  if (r.u32() != 0) {
+    auto qpi = make_shared<QpSolverInfo>();
+    qpi->qubits.resize(r.count(sizeof(int32_t)));
+    r.raw(qpi->qubits.data(), qpi->qubits.size());
+    auto numQubits = qpi->qubits.size();
+    for (auto i = 0u; i < numQubits; ++i) qpi->qubitIndices[qpi->qubits[i]] = i;
+
+    auto numCouplers = r.count(2 * sizeof(int32_t));
+    qpi->couplers.reserve(numCouplers);
+    for (auto i = 0u; i < numCouplers; ++i) {
+      int32_t qs[2];
+      r.raw(qs, 2);
+      qpi->couplers.push_back(make_pair(qs[0], qs[1]));
+    }
+
+    si.properties[propkeys::qubits] = qubitsJson(*qpi);
+    si.properties[propkeys::couplers] = couplersJson(*qpi);
+    si.qpInfo = qpi;
+  }
+  return si;
+}
+
+} // namespace {anonymous}
+
+namespace sapiremote {
+
+SolverCache::SolverCache(string dir, const string& token) :
+    dir_(std::move(dir)),
+    tokenHash_(hexHash(token)) {}
+
+string SolverCache::path(const string& url) const {
+  auto p = dir_;
+  if (p.back() != '/' && p.back() != '\\') p += '/';
+  return p + "solvers-" + hexHash(tokenHash_ + url) + ".cache";
+}
+
+unique_ptr<CachedSolverList> SolverCache::load(const string& url) const {
+  if (!enabled()) return unique_ptr<CachedSolverList>();
+
+  try {
+    string buffer;
+    if (!readFile(path(url), buffer)) return unique_ptr<CachedSolverList>();
+
+    auto header = binaryFileHeader(magic);
+    if (buffer.compare(0, header.size(), header) != 0) throw BadCacheFile();
+    Reader r(buffer);
+    r.skip(header.size());
+    if (r.str() != url || r.str() != tokenHash_) throw BadCacheFile(); // hash collision
+
+    auto list = unique_ptr<CachedSolverList>(new CachedSolverList);
+    list->etag = r.str();
+    auto numSolvers = r.u32();
+    for (auto i = 0u; i < numSolvers; ++i) list->solvers.push_back(readSolver(r));
+    if (!r.atEnd()) throw BadCacheFile();
+    return list;
+
+  } catch (BadCacheFile&) {
+  } catch (std::exception&) {
+  }
+  return unique_ptr<CachedSolverList>();
+}
+
+void SolverCache::store(const string& url, const CachedSolverList& list) const {
+  if (!enabled()) return;
+
+  try {
+    auto buffer = binaryFileHeader(magic);
+    Writer w(buffer);
+    w.str(url);
+    w.str(tokenHash_);
+    w.str(list.etag);
+    w.u32(static_cast<uint32_t>(list.solvers.size()));
+    BOOST_FOREACH( const auto& si, list.solvers ) writeSolver(w, si);
+
+    // private temporary file: other processes may be storing the same list
+    auto target = path(url);
+    auto tmp = target + ".tmp" + std::to_string(static_cast<unsigned long long>(std::random_device()()));
+    replaceFile(target, tmp, buffer, false);
+
+  } catch (std::exception&) {
+  }
+}
+
+} // namespace sapiremote
@@ -1,10 +1,15 @@
 //Copyright © 2019 D-Wave Systems Inc.
 //The software is licensed to authorized users only under the applicable license agreement.  See License.txt.
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <cstddef>
+#include <deque>
 #include <functional>
+#include <memory>
 #include <mutex>
-#include <queue>
 #include <stdexcept>
 #include <thread>
 #include <vector>
@@ -14,19 +19,30 @@
 #include <threadpool.hpp>
 #include <exceptions.hpp>
 
+using std::atomic;
 using std::bind;
+using std::deque;
 using std::function;
 using std::thread;
 using std::mutex;
 using std::condition_variable;
 using std::vector;
-using std::queue;
+using std::lock_guard;
 using std::unique_lock;
+using std::unique_ptr;
 using std::invalid_argument;
 using std::make_shared;
+using std::max;
+using std::memory_order_relaxed;
+using std::chrono::duration_cast;
+using std::chrono::nanoseconds;
+using std::chrono::steady_clock;
 
+using sapiremote::LatencyHistogram;
 using sapiremote::ServiceShutdownException;
+using sapiremote::Task;
 using sapiremote::ThreadPool;
+using sapiremote::ThreadPoolStats;
 
 namespace {
 
@@ -42,53 +58,186 @@ public:
   ~AutoJoinThread() { if (t_.joinable()) t_.join(); }
 };
 
+// reading the clock costs about as much as queueing a task, so only every latencySampleInterval-th task
+// is timed
+const unsigned int latencySampleInterval = 16;
+
+struct QueuedTask {
+  Task task;
+  bool timed;
+  steady_clock::time_point posted; // if timed
+
+  QueuedTask() : timed(false) {}
+  QueuedTask(Task& task, bool timed) :
+      task(std::move(task)), timed(timed), posted(timed ? steady_clock::now() : steady_clock::time_point()) {}
+  QueuedTask(QueuedTask&& other) : task(std::move(other.task)), timed(other.timed), posted(other.posted) {}
+  QueuedTask& operator=(QueuedTask&& other) {
+    task = std::move(other.task);
+    timed = other.timed;
+    posted = other.posted;
+    return *this;
+  }
+};
+
+// Statistics are only written by the worker's own thread, so plain loads and stores are enough (no
+// read-modify-write); stats() may see counters from slightly different moments.
+struct Worker : boost::noncopyable {
+  mutex queueMutex;
+  deque<QueuedTask> queue;
+
+  atomic<unsigned long long> tasksRun;
+  atomic<unsigned long long> steals;
+  atomic<unsigned long long> latencyBuckets[LatencyHistogram::numBuckets];
+  atomic<unsigned long long> latencyTotalNs;
+  atomic<unsigned long long> latencyMaxNs;
+
+  Worker() : tasksRun(0), steals(0), latencyTotalNs(0), latencyMaxNs(0) {
+    for (auto i = 0; i < LatencyHistogram::numBuckets; ++i) latencyBuckets[i].store(0, memory_order_relaxed);
+  }
+
+  static void increment(atomic<unsigned long long>& x, unsigned long long d = 1) {
+    x.store(x.load(memory_order_relaxed) + d, memory_order_relaxed);
+  }
+
+  void record(const QueuedTask& qt, bool stolen) {
+    increment(tasksRun);
+    if (stolen) increment(steals);
+    if (!qt.timed) return;
+
+    auto latency = duration_cast<nanoseconds>(steady_clock::now() - qt.posted);
+    auto ns = static_cast<unsigned long long>(latency.count());
+    auto bucket = 0;
+    for (auto limit = 1000000ull; bucket < LatencyHistogram::numBuckets - 1 && ns >= limit; limit *= 2) {
+      ++bucket;
+    }
+    increment(latencyBuckets[bucket]);
+    increment(latencyTotalNs, ns);
+    if (ns > latencyMaxNs.load(memory_order_relaxed)) latencyMaxNs.store(ns, memory_order_relaxed);
+  }
+};
+
+// Each worker has its own queue; posts are spread over the queues round-robin so producers rarely contend
+// for the same lock, and idle workers steal from the others' queues.  Every queue is FIFO, so a pool with
+// a single thread runs tasks in the order they were posted.  On a single core this is slower than one
+// shared queue (nothing contends, and posts pay for the extra bookkeeping); extras/threadpool-speed
+// compares the two.
 class ThreadPoolImpl : public ThreadPool {
 private:
-  queue<function<void()>> workQueue_;
-  vector<AutoJoinThread> threads_;
-  mutex mutex_;
-  condition_variable cv_;
-  bool running_;
-
-  void threadFn() {
-    for (;;) {
-      unique_lock<mutex> lock(mutex_);
-      while (running_  && workQueue_.empty()) cv_.wait(lock);
-      if (!running_) break;
-
-      auto work = workQueue_.front();
-      workQueue_.pop();
-      lock.unlock();
+  vector<unique_ptr<Worker>> workers_;
+  atomic<unsigned int> nextWorker_;
+  atomic<std::size_t> pending_; // tasks posted and not yet taken
+  atomic<int> idle_;
+  atomic<bool> running_;
+  mutex sleepMutex_;
+  condition_variable sleepCv_;
+  vector<AutoJoinThread> threads_; // after workers_ so threads are joined first
+
+  bool take(std::size_t self, QueuedTask& qt, bool& stolen) {
+    auto n = workers_.size();
+    for (std::size_t k = 0; k < n; ++k) {
+      auto& w = *workers_[(self + k) % n];
+      lock_guard<mutex> lock(w.queueMutex);
+      if (!w.queue.empty()) {
+        qt = std::move(w.queue.front());
+        w.queue.pop_front();
+        --pending_;
+        stolen = k > 0;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void threadFn(std::size_t self) {
+    auto& me = *workers_[self];
+    QueuedTask qt;
+    while (running_) {
+      auto stolen = false;
+      if (!take(self, qt, stolen)) {
+        unique_lock<mutex> lock(sleepMutex_);
+        ++idle_;
+        while (running_ && pending_ == 0) sleepCv_.wait(lock);
+        --idle_;
+        continue;
+      }
+
+      me.record(qt, stolen);
 
       try {
-        work();
+        qt.task();
       } catch (...) {
         // eat exceptions
       }
+      qt.task = Task(); // release captured state now rather than at the next task
     }
   }
 
   virtual void shutdownImpl() {
-    unique_lock<mutex> lock(mutex_);
-    running_ = false;
-    cv_.notify_all();
-    lock.unlock();
+    {
+      // posts check running_ under their queue's lock, so none can be queued once this is done
+      vector<unique_lock<mutex>> queueLocks;
+      for (std::size_t i = 0; i < workers_.size(); ++i) queueLocks.emplace_back(workers_[i]->queueMutex);
+      running_ = false;
+    }
+    {
+      lock_guard<mutex> lock(sleepMutex_);
+      sleepCv_.notify_all();
+    }
     threads_.clear();
   }
 
-  virtual void postImpl(function<void()> f) {
-    unique_lock<mutex> lock(mutex_);
-    if (!running_) throw ServiceShutdownException();
-    workQueue_.push(std::move(f));
-    cv_.notify_one();
+  virtual void postImpl(Task& task) {
+    auto ticket = nextWorker_++;
+    auto& w = *workers_[ticket % workers_.size()];
+    auto timed = ticket % latencySampleInterval == 0;
+
+    // pending_ changes under the queue lock, so it never counts tasks that aren't there (workers would spin)
+    // or goes negative.  idle_ is checked after: either the poster sees a sleeping worker or the worker sees
+    // the task, since both counters are sequentially consistent.
+    {
+      lock_guard<mutex> lock(w.queueMutex);
+      if (!running_) throw ServiceShutdownException();
+      w.queue.emplace_back(task, timed);
+      ++pending_;
+    }
+    if (idle_ > 0) {
+      lock_guard<mutex> lock(sleepMutex_);
+      sleepCv_.notify_one();
+    }
+  }
+
+  virtual ThreadPoolStats statsImpl() const {
+    ThreadPoolStats stats;
+    stats.queueDepth = pending_;
+    stats.tasksRun = 0;
+    stats.steals = 0;
+    stats.taskLatency = LatencyHistogram();
+    auto& latency = stats.taskLatency;
+    unsigned long long maxNs = 0;
+    for (std::size_t i = 0; i < workers_.size(); ++i) {
+      const auto& w = *workers_[i];
+      stats.tasksRun += w.tasksRun.load(memory_order_relaxed);
+      stats.steals += w.steals.load(memory_order_relaxed);
+      for (auto b = 0; b < LatencyHistogram::numBuckets; ++b) {
+        auto n = w.latencyBuckets[b].load(memory_order_relaxed);
+        latency.buckets[b] += n;
+        latency.samples += n;
+      }
+      latency.totalS += 1e-9 * w.latencyTotalNs.load(memory_order_relaxed);
+      maxNs = max(maxNs, w.latencyMaxNs.load(memory_order_relaxed));
+    }
+    latency.maxS = 1e-9 * maxNs;
+    return stats;
   }
 
 public:
-  ThreadPoolImpl(int threads) : running_(true) {
+  ThreadPoolImpl(int threads) : nextWorker_(0), pending_(0), idle_(0), running_(true) {
     if (threads < 1) throw std::invalid_argument("Number of threads must be positive");
+    workers_.reserve(threads);
+    for (auto i = 0; i < threads; ++i) workers_.push_back(unique_ptr<Worker>(new Worker));
     threads_.reserve(threads);
     for (auto i = 0; i < threads; ++i) {
-      threads_.push_back(AutoJoinThread(bind(&ThreadPoolImpl::threadFn, this)));
+      threads_.push_back(AutoJoinThread(bind(&ThreadPoolImpl::threadFn, this, static_cast<std::size_t>(i))));
     }
   }
 
@@ -0,0 +1,91 @@
+//Copyright © 2019 D-Wave Systems Inc.
+//The software is licensed to authorized users only under the applicable license agreement.  See License.txt.
+
+#include <memory>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include <answer-cache.hpp>
+#include <json.hpp>
+
+#include "json-builder.hpp"
+
+using std::make_shared;
+using std::string;
+
+using sapiremote::AnswerCache;
+using sapiremote::CachedAnswer;
+using sapiremote::CachedAnswerPtr;
+using sapiremote::approximateSize;
+
+namespace {
+
+auto o = jsonObject();
+auto a = jsonArray();
+
+CachedAnswerPtr makeAnswer(int n) {
+  auto answer = make_shared<CachedAnswer>();
+  answer->type = "ising";
+  answer->answer = json::Array(n, json::Value(1.5));
+  return answer;
+}
+
+} // namespace {anonymous}
+
+TEST(AnswerCacheTest, approximateSizeGrows) {
+  auto small = approximateSize((a, 1, 2).value());
+  auto large = approximateSize((a, 1, 2, 3, 4, 5, 6, 7, 8).value());
+  EXPECT_LT(small, large);
+  EXPECT_GT(approximateSize((o, "key", string(1000, 'x')).value()), 1000u);
+}
+
+TEST(AnswerCacheTest, findInsert) {
+  AnswerCache cache(1 << 20);
+  EXPECT_TRUE(cache.enabled());
+  EXPECT_FALSE(!!cache.find("a"));
+
+  auto answer = makeAnswer(10);
+  cache.insert("a", answer);
+  EXPECT_EQ(answer, cache.find("a"));
+  EXPECT_FALSE(!!cache.find("b"));
+
+  auto stats = cache.stats();
+  EXPECT_EQ(1u, stats.hits);
+  EXPECT_EQ(2u, stats.misses);
+  EXPECT_EQ(1u, stats.entries);
+  EXPECT_EQ(0u, stats.evictions);
+}
+
+TEST(AnswerCacheTest, evictsLeastRecentlyUsed) {
+  auto answerBytes = approximateSize(makeAnswer(100)->answer);
+  AnswerCache cache(answerBytes * 3);
+
+  cache.insert("a", makeAnswer(100));
+  cache.insert("b", makeAnswer(100));
+  EXPECT_TRUE(!!cache.find("a")); // b is now least recently used
+  cache.insert("c", makeAnswer(100));
+
+  EXPECT_TRUE(!!cache.find("a"));
+  EXPECT_FALSE(!!cache.find("b"));
+  EXPECT_TRUE(!!cache.find("c"));
+
+  auto stats = cache.stats();
+  EXPECT_EQ(1u, stats.evictions);
+  EXPECT_EQ(2u, stats.entries);
+  EXPECT_LE(stats.bytes, answerBytes * 3);
+}
+
+TEST(AnswerCacheTest, tooLarge) {
+  AnswerCache cache(100);
+  cache.insert("a", makeAnswer(1000));
+  EXPECT_FALSE(!!cache.find("a"));
+  EXPECT_EQ(0u, cache.stats().entries);
+}
+
+TEST(AnswerCacheTest, disabled) {
+  AnswerCache cache(0);
+  EXPECT_FALSE(cache.enabled());
+  cache.insert("a", makeAnswer(1));
+  EXPECT_FALSE(!!cache.find("a"));
+}
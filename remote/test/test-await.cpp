@@ -196,3 +196,36 @@ TEST(AwaitTest, SC90) {
   auto end = now();
   EXPECT_GE(end - start, 0.1);
 }
+
+
+
+TEST(AwaitTest, completionIndices) {
+  DelayedNotifier delayedNotifer(0.05);
+  vector<SubmittedProblemPtr> problems;
+  for (auto i = 0; i < 6; ++i) {
+    auto mp = make_shared<StrictMock<MockSubmittedProblem>>();
+    problems.push_back(mp);
+    switch (i) {
+      case 1: EXPECT_CALL(*mp, addSubmittedProblemObserverImpl(_)).WillOnce(Invoke(delayedNotifer)); break;
+      case 3: EXPECT_CALL(*mp, addSubmittedProblemObserverImpl(_)).WillOnce(Invoke(NotifyError)); break;
+      case 4: EXPECT_CALL(*mp, addSubmittedProblemObserverImpl(_)).WillOnce(Invoke(NotifyDone)); break;
+      default: EXPECT_CALL(*mp, addSubmittedProblemObserverImpl(_)).Times(1); break;
+    }
+  }
+
+  vector<size_t> doneIndices(1, 99);
+  EXPECT_TRUE(awaitCompletion(problems, 3, 2.0, doneIndices));
+  auto expected = vector<size_t>{99, 3, 4, 1};
+  EXPECT_EQ(expected, doneIndices);
+
+  // timeout still reports what finished
+  doneIndices.clear();
+  auto mp = make_shared<StrictMock<MockSubmittedProblem>>();
+  EXPECT_CALL(*mp, addSubmittedProblemObserverImpl(_)).WillOnce(Invoke(NotifyDone));
+  problems.assign(1, mp);
+  mp = make_shared<StrictMock<MockSubmittedProblem>>();
+  EXPECT_CALL(*mp, addSubmittedProblemObserverImpl(_)).Times(1);
+  problems.push_back(mp);
+  EXPECT_FALSE(awaitCompletion(problems, 2, 0.01, doneIndices));
+  EXPECT_EQ(vector<size_t>(1, 0), doneIndices);
+}
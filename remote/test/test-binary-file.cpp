@@ -0,0 +1,71 @@
+//Copyright © 2019 D-Wave Systems Inc.
+//The software is licensed to authorized users only under the applicable license agreement.  See License.txt.
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include <binary-file.hpp>
+
+using std::ifstream;
+using std::string;
+
+using sapiremote::binaryFileHeader;
+using sapiremote::fnv1a32;
+using sapiremote::fnv1a64;
+using sapiremote::readFile;
+using sapiremote::replaceFile;
+
+namespace {
+
+string tempPath(const string& name) {
+  auto path = testing::TempDir() + "binary-file-" + name;
+  std::remove(path.c_str());
+  return path;
+}
+
+bool exists(const string& path) {
+  return !!ifstream(path);
+}
+
+} // namespace {anonymous}
+
+TEST(BinaryFileTest, fnv1a) {
+  EXPECT_EQ(0x811c9dc5u, fnv1a32("", 0));
+  EXPECT_EQ(0xe40c292cu, fnv1a32("a", 1));
+  EXPECT_EQ(0xcbf29ce484222325ull, fnv1a64("", 0));
+  EXPECT_EQ(0xaf63dc4c8601ec8cull, fnv1a64("a", 1));
+}
+
+TEST(BinaryFileTest, header) {
+  auto header = binaryFileHeader("MAGIC123");
+  EXPECT_EQ(12u, header.size());
+  EXPECT_EQ(0, header.compare(0, 8, "MAGIC123"));
+  EXPECT_NE(binaryFileHeader("MAGIC124"), header);
+}
+
+TEST(BinaryFileTest, replace) {
+  auto path = tempPath("replace");
+  auto tmp = path + ".tmp";
+  string contents;
+  EXPECT_FALSE(readFile(path, contents));
+
+  ASSERT_TRUE(replaceFile(path, tmp, string("first\0file", 10), false));
+  ASSERT_TRUE(readFile(path, contents));
+  EXPECT_EQ(string("first\0file", 10), contents);
+
+  ASSERT_TRUE(replaceFile(path, tmp, "second", true));
+  contents.clear();
+  ASSERT_TRUE(readFile(path, contents));
+  EXPECT_EQ("second", contents);
+  EXPECT_FALSE(exists(tmp));
+}
+
+TEST(BinaryFileTest, replaceFailure) {
+  auto path = tempPath("replaceFailure");
+  auto tmp = testing::TempDir() + "no-such-binary-file-dir/tmp";
+  EXPECT_FALSE(replaceFile(path, tmp, "contents", true));
+  EXPECT_FALSE(exists(path));
+}
@@ -0,0 +1,242 @@
+//Copyright © 2019 D-Wave Systems Inc.
+//The software is licensed to authorized users only under the applicable license agreement.  See License.txt.
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#ifndef _WIN32
+#include <poll.h>
+#endif
+
+#include <gtest/gtest.h>
+
+#include <completion-queue.hpp>
+#include <problem.hpp>
+
+using std::lock_guard;
+using std::make_shared;
+using std::mutex;
+using std::shared_ptr;
+using std::string;
+using std::thread;
+using std::tuple;
+using std::vector;
+using std::weak_ptr;
+using std::chrono::duration;
+using std::chrono::milliseconds;
+using std::chrono::steady_clock;
+
+using sapiremote::AnswerCallbackPtr;
+using sapiremote::SubmittedProblem;
+using sapiremote::SubmittedProblemInfo;
+using sapiremote::SubmittedProblemObserverPtr;
+using sapiremote::SubmittedProblemPtr;
+using sapiremote::makeCompletionQueue;
+
+namespace {
+
+class FakeSubmittedProblem : public SubmittedProblem {
+private:
+  mutex mutex_;
+  bool done_;
+  vector<weak_ptr<sapiremote::SubmittedProblemObserver>> observers_; // weak, like the real thing
+
+  virtual string problemIdImpl() const { return string(); }
+  virtual bool doneImpl() const { return false; }
+  virtual SubmittedProblemInfo statusImpl() const { return SubmittedProblemInfo(); }
+  virtual tuple<string, json::Value> answerImpl() const { return tuple<string, json::Value>(); }
+  virtual void answerImpl(AnswerCallbackPtr) const {}
+  virtual void cancelImpl() {}
+  virtual void retryImpl() {}
+
+  virtual void addSubmittedProblemObserverImpl(const SubmittedProblemObserverPtr& observer) {
+    bool done;
+    {
+      lock_guard<mutex> lock(mutex_);
+      observers_.push_back(observer);
+      done = done_;
+    }
+    if (done) observer->notifyDone();
+  }
+
+  // caller must hold mutex_
+  vector<SubmittedProblemObserverPtr> liveObservers() {
+    vector<SubmittedProblemObserverPtr> live;
+    for (auto i = 0u; i < observers_.size(); ++i) {
+      auto o = observers_[i].lock();
+      if (o) live.push_back(o);
+    }
+    return live;
+  }
+
+public:
+  FakeSubmittedProblem() : done_(false) {}
+
+  size_t numObservers() {
+    lock_guard<mutex> lock(mutex_);
+    return liveObservers().size();
+  }
+
+  void finish(bool error = false) {
+    vector<SubmittedProblemObserverPtr> observers;
+    {
+      lock_guard<mutex> lock(mutex_);
+      done_ = true;
+      observers = liveObservers();
+    }
+    for (auto i = 0u; i < observers.size(); ++i) {
+      if (error) {
+        observers[i]->notifyError();
+      } else {
+        observers[i]->notifyDone();
+      }
+    }
+  }
+};
+typedef shared_ptr<FakeSubmittedProblem> FakeSubmittedProblemPtr;
+
+#ifndef _WIN32
+bool readable(int fd) {
+  pollfd pfd = {fd, POLLIN, 0};
+  return poll(&pfd, 1, 0) == 1 && (pfd.revents & POLLIN);
+}
+#endif
+
+} // namespace {anonymous}
+
+TEST(CompletionQueueTest, completionOrder) {
+  auto queue = makeCompletionQueue();
+  auto p0 = make_shared<FakeSubmittedProblem>();
+  auto p1 = make_shared<FakeSubmittedProblem>();
+  auto p2 = make_shared<FakeSubmittedProblem>();
+  queue->add(p0);
+  queue->add(p1);
+  queue->add(p2);
+  EXPECT_EQ(3u, queue->size());
+
+  vector<SubmittedProblemPtr> popped;
+  EXPECT_EQ(0u, queue->pop(popped, 10, 0.0));
+
+  p2->finish();
+  p0->finish(true);
+  EXPECT_EQ(2u, queue->pop(popped, 10, 0.0));
+  ASSERT_EQ(2u, popped.size());
+  EXPECT_EQ(p2, popped[0]);
+  EXPECT_EQ(p0, popped[1]);
+  EXPECT_EQ(1u, queue->size());
+
+  // popped problems aren't handed back again
+  p0->finish();
+  p1->finish();
+  p1->finish();
+  popped.clear();
+  EXPECT_EQ(1u, queue->pop(popped, 1, 0.0));
+  EXPECT_EQ(0u, queue->pop(popped, 1, 0.0));
+  ASSERT_EQ(1u, popped.size());
+  EXPECT_EQ(p1, popped[0]);
+  EXPECT_EQ(0u, queue->size());
+}
+
+TEST(CompletionQueueTest, maxProblems) {
+  auto queue = makeCompletionQueue();
+  vector<FakeSubmittedProblemPtr> problems;
+  for (auto i = 0; i < 5; ++i) {
+    problems.push_back(make_shared<FakeSubmittedProblem>());
+    queue->add(problems.back());
+    problems.back()->finish();
+  }
+
+  vector<SubmittedProblemPtr> popped;
+  EXPECT_EQ(0u, queue->pop(popped, 0, 0.0));
+  EXPECT_EQ(3u, queue->pop(popped, 3, 0.0));
+  EXPECT_EQ(2u, queue->pop(popped, 3, 0.0));
+  ASSERT_EQ(5u, popped.size());
+  for (auto i = 0; i < 5; ++i) EXPECT_EQ(problems[i], popped[i]);
+}
+
+TEST(CompletionQueueTest, addTwice) {
+  auto queue = makeCompletionQueue();
+  auto p = make_shared<FakeSubmittedProblem>();
+  queue->add(p);
+  queue->add(p);
+  EXPECT_EQ(1u, p->numObservers());
+  p->finish();
+  queue->add(p); // finished but not popped yet
+
+  vector<SubmittedProblemPtr> popped;
+  EXPECT_EQ(1u, queue->pop(popped, 10, 0.0));
+
+  // attaching again after popping works, e.g. after a retry
+  queue->add(p);
+  EXPECT_EQ(1u, queue->pop(popped, 10, 0.0));
+}
+
+TEST(CompletionQueueTest, keepsProblemsAlive) {
+  auto queue = makeCompletionQueue();
+  auto p = make_shared<FakeSubmittedProblem>();
+  weak_ptr<FakeSubmittedProblem> wp = p;
+  queue->add(p);
+  auto raw = p.get();
+  p.reset();
+  ASSERT_FALSE(wp.expired());
+
+  raw->finish();
+  vector<SubmittedProblemPtr> popped;
+  EXPECT_EQ(1u, queue->pop(popped, 10, 0.0));
+  popped.clear();
+  EXPECT_TRUE(wp.expired());
+
+  // nor does the queue stay alive through its problems
+  auto q = make_shared<FakeSubmittedProblem>();
+  weak_ptr<sapiremote::CompletionQueue> wq = queue;
+  queue->add(q);
+  queue.reset();
+  EXPECT_TRUE(wq.expired());
+  q->finish();
+}
+
+TEST(CompletionQueueTest, wait) {
+  auto queue = makeCompletionQueue();
+  auto p = make_shared<FakeSubmittedProblem>();
+  queue->add(p);
+
+  vector<SubmittedProblemPtr> popped;
+  auto t0 = steady_clock::now();
+  EXPECT_EQ(0u, queue->pop(popped, 10, 0.05));
+  EXPECT_GE(duration<double>(steady_clock::now() - t0).count(), 0.04);
+
+  thread finisher([p] {
+    std::this_thread::sleep_for(milliseconds(20));
+    p->finish();
+  });
+  EXPECT_EQ(1u, queue->pop(popped, 10, 1e9));
+  finisher.join();
+}
+
+#ifndef _WIN32
+TEST(CompletionQueueTest, notificationFd) {
+  auto queue = makeCompletionQueue();
+  auto fd = queue->notificationFd();
+  ASSERT_GE(fd, 0);
+  EXPECT_FALSE(readable(fd));
+
+  auto p0 = make_shared<FakeSubmittedProblem>();
+  auto p1 = make_shared<FakeSubmittedProblem>();
+  queue->add(p0);
+  queue->add(p1);
+  p0->finish();
+  p1->finish();
+  EXPECT_TRUE(readable(fd));
+
+  vector<SubmittedProblemPtr> popped;
+  queue->pop(popped, 1, 0.0);
+  EXPECT_TRUE(readable(fd));
+  queue->pop(popped, 1, 0.0);
+  EXPECT_FALSE(readable(fd));
+}
+#endif
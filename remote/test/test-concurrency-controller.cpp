@@ -0,0 +1,143 @@
+//Copyright © 2019 D-Wave Systems Inc.
+//The software is licensed to authorized users only under the applicable license agreement.  See License.txt.
+
+#include <cstddef>
+
+#include <gtest/gtest.h>
+
+#include <concurrency-controller.hpp>
+
+using sapiremote::ConcurrencyController;
+
+namespace concurrencyknobs = sapiremote::concurrencyknobs;
+namespace concurrencyreasons = sapiremote::concurrencyreasons;
+namespace requestclasses = sapiremote::requestclasses;
+
+TEST(ConcurrencyControllerTest, additiveIncrease) {
+  const int values[] = {2, 10, 100};
+  const int floors[] = {1, 1, 1};
+  const int ceilings[] = {4, 12, 0};
+  ConcurrencyController controller(values, floors, ceilings);
+
+  // one window is as many responses as there are request slots
+  controller.responseOk(requestclasses::STATUS, 0.01);
+  EXPECT_EQ(2, controller.limit(concurrencyknobs::ACTIVE_REQUESTS));
+  controller.responseOk(requestclasses::STATUS, 0.01);
+  EXPECT_EQ(3, controller.limit(concurrencyknobs::ACTIVE_REQUESTS));
+  for (auto i = 0; i < 20; ++i) controller.responseOk(requestclasses::STATUS, 0.01);
+  EXPECT_EQ(4, controller.limit(concurrencyknobs::ACTIVE_REQUESTS));
+  EXPECT_EQ(100, controller.limit(concurrencyknobs::IDS_PER_STATUS_QUERY));
+  EXPECT_EQ(10, controller.limit(concurrencyknobs::PROBLEMS_PER_SUBMISSION));
+
+  for (auto i = 0; i < 20; ++i) controller.responseOk(requestclasses::SUBMIT, 0.01);
+  EXPECT_EQ(12, controller.limit(concurrencyknobs::PROBLEMS_PER_SUBMISSION));
+
+  auto stats = controller.stats();
+  EXPECT_EQ(4u, stats.increases);
+  EXPECT_EQ(0u, stats.decreases);
+  ASSERT_EQ(4u, stats.recentDecisions.size());
+  EXPECT_EQ(concurrencyknobs::ACTIVE_REQUESTS, stats.recentDecisions[0].knob);
+  EXPECT_EQ(concurrencyreasons::HEALTHY, stats.recentDecisions[0].reason);
+  EXPECT_EQ(3, stats.recentDecisions[0].value);
+  EXPECT_EQ(concurrencyknobs::PROBLEMS_PER_SUBMISSION, stats.recentDecisions[3].knob);
+  EXPECT_EQ(12, stats.recentDecisions[3].value);
+  EXPECT_LE(stats.recentDecisions[0].timeS, stats.recentDecisions[3].timeS);
+}
+
+TEST(ConcurrencyControllerTest, multiplicativeDecrease) {
+  const int values[] = {10, 20, 100};
+  const int floors[] = {2, 1, 1};
+  const int ceilings[] = {20, 40, 200};
+  ConcurrencyController controller(values, floors, ceilings);
+
+  controller.responseFailed(requestclasses::SUBMIT);
+  EXPECT_EQ(7, controller.limit(concurrencyknobs::ACTIVE_REQUESTS));
+  EXPECT_EQ(14, controller.limit(concurrencyknobs::PROBLEMS_PER_SUBMISSION));
+  EXPECT_EQ(100, controller.limit(concurrencyknobs::IDS_PER_STATUS_QUERY));
+
+  // responses to requests sent before the cut don't cut again
+  controller.responseFailed(requestclasses::SUBMIT);
+  EXPECT_EQ(7, controller.limit(concurrencyknobs::ACTIVE_REQUESTS));
+  EXPECT_EQ(14, controller.limit(concurrencyknobs::PROBLEMS_PER_SUBMISSION));
+
+  for (auto i = 0; i < 200; ++i) controller.responseFailed(requestclasses::SUBMIT);
+  EXPECT_EQ(2, controller.limit(concurrencyknobs::ACTIVE_REQUESTS));
+  EXPECT_EQ(1, controller.limit(concurrencyknobs::PROBLEMS_PER_SUBMISSION));
+
+  auto stats = controller.stats();
+  EXPECT_EQ(0u, stats.increases);
+  ASSERT_FALSE(stats.recentDecisions.empty());
+  EXPECT_EQ(concurrencyreasons::FAILURE, stats.recentDecisions.back().reason);
+}
+
+TEST(ConcurrencyControllerTest, latencySpike) {
+  const int values[] = {10, 20, 100};
+  const int floors[] = {1, 1, 1};
+  const int ceilings[] = {20, 40, 200};
+  ConcurrencyController controller(values, floors, ceilings);
+
+  for (auto i = 0; i < 5; ++i) controller.responseOk(requestclasses::STATUS, 0.1);
+  controller.responseOk(requestclasses::STATUS, 0.3);
+  controller.responseOk(requestclasses::SUBMIT, 1.0); // no baseline for submissions yet
+  controller.responseOk(requestclasses::STATUS, -1.0); // no sample
+  EXPECT_EQ(10, controller.limit(concurrencyknobs::ACTIVE_REQUESTS));
+  EXPECT_EQ(100, controller.limit(concurrencyknobs::IDS_PER_STATUS_QUERY));
+
+  controller.responseOk(requestclasses::STATUS, 1.0);
+  EXPECT_EQ(7, controller.limit(concurrencyknobs::ACTIVE_REQUESTS));
+  EXPECT_EQ(70, controller.limit(concurrencyknobs::IDS_PER_STATUS_QUERY));
+  EXPECT_EQ(20, controller.limit(concurrencyknobs::PROBLEMS_PER_SUBMISSION));
+
+  auto stats = controller.stats();
+  EXPECT_EQ(2u, stats.decreases);
+  ASSERT_EQ(2u, stats.recentDecisions.size());
+  EXPECT_EQ(concurrencyreasons::LATENCY, stats.recentDecisions[1].reason);
+  EXPECT_EQ(concurrencyknobs::IDS_PER_STATUS_QUERY, stats.recentDecisions[1].knob);
+}
+
+TEST(ConcurrencyControllerTest, fixed) {
+  const int values[] = {6, 20, 100};
+  ConcurrencyController controller(values, values, values);
+
+  for (auto i = 0; i < 100; ++i) controller.responseFailed(requestclasses::STATUS);
+  for (auto i = 0; i < 100; ++i) controller.responseOk(requestclasses::SUBMIT, 0.01);
+  EXPECT_EQ(6, controller.limit(concurrencyknobs::ACTIVE_REQUESTS));
+  EXPECT_EQ(20, controller.limit(concurrencyknobs::PROBLEMS_PER_SUBMISSION));
+  EXPECT_EQ(100, controller.limit(concurrencyknobs::IDS_PER_STATUS_QUERY));
+  EXPECT_TRUE(controller.stats().recentDecisions.empty());
+}
+
+TEST(ConcurrencyControllerTest, tooManyIds) {
+  const int values[] = {1, 20, 100};
+  const int floors[] = {1, 1, 1};
+  const int ceilings[] = {1, 20, 200};
+  ConcurrencyController controller(values, floors, ceilings);
+
+  EXPECT_TRUE(controller.tooManyIds());
+  EXPECT_EQ(70, controller.limit(concurrencyknobs::IDS_PER_STATUS_QUERY));
+
+  // the server's limit caps growth from now on
+  for (auto i = 0; i < 100; ++i) controller.responseOk(requestclasses::STATUS, 0.01);
+  EXPECT_EQ(70, controller.limit(concurrencyknobs::IDS_PER_STATUS_QUERY));
+
+  while (controller.tooManyIds()) {}
+  EXPECT_EQ(1, controller.limit(concurrencyknobs::IDS_PER_STATUS_QUERY));
+  EXPECT_EQ(concurrencyreasons::TOO_MANY_IDS, controller.stats().recentDecisions.back().reason);
+}
+
+TEST(ConcurrencyControllerTest, recentDecisionsBounded) {
+  const int values[] = {1, 1, 1};
+  const int floors[] = {1, 1, 1};
+  const int ceilings[] = {1000, 1, 1};
+  ConcurrencyController controller(values, floors, ceilings);
+
+  // window grows with the limit: 1 + 2 + ... + 40 responses for 40 increases
+  for (auto i = 0; i < 820; ++i) controller.responseOk(requestclasses::CANCEL, -1.0);
+  auto stats = controller.stats();
+  EXPECT_EQ(41, stats.limits[concurrencyknobs::ACTIVE_REQUESTS]);
+  EXPECT_EQ(40u, stats.increases);
+  ASSERT_EQ(static_cast<std::size_t>(ConcurrencyController::maxRecentDecisions),
+      stats.recentDecisions.size());
+  EXPECT_EQ(41, stats.recentDecisions.back().value);
+  EXPECT_EQ(10, stats.recentDecisions.front().value);
+}
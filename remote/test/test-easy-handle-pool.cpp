@@ -0,0 +1,109 @@
+//Copyright © 2019 D-Wave Systems Inc.
+//The software is licensed to authorized users only under the applicable license agreement.  See License.txt.
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <curl/curl.h>
+
+#include <easy-handle-pool.hpp>
+#include <exceptions.hpp>
+#include <http-service.hpp>
+
+using std::make_shared;
+using std::vector;
+
+using sapiremote::ServiceShutdownException;
+using sapiremote::http::EasyHandlePool;
+using sapiremote::http::EasyHandlePtr;
+using sapiremote::http::HttpServiceStats;
+
+namespace {
+
+HttpServiceStats poolStats(EasyHandlePool& pool) {
+  HttpServiceStats s = HttpServiceStats();
+  pool.stats(s);
+  return s;
+}
+
+char* privateData(CURL* h) {
+  char* p = 0;
+  curl_easy_getinfo(h, CURLINFO_PRIVATE, &p);
+  return p;
+}
+
+} // namespace {anonymous}
+
+TEST(EasyHandlePoolTest, reuse) {
+  auto pool = make_shared<EasyHandlePool>();
+  auto h1 = pool->acquire();
+  ASSERT_TRUE(h1.get() != 0);
+  auto raw = h1.get();
+  h1.reset();
+
+  auto s = poolStats(*pool);
+  EXPECT_EQ(1u, s.handlePoolSize);
+  EXPECT_EQ(1u, s.idleHandles);
+  EXPECT_EQ(0u, s.handlePoolHits);
+  EXPECT_EQ(1u, s.handlePoolMisses);
+
+  auto h2 = pool->acquire();
+  EXPECT_EQ(raw, h2.get());
+  auto h3 = pool->acquire();
+  EXPECT_NE(raw, h3.get());
+
+  s = poolStats(*pool);
+  EXPECT_EQ(2u, s.handlePoolSize);
+  EXPECT_EQ(0u, s.idleHandles);
+  EXPECT_EQ(1u, s.handlePoolHits);
+  EXPECT_EQ(2u, s.handlePoolMisses);
+}
+
+TEST(EasyHandlePoolTest, resetOnRelease) {
+  auto pool = make_shared<EasyHandlePool>();
+  char data[] = "request state";
+  auto h = pool->acquire();
+  curl_easy_setopt(h.get(), CURLOPT_PRIVATE, data);
+  curl_easy_setopt(h.get(), CURLOPT_URL, "http://localhost/");
+  ASSERT_EQ(data, privateData(h.get()));
+  h.reset();
+
+  // options set for the previous request don't leak into the next one
+  h = pool->acquire();
+  EXPECT_TRUE(privateData(h.get()) == 0);
+  EXPECT_EQ(1u, poolStats(*pool).handlePoolHits);
+}
+
+TEST(EasyHandlePoolTest, maxIdleHandles) {
+  auto pool = make_shared<EasyHandlePool>();
+  vector<EasyHandlePtr> handles;
+  for (std::size_t i = 0; i < EasyHandlePool::maxIdleHandles + 3; ++i) handles.push_back(pool->acquire());
+  EXPECT_EQ(EasyHandlePool::maxIdleHandles + 3, poolStats(*pool).handlePoolSize);
+  handles.clear();
+
+  auto s = poolStats(*pool);
+  EXPECT_EQ(EasyHandlePool::maxIdleHandles, s.handlePoolSize);
+  EXPECT_EQ(EasyHandlePool::maxIdleHandles, s.idleHandles);
+}
+
+TEST(EasyHandlePoolTest, close) {
+  auto pool = make_shared<EasyHandlePool>();
+  auto h1 = pool->acquire();
+  auto h2 = pool->acquire();
+  h1.reset();
+  pool->close();
+
+  auto s = poolStats(*pool);
+  EXPECT_EQ(1u, s.handlePoolSize);
+  EXPECT_EQ(0u, s.idleHandles);
+  EXPECT_THROW(pool->acquire(), ServiceShutdownException);
+
+  // handles in use when the pool closed are destroyed when released, not pooled
+  h2.reset();
+  s = poolStats(*pool);
+  EXPECT_EQ(0u, s.handlePoolSize);
+  EXPECT_EQ(0u, s.idleHandles);
+}
@@ -0,0 +1,47 @@
+//Copyright © 2019 D-Wave Systems Inc.
+//The software is licensed to authorized users only under the applicable license agreement.  See License.txt.
+
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include <gzip.hpp>
+#include <exceptions.hpp>
+
+using std::string;
+
+using sapiremote::gzipCompress;
+using sapiremote::gzipDecompress;
+using sapiremote::DecodingException;
+
+TEST(GzipTest, empty) {
+  auto gz = gzipCompress("");
+  EXPECT_FALSE(gz.empty());
+  EXPECT_EQ("", gzipDecompress(gz));
+}
+
+TEST(GzipTest, header) {
+  auto gz = gzipCompress("hello");
+  ASSERT_GE(gz.size(), 2u);
+  EXPECT_EQ('\x1f', gz[0]);
+  EXPECT_EQ('\x8b', gz[1]);
+}
+
+TEST(GzipTest, roundTrip) {
+  string data;
+  for (auto i = 0; i < 100000; ++i) data.append(1, static_cast<char>((i * 7919) % 251));
+  data.append(200000, 'A');
+  auto gz = gzipCompress(data);
+  EXPECT_LT(gz.size(), data.size());
+  EXPECT_EQ(data, gzipDecompress(gz));
+}
+
+TEST(GzipTest, truncated) {
+  auto gz = gzipCompress(string(10000, 'x'));
+  gz.resize(gz.size() / 2);
+  EXPECT_THROW(gzipDecompress(gz), DecodingException);
+}
+
+TEST(GzipTest, corrupt) {
+  EXPECT_THROW(gzipDecompress("this is not gzip data"), DecodingException);
+}
@@ -300,9 +300,56 @@ TEST(JsonTest, Complex) {
   EXPECT_EQ(v1, v2);
 }
 
+TEST(JsonTest, AppendJson) {
+  auto v = json::stringToJson("{\"a\": [1, 2.5, \"x\\ty\"], \"b\": null, \"c\": \"\\u0001\\\"quoted\\\"\"}");
+  string s = "prefix ";
+  json::appendJson(s, v);
+  EXPECT_EQ("prefix " + json::jsonToString(v), s);
+
+  s.clear();
+  json::appendJson(s, v.getObject().at("a").getArray());
+  EXPECT_EQ("[1,2.5,\"x\\ty\"]", s);
+
+  s = "x";
+  json::appendJsonString(s, "plain \x01\"\\ run");
+  EXPECT_EQ("x\"plain \\u0001\\\"\\\\ run\"", s);
+}
+
 TEST(JsonTest, BadNumbers) {
   EXPECT_THROW(json::Value v(numeric_limits<double>::infinity()), json::ValueException);
   EXPECT_THROW(json::Value v(-numeric_limits<double>::infinity()), json::ValueException);
   EXPECT_THROW(json::Value v(numeric_limits<double>::quiet_NaN()), json::ValueException);
   EXPECT_THROW(json::Value v(numeric_limits<double>::signaling_NaN()), json::ValueException);
 }
+
+TEST(JsonTest, StreamParseSplits) {
+  string s = " {\"a\": [1, -2.5e3, true, false, null], \"b\\\"\\\\\": \"x\\u00e9\\ud834\\udd1e\", \"c\": {}} ";
+  json::Value expected = json::stringToJson(s);
+
+  for (auto split = size_t(0); split <= s.size(); ++split) {
+    json::StreamParser parser;
+    parser.feed(s.data(), split);
+    parser.feed(s.data() + split, s.size() - split);
+    EXPECT_EQ(expected, parser.finish()) << "split at " << split;
+  }
+
+  json::StreamParser parser;
+  for (auto i = size_t(0); i < s.size(); ++i) parser.feed(s.data() + i, 1);
+  EXPECT_EQ(expected, parser.finish());
+}
+
+TEST(JsonTest, StreamParseScalar) {
+  json::StreamParser parser;
+  parser.feed("12", 2);
+  parser.feed("34", 2);
+  EXPECT_EQ(json::Value(1234LL), parser.finish());
+}
+
+TEST(JsonTest, StreamParseErrors) {
+  json::StreamParser truncated;
+  truncated.feed("[1, 2", 5);
+  EXPECT_THROW(truncated.finish(), json::ParseException);
+
+  json::StreamParser bad;
+  EXPECT_THROW(bad.feed("[1, x, 2]", 9), json::ParseException);
+}
@@ -0,0 +1,376 @@
+//Copyright © 2019 D-Wave Systems Inc.
+//The software is licensed to authorized users only under the applicable license agreement.  See License.txt.
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/algorithm/string/split.hpp>
+#include <boost/algorithm/string/classification.hpp>
+#include <boost/foreach.hpp>
+
+#include <gtest/gtest.h>
+
+#include <http-service.hpp>
+#include <sapi-service.hpp>
+#include <retry-service.hpp>
+#include <answer-service.hpp>
+#include <problem-manager.hpp>
+#include <threadpool.hpp>
+#include <json.hpp>
+
+#include "test.hpp"
+
+using std::condition_variable;
+using std::count;
+using std::lock_guard;
+using std::make_shared;
+using std::map;
+using std::mutex;
+using std::shared_ptr;
+using std::string;
+using std::thread;
+using std::unique_lock;
+using std::vector;
+using std::chrono::steady_clock;
+using std::chrono::milliseconds;
+using std::chrono::seconds;
+using std::chrono::duration_cast;
+
+using sapiremote::http::HttpService;
+using sapiremote::http::HttpHeaders;
+using sapiremote::http::HttpServiceStats;
+using sapiremote::http::HttpCallbackPtr;
+using sapiremote::http::Proxy;
+using sapiremote::ProblemManagerLimits;
+using sapiremote::makeSapiService;
+using sapiremote::makeProblemManager;
+using sapiremote::makeAnswerService;
+using sapiremote::makeThreadPool;
+using sapiremote::makeRetryTimerService;
+using sapiremote::defaultRetryTiming;
+
+namespace submittedstates = sapiremote::submittedstates;
+
+namespace {
+
+const string baseUrl = "test://test/";
+const string statusPrefix = baseUrl + "problems/?id=";
+const string timeoutParam = "&timeout=";
+
+// Stand-in for the SAPI server's status endpoint.  Problems turn from PENDING to COMPLETED at fixed times.
+// Status queries are answered from a separate thread, like real HTTP responses.
+class StandInServer : public HttpService {
+public:
+  enum LongPollMode {
+    HONOUR,        // hold long polls until a listed problem completes or the timeout expires
+    IGNORE,        // answer long polls immediately
+    REJECT,        // answer long polls with HTTP 400
+    FAIL_ONCE,     // answer the first long poll with HTTP 503, then honour them
+    THROTTLE_ONCE  // answer the first long poll with HTTP 429, then honour them
+  };
+
+  struct Request {
+    bool longPoll;
+    std::size_t numIds;
+    steady_clock::time_point time;
+  };
+
+private:
+  const LongPollMode mode_;
+  const std::size_t maxIds_; // longer ID lists get HTTP 414
+  mutex mutex_;
+  condition_variable cv_;
+  map<string, steady_clock::time_point> completionTimes_;
+  vector<thread> responders_;
+  vector<Request> requests_;
+  int longPolls_;
+  int plainPolls_;
+  bool stopping_;
+
+  string status(const string& id, steady_clock::time_point now) {
+    auto iter = completionTimes_.find(id);
+    return iter != completionTimes_.end() && iter->second <= now ? "COMPLETED" : "PENDING";
+  }
+
+  void respond(string url, HttpCallbackPtr callback) {
+    auto timeoutPos = url.find(timeoutParam);
+    auto waitS = timeoutPos == string::npos ? 0 : std::atoi(url.c_str() + timeoutPos + timeoutParam.size());
+    vector<string> ids;
+    auto idsString = url.substr(statusPrefix.size(), timeoutPos - statusPrefix.size());
+    boost::split(ids, idsString, boost::is_any_of(","));
+
+    unique_lock<mutex> lock(mutex_);
+    if (ids.size() > maxIds_) {
+      lock.unlock();
+      callback->complete(414, make_shared<string>("URI too long"));
+      return;
+    }
+    if (waitS > 0 && mode_ == REJECT) {
+      lock.unlock();
+      callback->complete(400, make_shared<string>("unknown parameter"));
+      return;
+    }
+    if (waitS > 0 && (mode_ == FAIL_ONCE || mode_ == THROTTLE_ONCE) && longPolls_ == 1) {
+      lock.unlock();
+      callback->complete(mode_ == FAIL_ONCE ? 503 : 429, make_shared<string>("try again later"));
+      return;
+    }
+
+    if (waitS > 0 && mode_ != IGNORE) {
+      // problems that have already completed are reported right away
+      auto now = steady_clock::now();
+      auto deadline = now + seconds(waitS);
+      BOOST_FOREACH( const auto& id, ids ) {
+        auto iter = completionTimes_.find(id);
+        if (iter != completionTimes_.end() && iter->second < deadline) deadline = iter->second;
+      }
+      while (!stopping_ && cv_.wait_until(lock, deadline) != std::cv_status::timeout) {}
+    }
+
+    auto now = steady_clock::now();
+    json::Array response;
+    BOOST_FOREACH( const auto& id, ids ) {
+      json::Object problem;
+      problem["id"] = id;
+      problem["type"] = "ising";
+      problem["status"] = status(id, now);
+      response.push_back(std::move(problem));
+    }
+    lock.unlock();
+    callback->complete(200, make_shared<string>(json::jsonToString(response)));
+  }
+
+  virtual void asyncGetImpl(const string& url, const HttpHeaders&, const Proxy&, HttpCallbackPtr callback) {
+    lock_guard<mutex> lock(mutex_);
+    auto timeoutPos = url.find(timeoutParam);
+    auto longPoll = timeoutPos != string::npos;
+    if (longPoll) {
+      ++longPolls_;
+    } else {
+      ++plainPolls_;
+    }
+    auto ids = url.substr(statusPrefix.size(), timeoutPos - statusPrefix.size());
+    auto numIds = static_cast<std::size_t>(count(ids.begin(), ids.end(), ',') + 1);
+    requests_.push_back(Request{longPoll, numIds, steady_clock::now()});
+    responders_.push_back(thread(&StandInServer::respond, this, url, callback));
+  }
+
+  virtual void asyncPostImpl(const string&, const HttpHeaders&, string&, const Proxy&, HttpCallbackPtr) {
+    ADD_FAILURE() << "unexpected POST";
+  }
+
+  virtual void asyncDeleteImpl(const string&, const HttpHeaders&, string&, const Proxy&, HttpCallbackPtr) {
+    ADD_FAILURE() << "unexpected DELETE";
+  }
+
+  virtual void shutdownImpl() {}
+  virtual HttpServiceStats statsImpl() const { return HttpServiceStats(); }
+
+public:
+  StandInServer(LongPollMode mode, std::size_t maxIds = 1000) :
+      mode_(mode), maxIds_(maxIds), longPolls_(0), plainPolls_(0), stopping_(false) {}
+
+  ~StandInServer() {
+    {
+      lock_guard<mutex> lock(mutex_);
+      stopping_ = true;
+    }
+    cv_.notify_all();
+    joinResponders();
+  }
+
+  // responders may start new requests through their callbacks; join until none are left
+  void joinResponders() {
+    for (;;) {
+      vector<thread> responders;
+      {
+        lock_guard<mutex> lock(mutex_);
+        responders.swap(responders_);
+      }
+      if (responders.empty()) break;
+      BOOST_FOREACH( auto& t, responders ) t.join();
+    }
+  }
+
+  void addProblem(const string& id, steady_clock::time_point completionTime) {
+    lock_guard<mutex> lock(mutex_);
+    completionTimes_[id] = completionTime;
+  }
+
+  int longPolls() {
+    lock_guard<mutex> lock(mutex_);
+    return longPolls_;
+  }
+
+  int plainPolls() {
+    lock_guard<mutex> lock(mutex_);
+    return plainPolls_;
+  }
+
+  vector<Request> requests() {
+    lock_guard<mutex> lock(mutex_);
+    return requests_;
+  }
+};
+
+// Runs the real SAPI service and problem manager against server until the problems with the given IDs,
+// which must have been added to server, are done.  Returns when the last one was seen done.
+steady_clock::time_point awaitProblems(shared_ptr<StandInServer> server, const ProblemManagerLimits& limits,
+    const vector<string>& ids) {
+
+  auto sapiService = makeSapiService(server, baseUrl, "", Proxy());
+  auto answerService = makeAnswerService(makeThreadPool(1));
+  auto retryService = makeRetryTimerService();
+  auto problemManager = makeProblemManager(sapiService, answerService, retryService,
+    defaultRetryTiming(), limits);
+
+  auto problems = problemManager->addProblems(ids);
+  auto giveUp = steady_clock::now() + seconds(10);
+  auto allDone = [&problems] {
+    BOOST_FOREACH( const auto& sp, problems ) if (!sp->done()) return false;
+    return true;
+  };
+  while (!allDone() && steady_clock::now() < giveUp) std::this_thread::sleep_for(milliseconds(5));
+  auto doneTime = steady_clock::now();
+
+  BOOST_FOREACH( const auto& sp, problems ) {
+    EXPECT_TRUE(sp->done()) << sp->problemId();
+    EXPECT_EQ(submittedstates::DONE, sp->status().state) << sp->problemId();
+  }
+  retryService->shutdown();
+  server->joinResponders();
+  return doneTime;
+}
+
+// Time from the problem completing on the server until the client sees it done
+milliseconds completionLatency(StandInServer::LongPollMode mode, const ProblemManagerLimits& limits,
+    shared_ptr<StandInServer>& server, milliseconds completeAfter = milliseconds(300)) {
+
+  server = make_shared<StandInServer>(mode);
+  auto completionTime = steady_clock::now() + completeAfter;
+  server->addProblem("p1", completionTime);
+  auto doneTime = awaitProblems(server, limits, vector<string>{"p1"});
+  return duration_cast<milliseconds>(doneTime - completionTime);
+}
+
+} // namespace {anonymous}
+
+TEST(LongPollTest, lowerLatencyThanPolling) {
+  const auto pollLimits = pollingLimits(1, 1, 1000, 5000, 0);
+  const auto longPollLimits = pollingLimits(1, 1, 1000, 5000, 10);
+
+  // polling sees the problem pending first and has to ask again after the completion
+  shared_ptr<StandInServer> server;
+  auto pollLatency = completionLatency(StandInServer::HONOUR, pollLimits, server);
+  EXPECT_EQ(0, server->longPolls());
+  EXPECT_LE(2, server->plainPolls());
+
+  // a long poll is held until the completion, so one request is enough
+  auto longPollLatency = completionLatency(StandInServer::HONOUR, longPollLimits, server);
+  EXPECT_EQ(1, server->longPolls());
+  EXPECT_EQ(0, server->plainPolls());
+
+  RecordProperty("pollLatencyMs", static_cast<int>(pollLatency.count()));
+  RecordProperty("longPollLatencyMs", static_cast<int>(longPollLatency.count()));
+
+  // the next poll comes a minimum poll interval (1000 ms) after the first, 700 ms after the completion
+  EXPECT_LE(milliseconds(500), pollLatency);
+  EXPECT_GT(milliseconds(250), longPollLatency);
+  EXPECT_LT(longPollLatency, pollLatency);
+}
+
+TEST(LongPollTest, busyBatchKeepsLongPolling) {
+  const auto limits = pollingLimits(10, 1, 20, 100, 10);
+  auto server = make_shared<StandInServer>(StandInServer::HONOUR);
+  vector<string> ids;
+  auto start = steady_clock::now();
+  for (auto i = 0; i < 8; ++i) {
+    ids.push_back("p" + std::to_string(i));
+    server->addProblem(ids.back(), start + milliseconds(100 + 60 * i));
+  }
+  awaitProblems(server, limits, ids);
+
+  // every long poll comes back long before the wait is up, but each one with a completion
+  EXPECT_LE(4, server->longPolls());
+  EXPECT_EQ(0, server->plainPolls());
+}
+
+TEST(LongPollTest, ignoredFallsBackAndRetries) {
+  const auto limits = pollingLimits(1, 1, 50, 100, 10);
+  shared_ptr<StandInServer> server;
+  completionLatency(StandInServer::IGNORE, limits, server, milliseconds(2500));
+
+  // Three long polls, then plain polls, then one more long poll after ten of those.  Early answers don't
+  // make long polls more frequent than the minimum poll interval allows (allowing for the time from
+  // sending to the server seeing it).  The retried long poll is ignored too and the interval doubles, so
+  // there isn't another before the problem completes.
+  auto requests = server->requests();
+  ASSERT_LE(15u, requests.size());
+  for (std::size_t i = 0; i < 3; ++i) {
+    EXPECT_TRUE(requests[i].longPoll) << "request " << i;
+    if (i > 0) {
+      EXPECT_LE(milliseconds(45), requests[i].time - requests[i - 1].time) << "request " << i;
+    }
+  }
+  for (std::size_t i = 3; i < 13; ++i) EXPECT_FALSE(requests[i].longPoll) << "request " << i;
+  EXPECT_TRUE(requests[13].longPoll);
+  for (std::size_t i = 14; i < requests.size(); ++i) EXPECT_FALSE(requests[i].longPoll) << "request " << i;
+}
+
+TEST(LongPollTest, rejectedFallsBack) {
+  const auto limits = pollingLimits(1, 1, 50, 100, 10);
+  shared_ptr<StandInServer> server;
+  completionLatency(StandInServer::REJECT, limits, server);
+
+  EXPECT_EQ(1, server->longPolls());
+  EXPECT_LT(0, server->plainPolls());
+}
+
+TEST(LongPollTest, serverErrorRetried) {
+  const auto limits = pollingLimits(1, 1, 50, 100, 10);
+  shared_ptr<StandInServer> server;
+  completionLatency(StandInServer::FAIL_ONCE, limits, server);
+
+  // a server error isn't a rejection of the long poll parameter
+  EXPECT_EQ(2, server->longPolls());
+  EXPECT_EQ(0, server->plainPolls());
+}
+
+TEST(LongPollTest, throttledRetried) {
+  const auto limits = pollingLimits(1, 1, 50, 100, 10);
+  shared_ptr<StandInServer> server;
+  completionLatency(StandInServer::THROTTLE_ONCE, limits, server);
+
+  EXPECT_EQ(2, server->longPolls());
+  EXPECT_EQ(0, server->plainPolls());
+}
+
+TEST(LongPollTest, uriTooLongSplitsIds) {
+  const auto limits = pollingLimits(4, 1, 50, 100, 10);
+  auto server = make_shared<StandInServer>(StandInServer::HONOUR, 2);
+  vector<string> ids;
+  auto completionTime = steady_clock::now() + milliseconds(300);
+  for (auto i = 0; i < 4; ++i) {
+    ids.push_back("p" + std::to_string(i));
+    server->addProblem(ids.back(), completionTime);
+  }
+  awaitProblems(server, limits, ids);
+
+  // the first query lists all four problems and is refused; later ones list fewer, still long polling
+  auto requests = server->requests();
+  ASSERT_LE(3u, requests.size());
+  EXPECT_EQ(4u, requests[0].numIds);
+  for (std::size_t i = 1; i < requests.size(); ++i) {
+    EXPECT_GE(2u, requests[i].numIds) << "request " << i;
+  }
+  EXPECT_EQ(0, server->plainPolls());
+}
@@ -0,0 +1,95 @@
+//Copyright © 2019 D-Wave Systems Inc.
+//The software is licensed to authorized users only under the applicable license agreement.  See License.txt.
+
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <boost/foreach.hpp>
+
+#include <gtest/gtest.h>
+
+#include <mpsc-queue.hpp>
+
+using std::make_pair;
+using std::make_shared;
+using std::pair;
+using std::shared_ptr;
+using std::thread;
+using std::vector;
+
+using sapiremote::BoundedMpscQueue;
+
+TEST(MpscQueueTest, fifo) {
+  BoundedMpscQueue<int> q(3);
+  EXPECT_EQ(4u, q.capacity());
+
+  int x;
+  EXPECT_FALSE(q.tryPop(x));
+
+  // go round the ring a few times
+  for (auto round = 0; round < 3; ++round) {
+    for (auto i = 0; i < 4; ++i) {
+      x = 10 * round + i;
+      EXPECT_TRUE(q.tryPush(x));
+    }
+    x = -1;
+    EXPECT_FALSE(q.tryPush(x));
+    EXPECT_EQ(-1, x);
+    EXPECT_EQ(4u, q.approximateSize());
+
+    for (auto i = 0; i < 4; ++i) {
+      ASSERT_TRUE(q.tryPop(x));
+      EXPECT_EQ(10 * round + i, x);
+    }
+    EXPECT_FALSE(q.tryPop(x));
+    EXPECT_EQ(0u, q.approximateSize());
+  }
+}
+
+TEST(MpscQueueTest, releasesPoppedValues) {
+  BoundedMpscQueue<shared_ptr<int>> q(4);
+  auto p = make_shared<int>(5);
+  auto copy = p;
+  ASSERT_TRUE(q.tryPush(copy));
+  EXPECT_FALSE(!!copy);
+  EXPECT_EQ(2, p.use_count());
+
+  shared_ptr<int> out;
+  ASSERT_TRUE(q.tryPop(out));
+  out.reset();
+  EXPECT_EQ(1, p.use_count());
+}
+
+TEST(MpscQueueTest, manyProducers) {
+  const auto numProducers = 8;
+  const auto perProducer = 20000;
+  BoundedMpscQueue<pair<int, int>> q(64);
+
+  vector<thread> producers;
+  for (auto p = 0; p < numProducers; ++p) {
+    producers.push_back(thread([&q, p, perProducer] {
+      for (auto i = 0; i < perProducer; ++i) {
+        auto item = make_pair(p, i);
+        while (!q.tryPush(item)) std::this_thread::yield();
+      }
+    }));
+  }
+
+  // every item arrives exactly once, in order per producer
+  vector<int> next(numProducers, 0);
+  auto received = 0;
+  pair<int, int> item;
+  while (received < numProducers * perProducer) {
+    if (!q.tryPop(item)) {
+      std::this_thread::yield();
+      continue;
+    }
+    EXPECT_EQ(next[item.first], item.second);
+    ++next[item.first];
+    ++received;
+  }
+  BOOST_FOREACH( auto& t, producers ) t.join();
+  EXPECT_FALSE(q.tryPop(item));
+}
@@ -0,0 +1,189 @@
+//Copyright © 2019 D-Wave Systems Inc.
+//The software is licensed to authorized users only under the applicable license agreement.  See License.txt.
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <exceptions.hpp>
+#include <sapi-service.hpp>
+#include <retry-service.hpp>
+#include <answer-service.hpp>
+#include <problem-journal.hpp>
+#include <problem-manager.hpp>
+#include <threadpool.hpp>
+#include <json.hpp>
+
+#include "test.hpp"
+
+using std::ifstream;
+using std::make_shared;
+using std::ofstream;
+using std::string;
+using std::vector;
+using std::chrono::milliseconds;
+using std::chrono::seconds;
+using std::chrono::steady_clock;
+
+using sapiremote::JournalException;
+using sapiremote::SubmittedProblemPtr;
+using sapiremote::defaultRetryTiming;
+using sapiremote::makeAnswerService;
+using sapiremote::makeProblemJournal;
+using sapiremote::makeProblemManager;
+using sapiremote::makeRetryTimerService;
+using sapiremote::makeThreadPool;
+using sapiremote::resumeProblems;
+
+namespace {
+
+string journalPath(const string& name) {
+  auto path = testing::TempDir() + "problem-journal-" + name;
+  std::remove(path.c_str());
+  return path;
+}
+
+long fileSize(const string& path) {
+  ifstream in(path, std::ios::binary | std::ios::ate);
+  return static_cast<long>(in.tellg());
+}
+
+void copyFile(const string& from, const string& to) {
+  ifstream in(from, std::ios::binary);
+  ofstream out(to, std::ios::binary | std::ios::trunc);
+  out << in.rdbuf();
+}
+
+template<typename Pred>
+bool waitFor(Pred pred) {
+  auto giveUp = steady_clock::now() + seconds(10);
+  while (!pred()) {
+    if (steady_clock::now() > giveUp) return false;
+    std::this_thread::sleep_for(milliseconds(1));
+  }
+  return true;
+}
+
+} // namespace {anonymous}
+
+TEST(ProblemJournalTest, roundTrip) {
+  auto path = journalPath("roundTrip");
+  {
+    auto journal = makeProblemJournal(path, 0);
+    EXPECT_TRUE(journal->outstandingProblems().empty());
+    journal->problemSubmitted("a");
+    journal->problemSubmitted("b");
+    journal->problemSubmitted("c");
+    journal->problemDone("b");
+    journal->problemSubmitted("a");
+    journal->problemDone("never submitted");
+    EXPECT_EQ(vector<string>({"a", "c"}), journal->outstandingProblems());
+    EXPECT_TRUE(journal->sync());
+  }
+
+  auto journal = makeProblemJournal(path, 0);
+  EXPECT_EQ(vector<string>({"a", "c"}), journal->outstandingProblems());
+}
+
+TEST(ProblemJournalTest, tornRecord) {
+  auto path = journalPath("tornRecord");
+  {
+    auto journal = makeProblemJournal(path);
+    journal->problemSubmitted("a");
+    journal->problemSubmitted("b");
+    ASSERT_TRUE(journal->sync());
+  }
+  {
+    // crash partway through writing a record
+    ofstream out(path, std::ios::binary | std::ios::app);
+    out.write("\x01\x05\x00xy", 5);
+  }
+  {
+    auto journal = makeProblemJournal(path);
+    EXPECT_EQ(vector<string>({"a", "b"}), journal->outstandingProblems());
+    journal->problemSubmitted("c");
+    ASSERT_TRUE(journal->sync());
+  }
+
+  // the partial record must be gone, or it would hide records written after it
+  auto journal = makeProblemJournal(path);
+  EXPECT_EQ(vector<string>({"a", "b", "c"}), journal->outstandingProblems());
+}
+
+TEST(ProblemJournalTest, notAJournal) {
+  auto path = journalPath("notAJournal");
+  {
+    ofstream out(path, std::ios::binary);
+    out << "precious data";
+  }
+  EXPECT_THROW(makeProblemJournal(path), JournalException);
+  EXPECT_EQ(13, fileSize(path));
+}
+
+TEST(ProblemJournalTest, compacts) {
+  auto path = journalPath("compacts");
+  auto journal = makeProblemJournal(path, 0);
+  journal->problemSubmitted("keep");
+  for (auto i = 0; i < 20000; ++i) {
+    auto id = "problem-" + std::to_string(i);
+    journal->problemSubmitted(id);
+    journal->problemDone(id);
+  }
+  ASSERT_TRUE(journal->sync());
+  EXPECT_LT(fileSize(path), 200000); // 40000 records would be about 800 kB
+  EXPECT_EQ(vector<string>({"keep"}), journal->outstandingProblems());
+
+  journal.reset();
+  journal = makeProblemJournal(path, 0);
+  EXPECT_EQ(vector<string>({"keep"}), journal->outstandingProblems());
+  EXPECT_LT(fileSize(path), 100);
+}
+
+TEST(ProblemJournalTest, resumeAfterRestart) {
+  auto path = journalPath("resumeAfterRestart");
+  const auto limits = pollingLimits(10, 2, 10, 10, 0);
+  auto service = make_shared<StubSapiService>();
+  auto retryService = makeRetryTimerService();
+
+  {
+    auto journal = makeProblemJournal(path);
+    auto problemManager = makeProblemManager(service, makeAnswerService(makeThreadPool(1)), retryService,
+        defaultRetryTiming(), limits, journal);
+    vector<SubmittedProblemPtr> problems;
+    for (auto i = 0; i < 3; ++i) {
+      problems.push_back(problemManager->submitProblem("solver", "ising", json::Object(), json::Object()));
+    }
+    ASSERT_TRUE(waitFor([&] { return journal->outstandingProblems().size() == 3; }));
+    ASSERT_TRUE(journal->sync());
+
+    // crash: nothing after this reaches the file
+    copyFile(path, path + ".crash");
+  }
+  copyFile(path + ".crash", path);
+
+  // new process
+  service->completeAll();
+  auto journal = makeProblemJournal(path);
+  EXPECT_EQ(vector<string>({"p0", "p1", "p2"}), journal->outstandingProblems());
+  auto problemManager = makeProblemManager(service, makeAnswerService(makeThreadPool(1)), retryService,
+      defaultRetryTiming(), limits, journal);
+  auto problems = resumeProblems(*problemManager, *journal);
+  ASSERT_EQ(3u, problems.size());
+  EXPECT_EQ("p1", problems[1]->problemId());
+  EXPECT_TRUE(waitFor([&] { return problems[0]->done() && problems[1]->done() && problems[2]->done(); }));
+
+  // done problems stay outstanding until their answers are delivered or they're released
+  EXPECT_EQ(3u, journal->outstandingProblems().size());
+  problems[1]->answer();
+  EXPECT_EQ(vector<string>({"p0", "p2"}), journal->outstandingProblems());
+  problems.clear();
+  EXPECT_TRUE(journal->outstandingProblems().empty());
+
+  retryService->shutdown();
+}
@@ -37,11 +37,13 @@ using testing::SaveArg;
 using testing::Return;
 using testing::Invoke;
 using testing::NiceMock;
+using testing::Eq;
 using testing::_;
 
 using sapiremote::AnswerService;
 using sapiremote::SubmittedProblemObserverPtr;
 using sapiremote::SapiService;
+using sapiremote::SapiServiceStats;
 using sapiremote::RetryTimer;
 using sapiremote::RetryTimerPtr;
 using sapiremote::RetryNotifiable;
@@ -56,6 +58,8 @@ using sapiremote::AnswerCallback;
 using sapiremote::AnswerCallbackPtr;
 using sapiremote::makeProblemManager;
 using sapiremote::ProblemManagerLimits;
+using sapiremote::RequestSchedule;
+using sapiremote::AdaptiveLimits;
 using sapiremote::RemoteProblemInfo;
 using sapiremote::Problem;
 using sapiremote::NetworkException;
@@ -70,8 +74,8 @@ namespace {
 auto o = jsonObject();
 auto a = jsonArray();
 
-const sapiremote::RetryTiming dummyRetryTiming = { 1, 1, 1.0f };
-const ProblemManagerLimits minLimits = {1, 1, 1};
+const sapiremote::RetryTiming dummyRetryTiming = { 1, 1, 1.0f, 0.0f };
+const ProblemManagerLimits minLimits = {1, 1, 1, 0, 0, 0, 0, 0, RequestSchedule(), AdaptiveLimits()};
 
 class MockAnswerCallback : public AnswerCallback {
 public:
@@ -93,8 +97,10 @@ public:
   MOCK_METHOD1(fetchSolversImpl, void(SolversSapiCallbackPtr));
   MOCK_METHOD2(submitProblemsImpl, void(vector<Problem>&, StatusSapiCallbackPtr));
   MOCK_METHOD2(multiProblemStatusImpl,  void(const vector<string>& ids, StatusSapiCallbackPtr callback));
+  MOCK_METHOD3(longPollStatusImpl, void(const vector<string>& ids, int waitS, StatusSapiCallbackPtr callback));
   MOCK_METHOD2(fetchAnswerImpl, void(const string& id, FetchAnswerSapiCallbackPtr callback));
   MOCK_METHOD2(cancelProblemsImpl, void(const vector<string>& ids, CancelSapiCallbackPtr));
+  MOCK_CONST_METHOD0(statsImpl, SapiServiceStats());
 };
 
 class MockRetryNotifiable : public RetryNotifiable {
@@ -115,11 +121,38 @@ class MockRetryTimerService : public sapiremote::RetryTimerService {
 public:
   MOCK_METHOD0(shutdownImpl, void());
   MOCK_METHOD2(createRetryTimerImpl, RetryTimerPtr(const RetryNotifiableWeakPtr&, const sapiremote::RetryTiming&));
+  MOCK_METHOD1(createPollTimerImpl, sapiremote::PollTimerPtr(const RetryNotifiableWeakPtr&));
   MockRetryTimerService() {
     ON_CALL(*this, createRetryTimerImpl(_, _)).WillByDefault(Return(make_shared<NiceMock<MockRetryTimer>>()));
   }
 };
 
+// ProblemManagerImpl creates one retry timer per request type, in this order
+enum RetryTimerIndex { SUBMIT_TIMER, STATUS_TIMER, CANCEL_TIMER, ANSWER_TIMER, NUM_RETRY_TIMERS };
+
+// timer and notifiable belong to the given request type; the others get nice mocks
+void expectRetryTimer(MockRetryTimerService& service, RetryTimerIndex index, RetryTimerPtr timer,
+    RetryNotifiableWeakPtr& notifiable) {
+  testing::Sequence s;
+  for (auto i = 0; i < NUM_RETRY_TIMERS; ++i) {
+    if (i == index) {
+      EXPECT_CALL(service, createRetryTimerImpl(_, _)).InSequence(s)
+          .WillOnce(DoAll(SaveArg<0>(&notifiable), Return(timer)));
+    } else {
+      EXPECT_CALL(service, createRetryTimerImpl(_, _)).InSequence(s)
+          .WillOnce(Return(make_shared<NiceMock<MockRetryTimer>>()));
+    }
+  }
+}
+
+// completing a callback may start the next request right away, replacing the saved callback
+template<typename T>
+T take(T& callback) {
+  T taken;
+  taken.swap(callback);
+  return taken;
+}
+
 void CompleteAnswerCallback(AnswerCallbackPtr callback, std::string type, json::Value answer) {
   callback->answer(type, answer);
 }
@@ -162,8 +195,7 @@ TEST(ProblemManagerAutoRetryTest, SubmitUntilSuccess) {
   RetryNotifiableWeakPtr weakNotifiable;
 
   auto mockRetryService = make_shared<MockRetryTimerService>();
-  EXPECT_CALL(*mockRetryService, createRetryTimerImpl(_, _))
-    .WillOnce(DoAll(SaveArg<0>(&weakNotifiable), Return(mockRetryTimer)));
+  expectRetryTimer(*mockRetryService, SUBMIT_TIMER, mockRetryTimer, weakNotifiable);
 
   auto problemManager = makeProblemManager(mockSapiService, make_shared<MockAnswerService>(), mockRetryService,
     dummyRetryTiming, minLimits);
@@ -246,8 +278,7 @@ TEST(ProblemManagerAutoRetryTest, SubmitUntilNonNetworkFailure) {
   RetryNotifiableWeakPtr weakNotifiable;
 
   auto mockRetryService = make_shared<MockRetryTimerService>();
-  EXPECT_CALL(*mockRetryService, createRetryTimerImpl(_, _))
-    .WillOnce(DoAll(SaveArg<0>(&weakNotifiable), Return(mockRetryTimer)));
+  expectRetryTimer(*mockRetryService, SUBMIT_TIMER, mockRetryTimer, weakNotifiable);
 
   auto problemManager = makeProblemManager(mockSapiService, make_shared<MockAnswerService>(), mockRetryService,
     dummyRetryTiming, minLimits);
@@ -328,8 +359,7 @@ TEST(ProblemManagerAutoRetryTest, SubmitUntilFailure) {
   RetryNotifiableWeakPtr weakNotifiable;
 
   auto mockRetryService = make_shared<MockRetryTimerService>();
-  EXPECT_CALL(*mockRetryService, createRetryTimerImpl(_, _))
-    .WillOnce(DoAll(SaveArg<0>(&weakNotifiable), Return(mockRetryTimer)));
+  expectRetryTimer(*mockRetryService, SUBMIT_TIMER, mockRetryTimer, weakNotifiable);
 
   auto problemManager = makeProblemManager(mockSapiService, make_shared<MockAnswerService>(), mockRetryService,
     dummyRetryTiming, minLimits);
@@ -405,8 +435,7 @@ TEST(ProblemManagerAutoRetryTest, StatusUntilSuccess) {
   RetryNotifiableWeakPtr weakNotifiable;
 
   auto mockRetryService = make_shared<MockRetryTimerService>();
-  EXPECT_CALL(*mockRetryService, createRetryTimerImpl(_, _))
-    .WillOnce(DoAll(SaveArg<0>(&weakNotifiable), Return(mockRetryTimer)));
+  expectRetryTimer(*mockRetryService, STATUS_TIMER, mockRetryTimer, weakNotifiable);
 
   auto problemManager = makeProblemManager(mockSapiService, make_shared<MockAnswerService>(), mockRetryService,
     dummyRetryTiming, minLimits);
@@ -492,8 +521,7 @@ TEST(ProblemManagerAutoRetryTest, StatusUntilNonNetworkFailure) {
   RetryNotifiableWeakPtr weakNotifiable;
 
   auto mockRetryService = make_shared<MockRetryTimerService>();
-  EXPECT_CALL(*mockRetryService, createRetryTimerImpl(_, _))
-    .WillOnce(DoAll(SaveArg<0>(&weakNotifiable), Return(mockRetryTimer)));
+  expectRetryTimer(*mockRetryService, STATUS_TIMER, mockRetryTimer, weakNotifiable);
 
   auto problemManager = makeProblemManager(mockSapiService, make_shared<MockAnswerService>(), mockRetryService,
     dummyRetryTiming, minLimits);
@@ -575,8 +603,7 @@ TEST(ProblemManagerAutoRetryTest, StatusUntilFailure) {
   RetryNotifiableWeakPtr weakNotifiable;
 
   auto mockRetryService = make_shared<MockRetryTimerService>();
-  EXPECT_CALL(*mockRetryService, createRetryTimerImpl(_, _))
-    .WillOnce(DoAll(SaveArg<0>(&weakNotifiable), Return(mockRetryTimer)));
+  expectRetryTimer(*mockRetryService, STATUS_TIMER, mockRetryTimer, weakNotifiable);
 
   auto problemManager = makeProblemManager(mockSapiService, make_shared<MockAnswerService>(), mockRetryService,
     dummyRetryTiming, minLimits);
@@ -656,8 +683,7 @@ TEST(ProblemManagerAutoRetryTest, FetchAnswerUntilSuccess) {
   RetryNotifiableWeakPtr weakNotifiable;
 
   auto mockRetryService = make_shared<MockRetryTimerService>();
-  EXPECT_CALL(*mockRetryService, createRetryTimerImpl(_, _))
-    .WillOnce(DoAll(SaveArg<0>(&weakNotifiable), Return(mockRetryTimer)));
+  expectRetryTimer(*mockRetryService, ANSWER_TIMER, mockRetryTimer, weakNotifiable);
 
   auto problemManager = makeProblemManager(mockSapiService, mockAnswerService, mockRetryService,
     dummyRetryTiming, minLimits);
@@ -670,7 +696,7 @@ TEST(ProblemManagerAutoRetryTest, FetchAnswerUntilSuccess) {
   submitCallback->complete(vector<RemoteProblemInfo>{makeProblemInfo(problemId, "", remotestatuses::COMPLETED)});
 
   auto mockAnswerCallback = make_shared<MockAnswerCallback>();
-  EXPECT_CALL(*mockAnswerCallback, answerImpl(problem.type(), answer)).Times(1);
+  EXPECT_CALL(*mockAnswerCallback, answerImpl(Eq(problem.type()), answer)).Times(1);
   sp->answer(mockAnswerCallback);
 
   // fail 1
@@ -734,8 +760,7 @@ TEST(ProblemManagerAutoRetryTest, FetchAnswerUntilNonNetworkFailure) {
   RetryNotifiableWeakPtr weakNotifiable;
 
   auto mockRetryService = make_shared<MockRetryTimerService>();
-  EXPECT_CALL(*mockRetryService, createRetryTimerImpl(_, _))
-    .WillOnce(DoAll(SaveArg<0>(&weakNotifiable), Return(mockRetryTimer)));
+  expectRetryTimer(*mockRetryService, ANSWER_TIMER, mockRetryTimer, weakNotifiable);
 
   auto problemManager = makeProblemManager(mockSapiService, mockAnswerService, mockRetryService,
     dummyRetryTiming, minLimits);
@@ -748,7 +773,7 @@ TEST(ProblemManagerAutoRetryTest, FetchAnswerUntilNonNetworkFailure) {
   submitCallback->complete(vector<RemoteProblemInfo>{makeProblemInfo(problemId, "", remotestatuses::COMPLETED)});
 
   auto mockAnswerCallback = make_shared<MockAnswerCallback>();
-  EXPECT_CALL(*mockAnswerCallback, answerImpl(problem.type(), answer)).Times(0);
+  EXPECT_CALL(*mockAnswerCallback, answerImpl(Eq(problem.type()), answer)).Times(0);
   EXPECT_CALL(*mockAnswerCallback, errorImpl(Thrown(CommunicationException))).Times(1);
   sp->answer(mockAnswerCallback);
 
@@ -810,8 +835,7 @@ TEST(ProblemManagerAutoRetryTest, FetchAnswerUntilFailure) {
   RetryNotifiableWeakPtr weakNotifiable;
 
   auto mockRetryService = make_shared<MockRetryTimerService>();
-  EXPECT_CALL(*mockRetryService, createRetryTimerImpl(_, _))
-    .WillOnce(DoAll(SaveArg<0>(&weakNotifiable), Return(mockRetryTimer)));
+  expectRetryTimer(*mockRetryService, ANSWER_TIMER, mockRetryTimer, weakNotifiable);
 
   auto problemManager = makeProblemManager(mockSapiService, mockAnswerService, mockRetryService,
     dummyRetryTiming, minLimits);
@@ -872,13 +896,12 @@ TEST(ProblemManagerAutoRetryTest, CancelUntilSuccess) {
 
   auto mockRetryTimer = make_shared<MockRetryTimer>();
   EXPECT_CALL(*mockRetryTimer, successImpl()).Times(1);
-  EXPECT_CALL(*mockRetryTimer, retryImpl()).Times(4).WillRepeatedly(Return(RetryTimer::RETRY));
+  EXPECT_CALL(*mockRetryTimer, retryImpl()).Times(2).WillRepeatedly(Return(RetryTimer::RETRY));
 
   RetryNotifiableWeakPtr weakNotifiable;
 
   auto mockRetryService = make_shared<MockRetryTimerService>();
-  EXPECT_CALL(*mockRetryService, createRetryTimerImpl(_, _))
-    .WillOnce(DoAll(SaveArg<0>(&weakNotifiable), Return(mockRetryTimer)));
+  expectRetryTimer(*mockRetryService, CANCEL_TIMER, mockRetryTimer, weakNotifiable);
 
   auto problemManager = makeProblemManager(mockSapiService, make_shared<MockAnswerService>(), mockRetryService,
     dummyRetryTiming, minLimits);
@@ -893,33 +916,32 @@ TEST(ProblemManagerAutoRetryTest, CancelUntilSuccess) {
   submitCallback->complete(vector<RemoteProblemInfo>{makeProblemInfo(problemId, "", remotestatuses::PENDING)});
   submitCallback.reset();
 
-  // fail 1
+  // fail 1: cancellation backs off, status polls carry on
   ASSERT_TRUE(!!cancelCallback);
   cancelCallback->error(e);
   cancelCallback.reset();
-  notifiable->notify();
   ASSERT_TRUE(!!statusCallback);
-  statusCallback->error(e);
-  statusCallback.reset();
+  notifiable->notify(); // no free request slot yet
+  ASSERT_FALSE(!!cancelCallback);
+  take(statusCallback)->complete({makeProblemInfo(problemId, "", remotestatuses::PENDING)});
 
   // fail 2
-  notifiable->notify();
   ASSERT_TRUE(!!cancelCallback);
   cancelCallback->error(e);
   cancelCallback.reset();
-  notifiable->notify();
   ASSERT_TRUE(!!statusCallback);
-  statusCallback->error(e);
-  statusCallback.reset();
+  take(statusCallback)->complete({makeProblemInfo(problemId, "", remotestatuses::PENDING)});
+  ASSERT_TRUE(!!statusCallback);
+  ASSERT_FALSE(!!cancelCallback);
+  notifiable->notify();
+  take(statusCallback)->complete({makeProblemInfo(problemId, "", remotestatuses::PENDING)});
 
   // success
-  notifiable->notify();
   ASSERT_TRUE(!!cancelCallback);
   cancelCallback->complete();
   cancelCallback.reset();
   ASSERT_TRUE(!!statusCallback);
-  statusCallback->complete({makeProblemInfo(problemId, "", remotestatuses::IN_PROGRESS)});
-  statusCallback.reset();
+  take(statusCallback)->complete({makeProblemInfo(problemId, "", remotestatuses::IN_PROGRESS)});
 }
 
 
@@ -958,13 +980,12 @@ TEST(ProblemManagerAutoRetryTest, CancelUntilNonNetworkFailure) {
 
   auto mockRetryTimer = make_shared<MockRetryTimer>();
   EXPECT_CALL(*mockRetryTimer, successImpl()).Times(1);
-  EXPECT_CALL(*mockRetryTimer, retryImpl()).Times(4).WillRepeatedly(Return(RetryTimer::RETRY));
+  EXPECT_CALL(*mockRetryTimer, retryImpl()).Times(2).WillRepeatedly(Return(RetryTimer::RETRY));
 
   RetryNotifiableWeakPtr weakNotifiable;
 
   auto mockRetryService = make_shared<MockRetryTimerService>();
-  EXPECT_CALL(*mockRetryService, createRetryTimerImpl(_, _))
-    .WillOnce(DoAll(SaveArg<0>(&weakNotifiable), Return(mockRetryTimer)));
+  expectRetryTimer(*mockRetryService, CANCEL_TIMER, mockRetryTimer, weakNotifiable);
 
   auto problemManager = makeProblemManager(mockSapiService, make_shared<MockAnswerService>(), mockRetryService,
     dummyRetryTiming, minLimits);
@@ -979,27 +1000,23 @@ TEST(ProblemManagerAutoRetryTest, CancelUntilNonNetworkFailure) {
   submitCallback->complete(vector<RemoteProblemInfo>{makeProblemInfo(problemId, "", remotestatuses::PENDING)});
   submitCallback.reset();
 
-  // network fail 1
+  // network fail 1: cancellation backs off, status polls carry on
   ASSERT_TRUE(!!cancelCallback);
   cancelCallback->error(networkError);
   cancelCallback.reset();
-  notifiable->notify();
   ASSERT_TRUE(!!statusCallback);
-  statusCallback->error(networkError);
-  statusCallback.reset();
+  notifiable->notify();
+  take(statusCallback)->complete({makeProblemInfo(problemId, "", remotestatuses::PENDING)});
 
   // network fail 2
-  notifiable->notify();
   ASSERT_TRUE(!!cancelCallback);
   cancelCallback->error(networkError);
   cancelCallback.reset();
-  notifiable->notify();
   ASSERT_TRUE(!!statusCallback);
-  statusCallback->error(networkError);
-  statusCallback.reset();
+  notifiable->notify();
+  take(statusCallback)->complete({makeProblemInfo(problemId, "", remotestatuses::PENDING)});
 
   // other fail
-  notifiable->notify();
   ASSERT_TRUE(!!cancelCallback);
   cancelCallback->error(otherError);
   cancelCallback.reset();
@@ -1041,15 +1058,15 @@ TEST(ProblemManagerAutoRetryTest, CancelUntilFailure) {
 
   auto mockRetryTimer = make_shared<MockRetryTimer>();
   EXPECT_CALL(*mockRetryTimer, successImpl()).Times(0);
-  EXPECT_CALL(*mockRetryTimer, retryImpl()).WillOnce(Return(RetryTimer::RETRY));
-  EXPECT_CALL(*mockRetryTimer, retryImpl()).WillOnce(Return(RetryTimer::FAIL)).RetiresOnSaturation();
-  EXPECT_CALL(*mockRetryTimer, retryImpl()).Times(4).WillRepeatedly(Return(RetryTimer::RETRY)).RetiresOnSaturation();
+  EXPECT_CALL(*mockRetryTimer, retryImpl())
+    .WillOnce(Return(RetryTimer::RETRY))
+    .WillOnce(Return(RetryTimer::RETRY))
+    .WillOnce(Return(RetryTimer::FAIL));
 
   RetryNotifiableWeakPtr weakNotifiable;
 
   auto mockRetryService = make_shared<MockRetryTimerService>();
-  EXPECT_CALL(*mockRetryService, createRetryTimerImpl(_, _))
-    .WillOnce(DoAll(SaveArg<0>(&weakNotifiable), Return(mockRetryTimer)));
+  expectRetryTimer(*mockRetryService, CANCEL_TIMER, mockRetryTimer, weakNotifiable);
 
   auto problemManager = makeProblemManager(mockSapiService, make_shared<MockAnswerService>(), mockRetryService,
     dummyRetryTiming, minLimits);
@@ -1064,37 +1081,33 @@ TEST(ProblemManagerAutoRetryTest, CancelUntilFailure) {
   submitCallback->complete(vector<RemoteProblemInfo>{makeProblemInfo(problemId, "", remotestatuses::PENDING)});
   submitCallback.reset();
 
-  // fail 1
+  // fail 1: cancellation backs off, status polls carry on
   ASSERT_TRUE(!!cancelCallback);
   cancelCallback->error(e);
   cancelCallback.reset();
-  notifiable->notify();
   ASSERT_TRUE(!!statusCallback);
-  statusCallback->error(e);
-  statusCallback.reset();
+  notifiable->notify();
+  take(statusCallback)->complete({makeProblemInfo(problemId, "", remotestatuses::PENDING)});
 
   // fail 2
-  notifiable->notify();
   ASSERT_TRUE(!!cancelCallback);
   cancelCallback->error(e);
   cancelCallback.reset();
-  notifiable->notify();
   ASSERT_TRUE(!!statusCallback);
-  statusCallback->error(e);
-  statusCallback.reset();
+  notifiable->notify();
+  take(statusCallback)->complete({makeProblemInfo(problemId, "", remotestatuses::PENDING)});
 
   // real fail
-  notifiable->notify();
   ASSERT_TRUE(!!cancelCallback);
   cancelCallback->error(e);
   cancelCallback.reset();
-  notifiable->notify();
   ASSERT_TRUE(!!statusCallback);
-  statusCallback->error(e);
-  statusCallback.reset();
+  take(statusCallback)->complete({makeProblemInfo(problemId, "", remotestatuses::PENDING)});
 
   // stay failed
   notifiable->notify();
+  ASSERT_TRUE(!!statusCallback);
+  take(statusCallback)->complete({makeProblemInfo(problemId, "", remotestatuses::PENDING)});
   ASSERT_FALSE(!!cancelCallback);
 }
 
@@ -1132,8 +1145,7 @@ TEST(ProblemManagerAutoRetryTest, Starvation) {
   RetryNotifiableWeakPtr weakNotifiable;
 
   auto mockRetryService = make_shared<MockRetryTimerService>();
-  EXPECT_CALL(*mockRetryService, createRetryTimerImpl(_, _))
-    .WillOnce(DoAll(SaveArg<0>(&weakNotifiable), Return(mockRetryTimer)));
+  expectRetryTimer(*mockRetryService, SUBMIT_TIMER, mockRetryTimer, weakNotifiable);
 
   auto problemManager = makeProblemManager(mockSapiService, make_shared<MockAnswerService>(), mockRetryService,
     dummyRetryTiming, minLimits);
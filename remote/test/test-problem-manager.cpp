@@ -5,6 +5,7 @@
 #include <exception>
 #include <memory>
 #include <new>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
@@ -44,6 +45,10 @@ using testing::AnyNumber;
 using testing::ElementsAre;
 using testing::SizeIs;
 using testing::HasSubstr;
+using testing::AllOf;
+using testing::DoAll;
+using testing::Ge;
+using testing::Le;
 using testing::NiceMock;
 using testing::StrictMock;
 using testing::_;
@@ -52,6 +57,7 @@ using sapiremote::AnswerService;
 using sapiremote::SubmittedProblemObserver;
 using sapiremote::SubmittedProblemObserverPtr;
 using sapiremote::SapiService;
+using sapiremote::SapiServiceStats;
 using sapiremote::RetryTimer;
 using sapiremote::RetryTimerPtr;
 using sapiremote::RetryNotifiableWeakPtr;
@@ -65,6 +71,8 @@ using sapiremote::AnswerCallback;
 using sapiremote::AnswerCallbackPtr;
 using sapiremote::makeProblemManager;
 using sapiremote::ProblemManagerLimits;
+using sapiremote::RequestSchedule;
+using sapiremote::AdaptiveLimits;
 using sapiremote::SolverInfo;
 using sapiremote::RemoteProblemInfo;
 using sapiremote::Problem;
@@ -83,8 +91,8 @@ namespace {
 auto o = jsonObject();
 auto a = jsonArray();
 
-const sapiremote::RetryTiming dummyRetryTiming = { 1, 1, 1.0f };
-const ProblemManagerLimits minLimits = {1, 1, 1};
+const sapiremote::RetryTiming dummyRetryTiming = { 1, 1, 1.0f, 0.0f };
+const ProblemManagerLimits minLimits = {1, 1, 1, 0, 0, 0, 0, 0, RequestSchedule(), AdaptiveLimits()};
 
 class MockAnswerCallback : public AnswerCallback {
 public:
@@ -113,8 +121,10 @@ public:
   MOCK_METHOD1(fetchSolversImpl, void(SolversSapiCallbackPtr));
   MOCK_METHOD2(submitProblemsImpl, void(vector<Problem>&, StatusSapiCallbackPtr));
   MOCK_METHOD2(multiProblemStatusImpl,  void(const vector<string>& ids, StatusSapiCallbackPtr callback));
+  MOCK_METHOD3(longPollStatusImpl, void(const vector<string>& ids, int waitS, StatusSapiCallbackPtr callback));
   MOCK_METHOD2(fetchAnswerImpl, void(const string& id, FetchAnswerSapiCallbackPtr callback));
   MOCK_METHOD2(cancelProblemsImpl, void(const vector<string>& ids, CancelSapiCallbackPtr));
+  MOCK_CONST_METHOD0(statsImpl, SapiServiceStats());
 };
 
 class MockRetryTimer : public RetryTimer {
@@ -126,10 +136,16 @@ public:
   }
 };
 
+class MockPollTimer : public sapiremote::PollTimer {
+public:
+  MOCK_METHOD1(scheduleImpl, void(int));
+};
+
 class MockRetryTimerService : public sapiremote::RetryTimerService {
 public:
   MOCK_METHOD0(shutdownImpl, void());
   MOCK_METHOD2(createRetryTimerImpl, RetryTimerPtr(const RetryNotifiableWeakPtr&, const sapiremote::RetryTiming&));
+  MOCK_METHOD1(createPollTimerImpl, sapiremote::PollTimerPtr(const RetryNotifiableWeakPtr&));
   MockRetryTimerService() {
     ON_CALL(*this, createRetryTimerImpl(_, _)).WillByDefault(Return(make_shared<NiceMock<MockRetryTimer>>()));
   }
@@ -238,6 +254,40 @@ TEST(ProblemManagerTest, addProblem) {
 
 
 
+TEST(ProblemManagerTest, addProblems) {
+  vector<string> problemIds;
+  for (auto i = 0; i < 250; ++i) problemIds.push_back("p" + std::to_string(i));
+
+  vector<string> queriedIds;
+  vector<size_t> querySizes;
+  auto mockSapiService = make_shared<MockSapiService>();
+  EXPECT_CALL(*mockSapiService, submitProblemsImpl(_, _)).Times(0);
+  EXPECT_CALL(*mockSapiService, multiProblemStatusImpl(_, _)).Times(3)
+    .WillRepeatedly(WithArg<0>(Invoke([&](const vector<string>& ids) {
+      queriedIds.insert(queriedIds.end(), ids.begin(), ids.end());
+      querySizes.push_back(ids.size());
+    })));
+
+  auto mockAnswerService = make_shared<MockAnswerService>();
+  EXPECT_CALL(*mockAnswerService, postErrorImpl(_)).Times(AnyNumber());
+
+  auto mockRetryService = make_shared<NiceMock<MockRetryTimerService>>();
+  auto limits = ProblemManagerLimits{1, 100, 3, 0, 0, 0, 0, 0, RequestSchedule(), AdaptiveLimits()};
+  auto problemManager = makeProblemManager(mockSapiService, mockAnswerService, mockRetryService,
+    dummyRetryTiming, limits);
+
+  auto sps = problemManager->addProblems(problemIds);
+  ASSERT_EQ(problemIds.size(), sps.size());
+  for (size_t i = 0; i < sps.size(); ++i) EXPECT_EQ(problemIds[i], sps[i]->problemId());
+
+  EXPECT_THAT(querySizes, ElementsAre(100u, 100u, 50u));
+  EXPECT_EQ(problemIds, queriedIds);
+
+  EXPECT_TRUE(problemManager->addProblems(vector<string>()).empty());
+}
+
+
+
 TEST(ProblemManagerTest, problemStatus) {
   auto problemId = string("2345");
 
@@ -655,6 +705,263 @@ TEST(ProblemManagerTest, answer) {
 
 
 
+TEST(ProblemManagerTest, answerCached) {
+  auto problemType = string("trouble");
+  auto problemId = string("12345");
+  auto problemIds = vector<string>(1, problemId);
+  StatusSapiCallbackPtr statusCallback;
+
+  auto expectedAnswer = (o, "data", (a, 7, 8, 9)).value();
+
+  auto mockSapiService = make_shared<MockSapiService>();
+  EXPECT_CALL(*mockSapiService, fetchSolversImpl(_)).Times(0);
+  EXPECT_CALL(*mockSapiService, submitProblemsImpl(_, _)).Times(0);
+  EXPECT_CALL(*mockSapiService, multiProblemStatusImpl(problemIds, _)).WillOnce(SaveArg<1>(&statusCallback));
+  EXPECT_CALL(*mockSapiService, fetchAnswerImpl(problemId, _))
+      .WillOnce(WithArg<1>(CompleteWithAnswer(problemType, expectedAnswer)));
+  EXPECT_CALL(*mockSapiService, cancelProblemsImpl(_, _)).Times(0);
+
+  auto mockAnswerService = make_shared<MockAnswerService>();
+  EXPECT_CALL(*mockAnswerService, postAnswerImpl(_, _, _)).Times(3).WillRepeatedly(Invoke(CompleteAnswerCallback));
+
+  auto mockRetryService = make_shared<NiceMock<MockRetryTimerService>>();
+  const ProblemManagerLimits limits = {1, 1, 1, 1 << 20, 0, 0, 0, 0, RequestSchedule(), AdaptiveLimits()};
+  auto problemManager = makeProblemManager(mockSapiService, mockAnswerService, mockRetryService,
+    dummyRetryTiming, limits);
+
+  auto sp = problemManager->addProblem(problemId);
+  ASSERT_TRUE(!!statusCallback);
+  vector<RemoteProblemInfo> statusInfo;
+  statusInfo.push_back(makeProblemInfo(problemId, problemType, remotestatuses::COMPLETED));
+  statusCallback->complete(statusInfo);
+
+  for (auto i = 0; i < 3; ++i) {
+    auto answer = sp->answer();
+    EXPECT_EQ(problemType, get<0>(answer));
+    EXPECT_EQ(expectedAnswer, get<1>(answer));
+  }
+
+  auto stats = problemManager->stats().answerCache;
+  EXPECT_EQ(2u, stats.hits);
+  EXPECT_EQ(1u, stats.misses);
+  EXPECT_EQ(1u, stats.entries);
+  EXPECT_GT(stats.bytes, 0u);
+}
+
+
+
+TEST(ProblemManagerTest, answerPrefetch) {
+  auto problemType = string("trouble");
+  StatusSapiCallbackPtr statusCallback1;
+  StatusSapiCallbackPtr statusCallback2;
+  FetchAnswerSapiCallbackPtr fetchCallback1;
+  FetchAnswerSapiCallbackPtr fetchCallback2;
+
+  auto expectedAnswer = (o, "data", 789).value();
+
+  auto mockSapiService = make_shared<MockSapiService>();
+  EXPECT_CALL(*mockSapiService, fetchSolversImpl(_)).Times(0);
+  EXPECT_CALL(*mockSapiService, submitProblemsImpl(_, _)).Times(0);
+  EXPECT_CALL(*mockSapiService, multiProblemStatusImpl(vector<string>(1, "p1"), _))
+      .WillOnce(SaveArg<1>(&statusCallback1));
+  EXPECT_CALL(*mockSapiService, multiProblemStatusImpl(vector<string>(1, "p2"), _))
+      .WillOnce(SaveArg<1>(&statusCallback2));
+  EXPECT_CALL(*mockSapiService, fetchAnswerImpl("p1", _)).WillOnce(SaveArg<1>(&fetchCallback1));
+  EXPECT_CALL(*mockSapiService, fetchAnswerImpl("p2", _)).WillOnce(SaveArg<1>(&fetchCallback2));
+  EXPECT_CALL(*mockSapiService, cancelProblemsImpl(_, _)).Times(0);
+
+  auto mockAnswerService = make_shared<MockAnswerService>();
+  EXPECT_CALL(*mockAnswerService, postAnswerImpl(_, _, _)).WillOnce(Invoke(CompleteAnswerCallback));
+
+  auto mockRetryService = make_shared<NiceMock<MockRetryTimerService>>();
+  const ProblemManagerLimits limits = {1, 1, 2, 1 << 20, 1, 0, 0, 0, RequestSchedule(), AdaptiveLimits()};
+  auto problemManager = makeProblemManager(mockSapiService, mockAnswerService, mockRetryService,
+    dummyRetryTiming, limits);
+
+  auto sp1 = problemManager->addProblem("p1");
+  auto sp2 = problemManager->addProblem("p2");
+  ASSERT_TRUE(!!statusCallback1);
+  statusCallback1->complete(vector<RemoteProblemInfo>(1,
+      makeProblemInfo("p1", problemType, remotestatuses::COMPLETED)));
+  ASSERT_TRUE(!!statusCallback2);
+  statusCallback2->complete(vector<RemoteProblemInfo>(1,
+      makeProblemInfo("p2", problemType, remotestatuses::COMPLETED)));
+
+  // one prefetch at a time
+  ASSERT_TRUE(!!fetchCallback1);
+  EXPECT_FALSE(!!fetchCallback2);
+  fetchCallback1->complete(problemType, expectedAnswer);
+  ASSERT_TRUE(!!fetchCallback2);
+  fetchCallback2->complete(problemType, expectedAnswer);
+
+  // answer is already here
+  auto answer = sp1->answer();
+  EXPECT_EQ(problemType, get<0>(answer));
+  EXPECT_EQ(expectedAnswer, get<1>(answer));
+  EXPECT_EQ(2u, problemManager->stats().answerCache.entries);
+}
+
+
+
+TEST(ProblemManagerTest, scheduledPolls) {
+  auto problemType = string("slow");
+  StatusSapiCallbackPtr statusCallback1;
+  StatusSapiCallbackPtr statusCallback2;
+  StatusSapiCallbackPtr statusCallback3;
+  RetryNotifiableWeakPtr pollNotifiable;
+
+  auto mockSapiService = make_shared<MockSapiService>();
+  EXPECT_CALL(*mockSapiService, fetchSolversImpl(_)).Times(0);
+  EXPECT_CALL(*mockSapiService, submitProblemsImpl(_, _)).Times(0);
+  EXPECT_CALL(*mockSapiService, multiProblemStatusImpl(vector<string>(1, "p1"), _))
+      .WillOnce(SaveArg<1>(&statusCallback1));
+  EXPECT_CALL(*mockSapiService, multiProblemStatusImpl(vector<string>(1, "p2"), _))
+      .WillOnce(SaveArg<1>(&statusCallback2))
+      .WillOnce(SaveArg<1>(&statusCallback3));
+  EXPECT_CALL(*mockSapiService, fetchAnswerImpl(_, _)).Times(0);
+  EXPECT_CALL(*mockSapiService, cancelProblemsImpl(_, _)).Times(0);
+
+  auto mockPollTimer = make_shared<StrictMock<MockPollTimer>>();
+  {
+    InSequence s;
+    EXPECT_CALL(*mockPollTimer, scheduleImpl(AllOf(Ge(4000), Le(5000)))); // p1: estimate, clamped
+    EXPECT_CALL(*mockPollTimer, scheduleImpl(AllOf(Ge(50), Le(100))));    // p2: young, minimum interval
+    EXPECT_CALL(*mockPollTimer, scheduleImpl(AllOf(Ge(4000), Le(5000)))); // p1 still waiting
+  }
+
+  auto mockAnswerService = make_shared<NiceMock<MockAnswerService>>();
+  auto mockRetryService = make_shared<NiceMock<MockRetryTimerService>>();
+  EXPECT_CALL(*mockRetryService, createPollTimerImpl(_))
+      .WillOnce(DoAll(SaveArg<0>(&pollNotifiable), Return(mockPollTimer)));
+  const ProblemManagerLimits limits = {1, 1, 1, 0, 0, 100, 5000, 0, RequestSchedule(), AdaptiveLimits()};
+  auto problemManager = makeProblemManager(mockSapiService, mockAnswerService, mockRetryService,
+    dummyRetryTiming, limits);
+
+  auto sp1 = problemManager->addProblem("p1");
+  auto sp2 = problemManager->addProblem("p2");
+
+  auto p1Info = makeProblemInfo("p1", problemType, remotestatuses::PENDING);
+  p1Info.earliestCompletion = "2999-01-01T00:00:00.000Z";
+  ASSERT_TRUE(!!statusCallback1);
+  statusCallback1->complete(vector<RemoteProblemInfo>(1, p1Info));
+  ASSERT_TRUE(!!statusCallback2);
+  statusCallback2->complete(vector<RemoteProblemInfo>(1,
+      makeProblemInfo("p2", problemType, remotestatuses::IN_PROGRESS)));
+
+  // nothing polled until the timer fires
+  EXPECT_FALSE(!!statusCallback3);
+  // the timer fires for p2's poll, not for p1's
+  auto pn = pollNotifiable.lock();
+  ASSERT_TRUE(!!pn);
+  pn->notify();
+  EXPECT_TRUE(!!statusCallback3);
+  EXPECT_FALSE(sp1->done());
+  EXPECT_FALSE(sp2->done());
+}
+
+
+
+TEST(ProblemManagerTest, submitPriority) {
+  vector<string> submitted;
+  StatusSapiCallbackPtr submitCallback;
+  auto saveSubmission = [&](vector<Problem>& problems, StatusSapiCallbackPtr callback) {
+    submitted.push_back(problems.at(0).solver());
+    submitCallback = callback;
+  };
+
+  auto mockSapiService = make_shared<NiceMock<MockSapiService>>();
+  EXPECT_CALL(*mockSapiService, submitProblemsImpl(_, _)).Times(4).WillRepeatedly(Invoke(saveSubmission));
+
+  auto mockAnswerService = make_shared<NiceMock<MockAnswerService>>();
+  auto mockRetryService = make_shared<NiceMock<MockRetryTimerService>>();
+  auto problemManager = makeProblemManager(mockSapiService, mockAnswerService, mockRetryService,
+    dummyRetryTiming, minLimits);
+
+  auto data = (a, 1).value();
+  auto params = json::Object();
+  vector<sapiremote::SubmittedProblemPtr> sps;
+  sps.push_back(problemManager->submitProblem("first", "ising", data, params));
+  sps.push_back(problemManager->submitProblem("low1", "ising", data, params, -1));
+  sps.push_back(problemManager->submitProblem("high", "ising", data, params, 5));
+  sps.push_back(problemManager->submitProblem("low2", "ising", data, params, -1));
+
+  auto stats = problemManager->stats().requests[sapiremote::requestclasses::SUBMIT];
+  EXPECT_EQ(3u, stats.queueDepth);
+  EXPECT_EQ(1, stats.activeRequests);
+
+  for (auto i = 0; i < 3; ++i) {
+    ASSERT_TRUE(!!submitCallback);
+    auto callback = submitCallback;
+    submitCallback.reset();
+    callback->complete(vector<RemoteProblemInfo>(1,
+        makeProblemInfo("p" + std::to_string(i), "ising", remotestatuses::COMPLETED)));
+  }
+  EXPECT_THAT(submitted, ElementsAre("first", "high", "low1", "low2"));
+}
+
+
+
+TEST(ProblemManagerTest, reservedAnswerRequests) {
+  auto problemType = string("reserved");
+  StatusSapiCallbackPtr statusCallback1;
+  StatusSapiCallbackPtr statusCallback2;
+  FetchAnswerSapiCallbackPtr fetchCallback;
+
+  auto mockSapiService = make_shared<MockSapiService>();
+  EXPECT_CALL(*mockSapiService, fetchSolversImpl(_)).Times(0);
+  EXPECT_CALL(*mockSapiService, submitProblemsImpl(_, _)).Times(0);
+  EXPECT_CALL(*mockSapiService, multiProblemStatusImpl(vector<string>(1, "p1"), _))
+      .WillOnce(SaveArg<1>(&statusCallback1));
+  EXPECT_CALL(*mockSapiService, multiProblemStatusImpl(vector<string>(1, "p2"), _))
+      .WillOnce(SaveArg<1>(&statusCallback2));
+  EXPECT_CALL(*mockSapiService, multiProblemStatusImpl(vector<string>(1, "p3"), _)).Times(0);
+  EXPECT_CALL(*mockSapiService, fetchAnswerImpl("p1", _)).WillOnce(SaveArg<1>(&fetchCallback));
+  EXPECT_CALL(*mockSapiService, cancelProblemsImpl(_, _)).Times(0);
+
+  auto mockAnswerService = make_shared<NiceMock<MockAnswerService>>();
+  auto mockRetryService = make_shared<NiceMock<MockRetryTimerService>>();
+  auto limits = ProblemManagerLimits();
+  limits.maxProblemsPerSubmission = 1;
+  limits.maxIdsPerStatusQuery = 1;
+  limits.maxActiveRequests = 2;
+  limits.schedule.reserved[sapiremote::requestclasses::ANSWER] = 1;
+  auto problemManager = makeProblemManager(mockSapiService, mockAnswerService, mockRetryService,
+    dummyRetryTiming, limits);
+
+  // status queries get one request slot; the other is kept for answers
+  auto sp1 = problemManager->addProblem("p1");
+  auto sp2 = problemManager->addProblem("p2");
+  auto sp3 = problemManager->addProblem("p3");
+  auto stats = problemManager->stats().requests[sapiremote::requestclasses::STATUS];
+  EXPECT_EQ(1, stats.activeRequests);
+  EXPECT_EQ(2u, stats.queueDepth);
+  EXPECT_EQ(1u, stats.wait.samples);
+
+  ASSERT_TRUE(!!statusCallback1);
+  statusCallback1->complete(vector<RemoteProblemInfo>(1,
+      makeProblemInfo("p1", problemType, remotestatuses::COMPLETED)));
+  ASSERT_TRUE(!!statusCallback2);
+
+  // answer fetch isn't stuck behind p3's status query
+  sp1->answer(make_shared<NiceMock<MockAnswerCallback>>());
+  EXPECT_TRUE(!!fetchCallback);
+  EXPECT_EQ(1, problemManager->stats().requests[sapiremote::requestclasses::ANSWER].activeRequests);
+}
+
+
+
+TEST(ProblemManagerTest, invalidSchedule) {
+  auto mockSapiService = make_shared<NiceMock<MockSapiService>>();
+  auto mockAnswerService = make_shared<NiceMock<MockAnswerService>>();
+  auto mockRetryService = make_shared<NiceMock<MockRetryTimerService>>();
+  auto limits = minLimits;
+  limits.schedule.reserved[sapiremote::requestclasses::ANSWER] = 2;
+  EXPECT_THROW(makeProblemManager(mockSapiService, mockAnswerService, mockRetryService, dummyRetryTiming, limits),
+      std::invalid_argument);
+}
+
+
+
 TEST(ProblemManagerTest, answerCallback) {
   auto problemType = string("blarg");
   auto problemId = string("3456");
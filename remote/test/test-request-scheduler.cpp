@@ -0,0 +1,133 @@
+//Copyright © 2019 D-Wave Systems Inc.
+//The software is licensed to authorized users only under the applicable license agreement.  See License.txt.
+
+#include <stdexcept>
+
+#include <gtest/gtest.h>
+
+#include <request-scheduler.hpp>
+
+using sapiremote::RequestSchedule;
+using sapiremote::RequestScheduler;
+
+namespace requestclasses = sapiremote::requestclasses;
+
+namespace {
+
+bool skipNone(requestclasses::Type) { return false; }
+
+} // namespace {anonymous}
+
+TEST(RequestSchedulerTest, weights) {
+  auto schedule = RequestSchedule();
+  schedule.weights[requestclasses::SUBMIT] = 3;
+  schedule.weights[requestclasses::ANSWER] = 1;
+  RequestScheduler scheduler(1, schedule);
+
+  int sent[requestclasses::count] = {};
+  for (auto i = 0; i < 400; ++i) {
+    scheduler.push(requestclasses::SUBMIT);
+    scheduler.push(requestclasses::ANSWER);
+    auto c = scheduler.next(skipNone);
+    ASSERT_GE(c, 0);
+    ++sent[c];
+    EXPECT_EQ(-1, scheduler.next(skipNone)); // only one slot
+    scheduler.release(static_cast<requestclasses::Type>(c));
+  }
+  EXPECT_EQ(300, sent[requestclasses::SUBMIT]);
+  EXPECT_EQ(100, sent[requestclasses::ANSWER]);
+  EXPECT_EQ(0, sent[requestclasses::STATUS]);
+  EXPECT_EQ(0, sent[requestclasses::CANCEL]);
+}
+
+TEST(RequestSchedulerTest, defaultsToFifo) {
+  RequestScheduler scheduler(4, RequestSchedule());
+  scheduler.push(requestclasses::ANSWER);
+  scheduler.push(requestclasses::ANSWER);
+  scheduler.push(requestclasses::SUBMIT);
+  EXPECT_EQ(requestclasses::ANSWER, scheduler.next(skipNone));
+  EXPECT_EQ(requestclasses::SUBMIT, scheduler.next(skipNone));
+  EXPECT_EQ(-1, scheduler.next(skipNone));
+
+  auto stats = scheduler.stats(requestclasses::ANSWER);
+  EXPECT_EQ(1, stats.activeRequests);
+  EXPECT_EQ(1u, stats.wait.samples);
+  scheduler.release(requestclasses::ANSWER);
+  EXPECT_EQ(0, scheduler.stats(requestclasses::ANSWER).activeRequests);
+}
+
+TEST(RequestSchedulerTest, reserved) {
+  auto schedule = RequestSchedule();
+  schedule.reserved[requestclasses::ANSWER] = 1;
+  schedule.reserved[requestclasses::CANCEL] = 1;
+  RequestScheduler scheduler(3, schedule);
+
+  scheduler.push(requestclasses::SUBMIT);
+  EXPECT_EQ(requestclasses::SUBMIT, scheduler.next(skipNone));
+  scheduler.push(requestclasses::SUBMIT);
+  EXPECT_EQ(-1, scheduler.next(skipNone));
+
+  scheduler.push(requestclasses::ANSWER);
+  EXPECT_EQ(requestclasses::ANSWER, scheduler.next(skipNone));
+  scheduler.push(requestclasses::ANSWER);
+  EXPECT_EQ(-1, scheduler.next(skipNone));
+
+  scheduler.push(requestclasses::CANCEL);
+  EXPECT_EQ(requestclasses::CANCEL, scheduler.next(skipNone));
+
+  // the answer request finishing frees its reserved slot only
+  scheduler.release(requestclasses::ANSWER);
+  EXPECT_EQ(requestclasses::ANSWER, scheduler.next(skipNone));
+  scheduler.release(requestclasses::SUBMIT);
+  EXPECT_EQ(requestclasses::SUBMIT, scheduler.next(skipNone));
+}
+
+TEST(RequestSchedulerTest, skip) {
+  RequestScheduler scheduler(2, RequestSchedule());
+  scheduler.push(requestclasses::STATUS);
+  scheduler.push(requestclasses::CANCEL);
+  auto skipStatus = [](requestclasses::Type c) { return c == requestclasses::STATUS; };
+  EXPECT_EQ(requestclasses::CANCEL, scheduler.next(skipStatus));
+  EXPECT_EQ(-1, scheduler.next(skipStatus));
+  EXPECT_EQ(requestclasses::STATUS, scheduler.next(skipNone));
+}
+
+TEST(RequestSchedulerTest, invalidSchedule) {
+  auto schedule = RequestSchedule();
+  schedule.weights[requestclasses::STATUS] = -1;
+  EXPECT_THROW(RequestScheduler(1, schedule), std::invalid_argument);
+
+  schedule = RequestSchedule();
+  schedule.reserved[requestclasses::STATUS] = -1;
+  EXPECT_THROW(RequestScheduler(1, schedule), std::invalid_argument);
+
+  schedule = RequestSchedule();
+  schedule.reserved[requestclasses::STATUS] = 1;
+  schedule.reserved[requestclasses::ANSWER] = 1;
+  EXPECT_THROW(RequestScheduler(1, schedule), std::invalid_argument);
+  EXPECT_NO_THROW(RequestScheduler(2, schedule));
+}
+
+TEST(RequestSchedulerTest, setSlots) {
+  auto schedule = RequestSchedule();
+  schedule.reserved[requestclasses::ANSWER] = 1;
+  RequestScheduler scheduler(3, schedule);
+
+  scheduler.push(requestclasses::SUBMIT);
+  EXPECT_EQ(requestclasses::SUBMIT, scheduler.next(skipNone));
+  scheduler.push(requestclasses::SUBMIT);
+  EXPECT_EQ(requestclasses::SUBMIT, scheduler.next(skipNone));
+
+  // shrinking doesn't take back slots already given out
+  scheduler.setSlots(2);
+  scheduler.release(requestclasses::SUBMIT);
+  scheduler.push(requestclasses::SUBMIT);
+  EXPECT_EQ(-1, scheduler.next(skipNone));
+  scheduler.push(requestclasses::ANSWER);
+  EXPECT_EQ(requestclasses::ANSWER, scheduler.next(skipNone));
+
+  scheduler.setSlots(3);
+  EXPECT_EQ(requestclasses::SUBMIT, scheduler.next(skipNone));
+
+  EXPECT_THROW(scheduler.setSlots(0), std::invalid_argument);
+}
@@ -0,0 +1,164 @@
+//Copyright © 2019 D-Wave Systems Inc.
+//The software is licensed to authorized users only under the applicable license agreement.  See License.txt.
+
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/foreach.hpp>
+
+#include <gtest/gtest.h>
+
+#include <sapi-service.hpp>
+#include <retry-service.hpp>
+#include <answer-service.hpp>
+#include <problem-manager.hpp>
+#include <threadpool.hpp>
+#include <json.hpp>
+
+#include "test.hpp"
+
+using std::atomic;
+using std::exception_ptr;
+using std::make_shared;
+using std::shared_ptr;
+using std::string;
+using std::vector;
+using std::chrono::steady_clock;
+using std::chrono::milliseconds;
+using std::chrono::seconds;
+using std::chrono::duration_cast;
+
+using sapiremote::AnswerCallback;
+using sapiremote::RetryTiming;
+using sapiremote::SubmittedProblemPtr;
+using sapiremote::makeAnswerService;
+using sapiremote::makeProblemManager;
+using sapiremote::makeRetryTimerService;
+using sapiremote::makeThreadPool;
+
+namespace submittedstates = sapiremote::submittedstates;
+
+namespace {
+
+class IgnoreAnswer : public AnswerCallback {
+private:
+  virtual void answerImpl(string&, json::Value&) {}
+  virtual void errorImpl(exception_ptr) {}
+};
+
+class CountAnswer : public AnswerCallback {
+private:
+  shared_ptr<atomic<int>> answers_;
+  virtual void answerImpl(string&, json::Value&) { ++*answers_; }
+  virtual void errorImpl(exception_ptr) {}
+public:
+  CountAnswer(shared_ptr<atomic<int>> answers) : answers_(answers) {}
+};
+
+bool awaitDone(const vector<SubmittedProblemPtr>& problems, steady_clock::time_point giveUp) {
+  BOOST_FOREACH( const auto& sp, problems ) {
+    while (!sp->done()) {
+      if (steady_clock::now() > giveUp) return false;
+      std::this_thread::sleep_for(milliseconds(1));
+    }
+  }
+  return true;
+}
+
+} // namespace {anonymous}
+
+TEST(RetryIsolationTest, healthyRequestsKeepFlowing) {
+  const auto numProblems = 50;
+  const auto retryDelay = milliseconds(3000);
+  const RetryTiming timing = {static_cast<int>(retryDelay.count()), 10000, 2.0f, 0.0f};
+  const auto limits = pollingLimits(1, 2, 1, 1, 0);
+
+  // new problems are pending, polled problems are completed, answer fetches fail
+  auto service = make_shared<StubSapiService>();
+  service->completeAll();
+  service->failRequests(StubSapiService::ANSWER, true);
+  auto retryService = makeRetryTimerService();
+  auto problemManager = makeProblemManager(
+      service, makeAnswerService(makeThreadPool(1)), retryService, timing, limits);
+
+  // put answer fetches into back-off
+  auto victim = problemManager->submitProblem("solver", "ising", json::Object(), json::Object());
+  ASSERT_TRUE(awaitDone(vector<SubmittedProblemPtr>(1, victim), steady_clock::now() + seconds(10)));
+  victim->answer(make_shared<IgnoreAnswer>());
+  auto giveUp = steady_clock::now() + seconds(10);
+  while (service->failedRequests(StubSapiService::ANSWER) == 0 && steady_clock::now() < giveUp) {
+    std::this_thread::sleep_for(milliseconds(1));
+  }
+  ASSERT_EQ(1, service->failedRequests(StubSapiService::ANSWER));
+  auto backoffStart = steady_clock::now();
+
+  // submissions and status polls must not wait for the answer fetch retry
+  vector<SubmittedProblemPtr> problems;
+  for (auto i = 0; i < numProblems; ++i) {
+    problems.push_back(problemManager->submitProblem("solver", "ising", json::Object(), json::Object()));
+  }
+  ASSERT_TRUE(awaitDone(problems, steady_clock::now() + seconds(10)));
+  auto elapsed = duration_cast<milliseconds>(steady_clock::now() - backoffStart);
+
+  RecordProperty("elapsedMs", static_cast<int>(elapsed.count()));
+  EXPECT_LT(elapsed, retryDelay);
+  EXPECT_EQ(1, service->failedRequests(StubSapiService::ANSWER));
+  EXPECT_EQ(numProblems + 1, service->requestCount(StubSapiService::SUBMIT));
+  EXPECT_LE(numProblems + 1, service->requestCount(StubSapiService::STATUS));
+  BOOST_FOREACH( const auto& sp, problems ) EXPECT_EQ(submittedstates::DONE, sp->status().state);
+
+  retryService->shutdown();
+  service->joinResponders();
+}
+
+TEST(RetryIsolationTest, answersFlowDuringSubmitBackoff) {
+  const auto numProblems = 20;
+  const auto retryDelay = milliseconds(3000);
+  const RetryTiming timing = {static_cast<int>(retryDelay.count()), 10000, 2.0f, 0.0f};
+  const auto limits = pollingLimits(1, 2, 1, 1, 0);
+
+  auto service = make_shared<StubSapiService>();
+  service->completeAll();
+  auto retryService = makeRetryTimerService();
+  auto problemManager = makeProblemManager(
+      service, makeAnswerService(makeThreadPool(1)), retryService, timing, limits);
+
+  vector<SubmittedProblemPtr> problems;
+  for (auto i = 0; i < numProblems; ++i) {
+    problems.push_back(problemManager->submitProblem("solver", "ising", json::Object(), json::Object()));
+  }
+  ASSERT_TRUE(awaitDone(problems, steady_clock::now() + seconds(10)));
+
+  // put submissions into back-off
+  service->failRequests(StubSapiService::SUBMIT, true);
+  auto victim = problemManager->submitProblem("solver", "ising", json::Object(), json::Object());
+  auto giveUp = steady_clock::now() + seconds(10);
+  while (service->failedRequests(StubSapiService::SUBMIT) == 0 && steady_clock::now() < giveUp) {
+    std::this_thread::sleep_for(milliseconds(1));
+  }
+  ASSERT_EQ(1, service->failedRequests(StubSapiService::SUBMIT));
+  auto backoffStart = steady_clock::now();
+
+  // answer fetches must not wait for the submission retry
+  auto answers = make_shared<atomic<int>>(0);
+  BOOST_FOREACH( const auto& sp, problems ) sp->answer(make_shared<CountAnswer>(answers));
+  giveUp = steady_clock::now() + seconds(10);
+  while (*answers < numProblems && steady_clock::now() < giveUp) {
+    std::this_thread::sleep_for(milliseconds(1));
+  }
+  auto elapsed = duration_cast<milliseconds>(steady_clock::now() - backoffStart);
+
+  RecordProperty("elapsedMs", static_cast<int>(elapsed.count()));
+  EXPECT_EQ(numProblems, *answers);
+  EXPECT_LT(elapsed, retryDelay);
+  EXPECT_EQ(1, service->failedRequests(StubSapiService::SUBMIT));
+  EXPECT_FALSE(victim->done());
+
+  retryService->shutdown();
+  service->joinResponders();
+}
@@ -83,22 +83,24 @@ TEST(RetryServiceTest, InvalidParams) {
   auto rts = makeRetryTimerService();
   auto rn = make_shared<Event>();
 
-  EXPECT_THROW(rts->createRetryTimer(rn, {0, 10000, 2.0f}), std::invalid_argument);
-  EXPECT_THROW(rts->createRetryTimer(rn, {10, 10000, 0.0f}), std::invalid_argument);
-  EXPECT_THROW(rts->createRetryTimer(rn, {1000, 10, 2.0f}), std::invalid_argument);
+  EXPECT_THROW(rts->createRetryTimer(rn, {0, 10000, 2.0f, 0.0f}), std::invalid_argument);
+  EXPECT_THROW(rts->createRetryTimer(rn, {10, 10000, 0.0f, 0.0f}), std::invalid_argument);
+  EXPECT_THROW(rts->createRetryTimer(rn, {1000, 10, 2.0f, 0.0f}), std::invalid_argument);
+  EXPECT_THROW(rts->createRetryTimer(rn, {10, 10000, 2.0f, -0.1f}), std::invalid_argument);
+  EXPECT_THROW(rts->createRetryTimer(rn, {10, 10000, 2.0f, 1.0f}), std::invalid_argument);
 }
 
 TEST(RetryServiceTest, ShutdownTimerCreation) {
   auto rts = makeRetryTimerService();
   rts->shutdown();
   auto rn = make_shared<Event>();
-  EXPECT_THROW(rts->createRetryTimer(rn, {1, 10, 2.0f}), ServiceShutdownException);
+  EXPECT_THROW(rts->createRetryTimer(rn, {1, 10, 2.0f, 0.0f}), ServiceShutdownException);
 }
 
 TEST(RetryServiceTest, ShutdownTimerRetry) {
   auto rts = makeRetryTimerService();
   auto rn = make_shared<Event>();
-  auto timing = RetryTiming{1, 2, 3.0f};
+  auto timing = RetryTiming{1, 2, 3.0f, 0.0f};
   auto timer = rts->createRetryTimer(rn, timing);
   rts->shutdown();
   EXPECT_EQ(RetryTimer::SHUTDOWN, timer->retry());
@@ -107,7 +109,20 @@ TEST(RetryServiceTest, ShutdownTimerRetry) {
 TEST(RetryServiceTest, SufficientDelay) {
   auto rts = makeRetryTimerService();
   auto event = make_shared<Event>();
-  auto timing = RetryTiming{100, 100000, 1e3f};
+  auto timing = RetryTiming{100, 100000, 1e3f, 0.0f};
+  auto timer = rts->createRetryTimer(event, timing);
+
+  auto startTime = steady_clock::now();
+  EXPECT_EQ(RetryTimer::RETRY, timer->retry());
+  EXPECT_TRUE(event->wait(5000));
+  auto endTime = steady_clock::now();
+  EXPECT_LE(milliseconds(100), endTime - startTime);
+}
+
+TEST(RetryServiceTest, JitteredDelay) {
+  auto rts = makeRetryTimerService();
+  auto event = make_shared<Event>();
+  auto timing = RetryTiming{200, 100000, 1e3f, 0.5f};
   auto timer = rts->createRetryTimer(event, timing);
 
   auto startTime = steady_clock::now();
@@ -120,7 +135,7 @@ TEST(RetryServiceTest, SufficientDelay) {
 TEST(RetryServiceTest, RetryFails) {
   auto rts = makeRetryTimerService();
   auto event = make_shared<Event>();
-  auto timing = RetryTiming{20, 40, 1.5f}; // 20 30 40
+  auto timing = RetryTiming{20, 40, 1.5f, 0.0f}; // 20 30 40
   auto timer = rts->createRetryTimer(event, timing);
 
   EXPECT_EQ(RetryTimer::RETRY, timer->retry());
@@ -144,7 +159,7 @@ TEST(RetryServiceTest, RetryFails) {
 TEST(RetryServiceTest, RetryIgnoreWhileWaiting) {
   auto rts = makeRetryTimerService();
   auto event = make_shared<Event>();
-  auto timing = RetryTiming{100, 150, 2.0f}; // 100 150
+  auto timing = RetryTiming{100, 150, 2.0f, 0.0f}; // 100 150
   auto timer = rts->createRetryTimer(event, timing);
 
   EXPECT_EQ(RetryTimer::RETRY, timer->retry());
@@ -168,7 +183,7 @@ TEST(RetryServiceTest, RetryIgnoreWhileWaiting) {
 TEST(RetryServiceTest, Success) {
   auto rts = makeRetryTimerService();
   auto event = make_shared<Event>();
-  auto timing = RetryTiming{10, 10000, 1e3f}; // 10 10000
+  auto timing = RetryTiming{10, 10000, 1e3f, 0.0f}; // 10 10000
   auto timer = rts->createRetryTimer(event, timing);
 
   EXPECT_EQ(RetryTimer::RETRY, timer->retry());
@@ -180,3 +195,31 @@ TEST(RetryServiceTest, Success) {
   EXPECT_TRUE(event->wait(5000));
   event->reset();
 }
+
+TEST(RetryServiceTest, PollTimerKeepsEarliest) {
+  auto rts = makeRetryTimerService();
+  auto event = make_shared<Event>();
+  auto timer = rts->createPollTimer(event);
+
+  auto startTime = steady_clock::now();
+  timer->schedule(50);
+  timer->schedule(10000); // later; ignored
+  EXPECT_TRUE(event->wait(5000));
+  auto endTime = steady_clock::now();
+  EXPECT_LE(milliseconds(50), endTime - startTime);
+  event->reset();
+
+  timer->schedule(10000);
+  timer->schedule(20); // earlier; replaces
+  EXPECT_TRUE(event->wait(5000));
+}
+
+TEST(RetryServiceTest, ShutdownPollTimer) {
+  auto rts = makeRetryTimerService();
+  auto event = make_shared<Event>();
+  auto timer = rts->createPollTimer(event);
+  rts->shutdown();
+  timer->schedule(0);
+  EXPECT_FALSE(event->wait(100));
+  EXPECT_THROW(rts->createPollTimer(event), ServiceShutdownException);
+}
@@ -1,6 +1,8 @@
 //Copyright © 2019 D-Wave Systems Inc.
 //The software is licensed to authorized users only under the applicable license agreement.  See License.txt.
 
+#include <cstddef>
+#include <cstdio>
 #include <exception>
 #include <memory>
 #include <stdexcept>
@@ -13,31 +15,44 @@
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
 
+#include <coding.hpp>
 #include <exceptions.hpp>
+#include <gzip.hpp>
 #include <http-service.hpp>
 #include <sapi-service.hpp>
+#include <solver-cache.hpp>
 
 #include "test.hpp"
 #include "json-builder.hpp"
 
 using std::exception_ptr;
+using std::make_exception_ptr;
 using std::make_shared;
 using std::rethrow_exception;
+using std::shared_ptr;
 using std::string;
 using std::unique_ptr;
 using std::vector;
+using std::size_t;
 
 using testing::SaveArg;
+using testing::DoAll;
 using testing::Eq;
 using testing::ElementsAre;
 using testing::AtLeast;
 using testing::Invoke;
+using testing::Not;
 using testing::_;
 
 using sapiremote::http::HttpService;
 using sapiremote::http::HttpHeaders;
+using sapiremote::http::HttpServiceStats;
+using sapiremote::SapiServiceOptions;
+using sapiremote::SapiServiceStats;
 using sapiremote::http::Proxy;
 using sapiremote::http::HttpCallbackPtr;
+using sapiremote::http::HttpResult;
+using sapiremote::http::TransferInfo;
 
 using sapiremote::SapiService;
 using sapiremote::SolversSapiCallback;
@@ -48,15 +63,18 @@ using sapiremote::CancelSapiCallback;
 using sapiremote::FetchAnswerSapiCallback;
 using sapiremote::FetchAnswerSapiCallbackPtr;
 using sapiremote::SolverInfo;
+using sapiremote::SolverCache;
 using sapiremote::RemoteProblemInfo;
 using sapiremote::makeSapiService;
 using sapiremote::SolveException;
 using sapiremote::ProblemCancelledException;
 using sapiremote::NoAnswerException;
 using sapiremote::AuthenticationException;
+using sapiremote::TooManyProblemIdsException;
 using sapiremote::Problem;
 
 namespace remotestatuses = sapiremote::remotestatuses;
+namespace endpoints = sapiremote::endpoints;
 
 namespace {
 
@@ -72,6 +90,7 @@ public:
   MOCK_METHOD5(asyncDeleteImpl, void(
       const string& url, const HttpHeaders& headers, string& data, const Proxy& proxy, HttpCallbackPtr callback));
   MOCK_METHOD0(shutdownImpl, void());
+  MOCK_CONST_METHOD0(statsImpl, HttpServiceStats());
 };
 
 class MockSolverSapiCallback : public SolversSapiCallback {
@@ -116,6 +135,22 @@ MATCHER_P(EqJson, matchJson, "") {
   }
 }
 
+MATCHER_P(EqGzipJson, matchJson, "") {
+  try {
+    auto argJson = json::stringToJson(sapiremote::gzipDecompress(arg));
+    return argJson == matchJson;
+  } catch (sapiremote::DecodingException&) {
+    return false;
+  } catch (json::ParseException&) {
+    return false;
+  }
+}
+
+MATCHER_P2(HasHeader, name, value, "") {
+  auto iter = arg.find(name);
+  return iter != arg.end() && iter->second == value;
+}
+
 const auto solversPath = "solvers/remote/";
 const auto problemsPath = "problems/";
 
@@ -216,6 +251,59 @@ TEST(SapiServiceTest, fetchSolversAuthFailure) {
 
 
 
+TEST(SapiServiceTest, fetchSolversCached) {
+  const auto baseUrl = string("test://solver-cache/");
+  auto options = SapiServiceOptions();
+  options.solverCacheDir = testing::TempDir();
+  std::remove(SolverCache(options.solverCacheDir, "").path(baseUrl + solversPath).c_str());
+
+  HttpCallbackPtr httpCallback;
+  HttpHeaders headers;
+  vector<SolverInfo> solvers;
+
+  auto mockHttpService = make_shared<MockHttpService>();
+  EXPECT_CALL(*mockHttpService, asyncPostImpl(_, _, _, _, _)).Times(0);
+  EXPECT_CALL(*mockHttpService, asyncDeleteImpl(_, _, _, _, _)).Times(0);
+  EXPECT_CALL(*mockHttpService, shutdownImpl()).Times(0);
+  EXPECT_CALL(*mockHttpService, asyncGetImpl(Eq(baseUrl + solversPath), _, _, _)).Times(2)
+      .WillRepeatedly(DoAll(SaveArg<1>(&headers), SaveArg<3>(&httpCallback)));
+
+  auto expectedSolver1 = makeSolverInfo("solver1", (o, "qubits", (a, 0, 1), "couplers", (a, (a, 0, 1))));
+  auto expectedSolver2 = makeSolverInfo("solver2", (o, "stuff", (a, 1, "two", json::Null())));
+
+  auto mockSolverSapiCallback = make_shared<MockSolverSapiCallback>();
+  EXPECT_CALL(*mockSolverSapiCallback, errorImpl(_)).Times(0);
+  EXPECT_CALL(*mockSolverSapiCallback, completeImpl(ElementsAre(expectedSolver1, expectedSolver2))).Times(2)
+      .WillRepeatedly(SaveArg<0>(&solvers));
+
+  auto sapiService = makeSapiService(mockHttpService, baseUrl, "", Proxy(), options);
+
+  // nothing cached yet: unconditional request; response has an ETag so the list is stored
+  sapiService->fetchSolvers(mockSolverSapiCallback);
+  ASSERT_TRUE(!!httpCallback);
+  EXPECT_EQ(0u, headers.count("If-None-Match"));
+  auto solverData = (a,
+      (o, "id", expectedSolver1.id, "properties", expectedSolver1.properties),
+      (o, "id", expectedSolver2.id, "properties", expectedSolver2.properties)).value();
+  HttpResult result = { 200, make_shared<string>(json::jsonToString(solverData)), TransferInfo(), "\"v1\"" };
+  httpCallback->complete(result);
+
+  // revalidated: 304 delivers the cached list, qubit and coupler tables included
+  httpCallback.reset();
+  sapiService->fetchSolvers(mockSolverSapiCallback);
+  ASSERT_TRUE(!!httpCallback);
+  EXPECT_EQ("\"v1\"", headers["If-None-Match"]);
+  HttpResult notModified = { 304, make_shared<string>(), TransferInfo(), "\"v1\"" };
+  httpCallback->complete(notModified);
+
+  ASSERT_EQ(2u, solvers.size());
+  ASSERT_TRUE(!!solvers[0].qpInfo);
+  EXPECT_EQ(vector<int>({0, 1}), solvers[0].qpInfo->qubits);
+  EXPECT_FALSE(!!solvers[1].qpInfo);
+}
+
+
+
 TEST(SapiServiceTest, submitProblem) {
   const auto baseUrl = string("test://test/");
 
@@ -252,6 +340,94 @@ TEST(SapiServiceTest, submitProblem) {
 
 
 
+TEST(SapiServiceTest, problemCopiesSharePayload) {
+  auto problem = Problem("solver", "type", (a, string(1000, 'x')).value(), (o, "p", 1).object());
+  auto copy = problem;
+  EXPECT_EQ(&problem.data(), &copy.data());
+  EXPECT_EQ(&problem.params(), &copy.params());
+
+  auto empty = Problem();
+  EXPECT_EQ("", empty.solver());
+  EXPECT_TRUE(empty.data().isNull());
+}
+
+
+
+TEST(SapiServiceTest, submitProblemGzip) {
+  const auto baseUrl = string("test://test/");
+
+  HttpCallbackPtr httpCallback;
+  auto solver = "solver-123";
+  auto problemType = "magic";
+  auto problemData = (a, string(1000, 'A'), string(1000, 'B')).array();
+  auto problemParams = (o, "good", false).object();
+  auto postData = (a, (o, "solver", solver, "type", problemType, "data", problemData, "params", problemParams)).value();
+  const auto jsonSize = json::jsonToString(postData).size();
+
+  auto mockHttpService = make_shared<MockHttpService>();
+  EXPECT_CALL(*mockHttpService, asyncGetImpl(_, _, _, _)).Times(0);
+  EXPECT_CALL(*mockHttpService, asyncDeleteImpl(_, _, _, _, _)).Times(0);
+  EXPECT_CALL(*mockHttpService, shutdownImpl()).Times(0);
+  EXPECT_CALL(*mockHttpService, asyncPostImpl(Eq(baseUrl + problemsPath),
+      HasHeader("Content-Encoding", "gzip"), EqGzipJson(postData), _, _)).WillOnce(SaveArg<4>(&httpCallback));
+
+  RemoteProblemInfo pi = makeProblemInfo("problem-002", problemType, remotestatuses::IN_PROGRESS);
+  vector<RemoteProblemInfo> pis(1, pi);
+  auto statusData = (a, (o, "id", pi.id, "type", pi.type, "status", problemStatusToString(pi.status))).array();
+
+  auto mockStatusSapiCallback = make_shared<MockStatusSapiCallback>();
+  EXPECT_CALL(*mockStatusSapiCallback, errorImpl(_)).Times(0);
+  EXPECT_CALL(*mockStatusSapiCallback, completeImpl(pis)).Times(1);
+
+  auto options = SapiServiceOptions();
+  options.gzipMinBytes = 1024;
+  auto sapiService = makeSapiService(mockHttpService, baseUrl, "", Proxy(), options);
+  vector<Problem> problems;
+  problems.push_back(Problem(solver, problemType, problemData, problemParams));
+  sapiService->submitProblems(problems, mockStatusSapiCallback);
+
+  ASSERT_TRUE(!!httpCallback);
+  httpCallback->complete(200, make_shared<string>(json::jsonToString(statusData)));
+
+  auto stats = sapiService->stats();
+  EXPECT_EQ(1u, stats.submissions);
+  EXPECT_EQ(1u, stats.gzipSubmissions);
+  EXPECT_EQ(jsonSize, stats.gzipBytesIn);
+  EXPECT_LT(stats.gzipBytesOut, stats.gzipBytesIn);
+  EXPECT_EQ(stats.gzipBytesIn - stats.gzipBytesOut, stats.lastGzipBytesSaved);
+}
+
+
+
+TEST(SapiServiceTest, submitProblemGzipBelowThreshold) {
+  const auto baseUrl = string("test://test/");
+
+  auto solver = "solver-123";
+  auto problemType = "magic";
+  auto problemData = (a, "things", json::Null(), 456).array();
+  auto problemParams = (o, "good", false).object();
+  auto postData = (a, (o, "solver", solver, "type", problemType, "data", problemData, "params", problemParams)).value();
+
+  auto mockHttpService = make_shared<MockHttpService>();
+  EXPECT_CALL(*mockHttpService, asyncGetImpl(_, _, _, _)).Times(0);
+  EXPECT_CALL(*mockHttpService, asyncDeleteImpl(_, _, _, _, _)).Times(0);
+  EXPECT_CALL(*mockHttpService, shutdownImpl()).Times(0);
+  EXPECT_CALL(*mockHttpService, asyncPostImpl(Eq(baseUrl + problemsPath),
+      Not(HasHeader("Content-Encoding", "gzip")), EqJson(postData), _, _)).Times(1);
+
+  auto options = SapiServiceOptions();
+  options.gzipMinBytes = 1024;
+  auto sapiService = makeSapiService(mockHttpService, baseUrl, "", Proxy(), options);
+  vector<Problem> problems;
+  problems.push_back(Problem(solver, problemType, problemData, problemParams));
+  sapiService->submitProblems(problems, make_shared<MockStatusSapiCallback>());
+
+  auto stats = sapiService->stats();
+  EXPECT_EQ(1u, stats.submissions);
+  EXPECT_EQ(0u, stats.gzipSubmissions);
+}
+
+
 TEST(SapiServiceTest, submitMultipleProblems) {
   const auto baseUrl = string("test://test/");
 
@@ -335,6 +511,7 @@ TEST(SapiServiceTest, multiProblemStatus) {
   vector<RemoteProblemInfo> expectedProblemInfos;
   expectedProblemInfos.push_back(makeProblemInfo("p1", "hello", remotestatuses::COMPLETED, "abc", "def"));
   expectedProblemInfos.push_back(makeProblemInfo("p2", "blarg", remotestatuses::PENDING, "1111"));
+  expectedProblemInfos.back().earliestCompletion = "2222";
   expectedProblemInfos.push_back(makeProblemInfo("", "", remotestatuses::FAILED));
   expectedProblemInfos.push_back(makeProblemInfo("p2", "blarg", remotestatuses::IN_PROGRESS, "a day ago"));
   expectedProblemInfos.push_back(makeProblemInfo("p100", "asdf", remotestatuses::CANCELED, "", "weird"));
@@ -367,7 +544,8 @@ TEST(SapiServiceTest, multiProblemStatus) {
   ASSERT_TRUE(!!httpCallback);
   auto statusData = (a,
       (o, "id", "p1", "type", "hello", "status", "COMPLETED", "submitted_on", "abc", "solved_on", "def"),
-      (o, "id", "p2", "type", "blarg", "status", "PENDING", "submitted_on", "1111"),
+      (o, "id", "p2", "type", "blarg", "status", "PENDING", "submitted_on", "1111",
+          "earliest_estimated_completion", "2222"),
       json::Null(),
       (o, "id", "p2", "type", "blarg", "status", "IN_PROGRESS", "submitted_on", "a day ago"),
       (o, "id", "p100", "type", "asdf", "status", "CANCELED", "solved_on", "weird"),
@@ -378,6 +556,38 @@ TEST(SapiServiceTest, multiProblemStatus) {
 
 
 
+TEST(SapiServiceTest, longPollStatus) {
+  const auto baseUrl = string("test://test/");
+
+  HttpCallbackPtr httpCallback;
+
+  vector<RemoteProblemInfo> expectedProblemInfos;
+  expectedProblemInfos.push_back(makeProblemInfo("p1", "hello", remotestatuses::COMPLETED));
+  expectedProblemInfos.push_back(makeProblemInfo("p2", "blarg", remotestatuses::PENDING));
+
+  auto statusUrl = baseUrl + problemsPath + "?id=p1,p2&timeout=25";
+  auto mockHttpService = make_shared<MockHttpService>();
+  EXPECT_CALL(*mockHttpService, asyncGetImpl(statusUrl, _, _, _)).WillOnce(SaveArg<3>(&httpCallback));
+  EXPECT_CALL(*mockHttpService, asyncPostImpl(_, _, _, _, _)).Times(0);
+  EXPECT_CALL(*mockHttpService, asyncDeleteImpl(_, _, _, _, _)).Times(0);
+  EXPECT_CALL(*mockHttpService, shutdownImpl()).Times(0);
+
+  auto mockStatusSapiCallback = make_shared<MockStatusSapiCallback>();
+  EXPECT_CALL(*mockStatusSapiCallback, errorImpl(_)).Times(0);
+  EXPECT_CALL(*mockStatusSapiCallback, completeImpl(expectedProblemInfos)).Times(1);
+
+  auto sapiService = makeSapiService(mockHttpService, baseUrl, "", Proxy());
+  sapiService->longPollStatus(vector<string>{"p1", "p2"}, 25, mockStatusSapiCallback);
+
+  ASSERT_TRUE(!!httpCallback);
+  auto statusData = (a,
+      (o, "id", "p1", "type", "hello", "status", "COMPLETED"),
+      (o, "id", "p2", "type", "blarg", "status", "PENDING")).array();
+  httpCallback->complete(200, make_shared<string>(json::jsonToString(statusData)));
+}
+
+
+
 TEST(SapiServiceTest, multiProblemStatusAuthFailure) {
   const auto baseUrl = string("test://test/");
 
@@ -402,6 +612,30 @@ TEST(SapiServiceTest, multiProblemStatusAuthFailure) {
 
 
 
+TEST(SapiServiceTest, multiProblemStatusUriTooLong) {
+  const auto baseUrl = string("test://test/");
+
+  HttpCallbackPtr httpCallback;
+
+  auto mockHttpService = make_shared<MockHttpService>();
+  EXPECT_CALL(*mockHttpService, asyncGetImpl(_, _, _, _)).WillOnce(SaveArg<3>(&httpCallback));
+  EXPECT_CALL(*mockHttpService, asyncPostImpl(_, _, _, _, _)).Times(0);
+  EXPECT_CALL(*mockHttpService, asyncDeleteImpl(_, _, _, _, _)).Times(0);
+  EXPECT_CALL(*mockHttpService, shutdownImpl()).Times(0);
+
+  auto mockStatusSapiCallback = make_shared<MockStatusSapiCallback>();
+  EXPECT_CALL(*mockStatusSapiCallback, errorImpl(Thrown(TooManyProblemIdsException))).Times(1);
+  EXPECT_CALL(*mockStatusSapiCallback, completeImpl(_)).Times(0);
+
+  auto sapiService = makeSapiService(mockHttpService, baseUrl, "", Proxy());
+  sapiService->longPollStatus(vector<string>{"p1", "p2"}, 25, mockStatusSapiCallback);
+
+  ASSERT_TRUE(!!httpCallback);
+  httpCallback->complete(414, make_shared<string>());
+}
+
+
+
 TEST(SapiServiceTest, fetchAnswer) {
   const auto baseUrl = string("test://test/");
   auto problemType = string("magic");
@@ -427,10 +661,116 @@ TEST(SapiServiceTest, fetchAnswer) {
   sapiService->fetchAnswer(problemId, mockFetchAnswerSapiCallback);
 
   ASSERT_TRUE(!!httpCallback);
+  EXPECT_FALSE(httpCallback->streaming()); // parsed on a callback thread, not the I/O thread
   httpCallback->complete(200, make_shared<string>(json::jsonToString(answerData)));
 }
 
+TEST(SapiServiceTest, fetchAnswerCoalesced) {
+  const auto baseUrl = string("test://test/");
+  auto problemType = string("magic");
+  const auto problemId = "12345";
+  const auto answerUrl = baseUrl + problemsPath + problemId + "/";
+
+  HttpCallbackPtr httpCallback1;
+  HttpCallbackPtr httpCallback2;
 
+  auto mockHttpService = make_shared<MockHttpService>();
+  EXPECT_CALL(*mockHttpService, asyncGetImpl(answerUrl, _, _, _))
+      .WillOnce(SaveArg<3>(&httpCallback1))
+      .WillOnce(SaveArg<3>(&httpCallback2));
+  EXPECT_CALL(*mockHttpService, asyncPostImpl(_, _, _, _, _)).Times(0);
+  EXPECT_CALL(*mockHttpService, asyncDeleteImpl(_, _, _, _, _)).Times(0);
+  EXPECT_CALL(*mockHttpService, shutdownImpl()).Times(0);
+
+  auto expectedAnswer = (a, 1, 2, 3).value();
+  auto answerData = (o, "status", "COMPLETED", "type", problemType, "answer", expectedAnswer).value();
+
+  vector<shared_ptr<MockFetchAnswerSapiCallback>> callbacks;
+  for (auto i = 0; i < 3; ++i) {
+    callbacks.push_back(make_shared<MockFetchAnswerSapiCallback>());
+    EXPECT_CALL(*callbacks.back(), errorImpl(_)).Times(0);
+    EXPECT_CALL(*callbacks.back(), completeImpl(problemType, expectedAnswer)).Times(1);
+  }
+
+  auto sapiService = makeSapiService(mockHttpService, baseUrl, "", Proxy());
+  sapiService->fetchAnswer(problemId, callbacks[0]);
+  sapiService->fetchAnswer(problemId, callbacks[1]);
+  ASSERT_TRUE(!!httpCallback1);
+  EXPECT_FALSE(!!httpCallback2);
+  EXPECT_EQ(1u, sapiService->stats().coalescedAnswerFetches);
+
+  httpCallback1->complete(200, make_shared<string>(json::jsonToString(answerData)));
+
+  // flight has landed: next fetch makes a new request
+  sapiService->fetchAnswer(problemId, callbacks[2]);
+  ASSERT_TRUE(!!httpCallback2);
+  httpCallback2->complete(200, make_shared<string>(json::jsonToString(answerData)));
+  EXPECT_EQ(1u, sapiService->stats().coalescedAnswerFetches);
+}
+
+TEST(SapiServiceTest, fetchAnswerCoalescedError) {
+  const auto baseUrl = string("test://test/");
+
+  HttpCallbackPtr httpCallback;
+
+  auto mockHttpService = make_shared<MockHttpService>();
+  EXPECT_CALL(*mockHttpService, asyncGetImpl(_, _, _, _)).WillOnce(SaveArg<3>(&httpCallback));
+  EXPECT_CALL(*mockHttpService, asyncPostImpl(_, _, _, _, _)).Times(0);
+  EXPECT_CALL(*mockHttpService, asyncDeleteImpl(_, _, _, _, _)).Times(0);
+  EXPECT_CALL(*mockHttpService, shutdownImpl()).Times(0);
+
+  auto mockFetchAnswerSapiCallback1 = make_shared<MockFetchAnswerSapiCallback>();
+  auto mockFetchAnswerSapiCallback2 = make_shared<MockFetchAnswerSapiCallback>();
+  EXPECT_CALL(*mockFetchAnswerSapiCallback1, errorImpl(_)).Times(1);
+  EXPECT_CALL(*mockFetchAnswerSapiCallback1, completeImpl(_, _)).Times(0);
+  EXPECT_CALL(*mockFetchAnswerSapiCallback2, errorImpl(_)).Times(1);
+  EXPECT_CALL(*mockFetchAnswerSapiCallback2, completeImpl(_, _)).Times(0);
+
+  auto sapiService = makeSapiService(mockHttpService, baseUrl, "", Proxy());
+  sapiService->fetchAnswer("12345", mockFetchAnswerSapiCallback1);
+  sapiService->fetchAnswer("12345", mockFetchAnswerSapiCallback2);
+  ASSERT_TRUE(!!httpCallback);
+  httpCallback->error(make_exception_ptr(std::runtime_error("oops")));
+}
+
+TEST(SapiServiceTest, fetchAnswerTransferStats) {
+  const auto baseUrl = string("test://test/");
+  auto problemType = string("magic");
+
+  HttpCallbackPtr httpCallback;
+
+  auto mockHttpService = make_shared<MockHttpService>();
+  EXPECT_CALL(*mockHttpService, asyncGetImpl(_, _, _, _)).WillOnce(SaveArg<3>(&httpCallback));
+  EXPECT_CALL(*mockHttpService, asyncPostImpl(_, _, _, _, _)).Times(0);
+  EXPECT_CALL(*mockHttpService, asyncDeleteImpl(_, _, _, _, _)).Times(0);
+  EXPECT_CALL(*mockHttpService, shutdownImpl()).Times(0);
+
+  auto expectedAnswer = (o, "x", 1).value();
+  auto answerData = (o, "status", "COMPLETED", "type", problemType, "answer", expectedAnswer).value();
+
+  auto mockFetchAnswerSapiCallback = make_shared<MockFetchAnswerSapiCallback>();
+  EXPECT_CALL(*mockFetchAnswerSapiCallback, errorImpl(_)).Times(0);
+  EXPECT_CALL(*mockFetchAnswerSapiCallback, completeImpl(problemType, expectedAnswer)).Times(1);
+
+  auto sapiService = makeSapiService(mockHttpService, baseUrl, "", Proxy());
+  sapiService->fetchAnswer("12345", mockFetchAnswerSapiCallback);
+  ASSERT_TRUE(!!httpCallback);
+
+  TransferInfo transfer = { 0.0005, 0.003, 0.010, 0.020, 0.100, 0, 1234 };
+  HttpResult result = { 200, make_shared<string>(json::jsonToString(answerData)), transfer, "" };
+  httpCallback->complete(result);
+
+  auto stats = sapiService->stats();
+  EXPECT_EQ(0u, stats.endpointStats[endpoints::STATUS].responses);
+  const auto& answerStats = stats.endpointStats[endpoints::ANSWER];
+  EXPECT_EQ(1u, answerStats.responses);
+  EXPECT_EQ(1234u, answerStats.bytesReceived);
+  EXPECT_EQ(1u, answerStats.nameLookup.buckets[0]); // < 1 ms
+  EXPECT_EQ(1u, answerStats.connect.buckets[2]);    // [2 ms, 4 ms)
+  EXPECT_EQ(1u, answerStats.total.buckets[7]);      // [64 ms, 128 ms)
+  EXPECT_EQ(1u, answerStats.total.samples);
+  EXPECT_DOUBLE_EQ(0.100, answerStats.total.maxS);
+}
 
 TEST(SapiServiceTest, fetchAnswerUnavailable) {
   const auto baseUrl = string("test://test/");
@@ -0,0 +1,132 @@
+//Copyright © 2019 D-Wave Systems Inc.
+//The software is licensed to authorized users only under the applicable license agreement.  See License.txt.
+
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <coding.hpp>
+#include <solver-cache.hpp>
+#include <json.hpp>
+
+#include "test.hpp"
+#include "json-builder.hpp"
+
+using std::ofstream;
+using std::make_pair;
+using std::pair;
+using std::string;
+using std::vector;
+
+using sapiremote::CachedSolverList;
+using sapiremote::SolverCache;
+using sapiremote::SolverInfo;
+using sapiremote::extractQpSolverInfo;
+
+namespace {
+
+auto o = jsonObject();
+auto a = jsonArray();
+
+CachedSolverList makeList() {
+  CachedSolverList list;
+  list.etag = "\"v1\"";
+
+  auto qp = makeSolverInfo("qp", (o, "qubits", (a, 0, 1, 4), "couplers", (a, (a, 0, 4), (a, 1, 4)),
+      "num_qubits", 8));
+  qp.qpInfo = extractQpSolverInfo(qp.properties);
+  list.solvers.push_back(qp);
+  list.solvers.push_back(makeSolverInfo("other", (o, "stuff", (a, 1, "two", json::Null()))));
+  return list;
+}
+
+} // namespace {anonymous}
+
+TEST(SolverCacheTest, roundTrip) {
+  const auto url = "test://solver-cache/roundTrip/";
+  SolverCache cache(testing::TempDir(), "token");
+  ASSERT_TRUE(cache.enabled());
+
+  auto list = makeList();
+  cache.store(url, list);
+  auto loaded = cache.load(url);
+  ASSERT_TRUE(!!loaded);
+
+  EXPECT_EQ(list.etag, loaded->etag);
+  ASSERT_EQ(2u, loaded->solvers.size());
+  EXPECT_EQ(list.solvers[0], loaded->solvers[0]);
+  EXPECT_EQ(list.solvers[1], loaded->solvers[1]);
+  EXPECT_FALSE(!!loaded->solvers[1].qpInfo);
+
+  const auto& qpi = loaded->solvers[0].qpInfo;
+  ASSERT_TRUE(!!qpi);
+  EXPECT_EQ(vector<int>({0, 1, 4}), qpi->qubits);
+  auto expectedCouplers = vector<pair<int, int>>{make_pair(0, 4), make_pair(1, 4)};
+  EXPECT_EQ(expectedCouplers, qpi->couplers);
+  EXPECT_EQ(2, qpi->qubitIndices.at(4));
+}
+
+TEST(SolverCacheTest, keepsUnnormalizedCouplers) {
+  const auto url = "test://solver-cache/keepsUnnormalizedCouplers/";
+  SolverCache cache(testing::TempDir(), "token");
+
+  CachedSolverList list;
+  auto si = makeSolverInfo("qp", (o, "qubits", (a, 0, 4), "couplers", (a, (a, 4, 0))));
+  si.qpInfo = extractQpSolverInfo(si.properties);
+  list.solvers.push_back(si);
+  cache.store(url, list);
+
+  auto loaded = cache.load(url);
+  ASSERT_TRUE(!!loaded);
+  ASSERT_EQ(1u, loaded->solvers.size());
+  EXPECT_EQ(si, loaded->solvers[0]);
+}
+
+TEST(SolverCacheTest, misses) {
+  SolverCache cache(testing::TempDir(), "token");
+  cache.store("test://solver-cache/misses/", makeList());
+  EXPECT_FALSE(!!cache.load("test://solver-cache/misses/other/"));
+
+  // another token may see other solvers
+  SolverCache otherToken(testing::TempDir(), "other token");
+  EXPECT_FALSE(!!otherToken.load("test://solver-cache/misses/"));
+  EXPECT_NE(cache.path("test://solver-cache/misses/"), otherToken.path("test://solver-cache/misses/"));
+
+  SolverCache missingDir(testing::TempDir() + "/no-such-solver-cache-dir", "token");
+  missingDir.store("test://solver-cache/misses/", makeList());
+  EXPECT_FALSE(!!missingDir.load("test://solver-cache/misses/"));
+
+  SolverCache disabled("", "token");
+  EXPECT_FALSE(disabled.enabled());
+  EXPECT_FALSE(!!disabled.load("test://solver-cache/misses/"));
+}
+
+TEST(SolverCacheTest, corruptFileMisses) {
+  const auto url = "test://solver-cache/corruptFileMisses/";
+  SolverCache cache(testing::TempDir(), "token");
+  cache.store(url, makeList());
+  ASSERT_TRUE(!!cache.load(url));
+
+  string contents;
+  {
+    std::ifstream in(cache.path(url), std::ios::binary);
+    contents.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+  }
+
+  // every truncation must be rejected
+  for (auto size = 0u; size < contents.size(); size += 7) {
+    ofstream out(cache.path(url), std::ios::binary | std::ios::trunc);
+    out.write(contents.data(), size);
+    out.close();
+    EXPECT_FALSE(!!cache.load(url)) << "size " << size;
+  }
+
+  ofstream out(cache.path(url), std::ios::binary | std::ios::trunc);
+  out << "not a solver cache";
+  out.close();
+  EXPECT_FALSE(!!cache.load(url));
+}
@@ -5,6 +5,10 @@
 #include <condition_variable>
 #include <utility>
 #include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include <gtest/gtest.h>
 
@@ -16,8 +20,15 @@ using std::mutex;
 using std::lock_guard;
 using std::unique_lock;
 using std::ref;
+using std::make_shared;
+using std::shared_ptr;
+using std::string;
+using std::thread;
+using std::unique_ptr;
+using std::vector;
 using std::chrono::milliseconds;
 
+using sapiremote::Task;
 using sapiremote::makeThreadPool;
 
 namespace {
@@ -69,6 +80,32 @@ public:
   }
 };
 
+class Counter {
+  mutable mutex mutex_;
+  mutable condition_variable cv_;
+  int count_;
+
+public:
+  Counter() : count_(0) {}
+
+  void operator()() {
+    lock_guard<mutex> l(mutex_);
+    ++count_;
+    cv_.notify_all();
+  }
+
+  bool waitFor(int count, int millis) {
+    unique_lock<mutex> l(mutex_);
+    return cv_.wait_for(l, milliseconds(millis), [this, count] { return count_ >= count; });
+  }
+};
+
+struct BigTask {
+  char padding[2 * Task::inlineSize];
+  shared_ptr<int> calls;
+  void operator()() { ++*calls; }
+};
+
 } // namespace {anonymous}
 
 TEST(ThreadPoolTest, post) {
@@ -119,3 +156,76 @@ TEST(ThreadPoolTest, invalidNumThreads) {
   EXPECT_THROW(makeThreadPool(0), std::invalid_argument);
   EXPECT_THROW(makeThreadPool(-1), std::invalid_argument);
 }
+
+TEST(ThreadPoolTest, moveOnlyTask) {
+  auto threadPool = makeThreadPool(1);
+  Work w;
+  auto p = unique_ptr<Work*>(new Work*(&w));
+  auto f = [](unique_ptr<Work*>& p) { (**p)(); };
+  threadPool->post(std::bind(f, std::move(p)));
+  w.wait(100);
+  EXPECT_TRUE(w.done());
+}
+
+TEST(ThreadPoolTest, stats) {
+  auto threadPool = makeThreadPool(3);
+  Counter counter;
+  for (auto i = 0; i < 100; ++i) threadPool->post(ref(counter));
+  ASSERT_TRUE(counter.waitFor(100, 1000));
+
+  // counted before the task runs
+  auto stats = threadPool->stats();
+  EXPECT_EQ(0u, stats.queueDepth);
+  EXPECT_EQ(100u, stats.tasksRun);
+  EXPECT_LE(stats.steals, 100u);
+  EXPECT_LT(0u, stats.taskLatency.samples); // sampled
+  EXPECT_GE(100u, stats.taskLatency.samples);
+  EXPECT_GE(stats.taskLatency.maxS, 0.0);
+}
+
+TEST(ThreadPoolTest, queueDepth) {
+  auto threadPool = makeThreadPool(1);
+  Work wBlock;
+  wBlock.awaitNotification();
+  threadPool->post(ref(wBlock));
+  Counter counter;
+  for (auto i = 0; i < 5; ++i) threadPool->post(ref(counter));
+  EXPECT_LE(5u, threadPool->stats().queueDepth);
+  wBlock.notify();
+  EXPECT_TRUE(counter.waitFor(5, 1000));
+}
+
+TEST(ThreadPoolTest, manyProducers) {
+  auto threadPool = makeThreadPool(4);
+  Counter counter;
+  vector<thread> producers;
+  for (auto i = 0; i < 8; ++i) {
+    producers.push_back(thread([&] {
+      for (auto j = 0; j < 1000; ++j) threadPool->post(ref(counter));
+    }));
+  }
+  for (auto i = 0u; i < producers.size(); ++i) producers[i].join();
+  EXPECT_TRUE(counter.waitFor(8000, 5000));
+}
+
+TEST(TaskTest, inlineAndHeap) {
+  auto calls = make_shared<int>(0);
+  auto small = Task([calls] { ++*calls; });
+  BigTask bt;
+  bt.calls = calls;
+  auto big = Task(std::move(bt));
+  EXPECT_EQ(3, calls.use_count());
+
+  auto moved = std::move(small);
+  EXPECT_TRUE(small.empty());
+  moved();
+  big();
+  EXPECT_EQ(2, *calls);
+
+  big = std::move(moved);
+  EXPECT_EQ(2, calls.use_count());
+  big();
+  EXPECT_EQ(3, *calls);
+  big = Task();
+  EXPECT_EQ(1, calls.use_count());
+}
@@ -1,18 +1,45 @@
 //Copyright © 2019 D-Wave Systems Inc.
 //The software is licensed to authorized users only under the applicable license agreement.  See License.txt.
 
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
+#include <boost/foreach.hpp>
+
+#include <exceptions.hpp>
 #include <sapi-service.hpp>
 #include <json.hpp>
 
 #include "test.hpp"
 
+using std::exception_ptr;
+using std::function;
+using std::lock_guard;
+using std::make_shared;
+using std::mutex;
 using std::string;
+using std::thread;
+using std::vector;
 
+using sapiremote::CancelSapiCallbackPtr;
+using sapiremote::FetchAnswerSapiCallbackPtr;
+using sapiremote::NetworkException;
+using sapiremote::AdaptiveLimits;
+using sapiremote::Problem;
+using sapiremote::ProblemManagerLimits;
+using sapiremote::RequestSchedule;
 using sapiremote::SolverInfo;
+using sapiremote::SolversSapiCallbackPtr;
+using sapiremote::StatusSapiCallbackPtr;
 using sapiremote::RemoteProblemInfo;
 
+namespace remotestatuses = sapiremote::remotestatuses;
+
 SolverInfo makeSolverInfo(string id, json::Object properties) {
   SolverInfo solverInfo;
   solverInfo.id = std::move(id);
@@ -53,6 +80,142 @@ RemoteProblemInfo makeProblemInfo(
   return pi;
 }
 
+ProblemManagerLimits pollingLimits(
+    int batchSize, int maxActiveRequests, int minPollIntervalMs, int maxPollIntervalMs, int longPollWaitS) {
+
+  ProblemManagerLimits limits;
+  limits.maxProblemsPerSubmission = batchSize;
+  limits.maxIdsPerStatusQuery = batchSize;
+  limits.maxActiveRequests = maxActiveRequests;
+  limits.answerCacheBytes = 0;
+  limits.maxAnswerPrefetches = 0;
+  limits.minPollIntervalMs = minPollIntervalMs;
+  limits.maxPollIntervalMs = maxPollIntervalMs;
+  limits.longPollWaitS = longPollWaitS;
+  limits.schedule = RequestSchedule();
+  limits.adaptive = AdaptiveLimits();
+  return limits;
+}
+
+StubSapiService::StubSapiService() :
+    nextId_(0),
+    failed_(),
+    fail_(),
+    completeAll_(false) {}
+
+StubSapiService::~StubSapiService() {
+  joinResponders();
+}
+
+void StubSapiService::joinResponders() {
+  for (;;) {
+    vector<thread> responders;
+    {
+      lock_guard<mutex> lock(mutex_);
+      responders.swap(responders_);
+    }
+    if (responders.empty()) break;
+    BOOST_FOREACH( auto& t, responders ) {
+      // the last reference may be dropped by a callback on a responder thread
+      if (t.get_id() == std::this_thread::get_id()) {
+        t.detach();
+      } else {
+        t.join();
+      }
+    }
+  }
+}
+
+void StubSapiService::respond(function<void()> f) {
+  lock_guard<mutex> lock(mutex_);
+  responders_.push_back(thread(std::move(f)));
+}
+
+bool StubSapiService::record(RequestType type) {
+  lock_guard<mutex> lock(mutex_);
+  requests_.push_back(type);
+  if (fail_[type]) ++failed_[type];
+  return fail_[type];
+}
+
+void StubSapiService::respondError(function<void(exception_ptr)> error) {
+  respond([error] { error(std::make_exception_ptr(NetworkException("injected fault"))); });
+}
+
+vector<RemoteProblemInfo> StubSapiService::statusInfo(const vector<string>& ids) {
+  vector<RemoteProblemInfo> info;
+  lock_guard<mutex> lock(mutex_);
+  auto status = completeAll_ ? remotestatuses::COMPLETED : remotestatuses::PENDING;
+  BOOST_FOREACH( const auto& id, ids ) info.push_back(makeProblemInfo(id, "ising", status));
+  return info;
+}
+
+void StubSapiService::fetchSolversImpl(SolversSapiCallbackPtr) {
+  ADD_FAILURE() << "unexpected fetchSolvers";
+}
+
+void StubSapiService::submitProblemsImpl(vector<Problem>& problems, StatusSapiCallbackPtr callback) {
+  if (record(SUBMIT)) {
+    respondError([callback](exception_ptr e) { callback->error(e); });
+    return;
+  }
+  auto info = make_shared<vector<RemoteProblemInfo>>();
+  {
+    lock_guard<mutex> lock(mutex_);
+    for (auto i = 0u; i < problems.size(); ++i) {
+      info->push_back(makeProblemInfo("p" + std::to_string(nextId_++), "ising", remotestatuses::PENDING));
+    }
+  }
+  respond([callback, info] { callback->complete(*info); });
+}
+
+void StubSapiService::multiProblemStatusImpl(const vector<string>& ids, StatusSapiCallbackPtr callback) {
+  if (record(STATUS)) {
+    respondError([callback](exception_ptr e) { callback->error(e); });
+    return;
+  }
+  auto info = make_shared<vector<RemoteProblemInfo>>(statusInfo(ids));
+  respond([callback, info] { callback->complete(*info); });
+}
+
+void StubSapiService::longPollStatusImpl(const vector<string>& ids, int, StatusSapiCallbackPtr callback) {
+  multiProblemStatusImpl(ids, callback);
+}
+
+void StubSapiService::fetchAnswerImpl(const string&, FetchAnswerSapiCallbackPtr callback) {
+  if (record(ANSWER)) {
+    respondError([callback](exception_ptr e) { callback->error(e); });
+  } else {
+    respond([callback] { callback->complete("ising", json::Object()); });
+  }
+}
+
+void StubSapiService::cancelProblemsImpl(const vector<string>&, CancelSapiCallbackPtr) {
+  ADD_FAILURE() << "unexpected cancelProblems";
+}
+
+void StubSapiService::completeAll() {
+  lock_guard<mutex> lock(mutex_);
+  completeAll_ = true;
+}
+
+void StubSapiService::failRequests(RequestType type, bool fail) {
+  lock_guard<mutex> lock(mutex_);
+  fail_[type] = fail;
+}
+
+int StubSapiService::requestCount(RequestType type) const {
+  lock_guard<mutex> lock(mutex_);
+  auto n = 0;
+  BOOST_FOREACH( auto r, requests_ ) if (r == type) ++n;
+  return n;
+}
+
+int StubSapiService::failedRequests(RequestType type) const {
+  lock_guard<mutex> lock(mutex_);
+  return failed_[type];
+}
+
 namespace sapiremote {
 extern char const * const userAgent = "sapi-remote/test";
 
@@ -62,7 +225,7 @@ bool operator==(const SolverInfo& a, const SolverInfo& b) {
 
 bool operator==(const RemoteProblemInfo& a, const RemoteProblemInfo& b) {
   return a.id == b.id && a.status == b.status && a.type == b.type && a.submittedOn == b.submittedOn
-      && a.solvedOn == b.solvedOn;
+      && a.solvedOn == b.solvedOn && a.earliestCompletion == b.earliestCompletion;
 }
 
 bool operator==(const Problem& a, const Problem& b) {
@@ -74,7 +237,8 @@ bool operator==(const Problem& a, const Problem& b) {
 
 void PrintTo(const RemoteProblemInfo& pi, std::ostream* os) {
   *os << "RemoteProblemInfo(id=" << pi.id << ", type=" << pi.type << ", status=" << pi.status
-      << ", submittedOn=" << pi.submittedOn << ", solvedOn=" << pi.solvedOn << ")";
+      << ", submittedOn=" << pi.submittedOn << ", solvedOn=" << pi.solvedOn
+      << ", earliestCompletion=" << pi.earliestCompletion << ")";
 }
 } // namespace sapiremote
 
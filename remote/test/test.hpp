@@ -5,11 +5,16 @@
 #define TEST_TEST_HPP_INCLUDED
 
 #include <exception>
+#include <functional>
+#include <mutex>
 #include <string>
 #include <ostream>
+#include <thread>
+#include <vector>
 
 #include <gmock/gmock.h>
 
+#include <problem-manager.hpp>
 #include <sapi-service.hpp>
 #include <json.hpp>
 
@@ -53,6 +58,63 @@ sapiremote::RemoteProblemInfo makeProblemInfo(
   std::string submittedOn, std::string solvedOn);
 sapiremote::RemoteProblemInfo makeFailedProblemInfo(std::string id, std::string type, std::string errMsg);
 
+// Limits for problem manager tests that care only about batching, concurrency and polling: no answer cache
+// or prefetching, default request schedule, fixed limits.  batchSize applies to submissions and status
+// queries alike.
+sapiremote::ProblemManagerLimits pollingLimits(
+    int batchSize, int maxActiveRequests, int minPollIntervalMs, int maxPollIntervalMs, int longPollWaitS);
+
+// SapiService stand-in for problem manager tests that need a working server rather than mocked calls.
+// Submitted problems get IDs p0, p1, ... and are pending until completeAll.  Long polls are answered
+// right away, like plain status queries.  Answers are empty objects.  Requests of any type can be made to fail
+// with a network error.  Every response comes from a thread of its own, like real HTTP responses.
+class StubSapiService : public sapiremote::SapiService {
+public:
+  enum RequestType { SUBMIT, STATUS, ANSWER, NUM_REQUEST_TYPES };
+
+private:
+  mutable std::mutex mutex_;
+  std::vector<std::thread> responders_;
+  std::vector<RequestType> requests_;
+  int nextId_;
+  int failed_[NUM_REQUEST_TYPES];
+  bool fail_[NUM_REQUEST_TYPES];
+  bool completeAll_;
+
+  void respond(std::function<void()> f);
+  // returns true if the request must fail
+  bool record(RequestType type);
+  void respondError(std::function<void(std::exception_ptr)> error);
+  std::vector<sapiremote::RemoteProblemInfo> statusInfo(const std::vector<std::string>& ids);
+
+  virtual void fetchSolversImpl(sapiremote::SolversSapiCallbackPtr callback);
+  virtual void submitProblemsImpl(
+      std::vector<sapiremote::Problem>& problems, sapiremote::StatusSapiCallbackPtr callback);
+  virtual void multiProblemStatusImpl(
+      const std::vector<std::string>& ids, sapiremote::StatusSapiCallbackPtr callback);
+  virtual void longPollStatusImpl(
+      const std::vector<std::string>& ids, int waitS, sapiremote::StatusSapiCallbackPtr callback);
+  virtual void fetchAnswerImpl(const std::string& id, sapiremote::FetchAnswerSapiCallbackPtr callback);
+  virtual void cancelProblemsImpl(
+      const std::vector<std::string>& ids, sapiremote::CancelSapiCallbackPtr callback);
+  virtual sapiremote::SapiServiceStats statsImpl() const { return sapiremote::SapiServiceStats(); }
+
+public:
+  StubSapiService();
+  ~StubSapiService();
+
+  // responders may start new requests through their callbacks; joins until none are left
+  void joinResponders();
+
+  void completeAll();
+
+  // requests of the given type fail with a network error while set
+  void failRequests(RequestType type, bool fail);
+
+  int requestCount(RequestType type) const;
+  int failedRequests(RequestType type) const;
+};
+
 namespace sapiremote {
 bool operator==(const SolverInfo& a, const SolverInfo& b);
 bool operator==(const RemoteProblemInfo& a, const RemoteProblemInfo& b);